@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "factory.hpp"
+#include "uid.hpp"
+
+namespace fmk {
+
+/// An immutable copy of a factory. Its items and machines are split in chunks, which are shared
+/// with the previous snapshot whenever they didn't change, so that a snapshot only takes memory
+/// for the chunks that changed and a pointer for each of the others.
+///
+/// Chunks end after the entries whose UID hashes to a multiple of `average_chunk_size` rather
+/// than every fixed amount of entries, so that inserting or erasing an entry only changes the
+/// chunk it is in instead of shifting all the ones after it.
+class FactorySnapshot {
+public:
+    static constexpr std::size_t average_chunk_size = 32;
+
+    /// Takes a snapshot of a factory, sharing the chunks that are the same as in `previous`.
+    explicit FactorySnapshot(const Factory& factory, const FactorySnapshot* previous = nullptr);
+
+    /// Makes a copy of the factory as it was when the snapshot was taken.
+    Factory restore() const;
+
+private:
+    template<typename T> using ChunkT = std::vector<std::pair<Uid, T>>;
+    template<typename T> using ChunksT = std::vector<std::shared_ptr<const ChunkT<T>>>;
+
+    template<typename T>
+    static ChunksT<T> make_chunks(const util::UidMap<T>& entries, const ChunksT<T>* previous);
+
+    ChunksT<Item> items;
+    ChunksT<Machine> machines;
+};
+
+/// The states a factory went through while being edited, to undo and redo edits.
+class EditHistory {
+public:
+    /// A state of the factory and everything needed to go back to it.
+    struct Step {
+        FactorySnapshot factory;
+        /// Restored along with the factory, so that UIDs released by later edits aren't handed
+        /// out while they are in use again.
+        UidPool uid_pool;
+        /// The simulation results of the factory in this state, so that going back to it doesn't
+        /// simulate it again. Null once the step is too far from the current one.
+        std::shared_ptr<const Factory::Cache> cache;
+    };
+
+    /// @param max_steps How many steps are kept. The oldest ones are dropped past that.
+    /// @param max_cached_results How many steps around the current one keep their simulation
+    /// results. Results can take much more memory than the factory itself.
+    explicit EditHistory(std::size_t max_steps = 500, std::size_t max_cached_results = 16);
+
+    /// Forgets every step and starts over from the given state.
+    void reset(const Factory& factory,
+               const UidPool& uid_pool,
+               std::shared_ptr<const Factory::Cache> cache);
+    /// Records the state after an edit, dropping the steps that could be redone.
+    void record(const Factory& factory,
+                const UidPool& uid_pool,
+                std::shared_ptr<const Factory::Cache> cache);
+
+    bool can_undo() const { return current > 0; }
+    bool can_redo() const { return current + 1 < steps.size(); }
+    /// Goes back to the previous step, which must exist.
+    const Step& undo();
+    /// Goes forward to the next step, which must exist.
+    const Step& redo();
+
+    /// Gives the current step back its simulation results, after they were dropped and had to be
+    /// generated again.
+    void set_current_cache(std::shared_ptr<const Factory::Cache> cache);
+
+private:
+    /// Drops the simulation results of the steps too far from the current one.
+    void drop_distant_caches();
+
+    std::size_t max_steps;
+    std::size_t max_cached_results;
+    std::deque<Step> steps;
+    std::size_t current = 0;
+};
+
+} // namespace fmk
\ No newline at end of file
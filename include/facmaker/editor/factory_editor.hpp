@@ -1,17 +1,41 @@
 #pragma once
 
 #include <imgui.h>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
+#include "editor/edit_history.hpp"
+#include "editor/imnodes_ids.hpp"
+#include "editor/item_search.hpp"
 #include "factory.hpp"
+#include "io/factory_document.hpp"
+#include "io/module_library.hpp"
+#include "io/plot_export.hpp"
+#include "io/recipe_catalog.hpp"
+#include "io/simulation_cache.hpp"
+#include "sim/monte_carlo.hpp"
+#include "sim/stop_condition.hpp"
+#include "sim/throughput.hpp"
+#include "util/arena.hpp"
+#include "util/background_job.hpp"
 
 namespace imnodes {
 
 struct EditorContext;
 
 }
+namespace pfd {
+
+class open_file;
+class save_file;
+
+} // namespace pfd
 namespace fmk {
 
 class FactoryEditor {
@@ -31,20 +55,182 @@ public:
 private:
     void update_processing_graph();
     void update_item_statistics();
+    void update_plot_export();
+    void update_time_to_target();
+    void update_monte_carlo();
+    void update_recipes();
 
-    void parse_factory_json(std::istream& input);
-    void output_factory_json(std::ostream& output) const;
+    /// Polls the file dialogs and background file jobs, applying their results once finished.
+    void update_file_jobs();
+    void start_open_job(std::string path);
+    void start_import_job(std::string json);
+    void start_save_job(std::string path);
+    void start_export_job(std::string path);
+    /// Lays out the nodes of the factory in the background, see `layout_factory()`.
+    void start_layout_job();
 
+    /// Replaces the factory being edited. The document must contain its simulation results.
+    void apply_document(io::FactoryDocument document);
+    /// Retrieves the positions of the nodes from the node editor.
+    io::NodePositionsT node_positions() const;
+    /// Moves the nodes that are in the factory to the given positions in the node editor.
+    void apply_node_positions(const io::NodePositionsT& positions);
+
+    /// Simulates the factory after an edit and records the edit in the history.
     void regenerate_cache();
+    /// Starts simulating a snapshot of the factory as it is, or loading its results from the
+    /// simulation cache, cancelling the simulation of any previous edit. The results of the
+    /// previous state are shown until it finishes.
+    /// @param is_for_history Whether to give the results to the current step of the history.
+    void start_simulation(bool is_for_history);
+    /// Shows the results of `simulation.job` once it finishes, and queues new ones to be stored
+    /// in the simulation cache.
+    void update_simulation();
+    void undo();
+    void redo();
+    /// Replaces the factory with the state of a step of the history.
+    void restore(const EditHistory::Step& step);
+    /// Drops the Monte Carlo results after the factory changed, since they don't match it anymore.
+    void discard_monte_carlo();
+
+    /// Moves a node to the top left corner of the visible part of the node editor.
+    void place_in_view(Uid node_uid);
+
+    /// Keeps the position of a machine or item node that stops being drawn, so that it shows up
+    /// at the same place if it comes back (e.g. by undoing its removal).
+    void remember_node_position(Uid node_uid);
+
+    /// Removes an item from the factory, releasing its UIDs. It must not be used by any machine.
+    void erase_item(Uid item_uid);
+    /// Makes a UID that is not used anymore available again.
+    void release_uid(Uid uid);
 
     struct Cache {
-        Factory::Cache factory_cache;
+        /// Shared with background jobs, so that they can use it while the factory is edited.
+        std::shared_ptr<const Factory::Cache> factory_cache = std::make_shared<Factory::Cache>();
+        /// Reused between regenerations. The arena of the previous cache is only reused once
+        /// nothing (e.g. a background job) uses that cache anymore.
+        util::ArenaPool arenas;
     } cache;
 
     Factory factory;
+    /// How long the factory is simulated, as given by its file. Kept apart from the cache so that
+    /// simulations after edits don't depend on how long the one they replace went.
+    std::size_t ticks_to_simulate = io::FactoryDocument().ticks_to_simulate;
+    io::SimulationCache simulation_cache;
+    io::ModuleLibrary module_library;
     UidPool uid_pool;
+    EditHistory history;
     imnodes::EditorContext* imnodes_ctx;
+    ImnodesIds imnodes_ids;
+    /// Synced with the items of the factory after every edit.
+    ItemSearchIndex item_search;
+    /// Synced with the machines of the factory after every edit, so that nodes and links are
+    /// drawn right away instead of once the edit is simulated.
+    ItemGraph item_graph;
+    ItemFilter item_list_filter;
+    io::NodePositionsT forgotten_node_positions;
     std::optional<MachineEditor> new_machine;
+
+    std::unique_ptr<pfd::open_file> open_dialog;
+    std::unique_ptr<pfd::save_file> save_dialog;
+    std::unique_ptr<pfd::save_file> export_dialog;
+    std::unique_ptr<pfd::open_file> embed_dialog;
+    std::unique_ptr<pfd::open_file> recipe_dialog;
+    /// Loads, parses and simulates a factory. Yields nothing if it could not be loaded.
+    std::optional<util::BackgroundJob<std::optional<io::FactoryDocument>>> load_job;
+    /// Saves a factory or exports its plots. Yields whether the file could be written.
+    std::optional<util::BackgroundJob<bool>> save_job;
+    /// Summarizes a factory file to embed it as a module. Yields null if it couldn't be.
+    std::optional<util::BackgroundJob<std::shared_ptr<const sim::ModuleSummary>>> module_job;
+    /// Loads a recipe file. Yields null if it could not be loaded.
+    std::optional<util::BackgroundJob<std::shared_ptr<const io::RecipeCatalog>>> recipe_job;
+    /// Lays out the nodes of a snapshot of the factory. Yields their positions.
+    std::optional<util::BackgroundJob<io::NodePositionsT>> layout_job;
+    /// The positions laid out so far by `layout_job`, to show the nodes settle while it runs.
+    struct LayoutUpdates {
+        std::mutex mutex;
+        std::optional<io::NodePositionsT> positions;
+    };
+    std::shared_ptr<LayoutUpdates> layout_updates = std::make_shared<LayoutUpdates>();
+    struct Simulation {
+        /// The results of a snapshot of the factory.
+        struct Result {
+            Factory factory;
+            /// Null if the simulation was cancelled.
+            std::shared_ptr<const Factory::Cache> cache;
+            std::size_t ticks_to_simulate = 0;
+            /// Whether the results were simulated rather than loaded from `simulation_cache`.
+            bool is_new = false;
+        };
+        /// Simulates the factory after an edit, see `start_simulation()`.
+        std::optional<util::BackgroundJob<Result>> job;
+        bool is_for_history = false;
+    } simulation;
+    /// Stores simulation results in `simulation_cache`, one entry at a time.
+    std::optional<util::BackgroundJob<void>> store_job;
+    /// The latest results simulated while `store_job` was running, stored once it finishes.
+    /// Results in between are dropped, since edits rarely come back to them.
+    std::optional<Simulation::Result> pending_store;
+
+    struct PlotExport {
+        io::PlotExportOptions options;
+        /// Whether to export all items or only the ones in `items`.
+        bool all_items = true;
+        std::unordered_set<Uid> items;
+        bool as_csv = true;
+    } plot_export;
+
+    struct TimeToTarget {
+        sim::StopCondition condition = sim::StopCondition::reaches(Uid(Uid::INVALID_VALUE), 100);
+        std::size_t max_ticks = 6000;
+        /// Simulates a snapshot of the factory until the condition is met. Yields a description
+        /// of the result.
+        std::optional<util::BackgroundJob<std::string>> job;
+        std::string result;
+    } time_to_target;
+
+    struct MonteCarlo {
+        std::size_t replicas = 100;
+        std::uint64_t seed = 0;
+        /// Simulates replicas of a snapshot of the factory for `ticks_to_simulate`.
+        std::optional<util::BackgroundJob<sim::MonteCarloResult>> job;
+        /// Set if the factory was edited while `job` was running, to throw its result away.
+        bool is_job_outdated = false;
+        /// The results for the factory as it is, drawn along with the plots of its items.
+        std::optional<sim::MonteCarloResult> result;
+    } monte_carlo;
+
+    struct Throughput {
+        bool is_shown = false;
+        std::size_t window = 1200;
+        bool per_second = false;
+        /// The throughput of the items shown so far, for the results in `cache` and `window`.
+        std::unordered_map<Uid, sim::ThroughputSeries> series;
+        std::weak_ptr<const Factory::Cache> cache;
+        /// The items that came into view without their throughput during the frame, all
+        /// calculated by the same job.
+        std::vector<Uid> missing;
+        /// Simulates a snapshot of the factory for the throughput of the missing items.
+        std::optional<util::BackgroundJob<std::vector<sim::ThroughputSeries>>> job;
+        /// The results and window that `job` was started for, to throw its series away if they
+        /// changed since.
+        std::weak_ptr<const Factory::Cache> job_cache;
+        std::size_t job_window = 0;
+    } throughput;
+
+    struct Recipes {
+        std::shared_ptr<const io::RecipeCatalog> catalog;
+        std::string query;
+        /// The recipes whose name contains `query`, ignoring case, or all of them.
+        std::vector<io::RecipeCatalog::Index> matches;
+        bool are_matches_outdated = true;
+    } recipes;
+
+    bool show_plot_export_window = false;
+    bool show_time_to_target_window = false;
+    bool show_monte_carlo_window = false;
+    bool show_recipes_window = false;
     bool show_imgui_demo_window = false;
     bool show_implot_demo_window = false;
 };
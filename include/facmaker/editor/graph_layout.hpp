@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+#include "factory.hpp"
+#include "io/factory_document.hpp"
+
+namespace fmk {
+
+struct GraphLayoutOptions {
+    /// The horizontal space between layers.
+    float layer_gap = 80.f;
+    /// The vertical space between the nodes of a layer.
+    float node_gap = 30.f;
+    /// How many times the layers are reordered to reduce crossings, alternating between going
+    /// forward and backward.
+    std::size_t ordering_sweeps = 8;
+    std::size_t refinement_iterations = 64;
+    /// The threads to lay out with, or one per hardware thread if 0.
+    std::size_t worker_count = 0;
+    /// Called with the positions laid out so far once the nodes are ordered and every few
+    /// refinement iterations, from the thread running the layout, to show the nodes settle.
+    std::function<void(const io::NodePositionsT&)> on_update;
+};
+
+/// Lays out the nodes of a factory (its machines and its input and output items) from left to
+/// right along the flow of items, in layers:
+/// 1. Links that go back (e.g. recycling loops) are reversed, so that there are no cycles.
+/// 2. Nodes are put one layer after the nodes they get items from, and inputs right before the
+///    first machine that takes them.
+/// 3. Layers are reordered a few times by the average position of the neighbours of their nodes,
+///    which untangles most of the crossings.
+/// 4. Links pull the nodes they connect towards each other like springs, while the nodes of each
+///    layer keep their order and don't overlap.
+/// Internal items aren't nodes, but are laid out like hidden ones so that the machines they
+/// connect end up in consecutive layers.
+/// @param progress Receives the stage of the layout, and can cancel it, in which case the
+/// positions laid out so far are returned.
+/// @returns The top-left corner of every node, in grid space.
+io::NodePositionsT layout_factory(const Factory& factory,
+                                  const GraphLayoutOptions& options = {},
+                                  util::JobProgress* progress = nullptr);
+
+} // namespace fmk
\ No newline at end of file
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <map>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+
+#include "uid.hpp"
+
+namespace fmk {
+
+/// Maps the UIDs of the elements drawn in the node editor to imnodes' int IDs, which are only
+/// assigned once an element is drawn. IDs are never reused, so that the state imnodes keeps for a
+/// forgotten element (e.g. its position) doesn't end up applied to another one.
+class ImnodesIds {
+public:
+    /// Returns the imnodes ID of a node or attribute, assigning one if it doesn't have any yet.
+    int id(Uid uid);
+    /// Returns the imnodes ID of a node or attribute, if it has been assigned one.
+    std::optional<int> find(Uid uid) const;
+    /// Returns the imnodes ID of the link between two attributes, assigning one if it doesn't have
+    /// any yet. Links keep their ID across frames as long as their attributes aren't forgotten.
+    int link_id(Uid start_attribute, Uid end_attribute);
+    /// Returns the UID of the node or attribute with the given imnodes ID, if any.
+    std::optional<Uid> uid(int id) const;
+
+    /// Drops the ID of a node or attribute that won't be drawn anymore, along with the IDs of the
+    /// links to it.
+    void forget(Uid uid);
+    void clear();
+
+private:
+    std::unordered_map<Uid, int> ids;
+    std::unordered_map<int, Uid> uids;
+    std::map<std::pair<Uid::ValueT, Uid::ValueT>, int> link_ids;
+    int next_id = 0;
+};
+
+} // namespace fmk
\ No newline at end of file
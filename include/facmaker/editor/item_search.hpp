@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "item.hpp"
+#include "uid.hpp"
+#include "util/uid_map.hpp"
+
+namespace fmk {
+
+/// Finds the items whose name contains every word of a search, ignoring case, without going
+/// through all of them. Every substring of up to 3 characters of every name is indexed, so words
+/// that short are looked up directly, and longer ones only check the names that contain their
+/// rarest trigram.
+class ItemSearchIndex {
+public:
+    /// Indexes the items that were added or renamed since the last call, and drops the ones that
+    /// were removed.
+    void sync(const util::UidMap<Item>& items);
+
+    /// Appends the items that match a search to `out`, in the order they were indexed. An empty
+    /// search matches every item.
+    void search(std::string_view query, std::vector<Uid>& out) const;
+
+    /// Changes every time the index does, so that search results can be kept until then.
+    [[nodiscard]] std::size_t generation() const { return generation_; }
+
+private:
+    struct Entry {
+        Uid uid;
+        /// Lowercase, to match searches in any case.
+        std::string name;
+        bool is_removed = false;
+    };
+
+    void add(Uid uid, std::string_view name);
+    void index(std::uint32_t entry_i);
+    void unindex(std::uint32_t entry_i);
+    /// Renumbers the entries left once enough of them are removed.
+    void compact();
+
+    std::vector<Entry> entries;
+    std::unordered_map<Uid, std::uint32_t> entry_of;
+    /// The entries whose name contains a substring of up to 3 characters, in ascending order.
+    std::unordered_map<std::uint32_t, std::vector<std::uint32_t>> postings;
+    std::size_t removed_count = 0;
+    std::size_t generation_ = 0;
+};
+
+/// The items matching a search typed in a widget, searched again only when the search or the
+/// index change.
+struct ItemFilter {
+    std::string query;
+    std::vector<Uid> items;
+
+    /// Returns the items matching `query`.
+    const std::vector<Uid>& refresh(const ItemSearchIndex& index);
+
+private:
+    std::string searched_query;
+    std::size_t searched_generation = SIZE_MAX;
+};
+
+} // namespace fmk
\ No newline at end of file
@@ -1,95 +1,226 @@
 #pragma once
 
 #include <chrono>
+#include <cstdint>
 #include <functional>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
+#include <span>
 #include <string>
 #include <unordered_map>
-#include <unordered_set>
 #include <vector>
 
 #include "item.hpp"
+#include "quantity.hpp"
+#include "sim/stop_condition.hpp"
 #include "uid.hpp"
+#include "util/arena.hpp"
+#include "util/quantity_log.hpp"
 #include "util/quantity_plot.hpp"
+#include "util/uid_map.hpp"
 
 namespace fmk {
 
 namespace util {
 
-using ticks = std::chrono::duration<int, std::ratio<1, 20>>;
+using ticks = std::chrono::duration<TickCount, std::ratio<1, 20>>;
+
+class JobProgress;
 
 }
 
+/// How the operation time of a machine varies from one operation to the next. Only Monte Carlo
+/// simulations take it into account, deterministic ones always take `Machine::op_time`.
+struct OpTimeDistribution {
+    enum class Type : int { Fixed, Uniform, Normal } type = Type::Fixed;
+    /// The largest difference from `Machine::op_time` with `Uniform`, or the standard deviation
+    /// with `Normal`. Sampled operation times are rounded and take at least a tick.
+    util::ticks spread{0};
+
+    bool operator==(const OpTimeDistribution&) const = default;
+};
+
 struct Machine {
     std::string name;
 
     std::vector<ItemStream> inputs;
     std::vector<ItemStream> outputs;
     util::ticks op_time;
+    OpTimeDistribution op_time_distribution{};
+
+    bool operator==(const Machine&) const = default;
 };
 
-struct ItemNode {
+/// The machines linked to each item of a factory, stored as compressed sparse rows: the links of
+/// every item are contiguous, and all of them are stored in two arrays.
+class ItemGraph {
+public:
     struct Link {
         Uid machine;
+        /// The index of the item in the inputs or outputs of the machine.
         std::size_t io_index;
     };
 
-    struct LinkHash {
-        std::size_t operator()(const ItemNode::Link& link) const noexcept {
-            return link.io_index ^ (link.machine.value << 1);
-        }
-    };
-
-    std::unordered_set<Link, LinkHash> inputs;
-    std::unordered_set<Link, LinkHash> outputs;
+    ItemGraph() = default;
+    /// Builds the graph of the given machines with two passes over their streams, one counting the
+    /// links of each item and one filling them in.
+    explicit ItemGraph(const util::UidMap<Machine>& machines);
+
+    /// The machines that take an item as an input, in the order they appear in the factory.
+    std::span<const Link> consumers(Uid item) const {
+        return row(item, consumer_offsets, consumer_links);
+    }
+    /// The machines that give an item as an output, in the order they appear in the factory.
+    std::span<const Link> producers(Uid item) const {
+        return row(item, producer_offsets, producer_links);
+    }
+
+private:
+    std::span<const Link> row(Uid item,
+                              const std::vector<std::uint32_t>& offsets,
+                              const std::vector<Link>& links) const;
+
+    /// The row of each item that is linked to any machine.
+    util::UidMap<std::uint32_t> rows;
+    /// The links of row `i` are in `[offsets[i], offsets[i + 1])`.
+    std::vector<std::uint32_t> consumer_offsets;
+    std::vector<Link> consumer_links;
+    std::vector<std::uint32_t> producer_offsets;
+    std::vector<Link> producer_links;
 };
 
-inline bool operator==(const ItemNode::Link& a, const ItemNode::Link& b) {
-    return a.machine == b.machine && a.io_index == b.io_index;
-}
-
 struct Factory;
 struct Factory {
-    using MachinesT = std::unordered_map<Uid, Machine>;
-    using ItemsT = std::unordered_map<Uid, Item>;
+    using MachinesT = util::UidMap<Machine>;
+    using ItemsT = util::UidMap<Item>;
 
     /// The items being processed in this factory.
     ItemsT items;
-    /// The machines (processing nodes) in this factory.
+    /// The machines (processing nodes) in this factory. Machines earlier in this container get to
+    /// consume contested items first.
     MachinesT machines;
 
     class Cache {
     public:
         using ItemUidsT = std::vector<Uid>;
-        using ItemNodesT = std::unordered_map<Uid, ItemNode>;
-        using QuantityPlotsT = std::unordered_map<Uid, util::QuantityPlot>;
+        using QuantityPlotsT = std::pmr::unordered_map<Uid, util::QuantityPlot>;
+        using QuantityLogsT = std::pmr::unordered_map<Uid, util::QuantityLog>;
+
+        /// Where a simulation stopped because the quantity of an item didn't fit in `Quantity`.
+        struct Overflow {
+            Uid item;
+            std::size_t tick;
+        };
 
         Cache() = default;
 
-        /// A generated container with quantity plots for all the items in this factory.
-        const QuantityPlotsT& plots() const { return _plots; }
+        /// The plot of an item of this factory, with its quantity at every tick. Simulations only
+        /// record when the quantity of each item changes, so the plot is built the first time it
+        /// is needed, and then kept for as long as the cache. Safe to call from several threads.
+        const util::QuantityPlot& plot(Uid item) const;
+        /// Like `plot()`, but without keeping the plot in the cache, for one-off uses (e.g.
+        /// exporting every item) that shouldn't keep all plots in memory. Cheap if the plot was
+        /// loaded from a file or has already been built.
+        util::QuantityPlot make_plot(Uid item) const;
+        /// Writes the quantities of an item from `first_tick` on into `out`, one per tick,
+        /// without building its plot. Ticks after the last one simulated have its quantity.
+        void copy_quantities(Uid item, std::size_t first_tick, std::span<Quantity> out) const;
+        /// The quantity of an item at the end of a tick, without building its plot.
+        Quantity quantity_at(Uid item, std::size_t tick) const;
+        /// The highest quantity of an item, without building its plot.
+        Quantity max_quantity(Uid item) const;
+        /// Whether an item was simulated, which the other functions about items require. Items
+        /// added to the factory since then aren't.
+        bool contains(Uid item) const;
         /// A generated container with all the input item names in this factory.
         const ItemUidsT& inputs() const { return _inputs; }
         /// A generated container with all the output item names in this factory.
         const ItemUidsT& outputs() const { return _outputs; }
-        /// A generated map of the relationship of items with the machines in this factory.
-        const ItemNodesT& item_nodes() const { return _item_nodes; }
+        /// A generated graph of the relationship of items with the machines in this factory.
+        const ItemGraph& item_graph() const { return _item_graph; }
         /// The amount of ticks simulated for the item processing.
         std::size_t ticks_simulated() const { return _ticks_simulated; }
+        /// Set if the simulation stopped early because a quantity overflowed, in which case the
+        /// plots keep the values they had at that tick until the end.
+        const std::optional<Overflow>& overflow() const { return _overflow; }
+        /// Set if the simulation ended early because one of its stop conditions was met, in
+        /// which case `ticks_simulated()` only goes up to the end of the tick where it was met.
+        const std::optional<sim::StopResult>& stop() const { return _stop; }
+        /// Whether the simulation was cancelled before it finished, in which case
+        /// `ticks_simulated()` only goes up to where it got.
+        bool cancelled() const { return _cancelled; }
 
     private:
-        Cache(const Factory&, std::size_t ticks_to_simulate);
+        Cache(const Factory&,
+              std::size_t ticks_to_simulate,
+              std::shared_ptr<util::Arena> arena,
+              std::span<const sim::StopCondition> stop_conditions,
+              util::JobProgress* progress);
+        Cache(const Factory&,
+              QuantityPlotsT plots,
+              std::size_t ticks_simulated,
+              std::optional<Overflow> overflow);
         friend class Factory;
 
+        void classify_items(const Factory&);
+
+        /// The plots and logs of the items, and the arena they might be allocated from, which
+        /// must outlive them. Shared between copies of the cache.
+        struct Plots {
+            Plots() = default;
+            Plots(std::shared_ptr<util::Arena> arena, QuantityLogsT logs, QuantityPlotsT plots) :
+                arena(std::move(arena)), logs(std::move(logs)), plots(std::move(plots)) {}
+
+            std::shared_ptr<util::Arena> arena;
+            /// How the quantity of every simulated item changed. Empty if the plots were given to
+            /// `make_cache()` instead.
+            QuantityLogsT logs;
+            /// Guards `plots` and the arena, which plots built from the logs are allocated from.
+            std::mutex mutex;
+            QuantityPlotsT plots;
+        };
+        /// Calls `f` with the plot of an item if it has one, or with its log otherwise, while
+        /// holding the lock of the plots.
+        template<typename F> decltype(auto) visit_item(Uid item, F&& f) const;
+
         ItemUidsT _inputs;
         ItemUidsT _outputs;
-        ItemNodesT _item_nodes;
-        QuantityPlotsT _plots;
+        ItemGraph _item_graph;
+        std::shared_ptr<Plots> _plots = std::make_shared<Plots>();
         std::size_t _ticks_simulated = 0;
+        std::optional<Overflow> _overflow;
+        std::optional<sim::StopResult> _stop;
+        bool _cancelled = false;
     };
 
-    Cache generate_cache(std::size_t ticks_to_simulate) const {
-        return {*this, ticks_to_simulate};
+    /// Simulates the factory.
+    /// @param arena Where to allocate the plots and the temporary data of the simulation. A new
+    /// arena is used if null.
+    /// @param stop_conditions Conditions that end the simulation before `ticks_to_simulate`.
+    /// @param progress Receives the fraction of the ticks simulated so far. Cancelling it ends the
+    /// simulation early, keeping the ticks that were already simulated.
+    Cache generate_cache(std::size_t ticks_to_simulate,
+                         std::shared_ptr<util::Arena> arena = nullptr,
+                         std::span<const sim::StopCondition> stop_conditions = {},
+                         util::JobProgress* progress = nullptr) const {
+        return {*this, ticks_to_simulate, std::move(arena), stop_conditions, progress};
     };
+
+    /// Creates a cache for this factory from plots that were simulated beforehand (e.g. loaded
+    /// from a file) instead of simulating them again. `plots` must contain a plot for every item.
+    Cache make_cache(Cache::QuantityPlotsT plots,
+                     std::size_t ticks_simulated,
+                     std::optional<Cache::Overflow> overflow = std::nullopt) const {
+        return {*this, std::move(plots), ticks_simulated, overflow};
+    }
 };
 
+/// Renumbers all the UIDs of a factory (items, machines, streams and attributes) so that they are
+/// contiguous, in the order they appear in it, and replaces `uid_pool` with one that continues
+/// after them. Used when saving, so that files don't carry the gaps left by deleted elements.
+/// @returns The new UID of every UID that was renumbered.
+std::unordered_map<Uid, Uid> compact_uids(Factory& factory, UidPool& uid_pool);
+
 } // namespace fmk
\ No newline at end of file
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <span>
+#include <string_view>
+
+namespace fmk {
+
+/// Runs a command given through the command line without opening a window.
+/// @returns The exit code of the process.
+int run_headless(std::span<const std::string_view> args);
+
+} // namespace fmk
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <filesystem>
+#include <optional>
+#include <ostream>
+
+#include "io/factory_document.hpp"
+
+namespace fmk::io {
+
+/// Binary factory files are versioned; files with another version than this are rejected.
+constexpr std::uint32_t binary_format_version = 1;
+
+/// File extension used for binary factory files.
+constexpr const char* binary_format_extension = ".fmkb";
+
+/// Checks whether the file at `path` starts with the binary factory file signature.
+bool is_binary_factory_file(const std::filesystem::path& path);
+
+/// Writes a factory in the binary format.
+/// If `cache` is given, its plots are stored as well so that they don't have to be simulated again
+/// when the file is loaded. `cache_factory` is the factory the cache was simulated for, if it
+/// isn't `factory`: it must have the same items in the same order under other UIDs (e.g. before
+/// `compact_uids()`).
+void write_factory_binary(std::ostream& out,
+                          const Factory& factory,
+                          const UidPool& uid_pool,
+                          const NodePositionsT& node_positions,
+                          std::size_t ticks_to_simulate,
+                          const Factory::Cache* cache = nullptr,
+                          const Factory* cache_factory = nullptr);
+
+/// Reads a binary factory file by memory-mapping it. Stored plots are used in place, without
+/// copying them out of the mapping.
+/// @returns The document read, or nullopt if the file is not a valid binary factory file.
+std::optional<FactoryDocument> read_factory_binary(const std::filesystem::path& path);
+
+} // namespace fmk::io
\ No newline at end of file
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <optional>
+#include <unordered_map>
+
+#include "factory.hpp"
+#include "uid.hpp"
+
+namespace fmk::io {
+
+/// The position of a node in the node editor, in grid space.
+struct NodePosition {
+    float x;
+    float y;
+};
+
+using NodePositionsT = std::unordered_map<Uid, NodePosition>;
+
+/// Everything stored in a factory file.
+struct FactoryDocument {
+    Factory factory;
+    UidPool uid_pool{Uid(Uid::INVALID_VALUE + 1)};
+    std::size_t ticks_to_simulate = 6000;
+    /// Positions of the nodes that had one stored in the file.
+    NodePositionsT node_positions;
+    /// The simulation results stored alongside the factory, if any.
+    std::optional<Factory::Cache> cache;
+};
+
+} // namespace fmk::io
\ No newline at end of file
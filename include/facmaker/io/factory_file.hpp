@@ -0,0 +1,28 @@
+#pragma once
+
+#include <filesystem>
+#include <optional>
+
+#include "io/factory_document.hpp"
+#include "util/background_job.hpp"
+
+namespace fmk::io {
+
+/// Loads a factory file, detecting whether it is in the JSON or the binary format.
+/// Progress is reported through `progress` if given.
+/// @returns The document loaded, or nullopt if it could not be loaded.
+std::optional<FactoryDocument> load_factory_file(const std::filesystem::path& path,
+                                                 util::JobProgress* progress = nullptr);
+
+/// Saves a factory file, in the binary format if `path` has the binary format extension or in the
+/// JSON format otherwise. `cache` is only used by the binary format. The UIDs of the factory are
+/// compacted in the file, which doesn't affect the factory given.
+/// @returns Whether the file could be written.
+bool save_factory_file(const std::filesystem::path& path,
+                       const Factory& factory,
+                       const UidPool& uid_pool,
+                       const NodePositionsT& node_positions,
+                       std::size_t ticks_to_simulate,
+                       const Factory::Cache* cache = nullptr);
+
+} // namespace fmk::io
\ No newline at end of file
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <istream>
+#include <optional>
+#include <ostream>
+
+#include "io/factory_document.hpp"
+
+namespace fmk::io {
+
+/// Parses a factory in the JSON format. Errors are logged as they are found.
+/// @returns The document parsed, or nullopt if there were any errors.
+std::optional<FactoryDocument> parse_factory_json(std::istream& input);
+
+/// Writes a factory in the JSON format. Node positions are only written for machines and
+/// input/output items; nodes without a position are written at the origin.
+void write_factory_json(std::ostream& output,
+                        const Factory& factory,
+                        const UidPool& uid_pool,
+                        const NodePositionsT& node_positions,
+                        std::size_t ticks_to_simulate);
+
+} // namespace fmk::io
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "sim/module_summary.hpp"
+#include "util/background_job.hpp"
+
+namespace fmk::io {
+
+/// The summaries of the factory files embedded as modules. Each file is only simulated once,
+/// however many times it is embedded, until it changes. Safe to use from several threads.
+class ModuleLibrary {
+public:
+    /// The summary of the module in a factory file, which is loaded and summarized if it wasn't
+    /// before or if it changed since. Modules are simulated for as many ticks as their file says.
+    /// @returns The summary, or null if the file couldn't be loaded or summarized.
+    std::shared_ptr<const sim::ModuleSummary> get(const std::filesystem::path& path,
+                                                  util::JobProgress* progress = nullptr);
+
+private:
+    struct Entry {
+        std::filesystem::file_time_type last_write_time;
+        std::shared_ptr<const sim::ModuleSummary> summary;
+    };
+
+    std::mutex mutex;
+    /// By canonical path.
+    std::unordered_map<std::string, Entry> entries;
+};
+
+} // namespace fmk::io
\ No newline at end of file
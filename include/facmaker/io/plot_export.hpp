@@ -0,0 +1,70 @@
+#pragma once
+
+#include <ostream>
+#include <span>
+#include <string>
+
+#include "factory.hpp"
+
+namespace fmk::io {
+
+struct PlotExportOptions {
+    enum class Downsampling : int {
+        /// Export every tick.
+        None,
+        /// Export the first tick of every bucket of `bucket_size` ticks.
+        EveryNth,
+        /// Export the minimum and maximum quantities of every bucket of `bucket_size` ticks.
+        MinMax,
+    } downsampling = Downsampling::None;
+    std::size_t bucket_size = 20;
+    /// If not 0, every item also gets columns with how much of it was produced and consumed
+    /// during the last `throughput_window` ticks, and how much its stock changed. The factory is
+    /// simulated again for them, see `sim::simulate_throughput()`.
+    std::size_t throughput_window = 0;
+    /// The amount of rows converted and written at once.
+    std::size_t chunk_rows = 4096;
+};
+
+/// Quotes a CSV field if it contains commas, quotes or line breaks.
+std::string csv_escape(const std::string& str);
+
+/// Writes the plots of the given items as CSV, with a row per exported tick and a column per
+/// item (two per item, minimum and maximum, when using `Downsampling::MinMax`), followed by the
+/// columns of its throughput if any.
+/// Rows are converted and written in chunks, so no copy of the whole plots is made.
+/// @param progress Receives the progress of the throughput simulation and of the rows written,
+/// and can cancel the export.
+/// @returns false if the export was cancelled, leaving `out` incomplete.
+bool export_plots_csv(std::ostream& out,
+                      const Factory& factory,
+                      const Factory::Cache& cache,
+                      std::span<const Uid> items,
+                      const PlotExportOptions& options = {},
+                      util::JobProgress* progress = nullptr);
+
+/// Writes the plots of the given items in a compressed columnar binary format. Columns are written
+/// in chunks of `chunk_rows` rows; within a chunk, each column is delta encoded and stored as
+/// zigzag LEB128 varints, with runs of equal deltas collapsed.
+///
+/// Layout (little-endian):
+///     char magic[4] = "FMKS"; u32 version; u32 downsampling; u64 bucket_size;
+///     u64 row_count; u32 column_count;
+///     column_count * { u32 name_size; char name[name_size]; }
+///     chunks until row_count rows are read: {
+///         u32 chunk_row_count;
+///         column_count * { u32 byte_count; u8 encoded[byte_count]; }
+///     }
+/// Each encoded column is a sequence of (zigzag delta, repeat count) varint pairs, the first delta
+/// of a chunk being relative to the last value of the previous chunk (or 0).
+/// The tick of each row is implied by its index and the downsampling used.
+/// @param progress Like with `export_plots_csv()`.
+/// @returns false if the export was cancelled, leaving `out` incomplete.
+bool export_plots_columnar(std::ostream& out,
+                           const Factory& factory,
+                           const Factory::Cache& cache,
+                           std::span<const Uid> items,
+                           const PlotExportOptions& options = {},
+                           util::JobProgress* progress = nullptr);
+
+} // namespace fmk::io
\ No newline at end of file
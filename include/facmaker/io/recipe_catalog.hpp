@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "factory.hpp"
+#include "quantity.hpp"
+#include "uid.hpp"
+#include "util/arena.hpp"
+
+namespace fmk::io {
+
+/// The recipes of a game, to build factories from instead of entering every machine by hand. Item
+/// names are interned, so recipes refer to their items by index, and the streams of all recipes
+/// are stored one after another in a single array.
+class RecipeCatalog {
+public:
+    using Index = std::uint32_t;
+
+    struct Stream {
+        /// See `item_name()`.
+        Index item;
+        Quantity quantity;
+    };
+
+    /// Returns the index of the item with the given name, adding it if there's none.
+    Index intern_item(std::string_view name);
+    /// Adds a recipe, unless there's already one with the same name.
+    /// @returns The index of the recipe, or nullopt if the name was taken.
+    std::optional<Index> add_recipe(std::string_view name,
+                                    util::ticks op_time,
+                                    std::span<const Stream> inputs,
+                                    std::span<const Stream> outputs);
+
+    std::size_t item_count() const { return item_names.size(); }
+    std::string_view item_name(Index item) const { return item_names[item]; }
+    std::optional<Index> find_item(std::string_view name) const;
+
+    std::size_t recipe_count() const { return recipes.size(); }
+    std::string_view recipe_name(Index recipe) const { return recipes[recipe].name; }
+    util::ticks op_time(Index recipe) const { return recipes[recipe].op_time; }
+    std::span<const Stream> inputs(Index recipe) const;
+    std::span<const Stream> outputs(Index recipe) const;
+    std::optional<Index> find_recipe(std::string_view name) const;
+
+private:
+    /// Copies a name into `names`, where it stays at the same address for as long as the catalog
+    /// exists, even if it's moved.
+    std::string_view store_name(std::string_view name);
+
+    struct Recipe {
+        std::string_view name;
+        util::ticks op_time;
+        /// The inputs of the recipe are at `streams[first_stream...]`, followed by its outputs.
+        std::uint32_t first_stream;
+        std::uint32_t input_count;
+        std::uint32_t output_count;
+    };
+
+    std::unique_ptr<util::Arena> names = std::make_unique<util::Arena>();
+    std::vector<std::string_view> item_names;
+    std::unordered_map<std::string_view, Index> item_indices;
+    std::vector<Recipe> recipes;
+    std::unordered_map<std::string_view, Index> recipe_indices;
+    std::vector<Stream> streams;
+};
+
+/// Parses recipes in the JSON format, an array of objects like
+/// `{"name": "Gear", "time": 30, "inputs": {"Iron Plate": 2}, "outputs": {"Gear": 1}}` that can
+/// also be the `recipes` key of an object. The time is in ticks. Errors are logged as they are
+/// found, and recipes whose name was already taken are skipped.
+/// @returns The catalog parsed, or nullopt if there were any errors.
+std::optional<RecipeCatalog> parse_recipes_json(std::string_view json);
+
+/// Parses recipes in CSV, with a header naming the `name`, `time`, `inputs` and `outputs` columns
+/// in any order, and other columns that are ignored. Inputs and outputs are separated by `;` and
+/// given as a quantity followed by the name of an item (e.g. `2 Iron Plate;1 Copper Cable`).
+/// Fields can be quoted. Errors are handled like in `parse_recipes_json()`.
+std::optional<RecipeCatalog> parse_recipes_csv(std::string_view csv);
+
+/// Loads a recipe file, in CSV if `path` ends in .csv or in the JSON format otherwise.
+std::optional<RecipeCatalog> load_recipe_file(const std::filesystem::path& path,
+                                              util::JobProgress* progress = nullptr);
+
+/// Adds a machine to the factory for every recipe given, in order. The recipes use the items of
+/// the factory with the same name, and the ones that are missing are added, as inputs if only
+/// consumed by the recipes given, as outputs if only produced, or as internal items otherwise.
+/// @returns The UIDs of the new machines.
+std::vector<Uid> instantiate_recipes(Factory& factory,
+                                     UidPool& uid_pool,
+                                     const RecipeCatalog& catalog,
+                                     std::span<const RecipeCatalog::Index> recipes);
+
+} // namespace fmk::io
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+
+#include "factory.hpp"
+
+namespace fmk::io {
+
+/// Calculates a hash of everything that affects the simulation of a factory: item types and
+/// starting quantities, machine recipes and the amount of ticks to simulate. UIDs, names and node
+/// positions are ignored, so that a factory and the file it was saved to (with compacted UIDs)
+/// share their results.
+std::uint64_t hash_factory(const Factory& factory, std::size_t ticks_to_simulate);
+
+/// A persistent cache of simulation results, stored on disk and keyed by `hash_factory`.
+/// Entries are evicted in least recently used order once the cache grows over its maximum size.
+class SimulationCache {
+public:
+    SimulationCache(std::filesystem::path directory, std::uintmax_t max_bytes);
+
+    /// The per-user cache directory for facmaker (e.g. `~/.cache/facmaker/simulations`).
+    static std::filesystem::path default_directory();
+
+    /// Loads the simulation results for the given factory, if they were stored previously. Entries
+    /// are checked against the factory, so hash collisions are never mistaken for its results.
+    std::optional<Factory::Cache> load(const Factory& factory, std::size_t ticks_to_simulate) const;
+    /// Stores the simulation results of a factory, evicting old entries if needed. They are found
+    /// again by the ticks that were asked for, even if the simulation stopped before (e.g. because
+    /// a stop condition was met).
+    void store(const Factory& factory, std::size_t ticks_to_simulate, const Factory::Cache& cache);
+
+    /// Loads the simulation results for the given factory, or simulates and stores them if they
+    /// are not present in the cache. `arena` and `progress` are passed on to
+    /// `Factory::generate_cache`. Simulations that were cancelled aren't stored.
+    Factory::Cache get_or_generate(const Factory& factory,
+                                   std::size_t ticks_to_simulate,
+                                   std::shared_ptr<util::Arena> arena = nullptr,
+                                   util::JobProgress* progress = nullptr);
+
+private:
+    std::filesystem::path entry_path(std::uint64_t hash) const;
+    void evict();
+
+    std::filesystem::path directory;
+    std::uintmax_t max_bytes;
+};
+
+} // namespace fmk::io
\ No newline at end of file
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <ostream>
+
+#include "factory.hpp"
+
+namespace fmk::io {
+
+/// Writes the C++ source of a program that simulates this factory and nothing else, for factories
+/// simulated many times. The items, quantities and operation times of every machine are
+/// constants of the code, with a block of straight-line code per machine. The program only needs
+/// the standard library: it takes the path of a CSV file and a number of ticks,
+/// `ticks_to_simulate` by default, and writes there the plots of every item exactly like
+/// `export_plots_csv()` does with the results of `Factory::generate_cache()`.
+void write_simulator_source(std::ostream& out,
+                            const Factory& factory,
+                            std::size_t ticks_to_simulate);
+
+} // namespace fmk::io
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include <functional>
 #include <string>
 
+#include "quantity.hpp"
 #include "uid.hpp"
 #include "util/quantity_plot.hpp"
 
@@ -10,17 +11,25 @@ namespace fmk {
 
 struct Item {
     enum class NodeType : int { Input, Output, Internal } type = NodeType::Internal;
-    int starting_quantity = 0;
+    Quantity starting_quantity = 0;
     std::string name;
     /// The ID of the output/input attribute of the item's node (Only relevant if it is an input or
     /// output).
-    Uid attribute_uid{std::numeric_limits<int>::min()};
+    Uid attribute_uid{Uid::INVALID_VALUE};
+
+    bool operator==(const Item&) const = default;
 };
 
 struct ItemStream {
     Uid item;
-    int quantity;
+    Quantity quantity;
     Uid uid;
+    /// The chance of an output being produced at the end of each operation of its machine (e.g.
+    /// a byproduct), only taken into account by Monte Carlo simulations. Deterministic
+    /// simulations always produce it, and inputs are always consumed.
+    float probability = 1.f;
+
+    bool operator==(const ItemStream&) const = default;
 };
 
-} // namespace fmk
+} // namespace fmk
\ No newline at end of file
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace fmk {
+
+/// The type of item quantities and tick counts. They are 32-bit, unless facmaker is built with
+/// `FACMAKER_WIDE_QUANTITIES` for long simulations or big amounts of items, which doubles the
+/// memory used by plots.
+#ifdef FACMAKER_WIDE_QUANTITIES
+using Quantity = std::int64_t;
+using TickCount = std::int64_t;
+#else
+using Quantity = std::int32_t;
+using TickCount = std::int32_t;
+#endif
+
+namespace util {
+
+/// Converts an integer to another integer type.
+/// @returns The converted value, or nullopt if it doesn't fit in `T`.
+template<typename T, typename U> constexpr std::optional<T> narrow(U value) {
+    static_assert(std::is_integral_v<T> && std::is_integral_v<U>);
+    if (!std::in_range<T>(value)) {
+        return std::nullopt;
+    }
+    return static_cast<T>(value);
+}
+
+/// @returns `a + b`, or nullopt if it overflows.
+template<typename T> constexpr std::optional<T> checked_add(T a, T b) {
+    static_assert(std::is_integral_v<T> && std::is_signed_v<T>);
+    if ((b > 0 && a > std::numeric_limits<T>::max() - b) ||
+        (b < 0 && a < std::numeric_limits<T>::min() - b)) {
+        return std::nullopt;
+    }
+    return a + b;
+}
+
+/// @returns `a - b`, or nullopt if it overflows.
+template<typename T> constexpr std::optional<T> checked_sub(T a, T b) {
+    static_assert(std::is_integral_v<T> && std::is_signed_v<T>);
+    if ((b < 0 && a > std::numeric_limits<T>::max() + b) ||
+        (b > 0 && a < std::numeric_limits<T>::min() + b)) {
+        return std::nullopt;
+    }
+    return a - b;
+}
+
+} // namespace util
+
+} // namespace fmk
\ No newline at end of file
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "util/thread_pool.hpp"
+
+namespace fmk::server {
+
+/// Serves simulation requests from other processes on the same machine through a Unix domain
+/// socket, keeping the factories loaded between requests.
+///
+/// Each line received is a batch of requests, either a JSON array of requests or an object of
+/// the form `{"id": <any>, "requests": [...]}`. Requests within a batch run in order; batches
+/// run concurrently on a pool of workers. Each batch is answered with a single line of the form
+/// `{"id": <same id>, "results": [...]}`, with one result per request. Results have an `"ok"`
+/// boolean and an `"error"` string if it is false.
+///
+/// Requests are objects with an `"op"` and the `"name"` of the factory they act on:
+/// - `load`: Loads a factory from a `"path"` or an inline JSON `"factory"` object, replacing any
+///   factory with the same name.
+/// - `patch`: Changes or removes existing `"items"`
+///   (`{"<uid>": {"start_with": n, "type": "input"} | null}`) and `"machines"`
+///   (`{"<uid>": {"name": s, "time": n, "inputs": {...}, "outputs": {...}} | null}`) of a loaded
+///   factory, using the same fields as factory files. `null` removes the entry. The
+///   patch is discarded entirely if any part of it is invalid.
+/// - `simulate`: Simulates a factory for `"ticks"` ticks (or the amount given in its file) and
+///   returns its summary.
+/// - `summary`: Returns the starting, final, minimum and maximum quantities of every item in the
+///   last simulation of a factory.
+/// - `series`: Returns the simulated quantities of the given `"items"` (UIDs or names, all items
+///   if omitted), keeping one tick out of every `"every"` ticks if given.
+/// - `unload`: Forgets a factory.
+/// - `list`: Returns the names of the loaded factories. Doesn't take a name.
+class SimulationServer {
+public:
+    /// @param worker_count The amount of worker threads, or 0 to use one per hardware thread.
+    SimulationServer(std::filesystem::path socket_path, std::size_t worker_count = 0);
+    ~SimulationServer();
+
+    /// Listens on the socket and serves connections until `stop` is called.
+    /// @returns Whether the server could listen on the socket.
+    bool run();
+    /// Makes `run` return. Safe to call from signal handlers.
+    void stop() { stopping = true; }
+
+    /// Runs a batch of requests and returns the response to it, without a trailing newline.
+    std::string handle_batch(std::string_view batch);
+
+private:
+    struct Resident;
+
+    std::shared_ptr<Resident> find_resident(const std::string& name);
+
+    std::filesystem::path socket_path;
+    std::atomic<bool> stopping = false;
+    static_assert(std::atomic<bool>::is_always_lock_free);
+
+    std::mutex residents_mutex;
+    std::unordered_map<std::string, std::shared_ptr<Resident>> residents;
+
+    // Declared last so that pending batches finish before anything else is destroyed
+    util::ThreadPool workers;
+};
+
+} // namespace fmk::server
\ No newline at end of file
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <memory_resource>
+#include <span>
+#include <vector>
+
+#include "factory.hpp"
+
+namespace fmk::sim {
+
+/// A factory laid out in flat arrays, with items and machines referred to by their position in
+/// the factory instead of by UID, for the hot loop of the simulation.
+struct FlatFactory {
+    struct Stream {
+        std::uint32_t item;
+        Quantity quantity;
+    };
+
+    /// Machines are checked in blocks of this size, so the requirement columns are padded to a
+    /// multiple of it.
+    static constexpr std::size_t machine_block = 8;
+
+    FlatFactory(const Factory::ItemsT& items,
+                const Factory::MachinesT& machines,
+                std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    /// The position of an item, which must be in the factory.
+    std::uint32_t item_index(Uid item) const { return item_indices.at(item); }
+    /// The index of an item that always has a stock of 0, which requirements that can't fail
+    /// point at. Stocks must have an entry for it.
+    std::uint32_t unlimited_item() const { return static_cast<std::uint32_t>(item_count); }
+
+    std::span<const Stream> inputs(std::size_t machine_i) const {
+        return std::span(input_streams)
+            .subspan(input_offsets[machine_i],
+                     input_offsets[machine_i + 1] - input_offsets[machine_i]);
+    }
+    std::span<const Stream> outputs(std::size_t machine_i) const {
+        return std::span(output_streams)
+            .subspan(output_offsets[machine_i],
+                     output_offsets[machine_i + 1] - output_offsets[machine_i]);
+    }
+
+    /// Whether a machine has enough of all of its inputs in `stock` to start a cycle.
+    bool can_start(std::size_t machine_i, std::span<const Quantity> stock) const {
+        for (std::size_t column = 0; column < required_columns; column++) {
+            const auto cell = column * padded_machine_count + machine_i;
+            if (stock[required_items[cell]] < required_quantities[cell]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::size_t item_count = 0;
+    std::size_t machine_count = 0;
+    /// `machine_count` rounded up to a multiple of `machine_block`.
+    std::size_t padded_machine_count = 0;
+
+    std::pmr::vector<TickCount> op_times;
+    std::pmr::vector<OpTimeDistribution> op_time_distributions;
+    /// The streams of machine `i` are in `[offsets[i], offsets[i + 1])`.
+    std::pmr::vector<std::uint32_t> input_offsets;
+    std::pmr::vector<Stream> input_streams;
+    std::pmr::vector<std::uint32_t> output_offsets;
+    std::pmr::vector<Stream> output_streams;
+    /// The chance of producing each output stream, kept apart from the streams since only Monte
+    /// Carlo simulations read it.
+    std::pmr::vector<float> output_probabilities;
+    /// Whether any machine has a random operation time or output, so that Monte Carlo
+    /// simulations of factories without any can be skipped.
+    bool is_stochastic = false;
+
+    /// The inputs that a machine needs to have in stock, stored column by column: the `k`-th
+    /// requirement of machine `i` is at `k * padded_machine_count + i`. Input items are never
+    /// short, so their requirements point at `unlimited_item()` with a quantity of 0, like the
+    /// cells of machines with fewer requirements than there are columns.
+    std::size_t required_columns = 0;
+    std::pmr::vector<std::uint32_t> required_items;
+    std::pmr::vector<Quantity> required_quantities;
+
+private:
+    util::UidMap<std::uint32_t> item_indices;
+};
+
+/// Finds which machines don't have enough of their inputs in `stock` to start a cycle, setting
+/// their entry of `blocked` to -1 and the entries of the rest to 0. `stock` has the quantity of
+/// every item plus the one of `unlimited_item()`, and `blocked` has `padded_machine_count` entries.
+/// Uses AVX2 when the CPU supports it.
+void find_blocked_machines(const FlatFactory& factory,
+                           std::span<const Quantity> stock,
+                           std::span<std::int32_t> blocked);
+
+/// The portable implementation of `find_blocked_machines()`, which the vectorized one must match.
+void find_blocked_machines_scalar(const FlatFactory& factory,
+                                  std::span<const Quantity> stock,
+                                  std::span<std::int32_t> blocked);
+
+/// Whether `find_blocked_machines()` is vectorized on this CPU.
+bool has_vectorized_requirement_checks();
+
+} // namespace fmk::sim
\ No newline at end of file
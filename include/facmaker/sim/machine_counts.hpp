@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "factory.hpp"
+#include "uid.hpp"
+
+namespace fmk::sim {
+
+/// A rate at which to produce an item.
+struct RateTarget {
+    Uid item;
+    double per_minute;
+};
+
+struct MachineCountOptions {
+    enum class Objective {
+        /// The fewest machines in total.
+        MachineCount,
+        /// The least surplus of the internal and target items. Machines run whenever they have
+        /// their inputs, so the time that machines further down would spend idle with fewer
+        /// copies upstream is surplus that piles up instead. Ties are broken by machine count.
+        Surplus,
+    } objective = Objective::MachineCount;
+    /// The linear relaxations solved while searching for the best integer counts, after which
+    /// the best counts found so far are kept.
+    std::size_t max_relaxations = 20000;
+    /// The ticks to simulate the factory with the counts found for, to check them, or 0 not to.
+    std::size_t validation_ticks = 20 * 60 * 10;
+};
+
+struct MachineCounts {
+    struct ItemRate {
+        Uid item;
+        /// 0 for items without a target.
+        double target_per_minute;
+        /// The net production of the item if all the machines run all the time.
+        double planned_per_minute;
+        /// The net production of the item during the second half of the validation simulation.
+        std::optional<double> simulated_per_minute;
+    };
+
+    /// How many copies of each machine of the factory are needed, in the order of the factory.
+    std::vector<std::size_t> counts;
+    /// Whether the search went through every candidate, rather than stopping at
+    /// `max_relaxations`, so that there are no better counts.
+    bool is_optimal = false;
+    /// The rates of the target items and of the internal items, in the order of the factory.
+    std::vector<ItemRate> rates;
+    /// Set if the validation simulation overflowed.
+    std::optional<Factory::Cache::Overflow> overflow;
+};
+
+/// Finds how many copies of each machine of a factory produce the target items at least at their
+/// rate, without consuming any internal item faster than it is produced. Machines are assumed to
+/// run all the time, so the rates of items are linear in the counts: the linear relaxation with
+/// fractional counts is solved first, then branch and bound looks for the best integer counts.
+/// The counts are then checked by simulating copies of the machines.
+/// @param progress Receives the fraction of `max_relaxations` solved, and can cancel the search.
+/// @returns The counts, or nullopt if a target can't be met, no integer counts were found within
+/// `max_relaxations` or the search was cancelled, with the reason logged.
+std::optional<MachineCounts> solve_machine_counts(const Factory& factory,
+                                                  std::span<const RateTarget> targets,
+                                                  const MachineCountOptions& options = {},
+                                                  util::JobProgress* progress = nullptr);
+
+/// The machines of a factory, each repeated as many times as `counts` says in a row, with new
+/// UIDs for the copies.
+Factory::MachinesT repeat_machines(const Factory::MachinesT& machines,
+                                   std::span<const std::size_t> counts,
+                                   UidPool& uid_pool);
+
+} // namespace fmk::sim
\ No newline at end of file
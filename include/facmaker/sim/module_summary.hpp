@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "factory.hpp"
+#include "quantity.hpp"
+#include "uid.hpp"
+
+namespace fmk::sim {
+
+/// How a factory behaves as a whole once it runs in a steady state, so that it can be embedded in
+/// other factories as a single machine (a module) instead of all of its machines.
+struct ModuleSummary {
+    /// The net change of an input or output item of the module.
+    struct Flow {
+        /// Items are matched by name with the factory the module is embedded in.
+        std::string item;
+        /// How much the stock of the item changes every period of the steady state. Negative for
+        /// items the module consumes.
+        Quantity per_period;
+        /// The change of the stock of the item since the start at the end of every tick of the
+        /// warm-up.
+        std::vector<Quantity> warmup;
+    };
+
+    std::string name;
+    /// The ticks after which the module repeats itself once it is in its steady state.
+    std::size_t period;
+    /// The ticks it takes the module to get to its steady state.
+    std::size_t warmup_ticks;
+    /// The input and output items whose stock changes in the steady state.
+    std::vector<Flow> flows;
+};
+
+/// Simulates a factory until it repeats itself, with unlimited inputs, and summarizes what it
+/// consumes and produces. Changes of internal items in the steady state (e.g. byproducts piling
+/// up) are left out of the summary, with a warning.
+/// @param progress Passed on to `Factory::generate_cache`.
+/// @returns The summary, or nullopt if the factory didn't get to a steady state within
+/// `max_ticks`, its quantities overflowed or the simulation was cancelled.
+std::optional<ModuleSummary> summarize_module(std::string name,
+                                              const Factory& module,
+                                              std::size_t max_ticks,
+                                              util::JobProgress* progress = nullptr);
+
+/// Adds a machine standing for a module to a factory. It takes a period to operate, consuming and
+/// producing what the module does during one. Items are looked up by name, and the missing ones
+/// are added as inputs or outputs. The warm-up of the module isn't simulated.
+/// @returns The UID of the machine.
+Uid embed_module(Factory& factory, UidPool& uid_pool, const ModuleSummary& summary);
+
+} // namespace fmk::sim
\ No newline at end of file
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+
+#include "factory.hpp"
+#include "uid.hpp"
+#include "util/quantity_plot.hpp"
+
+namespace fmk::sim {
+
+/// How the quantity of every item spreads across the replicas of a Monte Carlo simulation. Only
+/// percentile bands are kept, not the plot of every replica.
+struct MonteCarloResult {
+    static constexpr std::size_t low_percentile = 5;
+    static constexpr std::size_t high_percentile = 95;
+
+    /// Percentiles of the quantity of an item at the end of every tick simulated.
+    struct Bands {
+        /// At `low_percentile`.
+        util::QuantityPlot low;
+        util::QuantityPlot median;
+        /// At `high_percentile`.
+        util::QuantityPlot high;
+    };
+
+    std::size_t replicas = 0;
+    std::size_t ticks_simulated = 0;
+    /// How many replicas stopped early because a quantity overflowed. They keep the quantities
+    /// they had at that tick until the end.
+    std::size_t overflowed_replicas = 0;
+    /// Whether the simulation was cancelled before it finished, in which case `ticks_simulated`
+    /// only goes up to where every replica got.
+    bool cancelled = false;
+    std::unordered_map<Uid, Bands> bands;
+};
+
+/// Simulates many replicas of a factory whose operation times and outputs are sampled from their
+/// distributions, in parallel. Replicas advance in lockstep by blocks of ticks, and the quantities
+/// of each block are reduced to percentiles before simulating the next one, so that memory doesn't
+/// grow with the amount of replicas. Factories without any randomness are only simulated once.
+/// @param seed Runs with the same seed and factory give the same results.
+/// @param worker_count The threads to simulate with, or one per hardware thread if 0.
+/// @param progress Receives the fraction of the ticks simulated, and can cancel the simulation.
+MonteCarloResult run_monte_carlo(const Factory& factory,
+                                 std::size_t ticks_to_simulate,
+                                 std::size_t replicas,
+                                 std::uint64_t seed,
+                                 std::size_t worker_count = 0,
+                                 util::JobProgress* progress = nullptr);
+
+} // namespace fmk::sim
\ No newline at end of file
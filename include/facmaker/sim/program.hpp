@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+#include "quantity.hpp"
+#include "sim/flat_factory.hpp"
+
+namespace fmk::sim {
+
+/// A factory compiled to the instructions that the simulation runs for every cycle of a machine.
+/// The instructions that start a cycle of a machine are followed by the ones that finish it, so
+/// everything the simulation needs to know about a machine is next to each other, instead of
+/// spread over the requirement columns, the streams and the operation times of `FlatFactory`.
+struct Program {
+    enum class Op : std::uint8_t {
+        /// Stops unless there's at least `quantity` of `item` in stock, without starting a cycle.
+        Require,
+        /// Changes the stock of `item` by `quantity`, which is the input stream negated.
+        Take,
+        /// Sets the overflow at `item`, for inputs whose quantity can't be negated.
+        Overflow,
+        /// Schedules the end of the cycle `quantity` ticks later, the nominal operation time.
+        Start,
+        /// Adds `quantity` of `item`, the output stream.
+        Give,
+        /// Frees the machine at the end of a cycle.
+        Finish,
+    };
+
+    struct Instruction {
+        Op op;
+        std::uint32_t item;
+        Quantity quantity;
+    };
+
+    explicit Program(const FlatFactory& factory,
+                     std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    /// The instructions of every machine one after another: `Require` for every input that isn't
+    /// an input item, `Take` or `Overflow` for every input, `Start`, `Give` for every output and
+    /// `Finish`.
+    std::pmr::vector<Instruction> code;
+    /// Where the instructions starting a cycle of every machine begin in `code`.
+    std::pmr::vector<std::uint32_t> start_entries;
+    /// Where the instructions finishing a cycle of every machine begin in `code`.
+    std::pmr::vector<std::uint32_t> finish_entries;
+};
+
+} // namespace fmk::sim
\ No newline at end of file
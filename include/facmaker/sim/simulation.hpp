@@ -0,0 +1,162 @@
+#pragma once
+
+#include <cstdint>
+#include <memory_resource>
+#include <optional>
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "factory.hpp"
+#include "sim/flat_factory.hpp"
+#include "sim/program.hpp"
+#include "sim/stop_condition.hpp"
+#include "util/background_job.hpp"
+#include "util/timing_wheel.hpp"
+
+namespace fmk::sim {
+
+/// A change of the stock of an item, by its position in the factory.
+struct StockChange {
+    std::uint32_t item;
+    Quantity modifier;
+};
+
+/// Runs a factory one tick at a time. It only keeps the current stock of every item and the
+/// changes made during the last tick, so that callers decide what to record.
+class Simulation {
+public:
+    /// How many ticks are simulated between progress reports, so that they cost next to nothing
+    /// while cancelling still takes effect within a fraction of a second on large factories.
+    static constexpr std::size_t progress_interval = 256;
+
+    /// How ticks are simulated, with the same results either way.
+    enum class Engine {
+        /// Runs the factory compiled to a `Program`.
+        Compiled,
+        /// Goes through the arrays of the `FlatFactory`, which is simpler and is kept to check
+        /// the compiled engine against.
+        Reference,
+    };
+
+    /// The items and machines must outlive the simulation.
+    Simulation(const Factory::ItemsT& items,
+               const Factory::MachinesT& machines,
+               std::pmr::memory_resource* resource = std::pmr::get_default_resource(),
+               Engine engine = Engine::Compiled);
+
+    /// Samples operation times and outputs from their distributions from now on, as in Monte
+    /// Carlo simulations, instead of always taking the nominal ones. Simulations with the same
+    /// factory and seed give the same results.
+    void randomize(std::uint64_t seed) { rng.emplace(seed); }
+
+    /// Simulates the next tick.
+    /// @returns false if a quantity overflowed, in which case the tick is left half done,
+    /// `overflow()` is set and the simulation can't go on.
+    bool step();
+
+    /// Reports the fraction of `ticks_to_simulate` simulated so far to `progress`, if any, once
+    /// every `progress_interval` ticks.
+    /// @returns false if the simulation was cancelled through `progress`.
+    bool report_progress(util::JobProgress* progress, std::size_t ticks_to_simulate) const {
+        if (!progress || _tick % progress_interval != 0) {
+            return true;
+        }
+        progress->set_fraction(static_cast<float>(_tick) / static_cast<float>(ticks_to_simulate));
+        return !progress->is_cancelled();
+    }
+
+    /// The amount of ticks simulated so far, which is also the next tick to simulate.
+    std::size_t tick() const { return _tick; }
+    /// The quantity of every item, by position in the factory.
+    std::span<const Quantity> stock() const {
+        return std::span(_stock).first(flat.item_count);
+    }
+    /// The changes of stock made during the last tick, in the order they were made.
+    std::span<const StockChange> changes() const { return _changes; }
+    const std::optional<Factory::Cache::Overflow>& overflow() const { return _overflow; }
+
+    const FlatFactory& flat_factory() const { return flat; }
+    /// The UID of the item at a position in the factory.
+    Uid item_uid(std::uint32_t item_i) const { return (items.begin() + item_i)->first; }
+    const Item& item(std::uint32_t item_i) const { return (items.begin() + item_i)->second; }
+
+private:
+    /// Changes the stock of an item, setting `_overflow` instead if it would overflow.
+    bool change_stock(std::uint32_t item_i, Quantity modifier);
+    /// The operation time of the next task of a machine, from its distribution.
+    TickCount sample_op_time(std::uint32_t machine_i);
+    /// Whether an output stream is produced by the task that just finished, from its chance.
+    bool sample_output(std::size_t stream_i);
+    /// Finish the tasks due at the current tick and start the machines that can, for `step()`.
+    bool run_compiled_tick();
+    bool run_reference_tick();
+
+    const Factory::ItemsT& items;
+    FlatFactory flat;
+    Engine engine;
+    Program program;
+    /// Has an extra entry for `FlatFactory::unlimited_item()`.
+    std::pmr::vector<Quantity> _stock;
+    /// In-flight tasks are scheduled at the tick they finish, by the index of their machine.
+    util::TimingWheel<std::uint32_t> tasks;
+    std::pmr::vector<bool> busy_machines;
+    std::pmr::vector<std::int32_t> blocked_machines;
+    std::pmr::vector<StockChange> _changes;
+    std::size_t _tick = 0;
+    std::optional<Factory::Cache::Overflow> _overflow;
+    /// Only set in randomized simulations.
+    std::optional<std::mt19937_64> rng;
+};
+
+/// Checks a set of stop conditions after every tick of a simulation.
+class StopConditionChecker {
+public:
+    /// The conditions must refer to items of the simulated factory, and outlive the checker.
+    StopConditionChecker(std::span<const StopCondition> conditions,
+                         const Simulation& simulation,
+                         std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    /// Checks the conditions against the tick that `simulation` just simulated.
+    /// @returns The condition that was met, if any.
+    std::optional<StopResult> check(const Simulation& simulation);
+
+private:
+    /// The state of a `SteadyState` condition: the stock at the start of the current window, and
+    /// how much it changed during the previous one.
+    struct Steadiness {
+        std::size_t condition;
+        std::size_t window;
+        std::pmr::vector<Quantity> window_start;
+        std::pmr::vector<std::uint64_t> previous_change;
+        bool has_previous_change = false;
+    };
+
+    /// Whether the stock of an item meets a condition on it.
+    bool is_met(const StopCondition& condition, Quantity stock) const;
+
+    std::span<const StopCondition> conditions;
+    /// The item conditions of item `i` are in `[item_offsets[i], item_offsets[i + 1])`.
+    std::pmr::vector<std::uint32_t> item_offsets;
+    std::pmr::vector<std::uint32_t> item_conditions;
+    std::pmr::vector<Steadiness> steady_states;
+};
+
+/// Simulates a factory until one of `conditions` is met, without recording any plot, to find out
+/// how long it takes to reach a target.
+/// @param progress Receives the fraction of `max_ticks` simulated, and can cancel the search.
+/// @returns The condition that was met, or nullopt if none was within `max_ticks`, a quantity
+/// overflowed before or the search was cancelled.
+std::optional<StopResult> find_stop(const Factory& factory,
+                                    std::span<const StopCondition> conditions,
+                                    std::size_t max_ticks,
+                                    util::JobProgress* progress = nullptr);
+
+/// A human-readable description of why a simulation stopped, e.g. "'Iron' reached 100 at tick 59
+/// (3.00 s)". The items don't need to be in the factory anymore.
+std::string describe_stop(const Factory& factory,
+                          const StopCondition& condition,
+                          const StopResult& result);
+
+} // namespace fmk::sim
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+
+#include "quantity.hpp"
+#include "uid.hpp"
+
+namespace fmk::sim {
+
+/// A condition that ends a simulation early, at the end of the first tick where it holds.
+///
+/// Item conditions are only checked when the stock of their item changes, so that they describe
+/// the item getting to the threshold: an item that starts above it and never changes doesn't
+/// meet `Reaches`, and an internal buffer that starts empty doesn't meet `AnyBufferDropsTo` until
+/// it has been filled and emptied again.
+struct StopCondition {
+    enum class Type {
+        /// The stock of `item` gets to `threshold` or more.
+        Reaches,
+        /// The stock of `item` gets to `threshold` or less.
+        DropsTo,
+        /// The stock of any internal item gets to `threshold` or less.
+        AnyBufferDropsTo,
+        /// The stock of every item changed by the same amount during the last two spans of
+        /// `window` ticks, i.e. the factory repeats itself with a period that divides `window`.
+        SteadyState,
+    };
+
+    static StopCondition reaches(Uid item, Quantity threshold) {
+        return {Type::Reaches, item, threshold};
+    }
+    static StopCondition drops_to(Uid item, Quantity threshold) {
+        return {Type::DropsTo, item, threshold};
+    }
+    static StopCondition any_buffer_drops_to(Quantity threshold) {
+        return {Type::AnyBufferDropsTo, Uid(Uid::INVALID_VALUE), threshold};
+    }
+    static StopCondition steady_state(std::size_t window) {
+        return {Type::SteadyState, Uid(Uid::INVALID_VALUE), 0, window};
+    }
+
+    Type type;
+    /// The item checked by `Reaches` and `DropsTo`.
+    Uid item = Uid(Uid::INVALID_VALUE);
+    Quantity threshold = 0;
+    /// The span of ticks compared by `SteadyState`, which must not be 0.
+    std::size_t window = 0;
+};
+
+/// Why a simulation stopped early.
+struct StopResult {
+    /// The index of the condition that was met. If several were met at the same tick, the first.
+    std::size_t condition;
+    /// The tick at whose end the condition was met.
+    std::size_t tick;
+    /// The item that met the condition, or an invalid UID for `SteadyState`.
+    Uid item = Uid(Uid::INVALID_VALUE);
+};
+
+} // namespace fmk::sim
\ No newline at end of file
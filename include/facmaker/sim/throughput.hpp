@@ -0,0 +1,50 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include "factory.hpp"
+#include "quantity.hpp"
+#include "uid.hpp"
+
+namespace fmk::sim {
+
+/// How much of an item went in and out of its stock during a rolling window of ticks, for the
+/// window ending at every tick of a simulation. Windows near the start only go back to tick 0.
+struct ThroughputSeries {
+    Uid item;
+    /// The length of the windows, in ticks.
+    std::size_t window;
+    /// The quantity produced during every window.
+    std::vector<Quantity> produced;
+    /// The quantity consumed during every window.
+    std::vector<Quantity> consumed;
+    /// How much the stock changed during every window.
+    std::vector<Quantity> net;
+
+    /// The ticks covered by the window ending at `tick`.
+    std::size_t window_ticks(std::size_t tick) const { return std::min(tick + 1, window); }
+    /// Converts a quantity from the window ending at `tick` to a quantity every `per` ticks
+    /// (e.g. 1200 for a rate per minute).
+    double rate(Quantity quantity, std::size_t tick, std::size_t per) const {
+        return static_cast<double>(quantity) * static_cast<double>(per) /
+               static_cast<double>(window_ticks(tick));
+    }
+};
+
+/// Simulates a factory again for `ticks` to calculate the throughput of some of its items over
+/// windows of `window` ticks, with as many values as the plots of a cache simulated that long.
+/// The changes of stock of every tick are added up into running totals of what every item
+/// produced and consumed, and the quantity of every window is the difference between the totals
+/// at both of its ends, so the series take a single pass whatever the window.
+/// @param progress Receives the fraction of the ticks simulated, and can cancel the simulation.
+/// @returns The series of the items, in the order given, or none if the simulation was cancelled.
+std::vector<ThroughputSeries> simulate_throughput(const Factory& factory,
+                                                  std::size_t ticks,
+                                                  std::span<const Uid> items,
+                                                  std::size_t window,
+                                                  util::JobProgress* progress = nullptr);
+
+} // namespace fmk::sim
\ No newline at end of file
@@ -1,17 +1,22 @@
 #pragma once
+#include <cstdint>
 #include <functional>
 #include <limits>
+#include <vector>
 
 namespace fmk {
 
 struct Uid {
-    static constexpr int INVALID_VALUE = std::numeric_limits<int>::min();
+    /// UIDs are 64-bit so that long sessions and big factories never run out of them. The editor
+    /// maps them to imnodes' int IDs only for the elements it draws.
+    using ValueT = std::int64_t;
 
-    explicit constexpr Uid(int val) : value(val) {}
+    static constexpr ValueT INVALID_VALUE = std::numeric_limits<ValueT>::min();
+
+    explicit constexpr Uid(ValueT val) : value(val) {}
     Uid() = delete;
 
-    // This is currently limited by imnodes
-    int value;
+    ValueT value;
 
     bool operator==(Uid const& other) const { return value == other.value; }
 };
@@ -20,19 +25,28 @@ class UidPool {
 public:
     explicit UidPool(Uid next_uid) : next_uid(next_uid) {}
 
+    /// Returns a released UID if there is any, or a never used one otherwise.
     Uid generate();
+    /// Makes a UID available to be generated again. It must not be in use anymore.
+    void release(Uid uid);
 
     [[nodiscard]] std::size_t available() const;
+    /// The first UID after all the ones that have been generated. Released UIDs are not saved
+    /// along with it, which is fine since factories are compacted when saved.
     [[nodiscard]] Uid get_next_uid() const { return next_uid; }
 
 private:
-    Uid next_uid{std::numeric_limits<int>::min()};
+    Uid next_uid{Uid::INVALID_VALUE};
+    std::vector<Uid> released;
 };
 
 } // namespace fmk
 
 template<> struct std::hash<fmk::Uid> {
     std::size_t operator()(fmk::Uid const& uid) const noexcept {
-        return std::hash<unsigned long long>{}(uid.value);
+        // Identity hashing works best with the prime bucket counts of `std::unordered_map`, as
+        // UIDs are mostly sequential. `util::UidMap` masks it to its power-of-two slot count
+        // directly, so sequential UIDs land in consecutive slots.
+        return static_cast<std::size_t>(uid.value);
     }
 };
\ No newline at end of file
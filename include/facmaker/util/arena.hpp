@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+namespace fmk::util {
+
+/// A monotonic memory resource that keeps its memory when reset, so that data that is regenerated
+/// over and over (e.g. simulation results while editing) reuses it instead of going through the
+/// heap for every container. Deallocations do nothing until the arena is reset. Not thread-safe.
+class Arena : public std::pmr::memory_resource {
+public:
+    explicit Arena(std::size_t initial_chunk_size = 64 * 1024);
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    /// Makes all of the memory of the arena available again. Nothing allocated from it before may
+    /// be used afterwards. If the memory was split in several chunks, they are merged into one so
+    /// that the next use that needs as much memory doesn't have to allocate any.
+    void reset();
+
+    /// The total size of the memory the arena has taken from the heap.
+    std::size_t bytes_reserved() const;
+    /// How many times the arena has taken memory from the heap.
+    std::size_t heap_allocations() const { return _heap_allocations; }
+
+private:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void*, std::size_t, std::size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+    struct Chunk {
+        std::unique_ptr<std::byte[]> data;
+        std::size_t size;
+    };
+
+    void add_chunk(std::size_t min_size);
+
+    std::vector<Chunk> _chunks;
+    /// The chunk being allocated from, and how much of it is used.
+    std::size_t _current_chunk = 0;
+    std::size_t _offset = 0;
+    std::size_t _next_chunk_size;
+    std::size_t _heap_allocations = 0;
+};
+
+/// Hands out arenas that nothing else is using anymore, resetting them first. Keeping the
+/// returned pointer alive (e.g. in the data allocated from the arena) marks the arena as used.
+/// Not thread-safe, but the arenas can be released from any thread.
+class ArenaPool {
+public:
+    std::shared_ptr<Arena> acquire();
+
+private:
+    std::vector<std::shared_ptr<Arena>> _arenas;
+};
+
+} // namespace fmk::util
\ No newline at end of file
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace fmk::util {
+
+/// Progress of a background job, written by the job and read by whoever is waiting on it.
+class JobProgress {
+public:
+    /// Sets a human-readable description of what the job is currently doing, and resets the
+    /// progress fraction.
+    void set_stage(std::string stage) {
+        std::lock_guard lock(mutex);
+        _stage = std::move(stage);
+        _fraction = 0.f;
+    }
+    /// Sets how much of the current stage has been completed, from 0 to 1.
+    void set_fraction(float fraction) { _fraction = fraction; }
+
+    std::string stage() const {
+        std::lock_guard lock(mutex);
+        return _stage;
+    }
+    float fraction() const { return _fraction; }
+
+    /// Asks the job to stop early. Jobs that support it check `is_cancelled()` regularly and
+    /// return whatever they have done so far.
+    void cancel() { _cancelled = true; }
+    bool is_cancelled() const { return _cancelled; }
+
+private:
+    mutable std::mutex mutex;
+    std::string _stage;
+    std::atomic<float> _fraction = 0.f;
+    std::atomic<bool> _cancelled = false;
+};
+
+/// A function running on its own thread that can be polled for completion without blocking.
+template<typename T> class BackgroundJob {
+public:
+    explicit BackgroundJob(std::function<T(JobProgress&)> function) :
+        _progress(std::make_shared<JobProgress>()),
+        result(std::async(std::launch::async, [function = std::move(function),
+                                               progress = _progress]() -> T {
+            return function(*progress);
+        })) {}
+    BackgroundJob(const BackgroundJob&) = delete;
+    BackgroundJob& operator=(const BackgroundJob&) = delete;
+    /// Cancels the job and waits for it to stop, since its thread can't outlive it. Jobs that
+    /// don't check for cancellation run until they finish.
+    ~BackgroundJob() { cancel(); }
+
+    /// Checks whether the job has finished and its result can be taken without blocking.
+    bool is_ready() const {
+        return result.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }
+    /// Takes the result of the job, waiting for it to finish if needed.
+    T take_result() { return result.get(); }
+
+    const JobProgress& progress() const { return *_progress; }
+    /// Asks the job to stop early, see `JobProgress::cancel()`.
+    void cancel() { _progress->cancel(); }
+
+private:
+    std::shared_ptr<JobProgress> _progress;
+    std::future<T> result;
+};
+
+} // namespace fmk::util
\ No newline at end of file
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+
+namespace fmk::util {
+
+/// How many times memory has been allocated through the global `operator new` so far, across all
+/// threads. Used to measure allocation-heavy code.
+///
+/// Counting replaces the global `operator new` of the whole program, so it is only linked into
+/// the benchmark and the tests that need it, through the `facmaker_heap_stats` target.
+std::size_t heap_allocation_count();
+
+} // namespace fmk::util
\ No newline at end of file
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace fmk::util {
+
+/// Minimizing a linear function of non-negative variables, subject to linear constraints.
+struct LinearProgram {
+    struct Term {
+        std::uint32_t variable;
+        double coefficient;
+    };
+
+    struct Constraint {
+        enum class Relation { LessEqual, GreaterEqual, Equal } relation;
+        /// Terms of the same variable are added up.
+        std::vector<Term> terms;
+        double bound;
+    };
+
+    /// The coefficient of every variable in the function to minimize, which also gives the amount
+    /// of variables.
+    std::vector<double> objective;
+    std::vector<Constraint> constraints;
+};
+
+struct LinearSolution {
+    enum class Status { Optimal, Infeasible, Unbounded, IterationLimit } status;
+    /// The minimum of the function and the values of the variables there, if `Optimal`.
+    double objective = 0;
+    std::vector<double> values;
+};
+
+/// Solves a linear program with the two-phase simplex method on a dense tableau, which is fine for
+/// the few hundred variables and constraints of a factory. Pivots follow Bland's rule after
+/// degenerate ones, so that the method doesn't cycle.
+LinearSolution solve_linear_program(const LinearProgram& program);
+
+} // namespace fmk::util
\ No newline at end of file
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <span>
+
+namespace fmk::util {
+
+/// A read-only memory mapping of a whole file.
+class MappedFile {
+public:
+    /// Maps the file at `path` into memory.
+    /// @returns The mapping, or nullptr if the file could not be opened or mapped.
+    static std::shared_ptr<const MappedFile> open(const std::filesystem::path& path);
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+
+    std::span<const std::byte> bytes() const { return {_data, _size}; }
+
+private:
+    MappedFile() = default;
+
+    const std::byte* _data = nullptr;
+    std::size_t _size = 0;
+#ifdef _WIN32
+    void* _mapping_handle = nullptr;
+#endif
+};
+
+} // namespace fmk::util
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include <imgui.h>
 #include <string>
+#include <type_traits>
 
 namespace ImGui {
 
@@ -16,6 +17,29 @@ bool SelectableInput(const char* str_id,
                      std::string* str,
                      ImGuiSelectableFlags flags = ImGuiSelectableFlags_None);
 
+/// The ImGui data type of an integer type.
+template<typename T> constexpr ImGuiDataType DataTypeOf() {
+    static_assert(std::is_integral_v<T> && (sizeof(T) == 4 || sizeof(T) == 8));
+    if constexpr (sizeof(T) == 4) {
+        return std::is_signed_v<T> ? ImGuiDataType_S32 : ImGuiDataType_U32;
+    } else {
+        return std::is_signed_v<T> ? ImGuiDataType_S64 : ImGuiDataType_U64;
+    }
+}
+
+/// ImGui::InputInt() for any integer type (e.g. 64-bit item quantities).
+template<typename T>
+bool InputInteger(const char* label, T* value, ImGuiInputTextFlags flags = 0) {
+    const T step = 1;
+    const T step_fast = 100;
+    return InputScalar(label, DataTypeOf<T>(), value, &step, &step_fast, nullptr, flags);
+}
+
+/// ImGui::DragInt() for any integer type (e.g. 64-bit item quantities).
+template<typename T> bool DragInteger(const char* label, T* value, float speed, T min, T max) {
+    return DragScalar(label, DataTypeOf<T>(), value, speed, &min, &max);
+}
+
 // From imgui/misc/cpp/imgui_stdlib:
 
 // ImGui::InputText() with std::string
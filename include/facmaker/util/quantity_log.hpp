@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <memory_resource>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include "quantity.hpp"
+#include "util/quantity_plot.hpp"
+
+namespace fmk::util {
+
+/// The quantity of an item over time, stored as the ticks where it changed and the value it had
+/// at the end of each of them. Items that rarely change take much less memory than with a
+/// `QuantityPlot`, which can be built from the log when the value at every tick is needed.
+///
+/// Once the changes would take more memory than a value for every tick, the log switches to
+/// storing that instead, so it is never much bigger than the equivalent plot.
+class QuantityLog {
+public:
+    using TickT = std::make_unsigned_t<TickCount>;
+
+    explicit QuantityLog(Quantity starting_value,
+                         std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    /// Records the value at the end of a tick, which must not be earlier than the last tick
+    /// recorded. Recording the same tick again replaces its value.
+    void record(std::size_t tick, Quantity value);
+
+    /// The value at the end of a tick.
+    Quantity value_at(std::size_t tick) const;
+    /// The highest value from the start until the last tick recorded.
+    Quantity max_value() const;
+
+    /// Writes the values of the ticks from `first_tick` on into `out`, one per tick, like a plot
+    /// of the log would have them, without building one.
+    void copy_values(std::size_t first_tick, std::span<Quantity> out) const;
+
+    /// Builds a plot with the values of the first `length` ticks.
+    QuantityPlot
+    to_plot(std::size_t length,
+            std::pmr::memory_resource* resource = std::pmr::get_default_resource()) const;
+
+private:
+    /// Replaces the changes with the value at every tick until the last one recorded.
+    void densify();
+
+    Quantity starting_value;
+    /// The ticks where the value changed, in order, or nothing once the log is dense.
+    std::pmr::vector<TickT> ticks;
+    /// The value at each tick of `ticks`, or at every tick once the log is dense.
+    std::pmr::vector<Quantity> values;
+    bool dense = false;
+};
+
+} // namespace fmk::util
\ No newline at end of file
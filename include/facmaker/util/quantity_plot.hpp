@@ -1,33 +1,74 @@
 #pragma once
 
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <span>
 #include <vector>
 
+#include "quantity.hpp"
+
 namespace fmk::util {
 
-class QuantityPlot {
+/// The quantity of an item over time, with a value of type `T` for every tick.
+template<typename T> class BasicQuantityPlot {
 public:
-    using ContainerT = std::vector<int>;
+    using ValueT = T;
+    using ContainerT = std::pmr::vector<T>;
+
+    BasicQuantityPlot() = default;
+    /// @param resource Where the values of the plot are allocated. Copies of the plot use the
+    /// default resource instead.
+    explicit BasicQuantityPlot(
+        std::size_t capacity,
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+    BasicQuantityPlot(std::size_t capacity,
+                      T starting_val,
+                      std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 
-    QuantityPlot() = default;
-    explicit QuantityPlot(std::size_t capacity);
-    QuantityPlot(std::size_t capacity, int starting_val);
+    /// Creates a read-only plot over values owned by someone else (e.g. a memory-mapped file).
+    /// `backing` is kept alive for as long as the plot references the values. Modifying the plot
+    /// copies the values into the plot's own container first.
+    static BasicQuantityPlot view(std::span<const T> values,
+                                  T max_value,
+                                  std::shared_ptr<const void> backing);
+
+    /// Creates a plot with a copy of `values`.
+    static BasicQuantityPlot copy_of(std::span<const T> values);
+    /// Creates a plot that takes ownership of `values`.
+    static BasicQuantityPlot from_values(ContainerT values);
 
     /// Changes a value in the plot by a modifier.
     /// If the value already exists, the modifier is directly applied as `val += mod`. If
     /// the value doesn't exist, the plot will be extended until `tick` using the last value
     /// in it, and then the same `val += mod` change will be applied.
-    void change_value(std::size_t tick, int modifier);
+    void change_value(std::size_t tick, T modifier);
 
     /// Inserts values coming from the last available one until `tick`.
     /// @returns The element extrapolated.
-    int extrapolate_until(std::size_t tick);
+    T extrapolate_until(std::size_t tick);
 
-    const ContainerT& container() const { return _container; }
-    int max_value() const { return _max_value_i == -1 ? 0 : _container[_max_value_i]; }
+    std::span<const T> values() const {
+        return _backing ? _view : std::span<const T>(_container);
+    }
+    T max_value() const;
 
 private:
+    explicit BasicQuantityPlot(ContainerT values);
+
+    /// Copies viewed values into `_container` so that they can be modified.
+    void detach();
+
     ContainerT _container;
     std::size_t _max_value_i = -1;
+
+    std::span<const T> _view;
+    std::shared_ptr<const void> _backing;
 };
 
+extern template class BasicQuantityPlot<std::int32_t>;
+extern template class BasicQuantityPlot<std::int64_t>;
+
+using QuantityPlot = BasicQuantityPlot<Quantity>;
+
 } // namespace fmk::util
\ No newline at end of file
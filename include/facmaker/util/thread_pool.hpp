@@ -0,0 +1,41 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace fmk::util {
+
+/// A fixed set of worker threads running submitted tasks in FIFO order.
+class ThreadPool {
+public:
+    /// Creates a pool with the given amount of workers, or one per hardware thread if 0.
+    explicit ThreadPool(std::size_t worker_count = 0);
+    /// Waits for all submitted tasks to finish before joining the workers.
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(std::function<void()> task);
+    /// Splits `[0, count)` in a range per worker, runs `task` on every range and waits for all of
+    /// them to finish. Must not be called from a task of the pool, which would wait for itself.
+    void parallel_for(std::size_t count, const std::function<void(std::size_t, std::size_t)>& task);
+
+    std::size_t worker_count() const { return workers.size(); }
+
+private:
+    void work();
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable task_available;
+    bool stopping = false;
+};
+
+} // namespace fmk::util
\ No newline at end of file
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+
+namespace fmk::util {
+
+/// Schedules values to be handed back at a given tick, for a clock that only moves forward one
+/// tick at a time.
+///
+/// The wheel is hierarchical: level 0 has a bucket for each of the next 256 ticks, and every other
+/// level covers 256 times as many ticks as the one below it with the same amount of buckets. When
+/// the clock reaches the start of a bucket of a higher level, its values are redistributed to the
+/// lower levels. Scheduling is constant time, and advancing the clock only touches the values due
+/// at the new tick, besides the occasional redistribution, no matter how many are scheduled.
+template<typename T> class TimingWheel {
+public:
+    explicit TimingWheel(std::pmr::memory_resource* resource = std::pmr::get_default_resource()) :
+        buckets(level_count * bucket_count, resource), overflow(resource), moving(resource) {}
+
+    /// The current tick, which starts at 0.
+    std::size_t now() const { return _now; }
+
+    /// Schedules `value` to be handed back when the clock gets to `tick`, which must be later
+    /// than the current one.
+    void schedule(std::size_t tick, T value) { place(Entry{tick, std::move(value)}); }
+
+    /// Moves the clock forward until `tick`, calling `on_due(value)` for every value scheduled
+    /// at each tick passed, in the order they were scheduled.
+    template<typename F> void advance_to(std::size_t tick, F&& on_due) {
+        while (_now < tick) {
+            _now++;
+            cascade();
+
+            auto& due = buckets[_now & bucket_mask];
+            for (auto& entry : due) { on_due(std::move(entry.value)); }
+            due.clear();
+        }
+    }
+
+private:
+    static constexpr std::size_t bits_per_level = 8;
+    static constexpr std::size_t bucket_count = std::size_t(1) << bits_per_level;
+    static constexpr std::size_t bucket_mask = bucket_count - 1;
+    static constexpr std::size_t level_count = 4;
+
+    struct Entry {
+        std::size_t tick;
+        T value;
+    };
+    using BucketT = std::pmr::vector<Entry>;
+
+    /// Puts an entry in the lowest level whose buckets all start in the same span of the level
+    /// above as the current tick, or in `overflow` if it is too far in the future for any level.
+    void place(Entry entry) {
+        for (std::size_t level = 0; level < level_count; level++) {
+            const auto shift = bits_per_level * level;
+            if ((entry.tick >> (shift + bits_per_level)) == (_now >> (shift + bits_per_level))) {
+                buckets[level * bucket_count + ((entry.tick >> shift) & bucket_mask)]
+                    .emplace_back(std::move(entry));
+                return;
+            }
+        }
+        overflow.emplace_back(std::move(entry));
+    }
+
+    /// Redistributes the buckets of the higher levels that start at the current tick, from the
+    /// highest one down, so that every value ends up in level 0 by the time it is due.
+    void cascade() {
+        if ((_now & bucket_mask) != 0) {
+            return;
+        }
+
+        constexpr auto wheel_bits = bits_per_level * level_count;
+        if (wheel_bits < 64 && (_now & ((std::uint64_t(1) << wheel_bits) - 1)) == 0) {
+            redistribute(overflow);
+        }
+        for (std::size_t level = level_count - 1; level > 0; level--) {
+            const auto shift = bits_per_level * level;
+            if ((_now & ((std::size_t(1) << shift) - 1)) == 0) {
+                redistribute(buckets[level * bucket_count + ((_now >> shift) & bucket_mask)]);
+            }
+        }
+    }
+
+    void redistribute(BucketT& bucket) {
+        // Placing an entry might put it back in `overflow`, so the bucket is emptied first
+        moving.swap(bucket);
+        for (auto& entry : moving) { place(std::move(entry)); }
+        moving.clear();
+    }
+
+    std::size_t _now = 0;
+    /// The buckets of all levels, one level after the other.
+    std::pmr::vector<BucketT> buckets;
+    /// Entries scheduled further than the highest level covers.
+    BucketT overflow;
+    /// Scratch space for the entries being redistributed.
+    BucketT moving;
+};
+
+} // namespace fmk::util
\ No newline at end of file
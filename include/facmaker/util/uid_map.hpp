@@ -0,0 +1,196 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "uid.hpp"
+
+namespace fmk::util {
+
+/// A map from UIDs to values that stores its entries contiguously and in insertion order, with an
+/// open-addressing index for lookups.
+///
+/// Iteration is deterministic and cache-friendly, unlike `std::unordered_map`. Insertions might
+/// invalidate iterators and references to other entries. Erasing keeps the order of the remaining
+/// entries, which e.g. decides which machines consume contested items first, so like
+/// `std::vector::erase` it moves back the entries after the erased one. Only their positions are
+/// updated in the index, so erasing the last entry takes constant time.
+///
+/// Keys of the entries must not be modified through iterators.
+template<typename T> class UidMap {
+public:
+    using key_type = Uid;
+    using mapped_type = T;
+    using value_type = std::pair<Uid, T>;
+    using iterator = typename std::vector<value_type>::iterator;
+    using const_iterator = typename std::vector<value_type>::const_iterator;
+
+    iterator begin() { return entries.begin(); }
+    iterator end() { return entries.end(); }
+    const_iterator begin() const { return entries.begin(); }
+    const_iterator end() const { return entries.end(); }
+    const_iterator cbegin() const { return entries.cbegin(); }
+    const_iterator cend() const { return entries.cend(); }
+
+    std::size_t size() const { return entries.size(); }
+    bool empty() const { return entries.empty(); }
+
+    void reserve(std::size_t count) {
+        entries.reserve(count);
+        if (count * 2 > slots.size()) {
+            rehash(count * 2);
+        }
+    }
+
+    void clear() {
+        entries.clear();
+        std::fill(slots.begin(), slots.end(), empty_slot);
+    }
+
+    iterator find(Uid uid) {
+        const auto index = find_index(uid);
+        return index ? begin() + *index : end();
+    }
+    const_iterator find(Uid uid) const {
+        const auto index = find_index(uid);
+        return index ? begin() + *index : end();
+    }
+
+    bool contains(Uid uid) const { return find_index(uid).has_value(); }
+    std::size_t count(Uid uid) const { return contains(uid) ? 1 : 0; }
+
+    T& at(Uid uid) {
+        const auto index = find_index(uid);
+        if (!index) {
+            throw std::out_of_range("UidMap::at");
+        }
+        return entries[*index].second;
+    }
+    const T& at(Uid uid) const {
+        const auto index = find_index(uid);
+        if (!index) {
+            throw std::out_of_range("UidMap::at");
+        }
+        return entries[*index].second;
+    }
+
+    T& operator[](Uid uid) { return try_emplace(uid).first->second; }
+
+    template<typename... Args> std::pair<iterator, bool> try_emplace(Uid uid, Args&&... args) {
+        if ((entries.size() + 1) * 2 > slots.size()) {
+            rehash(std::max<std::size_t>((entries.size() + 1) * 2, 16));
+        }
+
+        auto& slot = slots[find_slot(uid)];
+        if (slot.index != 0) {
+            return {begin() + (slot.index - 1), false};
+        }
+
+        entries.emplace_back(std::piecewise_construct, std::forward_as_tuple(uid),
+                             std::forward_as_tuple(std::forward<Args>(args)...));
+        slot = Slot{uid, static_cast<std::uint32_t>(entries.size())};
+        return {end() - 1, true};
+    }
+    template<typename... Args> std::pair<iterator, bool> emplace(Uid uid, Args&&... args) {
+        return try_emplace(uid, std::forward<Args>(args)...);
+    }
+    std::pair<iterator, bool> insert(value_type value) {
+        return try_emplace(value.first, std::move(value.second));
+    }
+
+    iterator erase(const_iterator pos) {
+        const auto index = static_cast<std::size_t>(pos - cbegin());
+        remove_slot(find_slot(pos->first));
+        entries.erase(pos);
+        for (auto moved = index; moved < entries.size(); moved++) {
+            slots[find_slot(entries[moved].first)].index--;
+        }
+        return begin() + static_cast<std::ptrdiff_t>(index);
+    }
+    std::size_t erase(Uid uid) {
+        const auto index = find_index(uid);
+        if (!index) {
+            return 0;
+        }
+        erase(cbegin() + *index);
+        return 1;
+    }
+
+private:
+    /// An entry of the index. Keys are stored next to the positions of their entries so that
+    /// probing doesn't have to touch the entries themselves.
+    struct Slot {
+        Uid uid;
+        /// The position of the entry plus one, or 0 if the slot is empty.
+        std::uint32_t index;
+    };
+    static constexpr Slot empty_slot{Uid(Uid::INVALID_VALUE), 0};
+
+    /// Returns the slot containing `uid`, or the empty slot where it would be inserted. There must
+    /// be at least one empty slot.
+    std::size_t find_slot(Uid uid) const {
+        // UIDs are handed out sequentially, so their low bits are already well distributed and
+        // lookups of neighbouring UIDs touch neighbouring slots
+        const auto mask = slots.size() - 1;
+        for (auto slot = static_cast<std::size_t>(std::hash<Uid>{}(uid)) & mask;;
+             slot = (slot + 1) & mask) {
+            if (slots[slot].index == 0 || slots[slot].uid == uid) {
+                return slot;
+            }
+        }
+    }
+
+    /// Empties a slot, moving back the slots after it that were probed past it, so that every
+    /// key can still be reached from its home slot without going through an empty one.
+    void remove_slot(std::size_t hole) {
+        const auto mask = slots.size() - 1;
+        for (auto slot = (hole + 1) & mask; slots[slot].index != 0; slot = (slot + 1) & mask) {
+            const auto home = static_cast<std::size_t>(std::hash<Uid>{}(slots[slot].uid)) & mask;
+            // The key can fill the hole unless its home slot comes after the hole
+            if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+                slots[hole] = slots[slot];
+                hole = slot;
+            }
+        }
+        slots[hole] = empty_slot;
+    }
+
+    std::optional<std::size_t> find_index(Uid uid) const {
+        if (slots.empty()) {
+            return std::nullopt;
+        }
+        const auto index = slots[find_slot(uid)].index;
+        if (index == 0) {
+            return std::nullopt;
+        }
+        return index - 1;
+    }
+
+    void rehash(std::size_t min_slots) {
+        std::size_t slot_count = 16;
+        while (slot_count < min_slots) { slot_count *= 2; }
+        slots.assign(slot_count, empty_slot);
+        rebuild_index();
+    }
+
+    void rebuild_index() {
+        std::fill(slots.begin(), slots.end(), empty_slot);
+        for (std::size_t index = 0; index < entries.size(); index++) {
+            const auto uid = entries[index].first;
+            slots[find_slot(uid)] = Slot{uid, static_cast<std::uint32_t>(index + 1)};
+        }
+    }
+
+    std::vector<value_type> entries;
+    /// Open-addressing index with linear probing. Its size is a power of two and at least twice
+    /// the amount of entries.
+    std::vector<Slot> slots;
+};
+
+} // namespace fmk::util
\ No newline at end of file
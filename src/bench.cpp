@@ -0,0 +1,226 @@
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <filesystem>
+#include <fmt/core.h>
+#include <iostream>
+#include <optional>
+#include <plog/Appenders/ColorConsoleAppender.h>
+#include <plog/Formatters/TxtFormatter.h>
+#include <plog/Init.h>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "io/factory_file.hpp"
+#include "sim/flat_factory.hpp"
+#include "sim/simulation.hpp"
+#include "util/arena.hpp"
+#include "util/heap_stats.hpp"
+
+namespace fmk {
+
+namespace {
+
+constexpr const char* usage =
+    "Usage:\n"
+    "    facmaker_bench [<factory>] [--machines <n>] [--ticks <n>] [--runs <n>]\n"
+    "        Times <n> simulations of a factory, 5 by default, or of a chain of <n> machines,\n"
+    "        1000 by default, with new and with reused arenas, and with both engines. Then\n"
+    "        checks that the compiled engine and the vectorized requirement checks match the\n"
+    "        reference ones.\n"
+    "        Exits with 1 if they don't.\n";
+
+std::optional<std::size_t> parse_size(std::string_view str) {
+    std::size_t value;
+    const auto [end, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+    if (ec != std::errc() || end != str.data() + str.size()) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+/// Generates a factory where every machine turns the item produced by the previous one into the
+/// next, with varying operation times and a single input item at the start of the chain.
+io::FactoryDocument make_chain_factory(std::size_t machine_count) {
+    io::FactoryDocument document;
+    auto& factory = document.factory;
+    auto& uid_pool = document.uid_pool;
+    factory.items.reserve(machine_count + 1);
+    factory.machines.reserve(machine_count);
+
+    Uid previous_item = uid_pool.generate();
+    factory.items[previous_item] =
+        Item{Item::NodeType::Input, 0, "Item 0", uid_pool.generate()};
+    for (std::size_t machine_i = 0; machine_i < machine_count; machine_i++) {
+        const auto next_item = uid_pool.generate();
+        const bool is_last = machine_i + 1 == machine_count;
+        factory.items[next_item] =
+            Item{is_last ? Item::NodeType::Output : Item::NodeType::Internal, 0,
+                 fmt::format("Item {}", machine_i + 1),
+                 is_last ? uid_pool.generate() : Uid(Uid::INVALID_VALUE)};
+
+        Machine machine;
+        machine.name = fmt::format("Machine {}", machine_i);
+        machine.inputs.emplace_back(ItemStream{previous_item, 1, uid_pool.generate()});
+        machine.outputs.emplace_back(ItemStream{next_item, 1, uid_pool.generate()});
+        machine.op_time = util::ticks(1 + static_cast<int>(machine_i % 5));
+        factory.machines[uid_pool.generate()] = std::move(machine);
+        previous_item = next_item;
+    }
+    return document;
+}
+
+int run_bench(std::span<const std::string_view> args) {
+    std::optional<std::filesystem::path> factory_path;
+    std::size_t machine_count = 1000;
+    std::optional<std::size_t> ticks;
+    std::size_t runs = 5;
+    for (std::size_t arg_i = 0; arg_i < args.size(); arg_i++) {
+        const auto arg = args[arg_i];
+        if (!arg.starts_with("--")) {
+            factory_path = arg;
+            continue;
+        }
+        if (arg_i + 1 >= args.size()) {
+            std::cerr << "Missing value for " << arg << "\n" << usage;
+            return 1;
+        }
+        const auto value = args[++arg_i];
+        const auto parsed = parse_size(value);
+        if (!parsed || *parsed == 0) {
+            std::cerr << "Invalid value '" << value << "' for " << arg << "\n";
+            return 1;
+        }
+
+        if (arg == "--machines") {
+            machine_count = *parsed;
+        } else if (arg == "--ticks") {
+            ticks = *parsed;
+        } else if (arg == "--runs") {
+            runs = *parsed;
+        } else {
+            std::cerr << "Unknown option " << arg << "\n" << usage;
+            return 1;
+        }
+    }
+
+    auto document = factory_path ? io::load_factory_file(*factory_path)
+                                 : std::make_optional(make_chain_factory(machine_count));
+    if (!document) {
+        return 1;
+    }
+    const auto& factory = document->factory;
+    const auto ticks_to_simulate = ticks.value_or(document->ticks_to_simulate);
+
+    std::cout << fmt::format("{} items, {} machines, {} ticks, {} runs\n", factory.items.size(),
+                             factory.machines.size(), ticks_to_simulate, runs);
+
+    const auto measure = [runs](std::string_view name, const auto& generate) {
+        using clock = std::chrono::steady_clock;
+        std::vector<double> run_ms;
+        std::size_t allocations = 0;
+        for (std::size_t run_i = 0; run_i < runs; run_i++) {
+            const auto allocations_before = util::heap_allocation_count();
+            const auto start = clock::now();
+            generate();
+            const std::chrono::duration<double, std::milli> elapsed = clock::now() - start;
+            allocations += util::heap_allocation_count() - allocations_before;
+            run_ms.emplace_back(elapsed.count());
+        }
+        std::sort(run_ms.begin(), run_ms.end());
+
+        std::cout << fmt::format("{}: min {:.3f} ms, median {:.3f} ms, max {:.3f} ms, "
+                                 "{} heap allocations per run\n",
+                                 name, run_ms.front(), run_ms[run_ms.size() / 2], run_ms.back(),
+                                 allocations / runs);
+    };
+
+    measure("New arena every run", [&] { factory.generate_cache(ticks_to_simulate); });
+
+    // Like the editor, keep the previous results alive while generating the next ones
+    util::ArenaPool arenas;
+    std::optional<Factory::Cache> previous;
+    measure("Reused arenas", [&] {
+        previous = factory.generate_cache(ticks_to_simulate, arenas.acquire());
+    });
+
+    const auto simulate = [&](sim::Simulation::Engine engine) {
+        sim::Simulation simulation(factory.items, factory.machines,
+                                   std::pmr::get_default_resource(), engine);
+        while (simulation.tick() < ticks_to_simulate && simulation.step()) {}
+    };
+    measure("Reference engine", [&] { simulate(sim::Simulation::Engine::Reference); });
+    measure("Compiled engine", [&] { simulate(sim::Simulation::Engine::Compiled); });
+
+    // Cross-check the compiled simulation against the reference one after every tick, with the
+    // nominal operation times and outputs, and with sampled ones
+    const auto engines_match = [&](std::optional<std::uint64_t> seed) {
+        sim::Simulation compiled(factory.items, factory.machines);
+        sim::Simulation reference(factory.items, factory.machines,
+                                  std::pmr::get_default_resource(),
+                                  sim::Simulation::Engine::Reference);
+        if (seed) {
+            compiled.randomize(*seed);
+            reference.randomize(*seed);
+        }
+        const auto same_change = [](const sim::StockChange& a, const sim::StockChange& b) {
+            return a.item == b.item && a.modifier == b.modifier;
+        };
+        while (compiled.tick() < ticks_to_simulate) {
+            const bool compiled_stepped = compiled.step();
+            if (compiled_stepped != reference.step() ||
+                !std::ranges::equal(compiled.stock(), reference.stock()) ||
+                !std::ranges::equal(compiled.changes(), reference.changes(), same_change)) {
+                return false;
+            }
+            if (!compiled_stepped) {
+                return compiled.overflow()->item == reference.overflow()->item &&
+                       compiled.overflow()->tick == reference.overflow()->tick;
+            }
+        }
+        return true;
+    };
+    const bool engines_matched = engines_match(std::nullopt) && engines_match(1);
+    std::cout << fmt::format("Compiled engine: {}\n",
+                             engines_matched ? "results match" : "RESULTS DIFFER");
+
+    // Cross-check the requirement checks used by the simulation against the scalar ones, with
+    // stocks that block some of the machines
+    const sim::FlatFactory flat(factory.items, factory.machines);
+    std::vector<Quantity> stock(flat.item_count + 1, 0);
+    for (std::size_t item_i = 0; item_i < flat.item_count; item_i++) {
+        stock[item_i] = static_cast<Quantity>(item_i * 7 % 5);
+    }
+    std::vector<std::int32_t> expected(flat.padded_machine_count);
+    std::vector<std::int32_t> blocked(flat.padded_machine_count);
+    const auto time_checks = [&](auto check, std::vector<std::int32_t>& out) {
+        using clock = std::chrono::steady_clock;
+        constexpr int repetitions = 1000;
+        const auto start = clock::now();
+        for (int repetition = 0; repetition < repetitions; repetition++) {
+            check(flat, stock, out);
+        }
+        const std::chrono::duration<double, std::micro> elapsed = clock::now() - start;
+        return elapsed.count() / repetitions;
+    };
+    const auto scalar_us = time_checks(sim::find_blocked_machines_scalar, expected);
+    const auto used_us = time_checks(sim::find_blocked_machines, blocked);
+    const bool matches = blocked == expected;
+    std::cout << fmt::format("Requirement checks: scalar {:.3f} us, {} {:.3f} us, {}\n", scalar_us,
+                             sim::has_vectorized_requirement_checks() ? "AVX2" : "scalar",
+                             used_us, matches ? "results match" : "RESULTS DIFFER");
+    return matches && engines_matched ? 0 : 1;
+}
+
+} // namespace
+
+} // namespace fmk
+
+int main(int argc, char** argv) {
+    static plog::ColorConsoleAppender<plog::TxtFormatter> console_appender;
+    plog::init(plog::info, &console_appender);
+
+    const std::vector<std::string_view> args(argv + 1, argv + argc);
+    return fmk::run_bench(args);
+}
\ No newline at end of file
@@ -1,23 +1,60 @@
+#include <algorithm>
+#include <chrono>
+#include <fmt/core.h>
 #include <imgui.h>
 #include <imgui_internal.h>
 #include <imnodes.h>
 #include <implot.h>
+#include <type_traits>
+#include <vector>
 
+#include "editor/imnodes_ids.hpp"
+#include "editor/item_search.hpp"
 #include "factory.hpp"
+#include "sim/monte_carlo.hpp"
+#include "sim/throughput.hpp"
 #include "util/more_imgui.hpp"
 
 namespace fmk {
 
+/// The title bar color of the node of an item or machine.
+inline unsigned int node_title_color(Uid uid) {
+    const auto bits = static_cast<unsigned int>(uid.value);
+    return 0xff + ((bits * 50) % 0xFF << 8) | ((bits * 186) % 0xFF << 16) |
+           ((bits * 67) % 0xFF << 24);
+}
+
+/// @param bands The percentiles of the item in a Monte Carlo simulation, drawn behind its plot.
+/// @param throughput The throughput of the item, drawn as rates on a second Y axis, per second or
+/// per minute.
 inline void draw_item_graph(const Factory& factory,
                             const Factory::Cache& cache,
                             const Uid item_uid,
                             bool expanded = true,
-                            bool reload_plot_limits = false) {
+                            bool reload_plot_limits = false,
+                            const sim::MonteCarloResult::Bands* bands = nullptr,
+                            const sim::ThroughputSeries* throughput = nullptr,
+                            bool per_second = false) {
+    // Plots are built on demand, so the ones scrolled out of view are skipped
+    const auto size = expanded ? ImVec2(400, 200) : ImVec2(100, 50);
+    if (!ImGui::IsRectVisible(size)) {
+        ImGui::Dummy(size);
+        return;
+    }
+
     auto& item = factory.items.at(item_uid);
-    auto& plot = cache.plots().at(item_uid);
+    // Items added by an edit only have a plot once the edit is simulated
+    if (!cache.contains(item_uid)) {
+        ImGui::TextDisabled("%s", fmt::format("{}: simulating...", item.name).c_str());
+        ImGui::Dummy(ImVec2(size.x, size.y - ImGui::GetTextLineHeightWithSpacing()));
+        return;
+    }
+    auto& plot = cache.plot(item_uid);
+    const auto max_value = bands ? std::max(plot.max_value(), bands->high.max_value())
+                                 : plot.max_value();
 
     ImPlot::SetNextPlotLimits(
-        1, static_cast<double>(cache.ticks_simulated()) + 1., 0., plot.max_value() + 1,
+        1, static_cast<double>(cache.ticks_simulated()) + 1., 0., max_value + 1,
         (expanded && !reload_plot_limits) ? ImGuiCond_Appearing : ImGuiCond_Always);
 
     {
@@ -26,7 +63,7 @@ inline void draw_item_graph(const Factory& factory,
         ImPlot::SetNextPlotTicksX(ticks_x, 3);
     }
     if (!expanded) {
-        double ticks_y[] = {0, static_cast<double>(plot.max_value())};
+        double ticks_y[] = {0, static_cast<double>(max_value)};
         ImPlot::SetNextPlotTicksY(ticks_y, 2);
     }
 
@@ -34,23 +71,68 @@ inline void draw_item_graph(const Factory& factory,
     ImPlot::PushStyleVar(ImPlotStyleVar_FillAlpha, 0.5f);
     ImPlot::PushStyleVar(ImPlotStyleVar_LabelPadding, ImVec2(0.75f, 1));
     ImPlot::PushStyleVar(ImPlotStyleVar_PlotPadding, ImVec2(expanded ? 10 : 0, 5));
+    const char* rate_label = per_second ? "Items/s" : "Items/min";
     if (ImPlot::BeginPlot(
-            item.name.c_str(), "Tick", "Items", expanded ? ImVec2(400, 200) : ImVec2(100, 50),
+            item.name.c_str(), "Tick", "Items", size,
             (expanded ? 0 : ImPlotFlags_NoChild) | ImPlotFlags_CanvasOnly ^ ImPlotFlags_NoTitle |
-                ImPlotFlags_AntiAliased,
+                ImPlotFlags_AntiAliased | (throughput ? ImPlotFlags_YAxis2 : 0),
             expanded ? 0 : ImPlotAxisFlags_NoDecorations,
-            (expanded ? 0 : ImPlotAxisFlags_NoLabel) | ImPlotAxisFlags_AutoFit)) {
-        auto plot_size = plot.container().size();
+            (expanded ? 0 : ImPlotAxisFlags_NoLabel) | ImPlotAxisFlags_AutoFit,
+            ImPlotAxisFlags_AutoFit, 0, rate_label)) {
+        auto plot_size = plot.values().size();
+
+        // ImPlot is instantiated for ImS64, which might be a different type than std::int64_t
+        // with the same size
+        using PlotValueT = std::conditional_t<sizeof(Quantity) == sizeof(ImS64), ImS64, ImS32>;
+        static_assert(sizeof(PlotValueT) == sizeof(Quantity));
+        const auto* plot_y = reinterpret_cast<const PlotValueT*>(plot.values().data());
 
         // Shift the X axis one value to the left so that the total tick count equals the
         // last value plotted
-        std::vector<int> plot_x(plot_size);
-        for (int i = 1; i <= plot_size; i++) { plot_x[i - 1] = i; }
-
-        ImPlot::PlotShaded(item.name.c_str(), plot_x.data(), plot.container().data(),
-                           static_cast<int>(plot_size));
-        ImPlot::PlotStairs(item.name.c_str(), plot_x.data(), plot.container().data(),
-                           static_cast<int>(plot_size));
+        std::vector<PlotValueT> plot_x(plot_size);
+        for (std::size_t i = 1; i <= plot_size; i++) { plot_x[i - 1] = static_cast<PlotValueT>(i); }
+
+        if (bands) {
+            // The bands go up to the ticks of the Monte Carlo simulation, which might not be as
+            // many as the ones of the plot
+            const auto band_size = bands->median.values().size();
+            std::vector<PlotValueT> band_x(band_size);
+            for (std::size_t i = 1; i <= band_size; i++) {
+                band_x[i - 1] = static_cast<PlotValueT>(i);
+            }
+            const auto* low_y = reinterpret_cast<const PlotValueT*>(bands->low.values().data());
+            const auto* median_y =
+                reinterpret_cast<const PlotValueT*>(bands->median.values().data());
+            const auto* high_y = reinterpret_cast<const PlotValueT*>(bands->high.values().data());
+            ImPlot::PlotShaded("P5-P95", band_x.data(), low_y, high_y,
+                               static_cast<int>(band_size));
+            ImPlot::PlotLine("Median", band_x.data(), median_y, static_cast<int>(band_size));
+        }
+        ImPlot::PlotShaded(item.name.c_str(), plot_x.data(), plot_y, static_cast<int>(plot_size));
+        ImPlot::PlotStairs(item.name.c_str(), plot_x.data(), plot_y, static_cast<int>(plot_size));
+
+        if (throughput) {
+            using namespace std::chrono_literals;
+            const auto per = static_cast<std::size_t>(
+                std::chrono::duration_cast<util::ticks>(per_second ? 1s : 1min).count());
+            const auto rate_size = throughput->net.size();
+            std::vector<double> rate_x(rate_size);
+            std::vector<double> rate_y(rate_size);
+            for (std::size_t i = 1; i <= rate_size; i++) { rate_x[i - 1] = static_cast<double>(i); }
+            const auto plot_rates = [&](const char* label, const std::vector<Quantity>& values) {
+                for (std::size_t tick = 0; tick < values.size(); tick++) {
+                    rate_y[tick] = throughput->rate(values[tick], tick, per);
+                }
+                ImPlot::PlotLine(label, rate_x.data(), rate_y.data(),
+                                 static_cast<int>(values.size()));
+            };
+
+            ImPlot::SetPlotYAxis(ImPlotYAxis_2);
+            plot_rates("Produced", throughput->produced);
+            plot_rates("Consumed", throughput->consumed);
+            plot_rates("Net", throughput->net);
+            ImPlot::SetPlotYAxis(ImPlotYAxis_1);
+        }
 
         ImPlot::EndPlot();
     }
@@ -60,20 +142,19 @@ inline void draw_item_graph(const Factory& factory,
 }
 
 /// Returns the input to delete, if any
-inline std::optional<Uid> draw_factory_inputs(const Factory& factory, const Factory::Cache& cache) {
+inline std::optional<Uid>
+draw_factory_inputs(const Factory& factory, const ItemGraph& graph, ImnodesIds& ids) {
     std::optional<Uid> to_delete;
 
-    for (auto& input_uid : cache.inputs()) {
-        const auto& item = factory.items.at(input_uid);
-        imnodes::PushColorStyle(imnodes::ColorStyle_TitleBar,
-                                0xff + ((input_uid.value * 50) % 0xFF << 8) |
-                                    ((input_uid.value * 186) % 0xFF << 16) |
-                                    ((input_uid.value * 67) % 0xFF << 24));
-        imnodes::BeginNode(input_uid.value);
+    for (auto& [input_uid, item] : factory.items) {
+        if (item.type != Item::NodeType::Input) {
+            continue;
+        }
+        imnodes::PushColorStyle(imnodes::ColorStyle_TitleBar, node_title_color(input_uid));
+        imnodes::BeginNode(ids.id(input_uid));
 
         imnodes::BeginNodeTitleBar();
-        if (!cache.item_nodes().contains(input_uid) ||
-            cache.item_nodes().at(input_uid).inputs.empty()) {
+        if (graph.consumers(input_uid).empty()) {
             if (ImGui::CloseButton(ImGui::GetID("delete"), ImVec2{ImGui::GetCursorPosX() + 3,
                                                                   ImGui::GetCursorPosY() + 45})) {
                 to_delete = input_uid;
@@ -84,7 +165,7 @@ inline std::optional<Uid> draw_factory_inputs(const Factory& factory, const Fact
         ImGui::TextUnformatted("Input");
         imnodes::EndNodeTitleBar();
 
-        imnodes::BeginOutputAttribute(item.attribute_uid.value);
+        imnodes::BeginOutputAttribute(ids.id(item.attribute_uid));
         ImGui::Text("%s", item.name.c_str());
         imnodes::EndOutputAttribute();
 
@@ -98,6 +179,7 @@ inline std::optional<Uid> draw_factory_inputs(const Factory& factory, const Fact
 
 inline void draw_factory_machines(const Factory& factory,
                                   const Factory::Cache& _cache,
+                                  ImnodesIds& ids,
                                   Factory::MachinesT::const_iterator& out_machine_to_erase,
                                   Factory::MachinesT::const_iterator& out_machine_to_edit) {
     for (auto machine_it = factory.machines.cbegin(); machine_it != factory.machines.cend();
@@ -105,11 +187,8 @@ inline void draw_factory_machines(const Factory& factory,
         const auto machine_uid = machine_it->first;
         const auto& machine = machine_it->second;
 
-        imnodes::PushColorStyle(imnodes::ColorStyle_TitleBar,
-                                0xff + ((machine_uid.value * 50) % 0xFF << 8) |
-                                    ((machine_uid.value * 186) % 0xFF << 16) |
-                                    ((machine_uid.value * 67) % 0xFF << 24));
-        imnodes::BeginNode(machine_uid.value);
+        imnodes::PushColorStyle(imnodes::ColorStyle_TitleBar, node_title_color(machine_uid));
+        imnodes::BeginNode(ids.id(machine_uid));
 
         imnodes::BeginNodeTitleBar();
         if (ImGui::CloseButton(ImGui::GetID("delete"),
@@ -128,20 +207,20 @@ inline void draw_factory_machines(const Factory& factory,
 
         for (auto& input : machine.inputs) {
             const auto& item = factory.items.at(input.item);
-            imnodes::BeginInputAttribute(input.uid.value);
-            ImGui::Text("%i %s", input.quantity, item.name.c_str());
+            imnodes::BeginInputAttribute(ids.id(input.uid));
+            ImGui::TextUnformatted(fmt::format("{} {}", input.quantity, item.name).c_str());
             imnodes::EndInputAttribute();
         }
 
         for (auto& output : machine.outputs) {
             const auto& item = factory.items.at(output.item);
-            imnodes::BeginOutputAttribute(output.uid.value);
+            imnodes::BeginOutputAttribute(ids.id(output.uid));
             ImGui::Indent(40);
-            ImGui::Text("%i %s", output.quantity, item.name.c_str());
+            ImGui::TextUnformatted(fmt::format("{} {}", output.quantity, item.name).c_str());
             imnodes::EndOutputAttribute();
         }
 
-        ImGui::TextDisabled("%li t/op", machine.op_time.count());
+        ImGui::TextDisabled("%s", fmt::format("{} t/op", machine.op_time.count()).c_str());
 
         imnodes::EndNode();
 
@@ -151,22 +230,22 @@ inline void draw_factory_machines(const Factory& factory,
 
 /// Returns the input to delete, if any
 inline std::optional<Uid> draw_factory_outputs(const Factory& factory,
-                                               const Factory::Cache& cache) {
+                                               const ItemGraph& graph,
+                                               const Factory::Cache& cache,
+                                               ImnodesIds& ids) {
     std::optional<Uid> to_delete;
 
-    for (auto& output_uid : cache.outputs()) {
-        const auto& item = factory.items.at(output_uid);
-        imnodes::PushColorStyle(imnodes::ColorStyle_TitleBar,
-                                0xff + ((output_uid.value * 50) % 0xFF << 8) |
-                                    ((output_uid.value * 186) % 0xFF << 16) |
-                                    ((output_uid.value * 67) % 0xFF << 24));
-        imnodes::BeginNode(output_uid.value);
+    for (auto& [output_uid, item] : factory.items) {
+        if (item.type != Item::NodeType::Output) {
+            continue;
+        }
+        imnodes::PushColorStyle(imnodes::ColorStyle_TitleBar, node_title_color(output_uid));
+        imnodes::BeginNode(ids.id(output_uid));
 
         imnodes::BeginNodeTitleBar();
         ImGui::PushStyleColor(ImGuiCol_HeaderHovered, ImVec4(0, 0, 0, 0));
         ImGui::PushStyleColor(ImGuiCol_HeaderActive, ImVec4(0, 0, 0, 0));
-        if (!cache.item_nodes().contains(output_uid) ||
-            cache.item_nodes().at(output_uid).outputs.empty()) {
+        if (graph.producers(output_uid).empty()) {
             if (ImGui::CloseButton(ImGui::GetID("delete"), ImVec2{ImGui::GetCursorPosX() + 3,
                                                                   ImGui::GetCursorPosY() + 45})) {
                 to_delete = output_uid;
@@ -182,7 +261,7 @@ inline std::optional<Uid> draw_factory_outputs(const Factory& factory,
         ImGui::PopStyleColor();
         imnodes::EndNodeTitleBar();
 
-        imnodes::BeginInputAttribute(item.attribute_uid.value);
+        imnodes::BeginInputAttribute(ids.id(item.attribute_uid));
         draw_item_graph(factory, cache, output_uid, expand_graph);
         imnodes::EndInputAttribute();
 
@@ -194,75 +273,104 @@ inline std::optional<Uid> draw_factory_outputs(const Factory& factory,
     return to_delete;
 }
 
-inline void
-draw_factory_links(const Factory& factory, const Factory::Cache& cache, UidPool& uid_gen) {
-    for (auto& [item_uid, node] : cache.item_nodes()) {
-        for (auto& input : node.inputs) {
-            for (auto& output : node.outputs) {
-                // FIXME: These generated UIDs will be discarded in a single frame! We should reuse
-                // them
-                imnodes::Link(
-                    uid_gen.generate().value,
-                    factory.machines.at(input.machine).inputs[input.io_index].uid.value,
-                    factory.machines.at(output.machine).outputs[output.io_index].uid.value);
+inline void draw_factory_links(const Factory& factory, const ItemGraph& graph, ImnodesIds& ids) {
+    const auto draw_link = [&ids](Uid start_attribute, Uid end_attribute) {
+        imnodes::Link(ids.link_id(start_attribute, end_attribute), ids.id(start_attribute),
+                      ids.id(end_attribute));
+    };
+
+    for (const auto& [item_uid, item] : factory.items) {
+        const auto consumers = graph.consumers(item_uid);
+        const auto producers = graph.producers(item_uid);
+        for (auto& input : consumers) {
+            for (auto& output : producers) {
+                draw_link(factory.machines.at(input.machine).inputs[input.io_index].uid,
+                          factory.machines.at(output.machine).outputs[output.io_index].uid);
             }
         }
 
-        auto& item = factory.items.at(item_uid);
-
         if (item.type == Item::NodeType::Input) {
-            for (auto& input : node.inputs) {
-                imnodes::Link(uid_gen.generate().value,
-                              factory.machines.at(input.machine).inputs[input.io_index].uid.value,
-                              item.attribute_uid.value);
+            for (auto& input : consumers) {
+                draw_link(factory.machines.at(input.machine).inputs[input.io_index].uid,
+                          item.attribute_uid);
             }
         } else if (item.type == Item::NodeType::Output) {
-            for (auto& output : node.outputs) {
-                imnodes::Link(
-                    uid_gen.generate().value, item.attribute_uid.value,
-                    factory.machines.at(output.machine).outputs[output.io_index].uid.value);
+            for (auto& output : producers) {
+                draw_link(item.attribute_uid,
+                          factory.machines.at(output.machine).outputs[output.io_index].uid);
             }
         }
     }
 }
 
+/// A combo to pick an item, with a field to search them by name. Only the items scrolled into
+/// view are submitted.
+/// @returns Whether an item was picked.
+inline bool draw_item_combo(const char* label,
+                            const Factory& factory,
+                            const ItemSearchIndex& item_search,
+                            Uid& item_uid) {
+    const auto item = factory.items.find(item_uid);
+    const auto* preview = item != factory.items.end() ? item->second.name.c_str() : "";
+    if (!ImGui::BeginCombo(label, preview, ImGuiComboFlags_HeightLarge)) {
+        return false;
+    }
+
+    // Only one combo is open at a time
+    static ItemFilter filter;
+    if (ImGui::IsWindowAppearing()) {
+        filter.query.clear();
+        ImGui::SetKeyboardFocusHere();
+    }
+    const bool pick_first = ImGui::InputTextWithHint("##search", "Search", &filter.query,
+                                                     ImGuiInputTextFlags_EnterReturnsTrue);
+    const auto& items = filter.refresh(item_search);
+    bool picked = false;
+    if (pick_first && !items.empty()) {
+        item_uid = items.front();
+        picked = true;
+        ImGui::CloseCurrentPopup();
+    }
+
+    ImGuiListClipper clipper;
+    clipper.Begin(static_cast<int>(items.size()));
+    while (clipper.Step()) {
+        for (auto row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+            const auto uid = items[static_cast<std::size_t>(row)];
+            const auto& name = factory.items.at(uid).name;
+            if (ImGui::Selectable(fmt::format("{}##{}", name, uid.value).c_str(),
+                                  uid == item_uid)) {
+                item_uid = uid;
+                picked = true;
+            }
+        }
+    }
+    ImGui::EndCombo();
+    return picked;
+}
+
 inline bool draw_machine_editor(const Factory& factory,
+                                const ItemSearchIndex& item_search,
                                 FactoryEditor::MachineEditor& editor,
                                 UidPool& uid_pool,
+                                ImnodesIds& ids,
                                 std::optional<ImVec2> node_pos = std::nullopt) {
 
-    imnodes::PushColorStyle(imnodes::ColorStyle_TitleBar,
-                            0xff + ((editor.machine_uid.value * 50) % 0xFF << 8) |
-                                ((editor.machine_uid.value * 186) % 0xFF << 16) |
-                                ((editor.machine_uid.value * 67) % 0xFF << 24));
-    imnodes::BeginNode(editor.machine_uid.value);
+    imnodes::PushColorStyle(imnodes::ColorStyle_TitleBar, node_title_color(editor.machine_uid));
+    imnodes::BeginNode(ids.id(editor.machine_uid));
     if (node_pos.has_value())
-        imnodes::SetNodeGridSpacePos(editor.machine_uid.value, *node_pos);
+        imnodes::SetNodeGridSpacePos(ids.id(editor.machine_uid), *node_pos);
 
     imnodes::BeginNodeTitleBar();
     ImGui::SelectableInput("##name", false, &editor.machine.name);
     imnodes::EndNodeTitleBar();
 
-    const auto& draw_io_manip = [&factory](ItemStream& obj) -> bool {
+    const auto& draw_io_manip = [&factory, &item_search](ItemStream& obj) -> bool {
         ImGui::SetNextItemWidth(40);
-        ImGui::DragInt("##o_quantity", &obj.quantity, 1.f, 1, 99999);
+        ImGui::DragInteger("##o_quantity", &obj.quantity, 1.f, Quantity(1), Quantity(99999));
         ImGui::SameLine();
         ImGui::SetNextItemWidth(100);
-        if (ImGui::BeginCombo("##o_item", factory.items.at(obj.item).name.c_str())) {
-            for (auto& [item_uid, item] : factory.items) {
-                const bool is_selected = obj.item == item_uid;
-                if (ImGui::Selectable(item.name.c_str(), is_selected)) {
-                    obj.item = item_uid;
-                }
-
-                // Set the initial focus when opening the combo (scrolling +
-                // keyboard navigation focus)
-                if (is_selected) {
-                    ImGui::SetItemDefaultFocus();
-                }
-            }
-            ImGui::EndCombo();
-        }
+        draw_item_combo("##o_item", factory, item_search, obj.item);
         ImGui::SameLine();
         return ImGui::SmallButton("-##rm_io");
     };
@@ -271,10 +379,14 @@ inline bool draw_machine_editor(const Factory& factory,
     ImGui::TextDisabled("Inputs");
     editor.machine.inputs.erase(
         std::remove_if(editor.machine.inputs.begin(), editor.machine.inputs.end(),
-                       [&draw_io_manip, &uid_pool](ItemStream& input) -> bool {
-                           imnodes::BeginInputAttribute(input.uid.value);
+                       [&draw_io_manip, &uid_pool, &ids](ItemStream& input) -> bool {
+                           imnodes::BeginInputAttribute(ids.id(input.uid));
                            bool remove = draw_io_manip(input);
                            imnodes::EndInputAttribute();
+                           if (remove) {
+                               uid_pool.release(input.uid);
+                               ids.forget(input.uid);
+                           }
                            return remove;
                        }),
         editor.machine.inputs.end());
@@ -288,10 +400,22 @@ inline bool draw_machine_editor(const Factory& factory,
     ImGui::TextDisabled("Outputs");
     editor.machine.outputs.erase(
         std::remove_if(editor.machine.outputs.begin(), editor.machine.outputs.end(),
-                       [&draw_io_manip, &uid_pool](ItemStream& output) -> bool {
-                           imnodes::BeginOutputAttribute(output.uid.value);
+                       [&draw_io_manip, &uid_pool, &ids](ItemStream& output) -> bool {
+                           imnodes::BeginOutputAttribute(ids.id(output.uid));
                            bool remove = draw_io_manip(output);
+                           // The chance of producing the output in Monte Carlo simulations
+                           ImGui::SameLine();
+                           ImGui::SetNextItemWidth(45);
+                           float percent = output.probability * 100.f;
+                           if (ImGui::DragFloat("##o_chance", &percent, 1.f, 0.f, 100.f,
+                                                "%.0f%%")) {
+                               output.probability = std::clamp(percent, 0.f, 100.f) / 100.f;
+                           }
                            imnodes::EndOutputAttribute();
+                           if (remove) {
+                               uid_pool.release(output.uid);
+                               ids.forget(output.uid);
+                           }
                            return remove;
                        }),
         editor.machine.outputs.end());
@@ -309,6 +433,22 @@ inline bool draw_machine_editor(const Factory& factory,
     ImGui::SameLine();
     ImGui::TextDisabled("t/op");
 
+    // How the operation time varies in Monte Carlo simulations
+    auto& distribution = editor.machine.op_time_distribution;
+    ImGui::SetNextItemWidth(80);
+    ImGui::Combo("##distribution", reinterpret_cast<int*>(&distribution.type),
+                 "Fixed\0Uniform\0Normal\0");
+    if (distribution.type != OpTimeDistribution::Type::Fixed) {
+        ImGui::SameLine();
+        ImGui::SetNextItemWidth(50);
+        int spread = static_cast<int>(distribution.spread.count());
+        ImGui::DragInt("##spread", &spread, 1.f, 0, 99999);
+        distribution.spread = util::ticks(spread);
+        ImGui::SameLine();
+        ImGui::TextDisabled(distribution.type == OpTimeDistribution::Type::Uniform ? "t +/-"
+                                                                                   : "t stddev");
+    }
+
     bool is_finished = ImGui::Button("Finish");
 
     imnodes::EndNode();
@@ -0,0 +1,122 @@
+#include "editor/edit_history.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+
+namespace fmk {
+
+namespace {
+
+/// Whether a chunk ends after the entry with this UID. UIDs are mostly sequential and different
+/// kinds of elements take them in a pattern, so their bits are mixed before deciding.
+bool ends_chunk(Uid uid) {
+    constexpr std::uint64_t golden_ratio = 0x9e3779b97f4a7c15;
+    const auto mixed = static_cast<std::uint64_t>(uid.value) * golden_ratio;
+    return (mixed >> 32) % FactorySnapshot::average_chunk_size == 0;
+}
+
+} // namespace
+
+FactorySnapshot::FactorySnapshot(const Factory& factory, const FactorySnapshot* previous) :
+    items(make_chunks(factory.items, previous ? &previous->items : nullptr)),
+    machines(make_chunks(factory.machines, previous ? &previous->machines : nullptr)) {}
+
+template<typename T>
+FactorySnapshot::ChunksT<T> FactorySnapshot::make_chunks(const util::UidMap<T>& entries,
+                                                         const ChunksT<T>* previous) {
+    // Chunks that didn't change start with the same UID as before
+    std::unordered_map<Uid, const std::shared_ptr<const ChunkT<T>>*> previous_chunks;
+    if (previous) {
+        previous_chunks.reserve(previous->size());
+        for (const auto& chunk : *previous) {
+            previous_chunks.emplace(chunk->front().first, &chunk);
+        }
+    }
+
+    ChunksT<T> chunks;
+    for (auto start = entries.begin(); start != entries.end();) {
+        auto end = start;
+        while (end != entries.end() && !ends_chunk((end++)->first)) {}
+
+        const auto same = previous_chunks.find(start->first);
+        if (same != previous_chunks.end() && std::equal(start, end, (*same->second)->begin(),
+                                                        (*same->second)->end())) {
+            chunks.emplace_back(*same->second);
+        } else {
+            chunks.emplace_back(std::make_shared<const ChunkT<T>>(start, end));
+        }
+        start = end;
+    }
+    return chunks;
+}
+
+Factory FactorySnapshot::restore() const {
+    Factory factory;
+    const auto copy_chunks = [](const auto& chunks, auto& entries) {
+        std::size_t size = 0;
+        for (const auto& chunk : chunks) { size += chunk->size(); }
+        entries.reserve(size);
+        for (const auto& chunk : chunks) {
+            for (const auto& [uid, value] : *chunk) { entries.try_emplace(uid, value); }
+        }
+    };
+    copy_chunks(items, factory.items);
+    copy_chunks(machines, factory.machines);
+    return factory;
+}
+
+EditHistory::EditHistory(std::size_t max_steps, std::size_t max_cached_results) :
+    max_steps(std::max(max_steps, std::size_t(1))), max_cached_results(max_cached_results) {}
+
+void EditHistory::reset(const Factory& factory,
+                        const UidPool& uid_pool,
+                        std::shared_ptr<const Factory::Cache> cache) {
+    steps.clear();
+    current = 0;
+    steps.push_back(Step{FactorySnapshot(factory), uid_pool, std::move(cache)});
+}
+
+void EditHistory::record(const Factory& factory,
+                         const UidPool& uid_pool,
+                         std::shared_ptr<const Factory::Cache> cache) {
+    if (steps.empty()) {
+        reset(factory, uid_pool, std::move(cache));
+        return;
+    }
+
+    steps.erase(steps.begin() + static_cast<std::ptrdiff_t>(current) + 1, steps.end());
+    steps.push_back(Step{FactorySnapshot(factory, &steps.back().factory), uid_pool,
+                         std::move(cache)});
+    if (steps.size() > max_steps) {
+        steps.pop_front();
+    }
+    current = steps.size() - 1;
+    drop_distant_caches();
+}
+
+const EditHistory::Step& EditHistory::undo() {
+    current--;
+    return steps[current];
+}
+
+const EditHistory::Step& EditHistory::redo() {
+    current++;
+    return steps[current];
+}
+
+void EditHistory::set_current_cache(std::shared_ptr<const Factory::Cache> cache) {
+    steps[current].cache = std::move(cache);
+    drop_distant_caches();
+}
+
+void EditHistory::drop_distant_caches() {
+    for (std::size_t step_i = 0; step_i < steps.size(); step_i++) {
+        const auto distance = step_i > current ? step_i - current : current - step_i;
+        if (distance >= max_cached_results) {
+            steps[step_i].cache.reset();
+        }
+    }
+}
+
+} // namespace fmk
\ No newline at end of file
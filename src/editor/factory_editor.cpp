@@ -1,41 +1,73 @@
 #include "editor/factory_editor.hpp"
 
-#include <boost/json.hpp>
-#include <charconv>
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
 #include <fmt/core.h>
 #include <fstream>
 #include <imgui.h>
 #include <imnodes.h>
 #include <implot.h>
-#include <iomanip>
 #include <iostream>
+#include <memory>
 #include <optional>
 #include <plog/Log.h>
+#include <sstream>
 #include <string>
-#include <string_view>
 
 #include "editor/draw_helpers.hpp"
+#include "editor/graph_layout.hpp"
+#include "io/binary_format.hpp"
+#include "io/factory_file.hpp"
+#include "io/json_format.hpp"
 #include "pfd/pfd.hpp"
-
-namespace json = boost::json;
+#include "sim/module_summary.hpp"
+#include "sim/simulation.hpp"
 
 namespace fmk {
 
 FactoryEditor::FactoryEditor() :
-    factory{.items = {}, .machines = {}}, uid_pool(Uid(Uid::INVALID_VALUE + 1)) {
+    factory{.items = {}, .machines = {}},
+    simulation_cache(io::SimulationCache::default_directory(), 256 * 1024 * 1024),
+    uid_pool(Uid(Uid::INVALID_VALUE + 1)) {
     imnodes_ctx = imnodes::EditorContextCreate();
-    auto input_stream = std::ifstream("assets/starting_program.json");
-    parse_factory_json(input_stream);
+    // Loaded in the background like any other file, so that a long simulation can be cancelled
+    start_open_job("assets/starting_program.json");
 
     imnodes::EditorContextSet(imnodes_ctx);
     imnodes::EditorContextResetPanning(ImVec2{50, 50});
 }
 
-FactoryEditor::~FactoryEditor() { imnodes::EditorContextFree(imnodes_ctx); }
+FactoryEditor::~FactoryEditor() {
+    // Every job waits for its thread when destroyed, so they are all cancelled first to stop
+    // together instead of one after the other
+    const auto cancel = [](auto& job) {
+        if (job) {
+            job->cancel();
+        }
+    };
+    cancel(load_job);
+    cancel(save_job);
+    cancel(module_job);
+    cancel(recipe_job);
+    cancel(layout_job);
+    cancel(time_to_target.job);
+    cancel(monte_carlo.job);
+    cancel(throughput.job);
+    cancel(simulation.job);
+
+    imnodes::EditorContextFree(imnodes_ctx);
+}
 
 void FactoryEditor::draw() {
+    update_simulation();
+    update_file_jobs();
     update_processing_graph();
     update_item_statistics();
+    update_plot_export();
+    update_time_to_target();
+    update_monte_carlo();
+    update_recipes();
 }
 
 void FactoryEditor::update_processing_graph() {
@@ -44,27 +76,64 @@ void FactoryEditor::update_processing_graph() {
 
     if (ImGui::BeginMenuBar()) {
         if (ImGui::BeginMenu("File")) {
-            if (ImGui::MenuItem("Open...")) {
-                const auto selection = pfd::open_file("Open Factory").result();
-                if (!selection.empty()) {
-                    std::ifstream file(selection[0]);
-                    parse_factory_json(file);
-                    PLOGD << "Imported data from '" << selection[0] << "'";
-                }
+            const bool is_busy = open_dialog || save_dialog || export_dialog || embed_dialog ||
+                                 recipe_dialog || load_job || save_job || module_job ||
+                                 recipe_job;
+            if (ImGui::MenuItem("Open...", nullptr, false, !is_busy)) {
+                open_dialog = std::make_unique<pfd::open_file>(
+                    "Open Factory", "",
+                    std::vector<std::string>{"Factory Files", "*.json *.fmkb", "All Files", "*"});
+            }
+            if (ImGui::MenuItem("Save As...", nullptr, false, !is_busy)) {
+                save_dialog = std::make_unique<pfd::save_file>(
+                    "Save Factory", "",
+                    std::vector<std::string>{"JSON Factory", "*.json", "Binary Factory",
+                                             "*.fmkb"});
             }
-            if (ImGui::MenuItem("Save As...")) {
-                const auto destination = pfd::save_file("Save Factory").result();
-                if (!destination.empty()) {
-                    std::ofstream file(destination);
-                    output_factory_json(file);
-                    PLOGD << "Exported data to '" << destination << "'";
+            ImGui::MenuItem("Export Plots...", nullptr, &show_plot_export_window);
+            if (ImGui::MenuItem("Embed Module...", nullptr, false, !is_busy)) {
+                embed_dialog = std::make_unique<pfd::open_file>(
+                    "Embed Module", "",
+                    std::vector<std::string>{"Factory Files", "*.json *.fmkb", "All Files", "*"});
+            }
+            if (ImGui::MenuItem("Import From Clipboard", nullptr, false, !is_busy)) {
+                if (const char* clipboard = ImGui::GetClipboardText()) {
+                    start_import_job(clipboard);
                 }
             }
-            if (ImGui::MenuItem("Import From Clipboard")) {
-                auto input = std::istringstream(ImGui::GetClipboardText());
-                parse_factory_json(input);
-                PLOGD << "Imported clipboard data";
+            if (ImGui::MenuItem("Import Recipes...", nullptr, false, !is_busy)) {
+                recipe_dialog = std::make_unique<pfd::open_file>(
+                    "Import Recipes", "",
+                    std::vector<std::string>{"Recipe Files", "*.json *.csv", "All Files", "*"});
             }
+            ImGui::MenuItem("Recipes", nullptr, &show_recipes_window, recipes.catalog != nullptr);
+            ImGui::EndMenu();
+        }
+        const bool can_edit_history = !new_machine && !load_job;
+        if (ImGui::BeginMenu("Edit")) {
+            if (ImGui::MenuItem("Undo", "Ctrl+Z", false, can_edit_history && history.can_undo())) {
+                undo();
+            }
+            if (ImGui::MenuItem("Redo", "Ctrl+Y", false, can_edit_history && history.can_redo())) {
+                redo();
+            }
+            ImGui::Separator();
+            if (ImGui::MenuItem("Arrange Nodes", nullptr, false, !layout_job && !load_job)) {
+                start_layout_job();
+            }
+            ImGui::EndMenu();
+        }
+        if (const auto& imgui_io = ImGui::GetIO();
+            imgui_io.KeyCtrl && !imgui_io.WantTextInput && can_edit_history) {
+            if (ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_Z)) && history.can_undo()) {
+                undo();
+            } else if (ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_Y)) && history.can_redo()) {
+                redo();
+            }
+        }
+        if (ImGui::BeginMenu("Simulation")) {
+            ImGui::MenuItem("Time To Target...", nullptr, &show_time_to_target_window);
+            ImGui::MenuItem("Monte Carlo...", nullptr, &show_monte_carlo_window);
             ImGui::EndMenu();
         }
         if (ImGui::BeginMenu("Debug")) {
@@ -72,6 +141,26 @@ void FactoryEditor::update_processing_graph() {
             ImGui::MenuItem("Show ImPlot Demo Window", nullptr, &show_implot_demo_window);
             ImGui::EndMenu();
         }
+        for (const auto* progress : {simulation.job ? &simulation.job->progress() : nullptr,
+                                     load_job ? &load_job->progress() : nullptr,
+                                     save_job ? &save_job->progress() : nullptr,
+                                     module_job ? &module_job->progress() : nullptr,
+                                     recipe_job ? &recipe_job->progress() : nullptr,
+                                     layout_job ? &layout_job->progress() : nullptr}) {
+            if (progress) {
+                ImGui::ProgressBar(progress->fraction(), ImVec2(200, 0),
+                                   progress->stage().c_str());
+            }
+        }
+        // Only loading and summarizing modules simulate, which is what can take arbitrarily long
+        if ((load_job || module_job) && ImGui::SmallButton("Cancel")) {
+            if (load_job) {
+                load_job->cancel();
+            }
+            if (module_job) {
+                module_job->cancel();
+            }
+        }
         ImGui::EndMenuBar();
     }
 
@@ -89,44 +178,54 @@ void FactoryEditor::update_processing_graph() {
     auto machine_to_erase = factory.machines.cend();
     auto machine_to_edit = factory.machines.cend();
 
-    if (const auto input_to_delete = draw_factory_inputs(factory, cache.factory_cache)) {
-        factory.items.erase(*input_to_delete);
+    if (const auto input_to_delete =
+            draw_factory_inputs(factory, item_graph, imnodes_ids)) {
+        erase_item(*input_to_delete);
         regenerate_cache();
     }
-    draw_factory_machines(factory, cache.factory_cache, machine_to_erase, machine_to_edit);
-    if (const auto output_to_delete = draw_factory_outputs(factory, cache.factory_cache)) {
-        factory.items.erase(*output_to_delete);
+    draw_factory_machines(factory, *cache.factory_cache, imnodes_ids, machine_to_erase,
+                          machine_to_edit);
+    if (const auto output_to_delete =
+            draw_factory_outputs(factory, item_graph, *cache.factory_cache, imnodes_ids)) {
+        erase_item(*output_to_delete);
         regenerate_cache();
     }
-    draw_factory_links(factory, cache.factory_cache, uid_pool);
+    draw_factory_links(factory, item_graph, imnodes_ids);
 
     if (new_machine) {
-        if (draw_machine_editor(factory, *new_machine, uid_pool, editor_node_start_pos)) {
+        if (draw_machine_editor(factory, item_search, *new_machine, uid_pool, imnodes_ids,
+                                editor_node_start_pos)) {
             factory.machines[new_machine->machine_uid] = std::move(new_machine->machine);
             new_machine.reset();
             regenerate_cache();
         }
         editor_node_start_pos.reset();
     } else if (machine_to_erase != factory.machines.end()) {
+        const auto& machine = machine_to_erase->second;
+        remember_node_position(machine_to_erase->first);
+        for (const auto* io : {&machine.inputs, &machine.outputs}) {
+            for (const auto& stream : *io) { release_uid(stream.uid); }
+        }
+        release_uid(machine_to_erase->first);
         factory.machines.erase(machine_to_erase);
 
         regenerate_cache();
     } else if (machine_to_edit != factory.machines.cend()) {
         auto [uid, machine] = *machine_to_edit;
 
+        // The machine is only recorded in the history once the changes are applied
         factory.machines.erase(machine_to_edit);
-        regenerate_cache();
-
         new_machine = MachineEditor{machine, uid};
+        regenerate_cache();
     }
 
     imnodes::EndNodeEditor();
 
-    if (int start_attr; imnodes::IsLinkDropped(&start_attr)) {
-        [&]() {
+    if (int start_attr_id; imnodes::IsLinkDropped(&start_attr_id)) {
+        [&, start_attr = imnodes_ids.uid(start_attr_id)]() {
             for (const auto& [machine_uid, machine] : factory.machines) {
                 for (const auto& input : machine.inputs) {
-                    if (start_attr == input.uid.value) {
+                    if (start_attr == input.uid) {
                         // Convert this machine's input item into an input!
                         factory.items.at(input.item).type = Item::NodeType::Input;
 
@@ -138,7 +237,7 @@ void FactoryEditor::update_processing_graph() {
 
             for (const auto& [machine_uid, machine] : factory.machines) {
                 for (const auto& output : machine.outputs) {
-                    if (start_attr == output.uid.value) {
+                    if (start_attr == output.uid) {
                         // Convert this machine's output item into an output!
                         factory.items.at(output.item).type = Item::NodeType::Output;
 
@@ -168,46 +267,57 @@ void FactoryEditor::update_processing_graph() {
         static auto flags = ImGuiTableFlags_Resizable | ImGuiTableFlags_Reorderable |
                             ImGuiTableFlags_Hideable | ImGuiTableFlags_BordersOuter |
                             ImGuiTableFlags_BordersV | ImGuiTableFlags_SizingStretchProp |
-                            ImGuiTableFlags_RowBg;
+                            ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY;
 
         static Uid item_being_edited(Uid::INVALID_VALUE);
         static std::string item_edit_name;
         static Item::NodeType item_edit_type;
-        static int item_edit_starting_quantity;
-
-        if (ImGui::BeginTable("item_table", 4, flags)) {
+        static Quantity item_edit_starting_quantity;
+
+        ImGui::InputTextWithHint("##item_search", "Search", &item_list_filter.query);
+        const auto& listed_items = item_list_filter.refresh(item_search);
+        // Scrolls by itself, so that only the rows in view are submitted
+        const ImVec2 table_size(0, ImGui::GetTextLineHeightWithSpacing() * 16);
+        if (ImGui::BeginTable("item_table", 4, flags, table_size)) {
+            ImGui::TableSetupScrollFreeze(0, 1);
             ImGui::TableSetupColumn("Edit");
             ImGui::TableSetupColumn("Name");
             ImGui::TableSetupColumn("Type");
             ImGui::TableSetupColumn("Starting Quantity");
             ImGui::TableHeadersRow();
-            for (const auto& [item_uid, item] : factory.items) {
-                ImGui::TableNextRow();
-                ImGui::TableNextColumn();
-                if (ImGui::Button(fmt::format("Edit##{}", item_uid.value).c_str())) {
-                    item_being_edited = item_uid;
-                    item_edit_name = item.name;
-                    item_edit_type = item.type;
-                    item_edit_starting_quantity = item.starting_quantity;
-                    ImGui::OpenPopup("Edit Item");
-                }
-                ImGui::TableNextColumn();
-                ImGui::Text(item.name.data());
-                ImGui::TableNextColumn();
-                switch (item.type) {
-                    case Item::NodeType::Input: ImGui::Text("Input"); break;
-                    case Item::NodeType::Output: ImGui::Text("Output"); break;
-                    case Item::NodeType::Internal: ImGui::Text("Internal"); break;
+            ImGuiListClipper clipper;
+            clipper.Begin(static_cast<int>(listed_items.size()));
+            while (clipper.Step()) {
+                for (auto row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+                    const auto item_uid = listed_items[static_cast<std::size_t>(row)];
+                    const auto& item = factory.items.at(item_uid);
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn();
+                    if (ImGui::Button(fmt::format("Edit##{}", item_uid.value).c_str())) {
+                        item_being_edited = item_uid;
+                        item_edit_name = item.name;
+                        item_edit_type = item.type;
+                        item_edit_starting_quantity = item.starting_quantity;
+                        ImGui::OpenPopup("Edit Item");
+                    }
+                    ImGui::TableNextColumn();
+                    ImGui::Text(item.name.data());
+                    ImGui::TableNextColumn();
+                    switch (item.type) {
+                        case Item::NodeType::Input: ImGui::Text("Input"); break;
+                        case Item::NodeType::Output: ImGui::Text("Output"); break;
+                        case Item::NodeType::Internal: ImGui::Text("Internal"); break;
+                    }
+                    ImGui::TableNextColumn();
+                    ImGui::TextUnformatted(fmt::format("{}", item.starting_quantity).c_str());
                 }
-                ImGui::TableNextColumn();
-                ImGui::Text("%i", item.starting_quantity);
             }
 
             if (ImGui::BeginPopup("Edit Item")) {
                 ImGui::InputText("Name", item_edit_name.data(), item_edit_name.capacity());
                 ImGui::Combo("Type", reinterpret_cast<int*>(&item_edit_type),
                              "Input\0Output\0Internal");
-                ImGui::InputInt("Starting Quantity", &item_edit_starting_quantity);
+                ImGui::InputInteger("Starting Quantity", &item_edit_starting_quantity);
                 if (ImGui::Button("Cancel")) {
                     item_being_edited = Uid(Uid::INVALID_VALUE);
                     ImGui::CloseCurrentPopup();
@@ -231,10 +341,10 @@ void FactoryEditor::update_processing_graph() {
 
         static char name[50];
         static int type;
-        static int starting_quantity;
+        static Quantity starting_quantity;
         ImGui::InputText("Name", name, sizeof(name));
         ImGui::Combo("Type", &type, "Input\0Output\0Internal");
-        ImGui::InputInt("Starting Quantity", &starting_quantity);
+        ImGui::InputInteger("Starting Quantity", &starting_quantity);
         if (ImGui::Button("Create new item")) {
             factory.items[uid_pool.generate()] = Item{
                 static_cast<Item::NodeType>(type),
@@ -244,13 +354,13 @@ void FactoryEditor::update_processing_graph() {
             regenerate_cache();
         }
 
-        ImGui::Text("Inputs");
-        for (const auto& input : cache.factory_cache.inputs()) {
-            ImGui::TextDisabled("%s", factory.items.at(input).name.c_str());
-        }
-        ImGui::Text("Outputs");
-        for (const auto& output : cache.factory_cache.outputs()) {
-            ImGui::TextDisabled("%s", factory.items.at(output).name.c_str());
+        for (const auto type : {Item::NodeType::Input, Item::NodeType::Output}) {
+            ImGui::Text(type == Item::NodeType::Input ? "Inputs" : "Outputs");
+            for (const auto& [item_uid, item] : factory.items) {
+                if (item.type == type) {
+                    ImGui::TextDisabled("%s", item.name.c_str());
+                }
+            }
         }
 
         ImGui::End();
@@ -261,335 +371,753 @@ void FactoryEditor::update_processing_graph() {
 
 void FactoryEditor::update_item_statistics() {
     ImGui::Begin("Item Statistics");
-    for (auto& [item_name, _] : factory.items) {
-        draw_item_graph(factory, cache.factory_cache, item_name, true);
+    if (const auto& overflow = cache.factory_cache->overflow()) {
+        const auto item = factory.items.find(overflow->item);
+        ImGui::TextColored(
+            ImVec4(1.f, .4f, .4f, 1.f), "%s",
+            fmt::format("The simulation stopped at tick {}: the quantity of '{}' overflowed",
+                        overflow->tick, item != factory.items.end() ? item->second.name : "?")
+                .c_str());
+    }
+
+    ImGui::Checkbox("Throughput", &throughput.is_shown);
+    if (throughput.is_shown) {
+        ImGui::SameLine();
+        ImGui::SetNextItemWidth(100);
+        int window = static_cast<int>(throughput.window);
+        if (ImGui::InputInt("Ticks Per Window", &window)) {
+            throughput.window = static_cast<std::size_t>(std::max(window, 1));
+            throughput.series.clear();
+        }
+        ImGui::SameLine();
+        ImGui::Checkbox("Per Second", &throughput.per_second);
     }
+    if (throughput.job) {
+        ImGui::SameLine();
+        ImGui::ProgressBar(throughput.job->progress().fraction(), ImVec2(100, 0), "Simulating");
+    }
+    if (throughput.cache.lock() != cache.factory_cache) {
+        throughput.series.clear();
+        throughput.cache = cache.factory_cache;
+    }
+    // Series simulated for other results or another window are dropped when the job finishes
+    const bool is_job_current = throughput.job_cache.lock() == cache.factory_cache &&
+                                throughput.job_window == throughput.window;
+    if (throughput.job && !is_job_current) {
+        throughput.job->cancel();
+    }
+    if (throughput.job && throughput.job->is_ready()) {
+        auto series = throughput.job->take_result();
+        if (is_job_current) {
+            for (auto& item_series : series) {
+                throughput.series.emplace(item_series.item, std::move(item_series));
+            }
+        }
+        throughput.job.reset();
+    }
+
+    for (auto& [item_uid, _] : factory.items) {
+        const sim::MonteCarloResult::Bands* bands = nullptr;
+        if (monte_carlo.result) {
+            const auto item_bands = monte_carlo.result->bands.find(item_uid);
+            bands = item_bands != monte_carlo.result->bands.end() ? &item_bands->second : nullptr;
+        }
+        // Like plots, throughput is only calculated for the items in view
+        const sim::ThroughputSeries* series = nullptr;
+        if (throughput.is_shown && ImGui::IsRectVisible(ImVec2(400, 200))) {
+            const auto item_series = throughput.series.find(item_uid);
+            if (item_series != throughput.series.end()) {
+                series = &item_series->second;
+            } else {
+                throughput.missing.emplace_back(item_uid);
+            }
+        }
+        draw_item_graph(factory, *cache.factory_cache, item_uid, true, false, bands, series,
+                        throughput.per_second);
+    }
+    // Items that come into view while the job runs are simulated by the next one. Series are
+    // keyed by the results shown, so none are simulated until those match the factory again
+    if (!throughput.missing.empty() && !throughput.job && !simulation.job) {
+        throughput.job_cache = cache.factory_cache;
+        throughput.job_window = throughput.window;
+        throughput.job.emplace([factory = factory, ticks = cache.factory_cache->ticks_simulated(),
+                                items = throughput.missing,
+                                window = throughput.window](util::JobProgress& progress) {
+            return sim::simulate_throughput(factory, ticks, items, window, &progress);
+        });
+    }
+    throughput.missing.clear();
     ImGui::End();
 }
 
-void FactoryEditor::regenerate_cache() {
-    cache.factory_cache = factory.generate_cache(cache.factory_cache.ticks_simulated());
-}
+void FactoryEditor::update_plot_export() {
+    if (!show_plot_export_window) {
+        return;
+    }
 
-void FactoryEditor::parse_factory_json(std::istream& input) {
-    Factory::MachinesT parsed_machines;
-    Factory::ItemsT parsed_items;
-    std::size_t ticks_to_simulate = 6000;
-    bool had_errors = false;
+    if (ImGui::Begin("Export Plots", &show_plot_export_window)) {
+        ImGui::Checkbox("All Items", &plot_export.all_items);
+        if (!plot_export.all_items) {
+            for (const auto& [item_uid, item] : factory.items) {
+                bool selected = plot_export.items.contains(item_uid);
+                if (ImGui::Checkbox(fmt::format("{}##{}", item.name, item_uid.value).c_str(),
+                                    &selected)) {
+                    if (selected) {
+                        plot_export.items.insert(item_uid);
+                    } else {
+                        plot_export.items.erase(item_uid);
+                    }
+                }
+            }
+        }
 
-    // We set the editor context to be able to set positions
-    imnodes::EditorContextSet(imnodes_ctx);
+        ImGui::Separator();
+        ImGui::Combo("Downsampling", reinterpret_cast<int*>(&plot_export.options.downsampling),
+                     "None\0Every Nth Tick\0Min/Max Per Bucket\0");
+        if (plot_export.options.downsampling != io::PlotExportOptions::Downsampling::None) {
+            int bucket_size = static_cast<int>(plot_export.options.bucket_size);
+            if (ImGui::InputInt("Ticks Per Bucket", &bucket_size)) {
+                plot_export.options.bucket_size =
+                    static_cast<std::size_t>(std::max(bucket_size, 1));
+            }
+        }
 
-    auto parse_xy = [](json::object const& object, Uid uid) {
-        if (auto x_val = object.if_contains("x")) {
-            imnodes::SetNodeGridSpacePos(uid.value,
-                                         {static_cast<float>(x_val->as_double()),
-                                          static_cast<float>(object.at("y").as_double())});
+        bool export_throughput = plot_export.options.throughput_window > 0;
+        if (ImGui::Checkbox("Throughput", &export_throughput)) {
+            plot_export.options.throughput_window = export_throughput ? throughput.window : 0;
+        }
+        if (export_throughput) {
+            int window = static_cast<int>(plot_export.options.throughput_window);
+            if (ImGui::InputInt("Ticks Per Window", &window)) {
+                plot_export.options.throughput_window =
+                    static_cast<std::size_t>(std::max(window, 1));
+            }
         }
-    };
 
-    json::error_code parse_error;
-    json::stream_parser parser;
-    std::size_t line_i = 0;
-    for (std::string line; !parse_error && std::getline(input, line); line_i++) {
-        parser.write_some(line, parse_error);
+        const bool is_busy = open_dialog || save_dialog || export_dialog || save_job;
+        if (ImGui::Button("Export CSV...") && !is_busy) {
+            plot_export.as_csv = true;
+            export_dialog = std::make_unique<pfd::save_file>(
+                "Export Plots", "", std::vector<std::string>{"CSV", "*.csv"});
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Export Columnar...") && !is_busy) {
+            plot_export.as_csv = false;
+            export_dialog = std::make_unique<pfd::save_file>(
+                "Export Plots", "", std::vector<std::string>{"Columnar Plots", "*.fmks"});
+        }
     }
-    parser.finish(parse_error);
+    ImGui::End();
+}
 
-    if (parse_error) {
-        PLOG_ERROR << fmt::format("JSON parsing error on line {}: {}", line_i,
-                                  parse_error.message());
-        had_errors = true;
-    } else {
-        auto val = parser.release();
-        if (const auto obj = val.if_object()) {
-            Uid next_uid(-1);
-            if (const auto uid_pool_val = obj->if_contains("uid_pool")) {
-                next_uid.value =
-                    static_cast<int>(uid_pool_val->as_object().at("next_uid").as_int64());
-            } else {
-                PLOG_ERROR << "JSON loading error: `uid_pool` key not found";
-                had_errors = true;
-            }
-            UidPool parse_uid_pool(next_uid);
-            if (const auto items_val = obj->if_contains("items")) {
-                if (const auto items = items_val->if_object()) {
-                    for (const auto& [item_uid_str, item_val] : *items) {
-                        Uid item_uid(Uid::INVALID_VALUE);
-                        const auto [_, ec] = std::from_chars(
-                            item_uid_str.data(), item_uid_str.data() + item_uid_str.size(),
-                            item_uid.value);
-
-                        if (ec != std::errc()) {
-                            PLOG_ERROR << "JSON loading error: Could not parse UID";
-                            had_errors = true;
-                        }
-
-                        if (auto item = item_val.if_object()) {
-                            parsed_items[item_uid].name = item->at("name").as_string();
-                            if (auto ty = item->at("type").if_string()) {
-                                if (*ty == "input") {
-                                    parsed_items[item_uid].type = Item::NodeType::Input;
-                                    parsed_items[item_uid].attribute_uid = uid_pool.generate();
-                                } else if (*ty == "output") {
-                                    parsed_items[item_uid].type = Item::NodeType::Output;
-                                    parsed_items[item_uid].attribute_uid = uid_pool.generate();
-                                } else if (*ty == "internal") {
-                                    parsed_items[item_uid].type = Item::NodeType::Internal;
-                                }
-                            }
-                            if (auto quantity = item->at("start_with").if_int64()) {
-                                parsed_items[item_uid].starting_quantity =
-                                    static_cast<int>(*quantity);
-                            }
-
-                            parse_xy(*item, item_uid);
-                        }
-                    }
-                } else {
-                    PLOG_ERROR << "JSON loading error: `items` must be an object`";
-                    had_errors = true;
+void FactoryEditor::update_time_to_target() {
+    if (time_to_target.job && time_to_target.job->is_ready()) {
+        time_to_target.result = time_to_target.job->take_result();
+        time_to_target.job.reset();
+    }
+    if (!show_time_to_target_window) {
+        return;
+    }
+
+    if (ImGui::Begin("Time To Target", &show_time_to_target_window)) {
+        auto& condition = time_to_target.condition;
+        ImGui::Combo("Condition", reinterpret_cast<int*>(&condition.type),
+                     "Item Reaches\0Item Drops To\0Any Buffer Drops To\0Steady State\0");
+
+        const bool needs_item = condition.type == sim::StopCondition::Type::Reaches ||
+                                condition.type == sim::StopCondition::Type::DropsTo;
+        const auto item = factory.items.find(condition.item);
+        if (needs_item) {
+            draw_item_combo("Item", factory, item_search, condition.item);
+        }
+        if (condition.type == sim::StopCondition::Type::SteadyState) {
+            if (ImGui::InputInteger("Window (Ticks)", &condition.window)) {
+                condition.window = std::max(condition.window, std::size_t(1));
+            }
+        } else {
+            ImGui::InputInteger("Quantity", &condition.threshold);
+        }
+        ImGui::InputInteger("Max Ticks", &time_to_target.max_ticks);
+
+        if (time_to_target.job) {
+            const auto& progress = time_to_target.job->progress();
+            ImGui::ProgressBar(progress.fraction(), ImVec2(200, 0), progress.stage().c_str());
+            ImGui::SameLine();
+            if (ImGui::Button("Cancel")) {
+                time_to_target.job->cancel();
+            }
+        } else if (ImGui::Button("Find") && (!needs_item || item != factory.items.end())) {
+            // The factory keeps being edited while simulating, so the job works on a snapshot
+            time_to_target.job.emplace([factory = factory, condition = condition,
+                                        max_ticks = time_to_target.max_ticks](
+                                           util::JobProgress& progress) {
+                progress.set_stage("Simulating");
+                const auto stop =
+                    sim::find_stop(factory, std::span(&condition, 1), max_ticks, &progress);
+                if (stop) {
+                    return sim::describe_stop(factory, condition, *stop);
                 }
+                return progress.is_cancelled() ? std::string("Cancelled")
+                                               : fmt::format("Not met within {} ticks", max_ticks);
+            });
+        }
+        ImGui::TextUnformatted(time_to_target.result.c_str());
+    }
+    ImGui::End();
+}
+
+void FactoryEditor::update_monte_carlo() {
+    if (monte_carlo.job && monte_carlo.job->is_ready()) {
+        auto result = monte_carlo.job->take_result();
+        if (!monte_carlo.is_job_outdated) {
+            monte_carlo.result = std::move(result);
+        }
+        monte_carlo.job.reset();
+        monte_carlo.is_job_outdated = false;
+    }
+    if (!show_monte_carlo_window) {
+        return;
+    }
+
+    if (ImGui::Begin("Monte Carlo", &show_monte_carlo_window)) {
+        if (ImGui::InputInteger("Replicas", &monte_carlo.replicas)) {
+            monte_carlo.replicas = std::max(monte_carlo.replicas, std::size_t(1));
+        }
+        ImGui::InputInteger("Seed", &monte_carlo.seed);
+
+        if (monte_carlo.job) {
+            const auto& progress = monte_carlo.job->progress();
+            ImGui::ProgressBar(progress.fraction(), ImVec2(200, 0), progress.stage().c_str());
+            ImGui::SameLine();
+            if (ImGui::Button("Cancel")) {
+                monte_carlo.job->cancel();
             }
+        } else if (ImGui::Button("Run")) {
+            // The factory keeps being edited while simulating, so the job works on a snapshot
+            monte_carlo.job.emplace([factory = factory,
+                                     ticks = ticks_to_simulate,
+                                     replicas = monte_carlo.replicas,
+                                     seed = monte_carlo.seed](util::JobProgress& progress) {
+                progress.set_stage("Simulating replicas");
+                return sim::run_monte_carlo(factory, ticks, replicas, seed, 0, &progress);
+            });
+        }
 
-            if (auto machines_val = obj->if_contains("machines")) {
-                if (const auto machines = machines_val->if_object()) {
-                    for (const auto& [machine_uid_str, machine_val] : *machines) {
-                        Uid machine_uid(Uid::INVALID_VALUE);
-                        const auto [_, ec] = std::from_chars(
-                            machine_uid_str.data(), machine_uid_str.data() + machine_uid_str.size(),
-                            machine_uid.value);
-
-                        if (ec != std::errc()) {
-                            PLOG_ERROR << "JSON loading error: Could not parse UID";
-                            had_errors = true;
-                        }
-
-                        if (auto machine = machine_val.if_object()) {
-                            Machine result;
-
-                            if (auto name_val = machine->if_contains("name")) {
-                                if (auto name = name_val->if_string()) {
-                                    result.name = *name;
-                                } else {
-                                    PLOG_ERROR
-                                        << "JSON loading error: Machine names must be strings";
-                                    had_errors = true;
-                                }
-                            } else {
-                                PLOG_ERROR
-                                    << "JSON loading error: Machines must have a \"name\" value";
-                                had_errors = true;
-                            }
-
-                            if (auto time_val = machine->if_contains("time")) {
-                                if (auto time = time_val->if_int64()) {
-                                    result.op_time = util::ticks(*time);
-                                } else {
-                                    PLOG_ERROR << "JSON loading error: Machine operation times "
-                                                  "must be integers";
-                                    had_errors = true;
-                                }
-                            } else {
-                                PLOG_ERROR
-                                    << "JSON loading error: Machines must have a \"time\" value";
-                                had_errors = true;
-                            }
-
-                            if (auto inputs_val = machine->if_contains("inputs")) {
-                                if (auto inputs = inputs_val->if_object()) {
-                                    for (const auto& [input_uid_str, input_qty] : *inputs) {
-                                        Uid input_uid(-1);
-                                        const auto [_, ec] = std::from_chars(
-                                            input_uid_str.data(),
-                                            input_uid_str.data() + input_uid_str.size(),
-                                            input_uid.value);
-
-                                        if (ec != std::errc()) {
-                                            PLOG_ERROR << "JSON loading error: Could not parse UID";
-                                            had_errors = true;
-                                        }
-                                        if (auto quantity = input_qty.if_int64()) {
-                                            parsed_items.insert({input_uid, Item{}});
-                                            result.inputs.emplace_back(
-                                                ItemStream{input_uid, static_cast<int>(*quantity),
-                                                           parse_uid_pool.generate()});
-                                        } else {
-                                            PLOG_ERROR << "JSON loading error: Input quantities "
-                                                          "must be integers";
-                                            had_errors = true;
-                                        }
-                                    }
-                                } else {
-                                    PLOG_ERROR
-                                        << "JSON loading error: Machine inputs must be objects";
-                                    had_errors = true;
-                                }
-                            } else {
-                                PLOG_ERROR
-                                    << "JSON loading error: Machines must have an \"inputs\" value";
-                                had_errors = true;
-                            }
-
-                            if (auto outputs_val = machine->if_contains("outputs")) {
-                                if (auto outputs = outputs_val->if_object()) {
-                                    for (const auto& [output_uid_str, output_qty] : *outputs) {
-                                        Uid output_uid(-1);
-                                        const auto [_, ec] = std::from_chars(
-                                            output_uid_str.data(),
-                                            output_uid_str.data() + output_uid_str.size(),
-                                            output_uid.value);
-
-                                        if (ec != std::errc()) {
-                                            PLOG_ERROR << "JSON loading error: Could not parse UID";
-                                            had_errors = true;
-                                        }
-                                        if (auto quantity = output_qty.if_int64()) {
-                                            parsed_items.insert({output_uid, Item{}});
-                                            result.outputs.emplace_back(
-                                                ItemStream{output_uid, static_cast<int>(*quantity),
-                                                           parse_uid_pool.generate()});
-                                        } else {
-                                            PLOG_ERROR << "JSON loading error: Output quantities "
-                                                          "must be integers";
-                                            had_errors = true;
-                                        }
-                                    }
-                                } else {
-                                    PLOG_ERROR
-                                        << "JSON loading error: Machine outputs must be objects";
-                                    had_errors = true;
-                                }
-                            } else {
-                                PLOG_ERROR << "JSON loading error: Machines must have an "
-                                              "\"outputs\" value";
-                                had_errors = true;
-                            }
-
-                            parse_xy(*machine, machine_uid);
-
-                            parsed_machines[machine_uid] = result;
-                        } else {
-                            PLOG_ERROR << "JSON loading error: Machines must be JSON objects";
-                            had_errors = true;
-                        }
-                    }
-                } else {
-                    PLOG_ERROR << "JSON loading error: \"machines\" must be an array";
-                    had_errors = true;
+        if (const auto& result = monte_carlo.result) {
+            ImGui::Text("%s", fmt::format("{} replicas over {} ticks{}", result->replicas,
+                                          result->ticks_simulated,
+                                          result->cancelled ? " (cancelled)" : "")
+                                  .c_str());
+            if (result->overflowed_replicas > 0) {
+                ImGui::TextColored(
+                    ImVec4(1.f, .4f, .4f, 1.f), "%s",
+                    fmt::format("{} replicas stopped early because a quantity overflowed",
+                                result->overflowed_replicas)
+                        .c_str());
+            }
+            if (ImGui::Button("Clear")) {
+                monte_carlo.result.reset();
+            }
+        }
+    }
+    ImGui::End();
+}
+
+void FactoryEditor::update_recipes() {
+    if (!show_recipes_window || !recipes.catalog) {
+        return;
+    }
+
+    if (ImGui::Begin("Recipes", &show_recipes_window)) {
+        const auto& catalog = *recipes.catalog;
+        ImGui::TextDisabled("%s", fmt::format("{} recipes, {} items", catalog.recipe_count(),
+                                              catalog.item_count())
+                                      .c_str());
+        if (ImGui::InputTextWithHint("##recipe_search", "Search", &recipes.query)) {
+            recipes.are_matches_outdated = true;
+        }
+        if (recipes.are_matches_outdated) {
+            const auto lower = [](char c) {
+                return std::tolower(static_cast<unsigned char>(c));
+            };
+            const auto is_match = [&](std::string_view name) {
+                return std::search(name.begin(), name.end(), recipes.query.begin(),
+                                   recipes.query.end(), [&](char a, char b) {
+                                       return lower(a) == lower(b);
+                                   }) != name.end();
+            };
+            recipes.matches.clear();
+            for (io::RecipeCatalog::Index recipe = 0; recipe < catalog.recipe_count(); recipe++) {
+                if (is_match(catalog.recipe_name(recipe))) {
+                    recipes.matches.emplace_back(recipe);
                 }
             }
-            if (auto ticks_val = obj->if_contains("simulate")) {
-                if (auto ticks = ticks_val->if_int64()) {
-                    ticks_to_simulate = *ticks;
-                } else {
-                    PLOG_ERROR << "JSON loading error: \"simulate\" value must be an integer";
-                    had_errors = true;
+            recipes.are_matches_outdated = false;
+        }
+
+        const auto describe_streams = [&catalog](const auto& streams) {
+            std::string description;
+            for (const auto& stream : streams) {
+                description += fmt::format("{}{} {}", description.empty() ? "" : ", ",
+                                           stream.quantity, catalog.item_name(stream.item));
+            }
+            return description;
+        };
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(recipes.matches.size()));
+        while (clipper.Step()) {
+            for (auto row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+                const auto recipe = recipes.matches[static_cast<std::size_t>(row)];
+                if (ImGui::SmallButton(fmt::format("Add##{}", recipe).c_str())) {
+                    const auto machine_uids =
+                        io::instantiate_recipes(factory, uid_pool, catalog, std::span(&recipe, 1));
+                    place_in_view(machine_uids.front());
+                    regenerate_cache();
+                }
+                ImGui::SameLine();
+                const auto name = catalog.recipe_name(recipe);
+                ImGui::TextUnformatted(name.data(), name.data() + name.size());
+                if (ImGui::IsItemHovered()) {
+                    ImGui::SetTooltip("%s", fmt::format("{} ticks: {} -> {}",
+                                                        catalog.op_time(recipe).count(),
+                                                        describe_streams(catalog.inputs(recipe)),
+                                                        describe_streams(catalog.outputs(recipe)))
+                                                .c_str());
                 }
-            } else {
-                PLOG_WARNING << "JSON loading warning: \"simulate\" value not "
-                                "present, using the default value of 6000 ticks";
             }
+        }
+    }
+    ImGui::End();
+}
+
+void FactoryEditor::discard_monte_carlo() {
+    monte_carlo.result.reset();
+    if (monte_carlo.job) {
+        monte_carlo.job->cancel();
+        monte_carlo.is_job_outdated = true;
+    }
+}
+
+void FactoryEditor::regenerate_cache() {
+    discard_monte_carlo();
+    item_search.sync(factory.items);
+    item_graph = ItemGraph(factory.machines);
+    if (!new_machine) {
+        // The step gets its results once they are simulated
+        history.record(factory, uid_pool, nullptr);
+    }
+    start_simulation(!new_machine);
+}
+
+void FactoryEditor::start_simulation(bool is_for_history) {
+    // Resetting the job cancels it, so that edits in a row don't each wait for the previous one
+    simulation.job.reset();
+    simulation.is_for_history = is_for_history;
+    simulation.job.emplace([this, factory = factory, ticks_to_simulate = ticks_to_simulate,
+                            arena = cache.arenas.acquire()](util::JobProgress& progress) mutable {
+        progress.set_stage("Simulating");
+        Simulation::Result result{.ticks_to_simulate = ticks_to_simulate};
+        if (auto cached = simulation_cache.load(factory, ticks_to_simulate)) {
+            result.cache = std::make_shared<const Factory::Cache>(std::move(*cached));
         } else {
-            PLOG_ERROR << "JSON loading error: Program must start with a JSON object";
-            had_errors = true;
+            auto simulated =
+                factory.generate_cache(ticks_to_simulate, std::move(arena), {}, &progress);
+            if (!simulated.cancelled()) {
+                result.cache = std::make_shared<const Factory::Cache>(std::move(simulated));
+                result.is_new = true;
+            }
         }
+        result.factory = std::move(factory);
+        return result;
+    });
+}
+
+void FactoryEditor::update_simulation() {
+    if (!simulation.job || !simulation.job->is_ready()) {
+        return;
+    }
+    auto result = simulation.job->take_result();
+    simulation.job.reset();
+    if (!result.cache) {
+        return;
     }
 
-    if (!had_errors) {
-        factory = Factory{std::move(parsed_items), std::move(parsed_machines)};
-        cache.factory_cache = factory.generate_cache(ticks_to_simulate);
+    cache.factory_cache = result.cache;
+    if (simulation.is_for_history) {
+        history.set_current_cache(result.cache);
+    }
+    // Stored in the background, so that edits don't wait on the disk
+    if (result.is_new) {
+        pending_store = std::move(result);
     }
 }
 
-void FactoryEditor::output_factory_json(std::ostream& out) const {
-    out << "{";
-
-    // Items
-    {
-        out << "\"items\":{";
-        for (auto item_it = factory.items.cbegin(); item_it != factory.items.cend(); item_it++) {
-            const auto& [item_uid, item] = *item_it;
-            out << "\"" << item_uid.value << "\":{\"name\":\"" << item.name << "\",\"type\":\"";
-            bool write_xy = false;
-            switch (item.type) {
-                case Item::NodeType::Input:
-                    out << "input";
-                    write_xy = true;
-                    break;
-                case Item::NodeType::Output:
-                    out << "output";
-                    write_xy = true;
-                    break;
-                case Item::NodeType::Internal: out << "internal"; break;
-            }
-            out << "\",\"start_with\":" << item.starting_quantity;
-            if (write_xy) {
-                imnodes::EditorContextSet(imnodes_ctx);
-                const auto [x, y] = imnodes::GetNodeGridSpacePos(item_uid.value);
-                out << ",\"x\":" << std::fixed << std::setprecision(1) << x << ",\"y\":" << y
-                    << "}";
-            } else {
-                out << "}";
-            }
-            if (std::next(item_it) != factory.items.cend()) {
-                out << ",";
-            }
-        }
-        out << "},";
-    }
-
-    // Machines
-    {
-        out << "\"machines\":{";
-        const auto& machines = factory.machines;
-        for (auto machine_it = machines.cbegin(); machine_it != machines.cend(); machine_it++) {
-            const auto& [machine_uid, machine] = *machine_it;
-
-            out << "\"" << machine_uid.value << "\":"
-                << "{";
-            {
-                out << "\"name\":\"" << machine.name << "\",";
-                out << "\"inputs\":{";
-                {
-                    const auto& inputs = machine.inputs;
-                    for (std::size_t i = 0; i < inputs.size(); i++) {
-                        out << "\"" << inputs[i].item.value << "\":" << inputs[i].quantity;
-                        if (i < inputs.size() - 1) {
-                            out << ",";
-                        }
-                    }
-                }
-                out << "},";
-                out << "\"outputs\":{";
-                {
-                    const auto& outputs = machine.outputs;
-                    for (std::size_t i = 0; i < outputs.size(); i++) {
-                        out << "\"" << outputs[i].item.value << "\":" << outputs[i].quantity;
-                        if (i < outputs.size() - 1) {
-                            out << ",";
-                        }
-                    }
-                }
-                out << "},";
-                out << "\"time\":" << machine.op_time.count() << ",";
-                const auto [x, y] = imnodes::GetNodeGridSpacePos(machine_uid.value);
-                out << "\"x\":" << std::fixed << std::setprecision(1) << x << ",\"y\":" << y;
+void FactoryEditor::undo() { restore(history.undo()); }
+
+void FactoryEditor::redo() { restore(history.redo()); }
+
+void FactoryEditor::restore(const EditHistory::Step& step) {
+    auto restored = step.factory.restore();
+
+    // Nodes that go away are forgotten as if they were erased, and the ones that come back are
+    // drawn where they were
+    for (const auto& [machine_uid, machine] : factory.machines) {
+        if (!restored.machines.contains(machine_uid)) {
+            remember_node_position(machine_uid);
+            imnodes_ids.forget(machine_uid);
+            for (const auto* io : {&machine.inputs, &machine.outputs}) {
+                for (const auto& stream : *io) { imnodes_ids.forget(stream.uid); }
             }
-            out << "}";
-            if (std::next(machine_it) != factory.machines.cend()) {
-                out << ",";
+        }
+    }
+    for (const auto& [item_uid, item] : factory.items) {
+        if (!restored.items.contains(item_uid)) {
+            remember_node_position(item_uid);
+            imnodes_ids.forget(item_uid);
+            imnodes_ids.forget(item.attribute_uid);
+            plot_export.items.erase(item_uid);
+        }
+    }
+
+    factory = std::move(restored);
+    uid_pool = step.uid_pool;
+    item_search.sync(factory.items);
+    item_graph = ItemGraph(factory.machines);
+    discard_monte_carlo();
+
+    imnodes::EditorContextSet(imnodes_ctx);
+    const auto place_node = [&](Uid node_uid) {
+        const auto position = forgotten_node_positions.find(node_uid);
+        if (position != forgotten_node_positions.end() && !imnodes_ids.find(node_uid)) {
+            imnodes::SetNodeGridSpacePos(imnodes_ids.id(node_uid),
+                                         {position->second.x, position->second.y});
+        }
+    };
+    for (const auto& [machine_uid, _] : factory.machines) { place_node(machine_uid); }
+    for (const auto& [item_uid, item] : factory.items) {
+        if (item.type != Item::NodeType::Internal) {
+            place_node(item_uid);
+        }
+    }
+
+    if (step.cache) {
+        simulation.job.reset();
+        cache.factory_cache = step.cache;
+    } else {
+        // Results of distant steps are dropped to save memory, but are usually still on disk
+        start_simulation(true);
+    }
+}
+
+void FactoryEditor::update_file_jobs() {
+    if (open_dialog && open_dialog->ready(0)) {
+        const auto selection = open_dialog->result();
+        open_dialog.reset();
+        if (!selection.empty()) {
+            start_open_job(selection[0]);
+        }
+    }
+    if (save_dialog && save_dialog->ready(0)) {
+        const auto destination = save_dialog->result();
+        save_dialog.reset();
+        if (!destination.empty()) {
+            start_save_job(destination);
+        }
+    }
+
+    if (export_dialog && export_dialog->ready(0)) {
+        const auto destination = export_dialog->result();
+        export_dialog.reset();
+        if (!destination.empty()) {
+            start_export_job(destination);
+        }
+    }
+
+    if (embed_dialog && embed_dialog->ready(0)) {
+        const auto selection = embed_dialog->result();
+        embed_dialog.reset();
+        if (!selection.empty()) {
+            module_job.emplace([this, path = selection[0]](util::JobProgress& progress) {
+                return module_library.get(path, &progress);
+            });
+        }
+    }
+
+    if (store_job && store_job->is_ready()) {
+        store_job->take_result();
+        store_job.reset();
+    }
+    if (!store_job && pending_store) {
+        store_job.emplace([this, store = std::move(*pending_store)](util::JobProgress&) {
+            simulation_cache.store(store.factory, store.ticks_to_simulate, *store.cache);
+        });
+        pending_store.reset();
+    }
+
+    if (load_job && load_job->is_ready()) {
+        // A failed load leaves the current factory untouched
+        if (auto document = load_job->take_result()) {
+            apply_document(std::move(*document));
+            PLOGD << "Imported factory";
+        }
+        load_job.reset();
+    }
+    if (module_job && module_job->is_ready()) {
+        if (const auto summary = module_job->take_result()) {
+            const auto machine_uid = sim::embed_module(factory, uid_pool, *summary);
+            place_in_view(machine_uid);
+            regenerate_cache();
+            PLOGD << "Embedded module '" << summary->name << "'";
+        }
+        module_job.reset();
+    }
+    if (recipe_dialog && recipe_dialog->ready(0)) {
+        const auto selection = recipe_dialog->result();
+        recipe_dialog.reset();
+        if (!selection.empty()) {
+            recipe_job.emplace([path = selection[0]](util::JobProgress& progress) {
+                auto catalog = io::load_recipe_file(path, &progress);
+                return catalog ? std::make_shared<const io::RecipeCatalog>(std::move(*catalog))
+                               : nullptr;
+            });
+        }
+    }
+    if (recipe_job && recipe_job->is_ready()) {
+        if (auto catalog = recipe_job->take_result()) {
+            PLOGD << "Imported " << catalog->recipe_count() << " recipes";
+            recipes.catalog = std::move(catalog);
+            recipes.are_matches_outdated = true;
+            show_recipes_window = true;
+        }
+        recipe_job.reset();
+    }
+    if (save_job && save_job->is_ready()) {
+        if (!save_job->take_result()) {
+            PLOG_ERROR << "Could not save factory";
+        }
+        save_job.reset();
+    }
+    if (layout_job) {
+        std::optional<io::NodePositionsT> positions;
+        {
+            std::lock_guard lock(layout_updates->mutex);
+            positions.swap(layout_updates->positions);
+        }
+        if (layout_job->is_ready()) {
+            positions = layout_job->take_result();
+            layout_job.reset();
+        }
+        if (positions) {
+            apply_node_positions(*positions);
+        }
+    }
+}
+
+void FactoryEditor::start_open_job(std::string path) {
+    load_job.emplace([this, path = std::move(path)](
+                         util::JobProgress& progress) -> std::optional<io::FactoryDocument> {
+        auto document = io::load_factory_file(path, &progress);
+        if (document && !document->cache) {
+            progress.set_stage("Simulating");
+            document->cache = simulation_cache.get_or_generate(
+                document->factory, document->ticks_to_simulate, nullptr, &progress);
+        }
+        // Cancelling keeps the current factory, instead of a partial simulation of this one
+        if (progress.is_cancelled()) {
+            return std::nullopt;
+        }
+        return document;
+    });
+}
+
+void FactoryEditor::start_import_job(std::string json) {
+    load_job.emplace([this, json = std::move(json)](
+                         util::JobProgress& progress) -> std::optional<io::FactoryDocument> {
+        progress.set_stage("Parsing");
+        auto input = std::istringstream(json);
+        auto document = io::parse_factory_json(input);
+        if (document) {
+            progress.set_stage("Simulating");
+            document->cache = simulation_cache.get_or_generate(
+                document->factory, document->ticks_to_simulate, nullptr, &progress);
+        }
+        // Cancelling keeps the current factory, instead of a partial simulation of this one
+        if (progress.is_cancelled()) {
+            return std::nullopt;
+        }
+        return document;
+    });
+}
+
+void FactoryEditor::start_save_job(std::string path) {
+    // The factory keeps being edited while saving, so the job works on a snapshot of it
+    // Results that are still being simulated for the last edit are left out rather than waited on
+    const bool save_cache =
+        std::filesystem::path(path).extension() == io::binary_format_extension &&
+        !simulation.job;
+    save_job.emplace([path = std::move(path), factory = factory, uid_pool = uid_pool,
+                      node_positions = node_positions(),
+                      ticks_to_simulate = ticks_to_simulate,
+                      factory_cache = save_cache ? cache.factory_cache : nullptr](
+                         util::JobProgress& progress) {
+        progress.set_stage("Saving");
+        const bool saved = io::save_factory_file(path, factory, uid_pool, node_positions,
+                                                 ticks_to_simulate, factory_cache.get());
+        if (saved) {
+            PLOGD << "Exported data to '" << path << "'";
+        }
+        return saved;
+    });
+}
+
+void FactoryEditor::start_export_job(std::string path) {
+    std::vector<Uid> items;
+    for (const auto& [item_uid, _] : factory.items) {
+        if (plot_export.all_items || plot_export.items.contains(item_uid)) {
+            items.emplace_back(item_uid);
+        }
+    }
+
+    // The results shown may not be the ones of the last edit yet, in which case the job simulates
+    // it itself
+    save_job.emplace([path = std::move(path), factory = factory,
+                      factory_cache = simulation.job ? nullptr : cache.factory_cache,
+                      ticks_to_simulate = ticks_to_simulate, items = std::move(items),
+                      options = plot_export.options,
+                      as_csv = plot_export.as_csv](util::JobProgress& progress) mutable {
+        if (!factory_cache) {
+            progress.set_stage("Simulating");
+            factory_cache = std::make_shared<const Factory::Cache>(
+                factory.generate_cache(ticks_to_simulate, nullptr, {}, &progress));
+            if (factory_cache->cancelled()) {
+                return true;
             }
         }
-        out << "},";
+        progress.set_stage("Exporting");
+        std::ofstream file(path, std::ios::binary);
+        const bool exported =
+            as_csv ? io::export_plots_csv(file, factory, *factory_cache, items, options, &progress)
+                   : io::export_plots_columnar(file, factory, *factory_cache, items, options,
+                                               &progress);
+        if (!exported) {
+            // Cancelled, which isn't an error, but the partial file is no use
+            file.close();
+            std::error_code ec;
+            std::filesystem::remove(path, ec);
+            return true;
+        }
+        if (file) {
+            PLOGD << "Exported plots to '" << path << "'";
+        }
+        return static_cast<bool>(file);
+    });
+}
+
+void FactoryEditor::start_layout_job() {
+    layout_job.emplace([factory = factory, updates = layout_updates](util::JobProgress& progress) {
+        GraphLayoutOptions options;
+        options.on_update = [&updates](const io::NodePositionsT& positions) {
+            std::lock_guard lock(updates->mutex);
+            updates->positions = positions;
+        };
+        return layout_factory(factory, options, &progress);
+    });
+}
+
+void FactoryEditor::apply_document(io::FactoryDocument document) {
+    // Positions laid out for the previous factory don't apply to this one, even if UIDs match.
+    // Resetting the job cancels it
+    layout_job.reset();
+    layout_updates->positions.reset();
+
+    imnodes::EditorContextSet(imnodes_ctx);
+    imnodes_ids.clear();
+    for (const auto& [uid, pos] : document.node_positions) {
+        imnodes::SetNodeGridSpacePos(imnodes_ids.id(uid), {pos.x, pos.y});
+    }
+
+    factory = std::move(document.factory);
+    uid_pool = document.uid_pool;
+    ticks_to_simulate = document.ticks_to_simulate;
+    simulation.job.reset();
+    cache.factory_cache = std::make_shared<const Factory::Cache>(std::move(*document.cache));
+    plot_export.items.clear();
+    item_search.sync(factory.items);
+    item_graph = ItemGraph(factory.machines);
+    discard_monte_carlo();
+    history.reset(factory, uid_pool, cache.factory_cache);
+    forgotten_node_positions.clear();
+
+    // Imported factories often only have positions for their inputs and outputs, which would
+    // leave all the machines stacked at the origin
+    if (std::any_of(factory.machines.begin(), factory.machines.end(), [&](const auto& machine) {
+            return !document.node_positions.contains(machine.first);
+        })) {
+        start_layout_job();
+    }
+}
+
+void FactoryEditor::place_in_view(Uid node_uid) {
+    imnodes::EditorContextSet(imnodes_ctx);
+    const auto panning = imnodes::EditorContextGetPanning();
+    imnodes::SetNodeGridSpacePos(imnodes_ids.id(node_uid), {50.f - panning.x, 50.f - panning.y});
+}
+
+void FactoryEditor::apply_node_positions(const io::NodePositionsT& positions) {
+    imnodes::EditorContextSet(imnodes_ctx);
+    for (const auto& [uid, position] : positions) {
+        // Nodes erased while the layout was running are skipped
+        if (factory.machines.contains(uid) || factory.items.contains(uid)) {
+            imnodes::SetNodeGridSpacePos(imnodes_ids.id(uid), {position.x, position.y});
+        }
+    }
+}
+
+io::NodePositionsT FactoryEditor::node_positions() const {
+    io::NodePositionsT node_positions;
+
+    imnodes::EditorContextSet(imnodes_ctx);
+    for (const auto& [item_uid, item] : factory.items) {
+        const auto id = imnodes_ids.find(item_uid);
+        if (item.type != Item::NodeType::Internal && id) {
+            const auto [x, y] = imnodes::GetNodeGridSpacePos(*id);
+            node_positions[item_uid] = io::NodePosition{x, y};
+        }
+    }
+    for (const auto& [machine_uid, _] : factory.machines) {
+        if (const auto id = imnodes_ids.find(machine_uid)) {
+            const auto [x, y] = imnodes::GetNodeGridSpacePos(*id);
+            node_positions[machine_uid] = io::NodePosition{x, y};
+        }
     }
 
-    // Simulate value
-    { out << "\"simulate\":" << cache.factory_cache.ticks_simulated() << ","; }
+    return node_positions;
+}
+
+void FactoryEditor::erase_item(Uid item_uid) {
+    const auto item = factory.items.find(item_uid);
+    if (item == factory.items.end()) {
+        return;
+    }
 
-    { out << "\"uid_pool\":{\"next_uid\":" << uid_pool.get_next_uid().value << "}"; }
+    remember_node_position(item_uid);
+    release_uid(item->second.attribute_uid);
+    release_uid(item_uid);
+    plot_export.items.erase(item_uid);
+    factory.items.erase(item);
+}
+
+void FactoryEditor::remember_node_position(Uid node_uid) {
+    if (const auto id = imnodes_ids.find(node_uid)) {
+        imnodes::EditorContextSet(imnodes_ctx);
+        const auto [x, y] = imnodes::GetNodeGridSpacePos(*id);
+        forgotten_node_positions[node_uid] = io::NodePosition{x, y};
+    }
+}
 
-    out << "}";
+void FactoryEditor::release_uid(Uid uid) {
+    uid_pool.release(uid);
+    imnodes_ids.forget(uid);
 }
 
 } // namespace fmk
\ No newline at end of file
@@ -0,0 +1,393 @@
+#include "editor/graph_layout.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <span>
+#include <vector>
+
+#include "util/background_job.hpp"
+#include "util/thread_pool.hpp"
+
+namespace fmk {
+
+namespace {
+
+/// How often the positions are published during the refinement.
+constexpr std::size_t update_interval = 16;
+
+/// Rough sizes of the nodes drawn by the editor, which are only known once they are drawn.
+constexpr float machine_width = 220.f;
+constexpr float machine_base_height = 70.f;
+constexpr float stream_height = 22.f;
+constexpr float item_width = 120.f;
+constexpr float input_height = 60.f;
+constexpr float output_height = 90.f;
+
+/// The items and machines of a factory as the vertices of a directed graph, with the items first.
+/// Links go from items to the machines that consume them, and from machines to the items they
+/// produce, stored as compressed rows.
+struct LayoutGraph {
+    struct Vertex {
+        Uid uid;
+        /// Only the vertices of internal items are hidden.
+        bool is_visible;
+        float width;
+        float height;
+    };
+
+    explicit LayoutGraph(const Factory& factory);
+
+    std::span<const std::uint32_t> successors(std::uint32_t vertex) const {
+        return std::span(successor_links)
+            .subspan(successor_offsets[vertex],
+                     successor_offsets[vertex + 1] - successor_offsets[vertex]);
+    }
+    std::span<const std::uint32_t> predecessors(std::uint32_t vertex) const {
+        return std::span(predecessor_links)
+            .subspan(predecessor_offsets[vertex],
+                     predecessor_offsets[vertex + 1] - predecessor_offsets[vertex]);
+    }
+
+    std::vector<Vertex> vertices;
+    std::vector<std::uint32_t> successor_offsets;
+    std::vector<std::uint32_t> successor_links;
+    std::vector<std::uint32_t> predecessor_offsets;
+    std::vector<std::uint32_t> predecessor_links;
+};
+
+LayoutGraph::LayoutGraph(const Factory& factory) {
+    vertices.reserve(factory.items.size() + factory.machines.size());
+    util::UidMap<std::uint32_t> item_vertices;
+    item_vertices.reserve(factory.items.size());
+    for (const auto& [item_uid, item] : factory.items) {
+        item_vertices.emplace(item_uid, static_cast<std::uint32_t>(vertices.size()));
+        switch (item.type) {
+            case Item::NodeType::Input:
+                vertices.emplace_back(Vertex{item_uid, true, item_width, input_height});
+                break;
+            case Item::NodeType::Output:
+                vertices.emplace_back(Vertex{item_uid, true, item_width, output_height});
+                break;
+            case Item::NodeType::Internal:
+                vertices.emplace_back(Vertex{item_uid, false, 0.f, 0.f});
+                break;
+        }
+    }
+
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> links;
+    for (const auto& [machine_uid, machine] : factory.machines) {
+        const auto machine_vertex = static_cast<std::uint32_t>(vertices.size());
+        const auto streams = static_cast<float>(machine.inputs.size() + machine.outputs.size());
+        vertices.emplace_back(Vertex{machine_uid, true, machine_width,
+                                     machine_base_height + streams * stream_height});
+        for (const auto& input : machine.inputs) {
+            links.emplace_back(item_vertices.at(input.item), machine_vertex);
+        }
+        for (const auto& output : machine.outputs) {
+            links.emplace_back(machine_vertex, item_vertices.at(output.item));
+        }
+    }
+
+    // Rows are counted first, then filled in back to front like the ones of `ItemGraph`
+    const auto fill_rows = [&](std::vector<std::uint32_t>& offsets,
+                               std::vector<std::uint32_t>& row_links, bool by_source) {
+        offsets.assign(vertices.size() + 1, 0);
+        for (const auto& [source, target] : links) { offsets[by_source ? source : target]++; }
+        std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+        row_links.resize(links.size());
+        for (auto link = links.rbegin(); link != links.rend(); link++) {
+            const auto [source, target] = *link;
+            row_links[--offsets[by_source ? source : target]] = by_source ? target : source;
+        }
+    };
+    fill_rows(successor_offsets, successor_links, true);
+    fill_rows(predecessor_offsets, predecessor_links, false);
+}
+
+/// Finds the links that close a cycle with a depth-first search from the vertices that don't get
+/// anything, which are then laid out as if they went the other way.
+/// @returns Whether the `i`-th successor link of the graph goes back.
+std::vector<char> find_back_links(const LayoutGraph& graph) {
+    const auto vertex_count = static_cast<std::uint32_t>(graph.vertices.size());
+    enum class State : char { Unvisited, InProgress, Done };
+    std::vector<State> states(vertex_count, State::Unvisited);
+    std::vector<char> is_back_link(graph.successor_links.size(), false);
+
+    std::vector<std::uint32_t> roots;
+    roots.reserve(vertex_count);
+    for (std::uint32_t vertex = 0; vertex < vertex_count; vertex++) {
+        if (graph.predecessors(vertex).empty()) {
+            roots.emplace_back(vertex);
+        }
+    }
+    for (std::uint32_t vertex = 0; vertex < vertex_count; vertex++) {
+        if (!graph.predecessors(vertex).empty()) {
+            roots.emplace_back(vertex);
+        }
+    }
+
+    // The stack holds the vertices being visited and the next link to follow from each
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> stack;
+    for (const auto root : roots) {
+        if (states[root] != State::Unvisited) {
+            continue;
+        }
+        states[root] = State::InProgress;
+        stack.emplace_back(root, graph.successor_offsets[root]);
+        while (!stack.empty()) {
+            auto& [vertex, link] = stack.back();
+            if (link == graph.successor_offsets[vertex + 1]) {
+                states[vertex] = State::Done;
+                stack.pop_back();
+                continue;
+            }
+            const auto link_i = link++;
+            const auto successor = graph.successor_links[link_i];
+            if (states[successor] == State::InProgress) {
+                is_back_link[link_i] = true;
+            } else if (states[successor] == State::Unvisited) {
+                states[successor] = State::InProgress;
+                stack.emplace_back(successor, graph.successor_offsets[successor]);
+            }
+        }
+    }
+    return is_back_link;
+}
+
+/// The graph with its back links reversed, so that it has no cycles.
+struct AcyclicLinks {
+    std::vector<std::vector<std::uint32_t>> successors;
+    std::vector<std::vector<std::uint32_t>> predecessors;
+};
+
+AcyclicLinks make_acyclic(const LayoutGraph& graph) {
+    const auto is_back_link = find_back_links(graph);
+    AcyclicLinks acyclic;
+    acyclic.successors.resize(graph.vertices.size());
+    acyclic.predecessors.resize(graph.vertices.size());
+    for (std::uint32_t vertex = 0; vertex < graph.vertices.size(); vertex++) {
+        for (auto link = graph.successor_offsets[vertex];
+             link < graph.successor_offsets[vertex + 1]; link++) {
+            auto source = vertex;
+            auto target = graph.successor_links[link];
+            if (source == target) {
+                continue;
+            }
+            if (is_back_link[link]) {
+                std::swap(source, target);
+            }
+            acyclic.successors[source].emplace_back(target);
+            acyclic.predecessors[target].emplace_back(source);
+        }
+    }
+    return acyclic;
+}
+
+/// Puts every vertex one layer after the last of the vertices it gets items from, and vertices
+/// that don't get anything right before the first of the ones they give items to.
+/// @returns The vertices of every layer.
+std::vector<std::vector<std::uint32_t>> assign_layers(const AcyclicLinks& links) {
+    const auto vertex_count = links.successors.size();
+    std::vector<std::uint32_t> pending(vertex_count);
+    std::vector<std::uint32_t> order;
+    order.reserve(vertex_count);
+    for (std::uint32_t vertex = 0; vertex < vertex_count; vertex++) {
+        pending[vertex] = static_cast<std::uint32_t>(links.predecessors[vertex].size());
+        if (pending[vertex] == 0) {
+            order.emplace_back(vertex);
+        }
+    }
+
+    std::vector<std::uint32_t> layers(vertex_count, 0);
+    for (std::size_t order_i = 0; order_i < order.size(); order_i++) {
+        const auto vertex = order[order_i];
+        for (const auto successor : links.successors[vertex]) {
+            layers[successor] = std::max(layers[successor], layers[vertex] + 1);
+            if (--pending[successor] == 0) {
+                order.emplace_back(successor);
+            }
+        }
+    }
+    for (auto vertex = order.rbegin(); vertex != order.rend(); vertex++) {
+        const auto& successors = links.successors[*vertex];
+        if (links.predecessors[*vertex].empty() && !successors.empty()) {
+            std::uint32_t first = layers[successors.front()];
+            for (const auto successor : successors) { first = std::min(first, layers[successor]); }
+            layers[*vertex] = first - 1;
+        }
+    }
+
+    std::vector<std::vector<std::uint32_t>> layered;
+    for (const auto vertex : order) {
+        if (layers[vertex] >= layered.size()) {
+            layered.resize(layers[vertex] + 1);
+        }
+        layered[layers[vertex]].emplace_back(vertex);
+    }
+    return layered;
+}
+
+/// Sorts every layer by the average position of the neighbours of its vertices in the layers
+/// before it, then after it, and so on.
+void reduce_crossings(std::vector<std::vector<std::uint32_t>>& layers,
+                      const AcyclicLinks& links,
+                      std::size_t sweeps,
+                      util::ThreadPool& pool) {
+    // Positions are relative to the size of the layer, since neighbours can be several layers away
+    std::vector<float> positions(links.successors.size());
+    const auto update_positions = [&](const std::vector<std::uint32_t>& layer) {
+        for (std::size_t i = 0; i < layer.size(); i++) {
+            positions[layer[i]] = static_cast<float>(i) / static_cast<float>(layer.size());
+        }
+    };
+    for (const auto& layer : layers) { update_positions(layer); }
+
+    std::vector<float> barycenters(links.successors.size());
+    for (std::size_t sweep = 0; sweep < sweeps; sweep++) {
+        const bool forward = sweep % 2 == 0;
+        const auto& neighbours = forward ? links.predecessors : links.successors;
+        for (std::size_t step = 1; step < layers.size(); step++) {
+            auto& layer = layers[forward ? step : layers.size() - 1 - step];
+            pool.parallel_for(layer.size(), [&](std::size_t first, std::size_t last) {
+                for (auto i = first; i < last; i++) {
+                    const auto vertex = layer[i];
+                    const auto& vertex_neighbours = neighbours[vertex];
+                    float sum = 0.f;
+                    for (const auto neighbour : vertex_neighbours) { sum += positions[neighbour]; }
+                    barycenters[vertex] = vertex_neighbours.empty()
+                                              ? positions[vertex]
+                                              : sum / static_cast<float>(vertex_neighbours.size());
+                }
+            });
+            std::stable_sort(layer.begin(), layer.end(), [&](std::uint32_t a, std::uint32_t b) {
+                return barycenters[a] < barycenters[b];
+            });
+            update_positions(layer);
+        }
+    }
+}
+
+} // namespace
+
+io::NodePositionsT layout_factory(const Factory& factory,
+                                  const GraphLayoutOptions& options,
+                                  util::JobProgress* progress) {
+    if (progress) {
+        progress->set_stage("Ordering nodes");
+    }
+    const LayoutGraph graph(factory);
+    const auto links = make_acyclic(graph);
+    auto layers = assign_layers(links);
+    util::ThreadPool pool(options.worker_count);
+    reduce_crossings(layers, links, options.ordering_sweeps, pool);
+
+    // Layers are as wide as their widest node, and nodes start stacked in their order
+    std::vector<float> xs(graph.vertices.size());
+    std::vector<float> ys(graph.vertices.size());
+    float layer_x = 0.f;
+    for (const auto& layer : layers) {
+        float width = 0.f;
+        float y = 0.f;
+        for (const auto vertex : layer) {
+            const auto& data = graph.vertices[vertex];
+            xs[vertex] = layer_x;
+            ys[vertex] = y + data.height / 2.f;
+            y += data.is_visible ? data.height + options.node_gap : 0.f;
+            width = std::max(width, data.width);
+        }
+        // Layers are centered vertically
+        for (const auto vertex : layer) { ys[vertex] -= y / 2.f; }
+        layer_x += width + options.layer_gap;
+    }
+
+    const auto positions = [&] {
+        io::NodePositionsT result;
+        result.reserve(graph.vertices.size());
+        for (std::size_t vertex = 0; vertex < graph.vertices.size(); vertex++) {
+            const auto& data = graph.vertices[vertex];
+            if (data.is_visible) {
+                result[data.uid] = io::NodePosition{xs[vertex], ys[vertex] - data.height / 2.f};
+            }
+        }
+        return result;
+    };
+    if (options.on_update) {
+        options.on_update(positions());
+    }
+
+    if (progress) {
+        progress->set_stage("Refining");
+    }
+    // Every iteration moves the nodes halfway towards the average height of their neighbours,
+    // all at once, then spreads the visible nodes of each layer apart where they overlap: both
+    // pushing them down from the top and up from the bottom keeps the order and the gaps, and the
+    // average of the two doesn't drift towards either side
+    std::vector<float> targets(graph.vertices.size());
+    for (std::size_t iteration = 0; iteration < options.refinement_iterations; iteration++) {
+        if (progress && progress->is_cancelled()) {
+            break;
+        }
+
+        pool.parallel_for(graph.vertices.size(), [&](std::size_t first, std::size_t last) {
+            for (auto vertex = static_cast<std::uint32_t>(first); vertex < last; vertex++) {
+                const auto& predecessors = links.predecessors[vertex];
+                const auto& successors = links.successors[vertex];
+                float sum = 0.f;
+                for (const auto neighbour : predecessors) { sum += ys[neighbour]; }
+                for (const auto neighbour : successors) { sum += ys[neighbour]; }
+                const auto count = predecessors.size() + successors.size();
+                targets[vertex] =
+                    count == 0 ? ys[vertex]
+                               : (ys[vertex] + sum / static_cast<float>(count)) / 2.f;
+            }
+        });
+
+        pool.parallel_for(layers.size(), [&](std::size_t first, std::size_t last) {
+            std::vector<std::uint32_t> visible;
+            std::vector<float> pushed_down;
+            for (auto layer_i = first; layer_i < last; layer_i++) {
+                visible.clear();
+                for (const auto vertex : layers[layer_i]) {
+                    if (graph.vertices[vertex].is_visible) {
+                        visible.emplace_back(vertex);
+                    } else {
+                        ys[vertex] = targets[vertex];
+                    }
+                }
+                const auto gap = [&](std::size_t i) {
+                    return (graph.vertices[visible[i - 1]].height +
+                            graph.vertices[visible[i]].height) /
+                               2.f +
+                           options.node_gap;
+                };
+
+                pushed_down.resize(visible.size());
+                for (std::size_t i = 0; i < visible.size(); i++) {
+                    pushed_down[i] = i == 0 ? targets[visible[i]]
+                                            : std::max(targets[visible[i]],
+                                                       pushed_down[i - 1] + gap(i));
+                }
+                float pushed_up = 0.f;
+                for (std::size_t i = visible.size(); i-- > 0;) {
+                    pushed_up = i + 1 == visible.size()
+                                    ? targets[visible[i]]
+                                    : std::min(targets[visible[i]], pushed_up - gap(i + 1));
+                    ys[visible[i]] = (pushed_down[i] + pushed_up) / 2.f;
+                }
+            }
+        });
+
+        if (progress) {
+            progress->set_fraction(static_cast<float>(iteration + 1) /
+                                   static_cast<float>(options.refinement_iterations));
+        }
+        if (options.on_update && (iteration + 1) % update_interval == 0) {
+            options.on_update(positions());
+        }
+    }
+
+    return positions();
+}
+
+} // namespace fmk
\ No newline at end of file
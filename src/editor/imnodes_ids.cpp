@@ -0,0 +1,60 @@
+#include "editor/imnodes_ids.hpp"
+
+namespace fmk {
+
+int ImnodesIds::id(Uid uid) {
+    if (const auto id = ids.find(uid); id != ids.end()) {
+        return id->second;
+    }
+
+    const int id = next_id++;
+    ids.emplace(uid, id);
+    uids.emplace(id, uid);
+    return id;
+}
+
+std::optional<int> ImnodesIds::find(Uid uid) const {
+    if (const auto id = ids.find(uid); id != ids.end()) {
+        return id->second;
+    }
+    return std::nullopt;
+}
+
+int ImnodesIds::link_id(Uid start_attribute, Uid end_attribute) {
+    const auto [link, inserted] =
+        link_ids.try_emplace(std::pair(start_attribute.value, end_attribute.value), 0);
+    if (inserted) {
+        link->second = next_id++;
+    }
+    return link->second;
+}
+
+std::optional<Uid> ImnodesIds::uid(int id) const {
+    if (const auto uid = uids.find(id); uid != uids.end()) {
+        return uid->second;
+    }
+    return std::nullopt;
+}
+
+void ImnodesIds::forget(Uid uid) {
+    if (const auto id = ids.find(uid); id != ids.end()) {
+        uids.erase(id->second);
+        ids.erase(id);
+    }
+
+    for (auto link = link_ids.begin(); link != link_ids.end();) {
+        if (link->first.first == uid.value || link->first.second == uid.value) {
+            link = link_ids.erase(link);
+        } else {
+            ++link;
+        }
+    }
+}
+
+void ImnodesIds::clear() {
+    ids.clear();
+    uids.clear();
+    link_ids.clear();
+}
+
+} // namespace fmk
\ No newline at end of file
@@ -0,0 +1,217 @@
+#include "editor/item_search.hpp"
+
+#include <algorithm>
+
+namespace fmk {
+
+namespace {
+
+/// Entries are only renumbered once this many are removed, so that removing a few items doesn't
+/// reindex all of them.
+constexpr std::size_t min_removed_to_compact = 1024;
+constexpr std::size_t max_removed_to_unindex = 256;
+
+/// Only ASCII letters, since names are UTF-8 and go through this for every item on every sync.
+char to_lower(char c) { return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c; }
+
+std::string to_lower(std::string_view str) {
+    std::string lower(str);
+    std::transform(lower.begin(), lower.end(), lower.begin(),
+                   [](char c) { return to_lower(c); });
+    return lower;
+}
+
+bool equals_lower(std::string_view lower, std::string_view str) {
+    return lower.size() == str.size() &&
+           std::equal(lower.begin(), lower.end(), str.begin(),
+                      [](char a, char b) { return a == to_lower(b); });
+}
+
+/// Identifies a substring of 1 to 3 characters.
+std::uint32_t gram_key(std::string_view gram) {
+    std::uint32_t key = static_cast<std::uint32_t>(gram.size()) << 24;
+    for (std::size_t char_i = 0; char_i < gram.size(); char_i++) {
+        key |= static_cast<std::uint32_t>(static_cast<unsigned char>(gram[char_i]))
+               << (16 - 8 * char_i);
+    }
+    return key;
+}
+
+/// The keys of every distinct substring of up to 3 characters of a name.
+std::vector<std::uint32_t> gram_keys(std::string_view name) {
+    std::vector<std::uint32_t> keys;
+    keys.reserve(name.size() * 3);
+    for (std::size_t start = 0; start < name.size(); start++) {
+        for (std::size_t length = 1; length <= 3 && start + length <= name.size(); length++) {
+            keys.emplace_back(gram_key(name.substr(start, length)));
+        }
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    return keys;
+}
+
+} // namespace
+
+void ItemSearchIndex::sync(const util::UidMap<Item>& items) {
+    bool changed = false;
+    std::vector<char> is_present(entries.size(), false);
+    for (const auto& [item_uid, item] : items) {
+        const auto entry = entry_of.find(item_uid);
+        if (entry == entry_of.end()) {
+            add(item_uid, item.name);
+            changed = true;
+            continue;
+        }
+
+        const auto entry_i = entry->second;
+        is_present[entry_i] = true;
+        if (!equals_lower(entries[entry_i].name, item.name)) {
+            unindex(entry_i);
+            entries[entry_i].name = to_lower(item.name);
+            index(entry_i);
+            changed = true;
+        }
+    }
+
+    std::vector<std::uint32_t> removed;
+    for (std::uint32_t entry_i = 0; entry_i < is_present.size(); entry_i++) {
+        if (!is_present[entry_i] && !entries[entry_i].is_removed) {
+            removed.emplace_back(entry_i);
+        }
+    }
+    // Removing entries one by one goes through the postings of all their substrings, which is
+    // slower than indexing everything again once many are removed at once
+    const bool reindex_all = removed.size() >= max_removed_to_unindex;
+    for (const auto entry_i : removed) {
+        auto& entry = entries[entry_i];
+        if (!reindex_all) {
+            unindex(entry_i);
+        }
+        entry_of.erase(entry.uid);
+        entry.is_removed = true;
+        entry.name.clear();
+        removed_count++;
+        changed = true;
+    }
+
+    if (changed) {
+        if (reindex_all ||
+            (removed_count >= min_removed_to_compact && removed_count * 2 > entries.size())) {
+            compact();
+        }
+        generation_++;
+    }
+}
+
+void ItemSearchIndex::search(std::string_view query, std::vector<Uid>& out) const {
+    const auto lower_query = to_lower(query);
+    std::vector<std::string_view> words;
+    const std::string_view remaining(lower_query);
+    for (std::size_t start = 0; start < remaining.size();) {
+        const auto end = std::min(remaining.find(' ', start), remaining.size());
+        if (end > start) {
+            words.emplace_back(remaining.substr(start, end - start));
+        }
+        start = end + 1;
+    }
+
+    if (words.empty()) {
+        for (const auto& entry : entries) {
+            if (!entry.is_removed) {
+                out.emplace_back(entry.uid);
+            }
+        }
+        return;
+    }
+
+    // Only the entries containing the rarest substring need to be checked
+    const std::vector<std::uint32_t>* rarest = nullptr;
+    for (const auto word : words) {
+        const auto gram_length = std::min(word.size(), std::size_t(3));
+        for (std::size_t start = 0; start + gram_length <= word.size(); start++) {
+            const auto posting = postings.find(gram_key(word.substr(start, gram_length)));
+            if (posting == postings.end()) {
+                return;
+            }
+            if (!rarest || posting->second.size() < rarest->size()) {
+                rarest = &posting->second;
+            }
+        }
+    }
+
+    // The postings of a single short word are exactly its matches
+    const bool needs_check = words.size() > 1 || words.front().size() > 3;
+    for (const auto entry_i : *rarest) {
+        const auto& entry = entries[entry_i];
+        if (!needs_check || std::all_of(words.begin(), words.end(), [&](std::string_view word) {
+                return entry.name.find(word) != std::string::npos;
+            })) {
+            out.emplace_back(entry.uid);
+        }
+    }
+}
+
+void ItemSearchIndex::add(Uid uid, std::string_view name) {
+    const auto entry_i = static_cast<std::uint32_t>(entries.size());
+    entries.emplace_back(Entry{uid, to_lower(name)});
+    entry_of.emplace(uid, entry_i);
+    index(entry_i);
+}
+
+void ItemSearchIndex::index(std::uint32_t entry_i) {
+    for (const auto key : gram_keys(entries[entry_i].name)) {
+        auto& posting = postings[key];
+        // New entries go at the end, only renamed ones need to be inserted in the middle
+        if (posting.empty() || posting.back() < entry_i) {
+            posting.emplace_back(entry_i);
+        } else {
+            posting.insert(std::lower_bound(posting.begin(), posting.end(), entry_i), entry_i);
+        }
+    }
+}
+
+void ItemSearchIndex::unindex(std::uint32_t entry_i) {
+    for (const auto key : gram_keys(entries[entry_i].name)) {
+        const auto posting = postings.find(key);
+        if (posting == postings.end()) {
+            continue;
+        }
+        auto& entry_indices = posting->second;
+        const auto it = std::lower_bound(entry_indices.begin(), entry_indices.end(), entry_i);
+        if (it != entry_indices.end() && *it == entry_i) {
+            entry_indices.erase(it);
+        }
+        if (entry_indices.empty()) {
+            postings.erase(posting);
+        }
+    }
+}
+
+void ItemSearchIndex::compact() {
+    auto old_entries = std::move(entries);
+    entries.clear();
+    entry_of.clear();
+    postings.clear();
+    removed_count = 0;
+    for (auto& entry : old_entries) {
+        if (!entry.is_removed) {
+            const auto entry_i = static_cast<std::uint32_t>(entries.size());
+            entry_of.emplace(entry.uid, entry_i);
+            entries.emplace_back(std::move(entry));
+            index(entry_i);
+        }
+    }
+}
+
+const std::vector<Uid>& ItemFilter::refresh(const ItemSearchIndex& index) {
+    if (query != searched_query || index.generation() != searched_generation) {
+        items.clear();
+        index.search(query, items);
+        searched_query = query;
+        searched_generation = index.generation();
+    }
+    return items;
+}
+
+} // namespace fmk
\ No newline at end of file
@@ -1,16 +1,144 @@
 #include "factory.hpp"
 #include <algorithm>
+#include <limits>
+#include <plog/Log.h>
+#include <type_traits>
+
+#include "sim/simulation.hpp"
 
 namespace fmk {
 
-Factory::Cache::ItemNodesT calculate_links(const Factory::MachinesT& machines);
-Factory::Cache::QuantityPlotsT simulate_item_evolution(const Factory::ItemsT& items,
-                                                       const Factory::MachinesT& machines,
-                                                       const Factory::Cache::ItemNodesT& nodes,
-                                                       std::size_t ticks_to_simulate);
+Factory::Cache::QuantityLogsT
+simulate_item_evolution(const Factory::ItemsT& items,
+                        const Factory::MachinesT& machines,
+                        std::size_t ticks_to_simulate,
+                        std::span<const sim::StopCondition> stop_conditions,
+                        util::JobProgress* progress,
+                        std::pmr::memory_resource* resource,
+                        std::optional<Factory::Cache::Overflow>& out_overflow,
+                        std::optional<sim::StopResult>& out_stop,
+                        std::size_t& out_ticks_simulated);
+
+Factory::Cache::Cache(const Factory& factory,
+                      std::size_t ticks_to_simulate,
+                      std::shared_ptr<util::Arena> arena,
+                      std::span<const sim::StopCondition> stop_conditions,
+                      util::JobProgress* progress) :
+    _item_graph(factory.machines), _ticks_simulated(ticks_to_simulate) {
+    classify_items(factory);
+
+    // Logs record ticks with as many bits as `TickCount`
+    constexpr auto max_ticks = static_cast<std::size_t>(std::numeric_limits<TickCount>::max());
+    if (_ticks_simulated > max_ticks) {
+        PLOG_WARNING << "Only simulating " << max_ticks << " ticks out of " << _ticks_simulated;
+        _ticks_simulated = max_ticks;
+    }
+
+    if (!arena) {
+        arena = std::make_shared<util::Arena>();
+    }
+    // The logs must be constructed in place: moving them into a container using another resource
+    // would copy them
+    auto* resource = arena.get();
+    std::size_t ticks_simulated = 0;
+    auto logs =
+        simulate_item_evolution(factory.items, factory.machines, _ticks_simulated, stop_conditions,
+                                progress, resource, _overflow, _stop, ticks_simulated);
+    _plots = std::make_shared<Plots>(std::move(arena), std::move(logs), QuantityPlotsT(resource));
+    if (_stop) {
+        _ticks_simulated = _stop->tick + 1;
+    } else if (!_overflow && ticks_simulated < _ticks_simulated) {
+        PLOG_INFO << "Simulation cancelled after " << ticks_simulated << " ticks out of "
+                  << _ticks_simulated;
+        _ticks_simulated = ticks_simulated;
+        _cancelled = true;
+    }
+
+    if (_overflow) {
+        PLOG_WARNING << "Simulation stopped at tick " << _overflow->tick << ": the quantity of '"
+                     << factory.items.at(_overflow->item).name << "' doesn't fit in "
+                     << sizeof(Quantity) * 8 << " bits";
+    }
+}
+
+Factory::Cache::Cache(const Factory& factory,
+                      QuantityPlotsT plots,
+                      std::size_t ticks_simulated,
+                      std::optional<Overflow> overflow) :
+    _item_graph(factory.machines),
+    _plots(std::make_shared<Plots>(nullptr, QuantityLogsT(), std::move(plots))),
+    _ticks_simulated(ticks_simulated),
+    _overflow(overflow) {
+    classify_items(factory);
+}
+
+template<typename F> decltype(auto) Factory::Cache::visit_item(Uid item, F&& f) const {
+    std::lock_guard lock(_plots->mutex);
+    if (const auto plot = _plots->plots.find(item); plot != _plots->plots.end()) {
+        return f(plot->second);
+    }
+    return f(_plots->logs.at(item));
+}
+
+const util::QuantityPlot& Factory::Cache::plot(Uid item) const {
+    std::lock_guard lock(_plots->mutex);
+    if (const auto plot = _plots->plots.find(item); plot != _plots->plots.end()) {
+        return plot->second;
+    }
+    // Elements of unordered maps never move, so the plot can be handed out while others are added
+    auto* resource = _plots->arena ? _plots->arena.get() : std::pmr::get_default_resource();
+    return _plots->plots
+        .try_emplace(item, _plots->logs.at(item).to_plot(_ticks_simulated + 1, resource))
+        .first->second;
+}
+
+util::QuantityPlot Factory::Cache::make_plot(Uid item) const {
+    return visit_item(item, [&](const auto& plot_or_log) -> util::QuantityPlot {
+        if constexpr (std::is_same_v<std::decay_t<decltype(plot_or_log)>, util::QuantityPlot>) {
+            return plot_or_log;
+        } else {
+            return plot_or_log.to_plot(_ticks_simulated + 1);
+        }
+    });
+}
+
+void Factory::Cache::copy_quantities(Uid item,
+                                     std::size_t first_tick,
+                                     std::span<Quantity> out) const {
+    visit_item(item, [&](const auto& plot_or_log) {
+        if constexpr (std::is_same_v<std::decay_t<decltype(plot_or_log)>, util::QuantityPlot>) {
+            const auto values = plot_or_log.values();
+            for (std::size_t value_i = 0; value_i < out.size(); value_i++) {
+                out[value_i] =
+                    values.empty() ? 0 : values[std::min(first_tick + value_i, values.size() - 1)];
+            }
+        } else {
+            plot_or_log.copy_values(first_tick, out);
+        }
+    });
+}
+
+Quantity Factory::Cache::quantity_at(Uid item, std::size_t tick) const {
+    return visit_item(item, [&](const auto& plot_or_log) -> Quantity {
+        if constexpr (std::is_same_v<std::decay_t<decltype(plot_or_log)>, util::QuantityPlot>) {
+            const auto values = plot_or_log.values();
+            return values.empty() ? 0 : values[std::min(tick, values.size() - 1)];
+        } else {
+            return plot_or_log.value_at(tick);
+        }
+    });
+}
+
+Quantity Factory::Cache::max_quantity(Uid item) const {
+    return visit_item(item, [](const auto& plot_or_log) { return plot_or_log.max_value(); });
+}
+
+bool Factory::Cache::contains(Uid item) const {
+    std::lock_guard lock(_plots->mutex);
+    return _plots->plots.contains(item) || _plots->logs.contains(item);
+}
 
-Factory::Cache::Cache(const Factory& factory, std::size_t ticks_to_simulate) :
-    _item_nodes(calculate_links(factory.machines)), _ticks_simulated(ticks_to_simulate) {
+void Factory::Cache::classify_items(const Factory& factory) {
     for (auto& [item_uid, item] : factory.items) {
         switch (item.type) {
             case Item::NodeType::Input: {
@@ -24,89 +152,157 @@ Factory::Cache::Cache(const Factory& factory, std::size_t ticks_to_simulate) :
             default: break;
         }
     }
-
-    _plots =
-        simulate_item_evolution(factory.items, factory.machines, _item_nodes, ticks_to_simulate);
 }
 
-Factory::Cache::ItemNodesT calculate_links(const Factory::MachinesT& machines) {
-    Factory::Cache::ItemNodesT result;
+ItemGraph::ItemGraph(const util::UidMap<Machine>& machines) {
+    // Count the links of every item, giving each linked item a row as it is found
+    for (const auto& [_, machine] : machines) {
+        for (const auto& input : machine.inputs) {
+            const auto [row, inserted] = rows.try_emplace(
+                input.item, static_cast<std::uint32_t>(rows.size()));
+            if (inserted) {
+                consumer_offsets.emplace_back(0);
+                producer_offsets.emplace_back(0);
+            }
+            consumer_offsets[row->second]++;
+        }
+        for (const auto& output : machine.outputs) {
+            const auto [row, inserted] = rows.try_emplace(
+                output.item, static_cast<std::uint32_t>(rows.size()));
+            if (inserted) {
+                consumer_offsets.emplace_back(0);
+                producer_offsets.emplace_back(0);
+            }
+            producer_offsets[row->second]++;
+        }
+    }
+
+    // Turn the counts into the offsets where each row ends, then fill the rows back to front so
+    // that the offsets end up pointing at where they start
+    for (auto* offsets : {&consumer_offsets, &producer_offsets}) {
+        std::uint32_t total = 0;
+        for (auto& offset : *offsets) {
+            total += offset;
+            offset = total;
+        }
+        offsets->emplace_back(total);
+    }
+    consumer_links.resize(consumer_offsets.back(), Link{Uid(Uid::INVALID_VALUE), 0});
+    producer_links.resize(producer_offsets.back(), Link{Uid(Uid::INVALID_VALUE), 0});
 
-    for (const auto& [machine_uid, machine] : machines) {
-        for (std::size_t input_i = 0; input_i < machine.inputs.size(); input_i++) {
-            result[machine.inputs[input_i].item].inputs.insert(
-                ItemNode::Link{machine_uid, input_i});
+    for (auto machine = machines.end(); machine != machines.begin();) {
+        --machine;
+        const auto& [machine_uid, machine_data] = *machine;
+        for (std::size_t input_i = machine_data.inputs.size(); input_i-- > 0;) {
+            const auto row = rows.at(machine_data.inputs[input_i].item);
+            consumer_links[--consumer_offsets[row]] = Link{machine_uid, input_i};
         }
-        for (std::size_t output_i = 0; output_i < machine.outputs.size(); output_i++) {
-            result[machine.outputs[output_i].item].outputs.insert(
-                ItemNode::Link{machine_uid, output_i});
+        for (std::size_t output_i = machine_data.outputs.size(); output_i-- > 0;) {
+            const auto row = rows.at(machine_data.outputs[output_i].item);
+            producer_links[--producer_offsets[row]] = Link{machine_uid, output_i};
         }
     }
+}
 
-    return result;
+std::span<const ItemGraph::Link> ItemGraph::row(Uid item,
+                                                const std::vector<std::uint32_t>& offsets,
+                                                const std::vector<Link>& links) const {
+    const auto row = rows.find(item);
+    if (row == rows.end()) {
+        return {};
+    }
+    return std::span(links).subspan(offsets[row->second],
+                                    offsets[row->second + 1] - offsets[row->second]);
 }
 
-Factory::Cache::QuantityPlotsT simulate_item_evolution(const Factory::ItemsT& items,
-                                                       const Factory::MachinesT& machines,
-                                                       const Factory::Cache::ItemNodesT& nodes,
-                                                       std::size_t ticks_to_simulate) {
-    Factory::Cache::QuantityPlotsT plots;
-    plots.reserve(items.size());
-    for (auto& [item_name, item] : items) {
-        plots[item_name] = util::QuantityPlot(ticks_to_simulate, item.starting_quantity);
+Factory::Cache::QuantityLogsT
+simulate_item_evolution(const Factory::ItemsT& items,
+                        const Factory::MachinesT& machines,
+                        std::size_t ticks_to_simulate,
+                        std::span<const sim::StopCondition> stop_conditions,
+                        util::JobProgress* progress,
+                        std::pmr::memory_resource* resource,
+                        std::optional<Factory::Cache::Overflow>& out_overflow,
+                        std::optional<sim::StopResult>& out_stop,
+                        std::size_t& out_ticks_simulated) {
+    Factory::Cache::QuantityLogsT logs(resource);
+    logs.reserve(items.size());
+    sim::Simulation simulation(items, machines, resource);
+    std::pmr::vector<util::QuantityLog*> item_logs(resource);
+    item_logs.reserve(items.size());
+    for (auto& [item_uid, item] : items) {
+        item_logs.emplace_back(
+            &logs.try_emplace(item_uid, item.starting_quantity, resource).first->second);
     }
 
-    struct ProcessingTask {
-        int starting_tick;
-    };
+    std::optional<sim::StopConditionChecker> checker;
+    if (!stop_conditions.empty()) {
+        checker.emplace(stop_conditions, simulation, resource);
+    }
 
-    std::unordered_map<Uid, ProcessingTask> tasks;
-
-    for (int tick = 0; tick < ticks_to_simulate; tick++) {
-        // Process tasks
-        for (auto task = tasks.cbegin(); task != tasks.cend();) {
-            auto& machine = machines.at(task->first);
-
-            // Check if the task has been finished
-            if (tick >= task->second.starting_tick + machine.op_time.count()) {
-                // Add outputs and remove this task if so
-                for (auto& output : machine.outputs) {
-                    plots.at(output.item).change_value(tick, output.quantity);
-                }
-                task = tasks.erase(task);
-            } else {
-                ++task;
-            }
+    while (simulation.tick() < ticks_to_simulate) {
+        if (!simulation.report_progress(progress, ticks_to_simulate)) {
+            break;
+        }
+        const auto tick = simulation.tick();
+        const bool finished_tick = simulation.step();
+
+        // Only the quantity at the end of the tick is recorded. Changes made before an overflow
+        // are kept, so that the plots show how it happened.
+        const auto stock = simulation.stock();
+        for (const auto& change : simulation.changes()) {
+            item_logs[change.item]->record(tick, stock[change.item]);
         }
+        if (!finished_tick) {
+            out_overflow = simulation.overflow();
+            break;
+        }
+        if (checker && (out_stop = checker->check(simulation))) {
+            break;
+        }
+    }
 
-        for (const auto& [machine_uid, machine] : machines) {
-            // Check if this machine can do a processing cycle
-            bool requirements_fulfilled = std::all_of(
-                machine.inputs.begin(), machine.inputs.end(),
-                [tick, &items, &plots](const ItemStream& required) -> bool {
-                    auto& item = items.at(required.item);
-                    return item.type == Item::NodeType::Input ||
-                           plots.at(required.item).extrapolate_until(tick) >= required.quantity;
-                });
+    out_ticks_simulated = simulation.tick();
+    return logs;
+}
 
-            // Check if this machine is not currently busy with a previous cycle
-            bool is_machine_free = tasks.find(machine_uid) == tasks.end();
+std::unordered_map<Uid, Uid> compact_uids(Factory& factory, UidPool& uid_pool) {
+    std::unordered_map<Uid, Uid> remapped;
+    uid_pool = UidPool(Uid(Uid::INVALID_VALUE + 1));
+    const auto remap = [&](Uid uid) {
+        if (uid.value == Uid::INVALID_VALUE) {
+            return uid;
+        }
+        if (const auto new_uid = remapped.find(uid); new_uid != remapped.end()) {
+            return new_uid->second;
+        }
+        return remapped.emplace(uid, uid_pool.generate()).first->second;
+    };
 
-            if (is_machine_free && requirements_fulfilled) {
-                // Remove items required
-                for (auto& input : machine.inputs) {
-                    plots.at(input.item).change_value(tick, -input.quantity);
-                }
+    Factory::ItemsT items;
+    items.reserve(factory.items.size());
+    for (auto& [item_uid, item] : factory.items) {
+        const auto new_uid = remap(item_uid);
+        item.attribute_uid = remap(item.attribute_uid);
+        items.emplace(new_uid, std::move(item));
+    }
 
-                // Add processing task
-                tasks[machine_uid] = ProcessingTask{tick};
+    Factory::MachinesT machines;
+    machines.reserve(factory.machines.size());
+    for (auto& [machine_uid, machine] : factory.machines) {
+        const auto new_uid = remap(machine_uid);
+        for (auto* io : {&machine.inputs, &machine.outputs}) {
+            for (auto& stream : *io) {
+                stream.item = remap(stream.item);
+                stream.uid = remap(stream.uid);
             }
         }
+        machines.emplace(new_uid, std::move(machine));
     }
 
-    for (auto& [_, plot] : plots) { plot.extrapolate_until(ticks_to_simulate); }
-
-    return plots;
+    factory.items = std::move(items);
+    factory.machines = std::move(machines);
+    return remapped;
 }
 
 } // namespace fmk
\ No newline at end of file
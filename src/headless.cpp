@@ -0,0 +1,743 @@
+#include "headless.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <csignal>
+#include <filesystem>
+#include <fmt/core.h>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <plog/Log.h>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "editor/graph_layout.hpp"
+#include "io/factory_file.hpp"
+#include "io/module_library.hpp"
+#include "io/plot_export.hpp"
+#include "io/recipe_catalog.hpp"
+#include "io/simulator_source.hpp"
+#include "server/simulation_server.hpp"
+#include "sim/machine_counts.hpp"
+#include "sim/monte_carlo.hpp"
+#include "sim/simulation.hpp"
+#include "util/background_job.hpp"
+
+namespace fmk {
+
+namespace {
+
+constexpr const char* usage =
+    "Usage:\n"
+    "    facmaker\n"
+    "        Opens the editor.\n"
+    "    facmaker export <factory> <output> [--items <name>,...] [--every <n> | --minmax <n>]\n"
+    "                    [--throughput <n>] [<stop condition>...]\n"
+    "        Simulates a factory and exports the plots of its items, or only the ones given, to\n"
+    "        <output>. CSV is used if <output> ends in .csv, the columnar format otherwise.\n"
+    "        --every <n> keeps one tick out of every <n>, --minmax <n> keeps the minimum and\n"
+    "        maximum of every <n> ticks. --throughput <n> adds how much of every item was\n"
+    "        produced and consumed during the last <n> ticks, at every tick. Stop conditions\n"
+    "        end the simulation early.\n"
+    "    facmaker query <factory> <stop condition>... [--ticks <n>]\n"
+    "        Simulates a factory, without keeping its plots, until one of the stop conditions\n"
+    "        is met or for <n> ticks, as many as the factory file says by default, and tells\n"
+    "        which one was met and when.\n"
+    "        Exits with 2 if none was.\n"
+    "    facmaker module <factory>\n"
+    "        Simulates a factory until it repeats itself and tells what it consumes and produces\n"
+    "        when embedded in other factories as a module.\n"
+    "    facmaker montecarlo <factory> [--replicas <n>] [--seed <n>] [--ticks <n>]\n"
+    "        Simulates <n> replicas of a factory, 100 by default, with random operation times\n"
+    "        and outputs, and tells the 5th percentile, median and 95th percentile of the\n"
+    "        quantity of every item at the end.\n"
+    "    facmaker solve <factory> <item>=<n>... [--surplus] [--output <output>]\n"
+    "        Finds how many copies of each machine make every <item> at <n> per minute\n"
+    "        without running out of internal items, with the fewest machines or, with\n"
+    "        --surplus, the least surplus piling up, and checks them with a short simulation.\n"
+    "        Given an <output>, saves the factory with the copies of the machines there.\n"
+    "    facmaker recipes <recipes> [<output> <recipe>...]\n"
+    "        Loads a recipe file, in CSV if it ends in .csv or in JSON otherwise, and tells how\n"
+    "        many recipes and items it has. Given an <output>, builds a factory with a machine\n"
+    "        for every <recipe> named, arranges it and saves it there.\n"
+    "    facmaker codegen <factory> <output>\n"
+    "        Writes to <output> the C++ source of a program that only simulates this factory,\n"
+    "        for factories simulated many times. Once compiled (e.g. c++ -O2 -std=c++17), it\n"
+    "        takes a CSV file to write and a number of ticks, as many as the factory file says\n"
+    "        by default, and writes the same plots as export.\n"
+    "    facmaker layout <factory> <output>\n"
+    "        Arranges the nodes of a factory in layers along the flow of items and saves it\n"
+    "        with its new node positions to <output>.\n"
+    "Stop conditions:\n"
+    "    --reaches <item>=<n>    The quantity of <item> gets to <n> or more.\n"
+    "    --drops-to <item>=<n>   The quantity of <item> gets to <n> or less. An <item> of *\n"
+    "                            stands for any internal item.\n"
+    "    --steady <n>            All quantities change by the same amount in two spans of <n>\n"
+    "                            ticks in a row.\n"
+    "Interrupting a simulation (e.g. with Ctrl+C) cancels it. export then writes the ticks\n"
+    "simulated so far.\n";
+
+std::optional<std::size_t> parse_size(std::string_view str) {
+    std::size_t value;
+    const auto [end, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+    if (ec != std::errc() || end != str.data() + str.size()) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+std::optional<Quantity> parse_quantity(std::string_view str) {
+    Quantity value;
+    const auto [end, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+    if (ec != std::errc() || end != str.data() + str.size()) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+std::optional<double> parse_rate(std::string_view str) {
+    double value;
+    const auto [end, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+    if (ec != std::errc() || end != str.data() + str.size() || value < 0) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+std::optional<Uid> find_item(const Factory& factory, std::string_view name) {
+    const auto item =
+        std::find_if(factory.items.begin(), factory.items.end(),
+                     [name](const auto& item) { return item.second.name == name; });
+    if (item == factory.items.end()) {
+        return std::nullopt;
+    }
+    return item->first;
+}
+
+bool is_stop_condition_option(std::string_view option) {
+    return option == "--reaches" || option == "--drops-to" || option == "--steady";
+}
+
+/// Parses the value of a stop condition option, printing what is wrong with it if it is invalid.
+std::optional<sim::StopCondition>
+parse_stop_condition(std::string_view option, std::string_view value, const Factory& factory) {
+    if (option == "--steady") {
+        const auto window = parse_size(value);
+        if (!window || *window == 0) {
+            std::cerr << "Invalid window '" << value << "' for " << option << "\n";
+            return std::nullopt;
+        }
+        return sim::StopCondition::steady_state(*window);
+    }
+
+    const auto separator = value.rfind('=');
+    const auto threshold = separator == std::string_view::npos
+                               ? std::nullopt
+                               : parse_quantity(value.substr(separator + 1));
+    if (!threshold) {
+        std::cerr << "Expected <item>=<n> for " << option << ", got '" << value << "'\n";
+        return std::nullopt;
+    }
+    const auto name = value.substr(0, separator);
+    if (option == "--drops-to" && name == "*") {
+        return sim::StopCondition::any_buffer_drops_to(*threshold);
+    }
+    const auto item = find_item(factory, name);
+    if (!item) {
+        std::cerr << "No item named '" << name << "'\n";
+        return std::nullopt;
+    }
+    return option == "--reaches" ? sim::StopCondition::reaches(*item, *threshold)
+                                 : sim::StopCondition::drops_to(*item, *threshold);
+}
+
+/// Parses stop condition options given as pairs of option and value.
+std::optional<std::vector<sim::StopCondition>>
+parse_stop_conditions(std::span<const std::pair<std::string_view, std::string_view>> options,
+                      const Factory& factory) {
+    std::vector<sim::StopCondition> conditions;
+    for (const auto& [option, value] : options) {
+        const auto condition = parse_stop_condition(option, value, factory);
+        if (!condition) {
+            return std::nullopt;
+        }
+        conditions.emplace_back(*condition);
+    }
+    return conditions;
+}
+
+volatile std::sig_atomic_t interrupted = 0;
+
+/// Runs a function in the background, printing its progress to stderr until it finishes.
+/// Interrupting the process cancels the function through its progress instead of killing it.
+template<typename T> T run_cancellable(std::function<T(util::JobProgress&)> function) {
+    interrupted = 0;
+    std::signal(SIGINT, [](int) { interrupted = 1; });
+
+    util::BackgroundJob<T> job(std::move(function));
+    int shown_percent = -1;
+    while (!job.is_ready()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        if (interrupted) {
+            job.cancel();
+        }
+        const auto percent = static_cast<int>(job.progress().fraction() * 100.f);
+        if (percent != shown_percent) {
+            std::cerr << "\r" << job.progress().stage() << " " << percent << "%" << std::flush;
+            shown_percent = percent;
+        }
+    }
+    if (shown_percent >= 0) {
+        std::cerr << "\n";
+    }
+
+    std::signal(SIGINT, SIG_DFL);
+    return job.take_result();
+}
+
+/// Loads a factory file and simulates it if the file doesn't contain simulation results.
+std::optional<io::FactoryDocument> load_simulated(const std::filesystem::path& path) {
+    return run_cancellable<std::optional<io::FactoryDocument>>([&](util::JobProgress& progress) {
+        auto document = io::load_factory_file(path, &progress);
+        if (document && !document->cache) {
+            progress.set_stage("Simulating");
+            document->cache = document->factory.generate_cache(document->ticks_to_simulate,
+                                                               nullptr, {}, &progress);
+        }
+        return document;
+    });
+}
+
+int run_export(std::span<const std::string_view> args) {
+    if (args.size() < 2) {
+        std::cerr << usage;
+        return 1;
+    }
+    const std::filesystem::path factory_path(args[0]);
+    const std::filesystem::path output_path(args[1]);
+
+    std::optional<std::string_view> item_names;
+    io::PlotExportOptions options;
+    std::vector<std::pair<std::string_view, std::string_view>> stop_options;
+    for (std::size_t arg_i = 2; arg_i < args.size(); arg_i++) {
+        const auto arg = args[arg_i];
+        if (arg_i + 1 >= args.size()) {
+            std::cerr << "Missing value for " << arg << "\n" << usage;
+            return 1;
+        }
+        const auto value = args[++arg_i];
+
+        if (arg == "--items") {
+            item_names = value;
+        } else if (arg == "--every" || arg == "--minmax") {
+            const auto bucket_size = parse_size(value);
+            if (!bucket_size || *bucket_size == 0) {
+                std::cerr << "Invalid bucket size '" << value << "'\n";
+                return 1;
+            }
+            options.downsampling = arg == "--every"
+                                       ? io::PlotExportOptions::Downsampling::EveryNth
+                                       : io::PlotExportOptions::Downsampling::MinMax;
+            options.bucket_size = *bucket_size;
+        } else if (arg == "--throughput") {
+            const auto window = parse_size(value);
+            if (!window || *window == 0) {
+                std::cerr << "Invalid throughput window '" << value << "'\n";
+                return 1;
+            }
+            options.throughput_window = *window;
+        } else if (is_stop_condition_option(arg)) {
+            stop_options.emplace_back(arg, value);
+        } else {
+            std::cerr << "Unknown option " << arg << "\n" << usage;
+            return 1;
+        }
+    }
+
+    auto document = stop_options.empty() ? load_simulated(factory_path)
+                                         : io::load_factory_file(factory_path);
+    if (!document) {
+        return 1;
+    }
+    const auto& factory = document->factory;
+
+    if (!stop_options.empty()) {
+        // Results saved in the file ran until the end, so the factory is simulated again
+        const auto conditions = parse_stop_conditions(stop_options, factory);
+        if (!conditions) {
+            return 1;
+        }
+        document->cache = run_cancellable<Factory::Cache>([&](util::JobProgress& progress) {
+            progress.set_stage("Simulating");
+            return factory.generate_cache(document->ticks_to_simulate, nullptr, *conditions,
+                                          &progress);
+        });
+        if (const auto& stop = document->cache->stop()) {
+            PLOGI << "Stopped early: "
+                  << sim::describe_stop(factory, (*conditions)[stop->condition], *stop);
+        }
+    }
+
+    std::vector<Uid> items;
+    if (item_names) {
+        for (std::size_t start = 0; start <= item_names->size();) {
+            auto end = item_names->find(',', start);
+            if (end == std::string_view::npos) {
+                end = item_names->size();
+            }
+            const auto name = item_names->substr(start, end - start);
+            const auto item = find_item(factory, name);
+            if (!item) {
+                std::cerr << "No item named '" << name << "'\n";
+                return 1;
+            }
+            items.emplace_back(*item);
+            start = end + 1;
+        }
+    } else {
+        for (const auto& [item_uid, _] : factory.items) { items.emplace_back(item_uid); }
+    }
+
+    std::ofstream output(output_path, std::ios::binary);
+    if (output_path.extension() == ".csv") {
+        io::export_plots_csv(output, factory, *document->cache, items, options);
+    } else {
+        io::export_plots_columnar(output, factory, *document->cache, items, options);
+    }
+    if (!output) {
+        PLOG_ERROR << "Could not write '" << output_path.string() << "'";
+        return 1;
+    }
+
+    PLOGI << "Exported " << items.size() << " items to '" << output_path.string() << "'";
+    return 0;
+}
+
+int run_query(std::span<const std::string_view> args) {
+    if (args.empty()) {
+        std::cerr << usage;
+        return 1;
+    }
+    const std::filesystem::path factory_path(args[0]);
+
+    std::optional<std::size_t> ticks;
+    std::vector<std::pair<std::string_view, std::string_view>> stop_options;
+    for (std::size_t arg_i = 1; arg_i < args.size(); arg_i++) {
+        const auto arg = args[arg_i];
+        if (arg_i + 1 >= args.size()) {
+            std::cerr << "Missing value for " << arg << "\n" << usage;
+            return 1;
+        }
+        const auto value = args[++arg_i];
+
+        if (arg == "--ticks") {
+            ticks = parse_size(value);
+            if (!ticks) {
+                std::cerr << "Invalid tick count '" << value << "'\n";
+                return 1;
+            }
+        } else if (is_stop_condition_option(arg)) {
+            stop_options.emplace_back(arg, value);
+        } else {
+            std::cerr << "Unknown option " << arg << "\n" << usage;
+            return 1;
+        }
+    }
+    if (stop_options.empty()) {
+        std::cerr << "No stop condition given\n" << usage;
+        return 1;
+    }
+
+    const auto document = io::load_factory_file(factory_path);
+    if (!document) {
+        return 1;
+    }
+    const auto conditions = parse_stop_conditions(stop_options, document->factory);
+    if (!conditions) {
+        return 1;
+    }
+
+    const auto max_ticks = ticks.value_or(document->ticks_to_simulate);
+    bool cancelled = false;
+    const auto stop =
+        run_cancellable<std::optional<sim::StopResult>>([&](util::JobProgress& progress) {
+            progress.set_stage("Simulating");
+            auto result = sim::find_stop(document->factory, *conditions, max_ticks, &progress);
+            cancelled = progress.is_cancelled();
+            return result;
+        });
+    if (!stop && cancelled) {
+        std::cerr << "Cancelled before any condition was met\n";
+        return 1;
+    }
+    if (!stop) {
+        std::cout << "No condition was met within " << max_ticks << " ticks\n";
+        return 2;
+    }
+    std::cout << sim::describe_stop(document->factory, (*conditions)[stop->condition], *stop)
+              << "\n";
+    return 0;
+}
+
+int run_module(std::span<const std::string_view> args) {
+    if (args.size() != 1) {
+        std::cerr << usage;
+        return 1;
+    }
+    const std::filesystem::path module_path(args[0]);
+
+    io::ModuleLibrary library;
+    const auto summary = run_cancellable<std::shared_ptr<const sim::ModuleSummary>>(
+        [&](util::JobProgress& progress) { return library.get(module_path, &progress); });
+    if (!summary) {
+        return 1;
+    }
+
+    const auto seconds = [](std::size_t ticks) {
+        return std::chrono::duration<double>(
+                   std::chrono::duration<double, util::ticks::period>(static_cast<double>(ticks)))
+            .count();
+    };
+    const auto period_seconds = seconds(summary->period);
+    std::cout << fmt::format("Module '{}' repeats every {} ticks ({:.2f} s) after a warm-up of {} "
+                             "ticks ({:.2f} s)\n",
+                             summary->name, summary->period, period_seconds,
+                             summary->warmup_ticks, seconds(summary->warmup_ticks));
+    for (const auto& flow : summary->flows) {
+        const auto quantity = flow.per_period < 0 ? -static_cast<std::int64_t>(flow.per_period)
+                                                  : static_cast<std::int64_t>(flow.per_period);
+        std::cout << fmt::format("    {} {} '{}' per period ({:.2f}/s)\n",
+                                 flow.per_period < 0 ? "Consumes" : "Produces", quantity,
+                                 flow.item, static_cast<double>(quantity) / period_seconds);
+    }
+    return 0;
+}
+
+int run_montecarlo(std::span<const std::string_view> args) {
+    if (args.empty()) {
+        std::cerr << usage;
+        return 1;
+    }
+    const std::filesystem::path factory_path(args[0]);
+
+    std::size_t replicas = 100;
+    std::size_t seed = 0;
+    std::optional<std::size_t> ticks;
+    for (std::size_t arg_i = 1; arg_i < args.size(); arg_i++) {
+        const auto arg = args[arg_i];
+        if (arg_i + 1 >= args.size()) {
+            std::cerr << "Missing value for " << arg << "\n" << usage;
+            return 1;
+        }
+        const auto value = parse_size(args[++arg_i]);
+        if (!value) {
+            std::cerr << "Invalid value '" << args[arg_i] << "' for " << arg << "\n";
+            return 1;
+        }
+
+        if (arg == "--replicas") {
+            replicas = std::max(*value, std::size_t(1));
+        } else if (arg == "--seed") {
+            seed = *value;
+        } else if (arg == "--ticks") {
+            ticks = *value;
+        } else {
+            std::cerr << "Unknown option " << arg << "\n" << usage;
+            return 1;
+        }
+    }
+
+    const auto document = io::load_factory_file(factory_path);
+    if (!document) {
+        return 1;
+    }
+    const auto result = run_cancellable<sim::MonteCarloResult>([&](util::JobProgress& progress) {
+        progress.set_stage("Simulating replicas");
+        return sim::run_monte_carlo(document->factory,
+                                    ticks.value_or(document->ticks_to_simulate), replicas, seed,
+                                    0, &progress);
+    });
+    if (result.ticks_simulated == 0) {
+        std::cerr << (result.cancelled ? "Cancelled before any tick was simulated\n"
+                                       : "No tick to simulate\n");
+        return 1;
+    }
+
+    std::cout << fmt::format("{} replicas after {} ticks{}:\n", result.replicas,
+                             result.ticks_simulated, result.cancelled ? " (cancelled)" : "");
+    for (const auto& [item_uid, item] : document->factory.items) {
+        const auto& bands = result.bands.at(item_uid);
+        std::cout << fmt::format("    '{}': p{} {}, median {}, p{} {}\n", item.name,
+                                 sim::MonteCarloResult::low_percentile,
+                                 bands.low.values().back(), bands.median.values().back(),
+                                 sim::MonteCarloResult::high_percentile,
+                                 bands.high.values().back());
+    }
+    if (result.overflowed_replicas > 0) {
+        std::cout << result.overflowed_replicas
+                  << " replicas stopped early because a quantity overflowed\n";
+    }
+    return 0;
+}
+
+int run_layout(std::span<const std::string_view> args) {
+    if (args.size() != 2) {
+        std::cerr << usage;
+        return 1;
+    }
+    const std::filesystem::path factory_path(args[0]);
+    const std::filesystem::path output_path(args[1]);
+
+    const auto document = io::load_factory_file(factory_path);
+    if (!document) {
+        return 1;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    const auto node_positions =
+        run_cancellable<io::NodePositionsT>([&](util::JobProgress& progress) {
+            return layout_factory(document->factory, {}, &progress);
+        });
+    const std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::cout << fmt::format("Laid out {} nodes in {:.1f} ms\n", node_positions.size(),
+                             elapsed.count());
+
+    const auto* cache = document->cache ? &*document->cache : nullptr;
+    return io::save_factory_file(output_path, document->factory, document->uid_pool,
+                                 node_positions, document->ticks_to_simulate, cache)
+               ? 0
+               : 1;
+}
+
+int run_solve(std::span<const std::string_view> args) {
+    if (args.empty()) {
+        std::cerr << usage;
+        return 1;
+    }
+    auto document = io::load_factory_file(std::filesystem::path(args[0]));
+    if (!document) {
+        return 1;
+    }
+    auto& factory = document->factory;
+
+    sim::MachineCountOptions options;
+    std::optional<std::filesystem::path> output_path;
+    std::vector<sim::RateTarget> targets;
+    for (std::size_t arg_i = 1; arg_i < args.size(); arg_i++) {
+        const auto arg = args[arg_i];
+        if (arg == "--surplus") {
+            options.objective = sim::MachineCountOptions::Objective::Surplus;
+        } else if (arg == "--output" && arg_i + 1 < args.size()) {
+            output_path = args[++arg_i];
+        } else if (arg.starts_with("--")) {
+            std::cerr << "Unknown option " << arg << "\n" << usage;
+            return 1;
+        } else {
+            const auto separator = arg.rfind('=');
+            const auto rate = separator == std::string_view::npos
+                                  ? std::nullopt
+                                  : parse_rate(arg.substr(separator + 1));
+            if (!rate) {
+                std::cerr << "Expected <item>=<n>, got '" << arg << "'\n";
+                return 1;
+            }
+            const auto item = find_item(factory, arg.substr(0, separator));
+            if (!item) {
+                std::cerr << "No item named '" << arg.substr(0, separator) << "'\n";
+                return 1;
+            }
+            targets.emplace_back(sim::RateTarget{*item, *rate});
+        }
+    }
+    if (targets.empty()) {
+        std::cerr << "No target rate given\n" << usage;
+        return 1;
+    }
+
+    const auto solution =
+        run_cancellable<std::optional<sim::MachineCounts>>([&](util::JobProgress& progress) {
+            return sim::solve_machine_counts(factory, targets, options, &progress);
+        });
+    if (!solution) {
+        return 1;
+    }
+
+    std::cout << (solution->is_optimal
+                      ? "Machine counts:\n"
+                      : fmt::format("Best machine counts found within {} relaxations:\n",
+                                    options.max_relaxations));
+    std::size_t machine_i = 0;
+    for (const auto& [_, machine] : factory.machines) {
+        if (const auto count = solution->counts[machine_i++]; count > 0) {
+            std::cout << fmt::format("    {:>5} x {}\n", count, machine.name);
+        }
+    }
+    std::cout << fmt::format("Rates per minute: {:>10} {:>10} {:>10}\n", "target", "planned",
+                             "simulated");
+    for (const auto& rate : solution->rates) {
+        const auto target = rate.target_per_minute > 0
+                                ? fmt::format("{:.2f}", rate.target_per_minute)
+                                : std::string("-");
+        const auto simulated = rate.simulated_per_minute
+                                   ? fmt::format("{:.2f}", *rate.simulated_per_minute)
+                                   : std::string("-");
+        std::cout << fmt::format("    {:<13} {:>10} {:>10.2f} {:>10}\n",
+                                 factory.items.at(rate.item).name, target,
+                                 rate.planned_per_minute, simulated);
+    }
+
+    if (!output_path) {
+        return 0;
+    }
+    factory.machines = sim::repeat_machines(factory.machines, solution->counts, document->uid_pool);
+    const auto node_positions = layout_factory(factory);
+    return io::save_factory_file(*output_path, factory, document->uid_pool, node_positions,
+                                 document->ticks_to_simulate)
+               ? 0
+               : 1;
+}
+
+int run_codegen(std::span<const std::string_view> args) {
+    if (args.size() != 2) {
+        std::cerr << usage;
+        return 1;
+    }
+    const std::filesystem::path factory_path(args[0]);
+    const std::filesystem::path output_path(args[1]);
+
+    const auto document = io::load_factory_file(factory_path);
+    if (!document) {
+        return 1;
+    }
+    std::ofstream output(output_path, std::ios::binary);
+    io::write_simulator_source(output, document->factory, document->ticks_to_simulate);
+    if (!output) {
+        PLOG_ERROR << "Could not write '" << output_path.string() << "'";
+        return 1;
+    }
+    return 0;
+}
+
+int run_recipes(std::span<const std::string_view> args) {
+    if (args.empty() || args.size() == 2) {
+        std::cerr << usage;
+        return 1;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto catalog = io::load_recipe_file(std::filesystem::path(args[0]));
+    if (!catalog) {
+        return 1;
+    }
+    const std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::cout << fmt::format("Loaded {} recipes with {} items in {:.1f} ms\n",
+                             catalog->recipe_count(), catalog->item_count(), elapsed.count());
+    if (args.size() == 1) {
+        return 0;
+    }
+
+    std::vector<io::RecipeCatalog::Index> recipes;
+    for (const auto name : args.subspan(2)) {
+        const auto recipe = catalog->find_recipe(name);
+        if (!recipe) {
+            std::cerr << "Unknown recipe '" << name << "'\n";
+            return 1;
+        }
+        recipes.emplace_back(*recipe);
+    }
+    io::FactoryDocument document;
+    io::instantiate_recipes(document.factory, document.uid_pool, *catalog, recipes);
+    const auto node_positions = layout_factory(document.factory);
+    return io::save_factory_file(std::filesystem::path(args[1]), document.factory,
+                                 document.uid_pool, node_positions, document.ticks_to_simulate)
+               ? 0
+               : 1;
+}
+
+server::SimulationServer* running_server = nullptr;
+
+int run_serve(std::span<const std::string_view> args) {
+    if (args.empty()) {
+        std::cerr << usage;
+        return 1;
+    }
+    const std::filesystem::path socket_path(args[0]);
+
+    std::size_t worker_count = 0;
+    for (std::size_t arg_i = 1; arg_i < args.size(); arg_i++) {
+        const auto arg = args[arg_i];
+        if (arg == "--workers" && arg_i + 1 < args.size()) {
+            const auto value = args[++arg_i];
+            const auto parsed = parse_size(value);
+            if (!parsed || *parsed == 0) {
+                std::cerr << "Invalid worker count '" << value << "'\n";
+                return 1;
+            }
+            worker_count = *parsed;
+        } else {
+            std::cerr << "Unknown option " << arg << "\n" << usage;
+            return 1;
+        }
+    }
+
+    server::SimulationServer server(socket_path, worker_count);
+    running_server = &server;
+    const auto stop_server = [](int) { running_server->stop(); };
+    std::signal(SIGINT, stop_server);
+    std::signal(SIGTERM, stop_server);
+
+    const bool served = server.run();
+
+    std::signal(SIGINT, SIG_DFL);
+    std::signal(SIGTERM, SIG_DFL);
+    running_server = nullptr;
+    return served ? 0 : 1;
+}
+
+} // namespace
+
+int run_headless(std::span<const std::string_view> args) {
+    if (args.empty()) {
+        std::cerr << usage;
+        return 1;
+    }
+
+    const auto command = args[0];
+    if (command == "export") {
+        return run_export(args.subspan(1));
+    }
+    if (command == "serve") {
+        return run_serve(args.subspan(1));
+    }
+    if (command == "query") {
+        return run_query(args.subspan(1));
+    }
+    if (command == "montecarlo") {
+        return run_montecarlo(args.subspan(1));
+    }
+    if (command == "recipes") {
+        return run_recipes(args.subspan(1));
+    }
+    if (command == "solve") {
+        return run_solve(args.subspan(1));
+    }
+    if (command == "codegen") {
+        return run_codegen(args.subspan(1));
+    }
+    if (command == "layout") {
+        return run_layout(args.subspan(1));
+    }
+    if (command == "module") {
+        return run_module(args.subspan(1));
+    }
+
+    std::cerr << "Unknown command '" << command << "'\n" << usage;
+    return 1;
+}
+
+} // namespace fmk
\ No newline at end of file
@@ -0,0 +1,552 @@
+#include "io/binary_format.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <plog/Log.h>
+#include <type_traits>
+
+#include "util/mapped_file.hpp"
+
+namespace fmk::io {
+
+namespace {
+
+// File layout (all values in host byte order, checked through `FileHeader::byte_order`):
+//
+// FileHeader
+// ItemRecord[item_count]          at items_offset
+// MachineRecord[machine_count]    at machines_offset
+// StreamRecord[stream_count]      at streams_offset (machine inputs followed by its outputs)
+// char[string_bytes]              at strings_offset (item & machine names, not null-terminated)
+// Plots (optional)                at plots_offset, aligned to `section_alignment`:
+//     PlotsHeader
+//     std::int64_t item_uid[column_count]
+//     Value max_value[column_count]
+//     (padding to `section_alignment`)
+//     Value values[column_count][column_stride], each column holding `column_length` values
+//                                                followed by padding
+//
+// Plot values are integers of `PlotsHeader::value_size` bytes, the size of `Quantity` in the
+// build that wrote the file. Plot columns are aligned so that they can be used in place once the
+// file is memory-mapped, if the reading build uses the same size.
+
+constexpr std::array<char, 4> file_magic = {'F', 'M', 'K', 'B'};
+constexpr std::uint32_t byte_order_mark = 0x01020304;
+constexpr std::size_t section_alignment = 64;
+
+constexpr std::uint32_t file_flag_has_plots = 1 << 0;
+
+struct FileHeader {
+    std::array<char, 4> magic;
+    std::uint32_t byte_order;
+    std::uint32_t version;
+    std::uint32_t flags;
+    std::int64_t next_uid;
+    std::uint64_t ticks_to_simulate;
+    std::uint64_t item_count;
+    std::uint64_t items_offset;
+    std::uint64_t machine_count;
+    std::uint64_t machines_offset;
+    std::uint64_t stream_count;
+    std::uint64_t streams_offset;
+    std::uint64_t string_bytes;
+    std::uint64_t strings_offset;
+    std::uint64_t plots_offset;
+};
+
+struct ItemRecord {
+    std::int64_t uid;
+    std::int64_t attribute_uid;
+    std::int64_t starting_quantity;
+    std::int32_t type;
+    std::uint32_t name_offset;
+    std::uint32_t name_size;
+    std::uint32_t has_position;
+    float x;
+    float y;
+};
+
+struct MachineRecord {
+    std::int64_t uid;
+    std::int64_t op_time;
+    std::int64_t op_time_spread;
+    std::int32_t op_time_distribution;
+    std::uint32_t name_offset;
+    std::uint32_t name_size;
+    std::uint32_t first_stream;
+    std::uint32_t input_count;
+    std::uint32_t output_count;
+    std::uint32_t has_position;
+    float x;
+    float y;
+};
+
+struct StreamRecord {
+    std::int64_t item;
+    std::int64_t uid;
+    std::int64_t quantity;
+    float probability;
+    std::uint32_t padding;
+};
+
+struct PlotsHeader {
+    std::uint64_t ticks_simulated;
+    std::uint64_t column_count;
+    std::uint64_t column_length;
+    std::uint64_t column_stride;
+    std::uint64_t value_size;
+    /// The item whose quantity overflowed during the simulation, or `Uid::INVALID_VALUE`.
+    std::int64_t overflow_item;
+    std::uint64_t overflow_tick;
+};
+
+std::uint64_t align_up(std::uint64_t value, std::uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+template<typename T> void write_pod(std::ostream& out, const T& value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void write_padding(std::ostream& out, std::uint64_t& written, std::uint64_t alignment) {
+    static constexpr std::array<char, section_alignment> zeroes{};
+    const auto padding = align_up(written, alignment) - written;
+    out.write(zeroes.data(), static_cast<std::streamsize>(padding));
+    written += padding;
+}
+
+/// Bounds-checked view over the bytes of a mapped file.
+class Reader {
+public:
+    explicit Reader(std::span<const std::byte> bytes) : bytes(bytes) {}
+
+    bool contains(std::uint64_t offset, std::uint64_t size) const {
+        return offset <= bytes.size() && size <= bytes.size() - offset;
+    }
+
+    template<typename T> bool contains_array(std::uint64_t offset, std::uint64_t count) const {
+        return contains_array(offset, count, sizeof(T));
+    }
+    bool contains_array(std::uint64_t offset, std::uint64_t count, std::size_t size) const {
+        return count <= bytes.size() / size && contains(offset, count * size);
+    }
+
+    template<typename T> T read(std::uint64_t offset) const {
+        static_assert(std::is_trivially_copyable_v<T>);
+        T value;
+        std::memcpy(&value, bytes.data() + offset, sizeof(T));
+        return value;
+    }
+
+    std::span<const std::byte> bytes;
+};
+
+/// Reads a plot stored with values of type `T`. The values are used in place if `T` is
+/// `Quantity`, and converted otherwise.
+/// @returns The plot, or nullopt if its values don't fit in `Quantity`.
+template<typename T>
+std::optional<util::QuantityPlot> read_plot(std::span<const T> values,
+                                            T max_value,
+                                            const std::shared_ptr<const util::MappedFile>& file) {
+    if constexpr (std::is_same_v<T, Quantity>) {
+        return util::QuantityPlot::view(values, max_value, file);
+    } else {
+        std::vector<Quantity> converted;
+        converted.reserve(values.size());
+        for (const auto value : values) {
+            const auto quantity = util::narrow<Quantity>(value);
+            if (!quantity) {
+                return std::nullopt;
+            }
+            converted.emplace_back(*quantity);
+        }
+        return util::QuantityPlot::copy_of(converted);
+    }
+}
+
+template<typename T>
+std::optional<Factory::Cache::QuantityPlotsT>
+read_plot_columns(const Reader& reader,
+                  const PlotsHeader& header,
+                  std::uint64_t uids_offset,
+                  std::uint64_t maxima_offset,
+                  std::uint64_t columns_offset,
+                  const std::shared_ptr<const util::MappedFile>& file) {
+    const auto* columns = reinterpret_cast<const T*>(reader.bytes.data() + columns_offset);
+
+    Factory::Cache::QuantityPlotsT plots;
+    plots.reserve(header.column_count);
+    for (std::uint64_t column_i = 0; column_i < header.column_count; column_i++) {
+        const Uid item_uid(
+            reader.read<std::int64_t>(uids_offset + column_i * sizeof(std::int64_t)));
+        const auto max_value = reader.read<T>(maxima_offset + column_i * sizeof(T));
+        const std::span<const T> values(columns + column_i * header.column_stride,
+                                        header.column_length);
+        auto plot = read_plot(values, max_value, file);
+        if (!plot) {
+            PLOG_WARNING << "Binary loading warning: Stored plots have quantities too large for "
+                            "this build, they will be simulated again";
+            return std::nullopt;
+        }
+        plots.try_emplace(item_uid, std::move(*plot));
+    }
+    return plots;
+}
+
+std::optional<Factory::Cache::QuantityPlotsT>
+read_plots(const Reader& reader,
+           std::uint64_t offset,
+           const Factory& factory,
+           const std::shared_ptr<const util::MappedFile>& file,
+           std::size_t& out_ticks_simulated,
+           std::optional<Factory::Cache::Overflow>& out_overflow) {
+    if (offset % section_alignment != 0 || !reader.contains(offset, sizeof(PlotsHeader))) {
+        PLOG_ERROR << "Binary loading error: Plot section out of bounds";
+        return std::nullopt;
+    }
+    const auto header = reader.read<PlotsHeader>(offset);
+    if (header.value_size != sizeof(std::int32_t) && header.value_size != sizeof(std::int64_t)) {
+        PLOG_ERROR << "Binary loading error: Invalid plot value size " << header.value_size;
+        return std::nullopt;
+    }
+
+    const auto uids_offset = offset + sizeof(PlotsHeader);
+    const auto maxima_offset = uids_offset + header.column_count * sizeof(std::int64_t);
+    const auto columns_offset =
+        align_up(maxima_offset + header.column_count * header.value_size, section_alignment);
+
+    if (!reader.contains_array<std::int64_t>(uids_offset, header.column_count) ||
+        !reader.contains_array(maxima_offset, header.column_count, header.value_size) ||
+        header.column_stride < header.column_length ||
+        header.column_stride % (section_alignment / header.value_size) != 0 ||
+        (header.column_stride != 0 &&
+         header.column_count > std::numeric_limits<std::uint64_t>::max() / header.column_stride) ||
+        !reader.contains_array(columns_offset, header.column_count * header.column_stride,
+                               header.value_size)) {
+        PLOG_ERROR << "Binary loading error: Plot section out of bounds";
+        return std::nullopt;
+    }
+
+    auto plots = header.value_size == sizeof(std::int32_t)
+                     ? read_plot_columns<std::int32_t>(reader, header, uids_offset, maxima_offset,
+                                                       columns_offset, file)
+                     : read_plot_columns<std::int64_t>(reader, header, uids_offset, maxima_offset,
+                                                       columns_offset, file);
+    if (!plots) {
+        return std::nullopt;
+    }
+
+    for (const auto& [item_uid, _] : factory.items) {
+        if (!plots->contains(item_uid)) {
+            PLOG_WARNING << "Binary loading warning: Stored plots do not match the factory, they "
+                            "will be simulated again";
+            return std::nullopt;
+        }
+    }
+
+    out_ticks_simulated = header.ticks_simulated;
+    if (header.overflow_item != Uid::INVALID_VALUE) {
+        out_overflow = Factory::Cache::Overflow{Uid(header.overflow_item),
+                                                static_cast<std::size_t>(header.overflow_tick)};
+    }
+    return plots;
+}
+
+} // namespace
+
+bool is_binary_factory_file(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    std::array<char, 4> magic{};
+    file.read(magic.data(), magic.size());
+    return file && magic == file_magic;
+}
+
+void write_factory_binary(std::ostream& out,
+                          const Factory& factory,
+                          const UidPool& uid_pool,
+                          const NodePositionsT& node_positions,
+                          std::size_t ticks_to_simulate,
+                          const Factory::Cache* cache,
+                          const Factory* cache_factory) {
+    std::vector<ItemRecord> items;
+    std::vector<MachineRecord> machines;
+    std::vector<StreamRecord> streams;
+    std::string strings;
+
+    auto store_string = [&strings](const std::string& str, std::uint32_t& out_offset,
+                                   std::uint32_t& out_size) {
+        out_offset = static_cast<std::uint32_t>(strings.size());
+        out_size = static_cast<std::uint32_t>(str.size());
+        strings += str;
+    };
+    auto store_position = [&node_positions](Uid uid, std::uint32_t& out_has_position,
+                                            float& out_x, float& out_y) {
+        if (auto pos = node_positions.find(uid); pos != node_positions.end()) {
+            out_has_position = 1;
+            out_x = pos->second.x;
+            out_y = pos->second.y;
+        }
+    };
+
+    items.reserve(factory.items.size());
+    for (const auto& [item_uid, item] : factory.items) {
+        ItemRecord record{};
+        record.uid = item_uid.value;
+        record.attribute_uid = item.attribute_uid.value;
+        record.type = static_cast<std::int32_t>(item.type);
+        record.starting_quantity = item.starting_quantity;
+        store_string(item.name, record.name_offset, record.name_size);
+        store_position(item_uid, record.has_position, record.x, record.y);
+        items.emplace_back(record);
+    }
+
+    machines.reserve(factory.machines.size());
+    for (const auto& [machine_uid, machine] : factory.machines) {
+        MachineRecord record{};
+        record.uid = machine_uid.value;
+        record.op_time = machine.op_time.count();
+        record.op_time_spread = machine.op_time_distribution.spread.count();
+        record.op_time_distribution = static_cast<std::int32_t>(machine.op_time_distribution.type);
+        store_string(machine.name, record.name_offset, record.name_size);
+        record.first_stream = static_cast<std::uint32_t>(streams.size());
+        record.input_count = static_cast<std::uint32_t>(machine.inputs.size());
+        record.output_count = static_cast<std::uint32_t>(machine.outputs.size());
+        store_position(machine_uid, record.has_position, record.x, record.y);
+        for (const auto* io : {&machine.inputs, &machine.outputs}) {
+            for (const auto& stream : *io) {
+                streams.emplace_back(StreamRecord{stream.item.value, stream.uid.value,
+                                                  stream.quantity, stream.probability, 0});
+            }
+        }
+        machines.emplace_back(record);
+    }
+
+    FileHeader header{};
+    header.magic = file_magic;
+    header.byte_order = byte_order_mark;
+    header.version = binary_format_version;
+    header.flags = cache ? file_flag_has_plots : 0;
+    header.next_uid = uid_pool.get_next_uid().value;
+    header.ticks_to_simulate = ticks_to_simulate;
+    header.item_count = items.size();
+    header.items_offset = sizeof(FileHeader);
+    header.machine_count = machines.size();
+    header.machines_offset = header.items_offset + items.size() * sizeof(ItemRecord);
+    header.stream_count = streams.size();
+    header.streams_offset = header.machines_offset + machines.size() * sizeof(MachineRecord);
+    header.string_bytes = strings.size();
+    header.strings_offset = header.streams_offset + streams.size() * sizeof(StreamRecord);
+    header.plots_offset =
+        cache ? align_up(header.strings_offset + strings.size(), section_alignment) : 0;
+
+    write_pod(out, header);
+    out.write(reinterpret_cast<const char*>(items.data()),
+              static_cast<std::streamsize>(items.size() * sizeof(ItemRecord)));
+    out.write(reinterpret_cast<const char*>(machines.data()),
+              static_cast<std::streamsize>(machines.size() * sizeof(MachineRecord)));
+    out.write(reinterpret_cast<const char*>(streams.data()),
+              static_cast<std::streamsize>(streams.size() * sizeof(StreamRecord)));
+    out.write(strings.data(), static_cast<std::streamsize>(strings.size()));
+
+    if (!cache)
+        return;
+
+    std::uint64_t written = header.strings_offset + strings.size();
+    write_padding(out, written, section_alignment);
+
+    // The cache knows the items by their UIDs in `cache_factory`, which are in the same order
+    const auto& cache_items = cache_factory ? cache_factory->items : factory.items;
+    const auto cache_uid = [&cache_items](std::size_t item_i) {
+        return cache_items.begin()[item_i].first;
+    };
+    auto overflow = cache->overflow();
+    if (overflow) {
+        const auto cache_item = cache_items.find(overflow->item);
+        overflow->item = cache_item != cache_items.end()
+                             ? factory.items.begin()[cache_item - cache_items.begin()].first
+                             : overflow->item;
+    }
+    // Plots have a value for every tick simulated plus the one after the last
+    const std::size_t column_length = cache->ticks_simulated() + 1;
+
+    PlotsHeader plots_header{};
+    plots_header.ticks_simulated = cache->ticks_simulated();
+    plots_header.column_count = factory.items.size();
+    plots_header.column_length = column_length;
+    plots_header.column_stride = align_up(column_length, section_alignment / sizeof(Quantity));
+    plots_header.value_size = sizeof(Quantity);
+    plots_header.overflow_item = overflow ? overflow->item.value : Uid::INVALID_VALUE;
+    plots_header.overflow_tick = overflow ? overflow->tick : 0;
+    write_pod(out, plots_header);
+    written += sizeof(PlotsHeader);
+
+    for (const auto& [item_uid, _] : factory.items) {
+        write_pod(out, static_cast<std::int64_t>(item_uid.value));
+    }
+    for (std::size_t item_i = 0; item_i < factory.items.size(); item_i++) {
+        write_pod(out, cache->max_quantity(cache_uid(item_i)));
+    }
+    written += factory.items.size() * (sizeof(std::int64_t) + sizeof(Quantity));
+    write_padding(out, written, section_alignment);
+
+    // Columns are copied out of the cache one at a time, without building the plots, so that
+    // saving doesn't keep all of them in memory
+    std::vector<Quantity> column(plots_header.column_stride);
+    for (std::size_t item_i = 0; item_i < factory.items.size(); item_i++) {
+        cache->copy_quantities(cache_uid(item_i), 0, std::span(column).first(column_length));
+        out.write(reinterpret_cast<const char*>(column.data()),
+                  static_cast<std::streamsize>(column.size() * sizeof(Quantity)));
+    }
+}
+
+std::optional<FactoryDocument> read_factory_binary(const std::filesystem::path& path) {
+    const auto file = util::MappedFile::open(path);
+    if (!file) {
+        PLOG_ERROR << "Binary loading error: Could not map '" << path.string() << "'";
+        return std::nullopt;
+    }
+
+    const Reader reader(file->bytes());
+    if (!reader.contains(0, sizeof(FileHeader))) {
+        PLOG_ERROR << "Binary loading error: File is too small";
+        return std::nullopt;
+    }
+    const auto header = reader.read<FileHeader>(0);
+    if (header.magic != file_magic) {
+        PLOG_ERROR << "Binary loading error: Not a binary factory file";
+        return std::nullopt;
+    }
+    if (header.byte_order != byte_order_mark) {
+        PLOG_ERROR << "Binary loading error: File was written on a machine with a different byte "
+                      "order";
+        return std::nullopt;
+    }
+    if (header.version != binary_format_version) {
+        PLOG_ERROR << "Binary loading error: File version " << header.version
+                   << " is not the supported version " << binary_format_version;
+        return std::nullopt;
+    }
+    if (!reader.contains_array<ItemRecord>(header.items_offset, header.item_count) ||
+        !reader.contains_array<MachineRecord>(header.machines_offset, header.machine_count) ||
+        !reader.contains_array<StreamRecord>(header.streams_offset, header.stream_count) ||
+        !reader.contains(header.strings_offset, header.string_bytes)) {
+        PLOG_ERROR << "Binary loading error: File sections out of bounds";
+        return std::nullopt;
+    }
+
+    const auto* strings =
+        reinterpret_cast<const char*>(reader.bytes.data() + header.strings_offset);
+    auto read_string = [&](std::uint32_t offset, std::uint32_t size) -> std::optional<std::string> {
+        if (offset > header.string_bytes || size > header.string_bytes - offset) {
+            PLOG_ERROR << "Binary loading error: Name out of bounds";
+            return std::nullopt;
+        }
+        return std::string(strings + offset, size);
+    };
+
+    FactoryDocument document;
+    document.uid_pool = UidPool(Uid(header.next_uid));
+    document.ticks_to_simulate = header.ticks_to_simulate;
+
+    document.factory.items.reserve(header.item_count);
+    for (std::uint64_t i = 0; i < header.item_count; i++) {
+        const auto record =
+            reader.read<ItemRecord>(header.items_offset + i * sizeof(ItemRecord));
+        auto name = read_string(record.name_offset, record.name_size);
+        if (!name || record.type < static_cast<std::int32_t>(Item::NodeType::Input) ||
+            record.type > static_cast<std::int32_t>(Item::NodeType::Internal)) {
+            PLOG_ERROR << "Binary loading error: Invalid item record";
+            return std::nullopt;
+        }
+        const auto starting_quantity = util::narrow<Quantity>(record.starting_quantity);
+        if (!starting_quantity) {
+            PLOG_ERROR << "Binary loading error: Starting quantity of '" << *name
+                       << "' is too large for this build";
+            return std::nullopt;
+        }
+
+        const Uid item_uid(record.uid);
+        Item item{static_cast<Item::NodeType>(record.type), *starting_quantity, std::move(*name),
+                  Uid(record.attribute_uid)};
+        if (!document.factory.items.try_emplace(item_uid, std::move(item)).second) {
+            PLOG_ERROR << "Binary loading error: Duplicate item UID " << item_uid.value;
+            return std::nullopt;
+        }
+        if (record.has_position) {
+            document.node_positions[item_uid] = NodePosition{record.x, record.y};
+        }
+    }
+
+    document.factory.machines.reserve(header.machine_count);
+    for (std::uint64_t i = 0; i < header.machine_count; i++) {
+        const auto record =
+            reader.read<MachineRecord>(header.machines_offset + i * sizeof(MachineRecord));
+        auto name = read_string(record.name_offset, record.name_size);
+        const std::uint64_t stream_end = static_cast<std::uint64_t>(record.first_stream) +
+                                         record.input_count + record.output_count;
+        if (!name || stream_end > header.stream_count) {
+            PLOG_ERROR << "Binary loading error: Invalid machine record";
+            return std::nullopt;
+        }
+        const auto op_time = util::narrow<TickCount>(record.op_time);
+        const auto op_time_spread = util::narrow<TickCount>(record.op_time_spread);
+        if (!op_time || !op_time_spread) {
+            PLOG_ERROR << "Binary loading error: Operation time of '" << *name
+                       << "' is too large for this build";
+            return std::nullopt;
+        }
+        using DistributionType = OpTimeDistribution::Type;
+        if (record.op_time_distribution < static_cast<std::int32_t>(DistributionType::Fixed) ||
+            record.op_time_distribution > static_cast<std::int32_t>(DistributionType::Normal)) {
+            PLOG_ERROR << "Binary loading error: Invalid machine record";
+            return std::nullopt;
+        }
+
+        Machine machine{std::move(*name), {}, {}, util::ticks(*op_time),
+                        OpTimeDistribution{
+                            static_cast<DistributionType>(record.op_time_distribution),
+                            util::ticks(*op_time_spread)}};
+        for (std::uint64_t stream_i = record.first_stream; stream_i < stream_end; stream_i++) {
+            const auto stream = reader.read<StreamRecord>(header.streams_offset +
+                                                          stream_i * sizeof(StreamRecord));
+            const Uid item_uid(stream.item);
+            const auto quantity = util::narrow<Quantity>(stream.quantity);
+            if (!document.factory.items.contains(item_uid) || !quantity) {
+                PLOG_ERROR << "Binary loading error: Machine '" << machine.name
+                           << "' references an unknown item or a quantity too large for this "
+                              "build";
+                return std::nullopt;
+            }
+            auto& io = stream_i < record.first_stream + record.input_count ? machine.inputs
+                                                                           : machine.outputs;
+            io.emplace_back(ItemStream{item_uid, *quantity, Uid(stream.uid), stream.probability});
+        }
+
+        const Uid machine_uid(record.uid);
+        if (!document.factory.machines.try_emplace(machine_uid, std::move(machine)).second) {
+            PLOG_ERROR << "Binary loading error: Duplicate machine UID " << machine_uid.value;
+            return std::nullopt;
+        }
+        if (record.has_position) {
+            document.node_positions[machine_uid] = NodePosition{record.x, record.y};
+        }
+    }
+
+    if (header.flags & file_flag_has_plots) {
+        std::size_t ticks_simulated;
+        std::optional<Factory::Cache::Overflow> overflow;
+        if (auto plots = read_plots(reader, header.plots_offset, document.factory, file,
+                                    ticks_simulated, overflow)) {
+            document.cache =
+                document.factory.make_cache(std::move(*plots), ticks_simulated, overflow);
+        }
+    }
+
+    return document;
+}
+
+} // namespace fmk::io
\ No newline at end of file
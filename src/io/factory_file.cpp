@@ -0,0 +1,101 @@
+#include "io/factory_file.hpp"
+
+#include <fstream>
+#include <plog/Log.h>
+#include <sstream>
+
+#include "io/binary_format.hpp"
+#include "io/json_format.hpp"
+
+namespace fmk::io {
+
+std::optional<FactoryDocument> load_factory_file(const std::filesystem::path& path,
+                                                 util::JobProgress* progress) {
+    if (progress) {
+        progress->set_stage("Reading");
+    }
+
+    if (is_binary_factory_file(path)) {
+        return read_factory_binary(path);
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        PLOG_ERROR << "Could not open '" << path.string() << "'";
+        return std::nullopt;
+    }
+
+    std::error_code ec;
+    const auto file_size = std::filesystem::file_size(path, ec);
+    std::string contents;
+    if (!ec) {
+        contents.reserve(file_size);
+    }
+
+    constexpr std::size_t chunk_size = 1 << 16;
+    char chunk[chunk_size];
+    while (file.read(chunk, chunk_size) || file.gcount() > 0) {
+        contents.append(chunk, static_cast<std::size_t>(file.gcount()));
+        if (progress && !ec && file_size > 0) {
+            progress->set_fraction(static_cast<float>(contents.size()) /
+                                   static_cast<float>(file_size));
+        }
+    }
+
+    if (progress) {
+        progress->set_stage("Parsing");
+    }
+    std::istringstream input(std::move(contents));
+    return parse_factory_json(input);
+}
+
+bool save_factory_file(const std::filesystem::path& path,
+                       const Factory& factory,
+                       const UidPool& uid_pool,
+                       const NodePositionsT& node_positions,
+                       std::size_t ticks_to_simulate,
+                       const Factory::Cache* cache) {
+    auto compacted = factory;
+    auto compacted_pool = uid_pool;
+    const auto remapped = compact_uids(compacted, compacted_pool);
+
+    NodePositionsT compacted_positions;
+    for (const auto& [uid, position] : node_positions) {
+        if (const auto new_uid = remapped.find(uid); new_uid != remapped.end()) {
+            compacted_positions[new_uid->second] = position;
+        }
+    }
+
+    // Written to a temporary file first, since the file being replaced may be the one the cache
+    // was loaded from: its plots are still mapped, and truncating it would pull them out from
+    // under us
+    auto temp_path = path;
+    temp_path += ".tmp";
+    const bool is_binary = path.extension() == binary_format_extension;
+    bool is_written;
+    {
+        std::ofstream file(temp_path, is_binary ? std::ios::binary : std::ios::openmode());
+        if (is_binary) {
+            write_factory_binary(file, compacted, compacted_pool, compacted_positions,
+                                 ticks_to_simulate, cache, &factory);
+        } else {
+            write_factory_json(file, compacted, compacted_pool, compacted_positions,
+                               ticks_to_simulate);
+        }
+        file.close();
+        is_written = static_cast<bool>(file);
+    }
+
+    std::error_code ec;
+    if (is_written) {
+        std::filesystem::rename(temp_path, path, ec);
+        if (!ec) {
+            return true;
+        }
+        PLOG_ERROR << "Could not replace '" << path.string() << "': " << ec.message();
+    }
+    std::filesystem::remove(temp_path, ec);
+    return false;
+}
+
+} // namespace fmk::io
\ No newline at end of file
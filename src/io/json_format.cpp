@@ -0,0 +1,449 @@
+#include "io/json_format.hpp"
+
+#include <algorithm>
+#include <boost/json.hpp>
+#include <charconv>
+#include <fmt/core.h>
+#include <limits>
+#include <plog/Log.h>
+#include <string>
+
+namespace json = boost::json;
+
+namespace fmk::io {
+
+namespace {
+
+/// Reads an integer that must fit in `T`, like item quantities.
+template<typename T> std::optional<T> parse_integer(const json::value& value) {
+    const auto integer = value.if_int64();
+    return integer ? util::narrow<T>(*integer) : std::nullopt;
+}
+
+} // namespace
+
+std::optional<FactoryDocument> parse_factory_json(std::istream& input) {
+    Factory::MachinesT parsed_machines;
+    Factory::ItemsT parsed_items;
+    NodePositionsT parsed_positions;
+    std::size_t ticks_to_simulate = 6000;
+    Uid next_uid(-1);
+    UidPool parse_uid_pool(next_uid);
+    bool had_errors = false;
+
+    auto parse_xy = [&parsed_positions](json::object const& object, Uid uid) {
+        if (auto x_val = object.if_contains("x")) {
+            parsed_positions[uid] = NodePosition{static_cast<float>(x_val->as_double()),
+                                                 static_cast<float>(object.at("y").as_double())};
+        }
+    };
+
+    json::error_code parse_error;
+    json::stream_parser parser;
+    std::size_t line_i = 0;
+    for (std::string line; !parse_error && std::getline(input, line); line_i++) {
+        parser.write_some(line, parse_error);
+    }
+    parser.finish(parse_error);
+
+    if (parse_error) {
+        PLOG_ERROR << fmt::format("JSON parsing error on line {}: {}", line_i,
+                                  parse_error.message());
+        had_errors = true;
+    } else {
+        auto val = parser.release();
+        if (const auto obj = val.if_object()) {
+            if (const auto uid_pool_val = obj->if_contains("uid_pool")) {
+                next_uid.value = uid_pool_val->as_object().at("next_uid").as_int64();
+            } else {
+                PLOG_ERROR << "JSON loading error: `uid_pool` key not found";
+                had_errors = true;
+            }
+            parse_uid_pool = UidPool(next_uid);
+            if (const auto items_val = obj->if_contains("items")) {
+                if (const auto items = items_val->if_object()) {
+                    for (const auto& [item_uid_str, item_val] : *items) {
+                        Uid item_uid(Uid::INVALID_VALUE);
+                        const auto [_, ec] = std::from_chars(
+                            item_uid_str.data(), item_uid_str.data() + item_uid_str.size(),
+                            item_uid.value);
+
+                        if (ec != std::errc()) {
+                            PLOG_ERROR << "JSON loading error: Could not parse UID";
+                            had_errors = true;
+                        }
+
+                        if (auto item = item_val.if_object()) {
+                            parsed_items[item_uid].name = item->at("name").as_string();
+                            if (auto ty = item->at("type").if_string()) {
+                                if (*ty == "input") {
+                                    parsed_items[item_uid].type = Item::NodeType::Input;
+                                    parsed_items[item_uid].attribute_uid =
+                                        parse_uid_pool.generate();
+                                } else if (*ty == "output") {
+                                    parsed_items[item_uid].type = Item::NodeType::Output;
+                                    parsed_items[item_uid].attribute_uid =
+                                        parse_uid_pool.generate();
+                                } else if (*ty == "internal") {
+                                    parsed_items[item_uid].type = Item::NodeType::Internal;
+                                }
+                            }
+                            if (auto quantity = parse_integer<Quantity>(item->at("start_with"))) {
+                                parsed_items[item_uid].starting_quantity = *quantity;
+                            } else if (item->at("start_with").is_int64()) {
+                                PLOG_ERROR << "JSON loading error: Starting quantity of item "
+                                           << item_uid.value << " is too large for this build";
+                                had_errors = true;
+                            }
+
+                            parse_xy(*item, item_uid);
+                        }
+                    }
+                } else {
+                    PLOG_ERROR << "JSON loading error: `items` must be an object`";
+                    had_errors = true;
+                }
+            }
+
+            if (auto machines_val = obj->if_contains("machines")) {
+                if (const auto machines = machines_val->if_object()) {
+                    for (const auto& [machine_uid_str, machine_val] : *machines) {
+                        Uid machine_uid(Uid::INVALID_VALUE);
+                        const auto [_, ec] = std::from_chars(
+                            machine_uid_str.data(), machine_uid_str.data() + machine_uid_str.size(),
+                            machine_uid.value);
+
+                        if (ec != std::errc()) {
+                            PLOG_ERROR << "JSON loading error: Could not parse UID";
+                            had_errors = true;
+                        }
+
+                        if (auto machine = machine_val.if_object()) {
+                            Machine result;
+
+                            if (auto name_val = machine->if_contains("name")) {
+                                if (auto name = name_val->if_string()) {
+                                    result.name = *name;
+                                } else {
+                                    PLOG_ERROR
+                                        << "JSON loading error: Machine names must be strings";
+                                    had_errors = true;
+                                }
+                            } else {
+                                PLOG_ERROR
+                                    << "JSON loading error: Machines must have a \"name\" value";
+                                had_errors = true;
+                            }
+
+                            if (auto time_val = machine->if_contains("time")) {
+                                if (auto time = parse_integer<TickCount>(*time_val)) {
+                                    result.op_time = util::ticks(*time);
+                                } else {
+                                    PLOG_ERROR << "JSON loading error: Machine operation times "
+                                                  "must be integers within the supported range";
+                                    had_errors = true;
+                                }
+                            } else {
+                                PLOG_ERROR
+                                    << "JSON loading error: Machines must have a \"time\" value";
+                                had_errors = true;
+                            }
+
+                            if (auto inputs_val = machine->if_contains("inputs")) {
+                                if (auto inputs = inputs_val->if_object()) {
+                                    for (const auto& [input_uid_str, input_qty] : *inputs) {
+                                        Uid input_uid(-1);
+                                        const auto [_, ec] = std::from_chars(
+                                            input_uid_str.data(),
+                                            input_uid_str.data() + input_uid_str.size(),
+                                            input_uid.value);
+
+                                        if (ec != std::errc()) {
+                                            PLOG_ERROR << "JSON loading error: Could not parse UID";
+                                            had_errors = true;
+                                        }
+                                        if (auto quantity = parse_integer<Quantity>(input_qty)) {
+                                            parsed_items.insert({input_uid, Item{}});
+                                            result.inputs.emplace_back(ItemStream{
+                                                input_uid, *quantity, parse_uid_pool.generate()});
+                                        } else {
+                                            PLOG_ERROR << "JSON loading error: Input quantities "
+                                                          "must be integers within the supported "
+                                                          "range";
+                                            had_errors = true;
+                                        }
+                                    }
+                                } else {
+                                    PLOG_ERROR
+                                        << "JSON loading error: Machine inputs must be objects";
+                                    had_errors = true;
+                                }
+                            } else {
+                                PLOG_ERROR
+                                    << "JSON loading error: Machines must have an \"inputs\" value";
+                                had_errors = true;
+                            }
+
+                            if (auto outputs_val = machine->if_contains("outputs")) {
+                                if (auto outputs = outputs_val->if_object()) {
+                                    for (const auto& [output_uid_str, output_qty] : *outputs) {
+                                        Uid output_uid(-1);
+                                        const auto [_, ec] = std::from_chars(
+                                            output_uid_str.data(),
+                                            output_uid_str.data() + output_uid_str.size(),
+                                            output_uid.value);
+
+                                        if (ec != std::errc()) {
+                                            PLOG_ERROR << "JSON loading error: Could not parse UID";
+                                            had_errors = true;
+                                        }
+                                        if (auto quantity = parse_integer<Quantity>(output_qty)) {
+                                            parsed_items.insert({output_uid, Item{}});
+                                            result.outputs.emplace_back(ItemStream{
+                                                output_uid, *quantity, parse_uid_pool.generate()});
+                                        } else {
+                                            PLOG_ERROR << "JSON loading error: Output quantities "
+                                                          "must be integers within the supported "
+                                                          "range";
+                                            had_errors = true;
+                                        }
+                                    }
+                                } else {
+                                    PLOG_ERROR
+                                        << "JSON loading error: Machine outputs must be objects";
+                                    had_errors = true;
+                                }
+                            } else {
+                                PLOG_ERROR << "JSON loading error: Machines must have an "
+                                              "\"outputs\" value";
+                                had_errors = true;
+                            }
+
+                            // Randomness is optional, since only Monte Carlo simulations use it
+                            if (auto distribution_val = machine->if_contains("time_distribution")) {
+                                const auto distribution = distribution_val->if_string();
+                                if (distribution && *distribution == "fixed") {
+                                    result.op_time_distribution.type =
+                                        OpTimeDistribution::Type::Fixed;
+                                } else if (distribution && *distribution == "uniform") {
+                                    result.op_time_distribution.type =
+                                        OpTimeDistribution::Type::Uniform;
+                                } else if (distribution && *distribution == "normal") {
+                                    result.op_time_distribution.type =
+                                        OpTimeDistribution::Type::Normal;
+                                } else {
+                                    PLOG_ERROR << "JSON loading error: Machine time distributions "
+                                                  "must be \"fixed\", \"uniform\" or "
+                                                  "\"normal\"";
+                                    had_errors = true;
+                                }
+                            }
+                            if (auto spread_val = machine->if_contains("time_spread")) {
+                                const auto spread = parse_integer<TickCount>(*spread_val);
+                                if (spread && *spread >= 0) {
+                                    result.op_time_distribution.spread = util::ticks(*spread);
+                                } else {
+                                    PLOG_ERROR << "JSON loading error: Machine time spreads must "
+                                                  "be positive integers within the supported "
+                                                  "range";
+                                    had_errors = true;
+                                }
+                            }
+                            if (auto chances_val = machine->if_contains("output_chances")) {
+                                if (auto chances = chances_val->if_object()) {
+                                    for (const auto& [output_uid_str, chance_val] : *chances) {
+                                        Uid output_uid(-1);
+                                        std::from_chars(
+                                            output_uid_str.data(),
+                                            output_uid_str.data() + output_uid_str.size(),
+                                            output_uid.value);
+                                        const auto output = std::find_if(
+                                            result.outputs.begin(), result.outputs.end(),
+                                            [&](const auto& o) { return o.item == output_uid; });
+                                        const auto chance =
+                                            chance_val.is_number() ? chance_val.to_number<double>()
+                                                                   : -1.;
+                                        if (output == result.outputs.end() || chance < 0. ||
+                                            chance > 1.) {
+                                            PLOG_ERROR << "JSON loading error: Output chances "
+                                                          "must be numbers from 0 to 1 for "
+                                                          "outputs of the machine";
+                                            had_errors = true;
+                                        } else {
+                                            output->probability = static_cast<float>(chance);
+                                        }
+                                    }
+                                } else {
+                                    PLOG_ERROR
+                                        << "JSON loading error: Machine output chances must be "
+                                           "objects";
+                                    had_errors = true;
+                                }
+                            }
+
+                            parse_xy(*machine, machine_uid);
+
+                            parsed_machines[machine_uid] = result;
+                        } else {
+                            PLOG_ERROR << "JSON loading error: Machines must be JSON objects";
+                            had_errors = true;
+                        }
+                    }
+                } else {
+                    PLOG_ERROR << "JSON loading error: \"machines\" must be an array";
+                    had_errors = true;
+                }
+            }
+            if (auto ticks_val = obj->if_contains("simulate")) {
+                const auto ticks = parse_integer<TickCount>(*ticks_val);
+                if (ticks && *ticks >= 0) {
+                    ticks_to_simulate = static_cast<std::size_t>(*ticks);
+                } else {
+                    PLOG_ERROR << fmt::format("JSON loading error: \"simulate\" value must be an "
+                                              "integer from 0 to {}",
+                                              std::numeric_limits<TickCount>::max());
+                    had_errors = true;
+                }
+            } else {
+                PLOG_WARNING << "JSON loading warning: \"simulate\" value not "
+                                "present, using the default value of 6000 ticks";
+            }
+        } else {
+            PLOG_ERROR << "JSON loading error: Program must start with a JSON object";
+            had_errors = true;
+        }
+    }
+
+    if (had_errors) {
+        return std::nullopt;
+    }
+
+    FactoryDocument document;
+    document.factory = Factory{std::move(parsed_items), std::move(parsed_machines)};
+    document.uid_pool = std::move(parse_uid_pool);
+    document.ticks_to_simulate = ticks_to_simulate;
+    document.node_positions = std::move(parsed_positions);
+    return document;
+}
+
+void write_factory_json(std::ostream& out,
+                        const Factory& factory,
+                        const UidPool& uid_pool,
+                        const NodePositionsT& node_positions,
+                        std::size_t ticks_to_simulate) {
+    auto output_xy = [&out, &node_positions](Uid uid) {
+        const auto pos = node_positions.find(uid);
+        const auto [x, y] = pos != node_positions.end() ? pos->second : NodePosition{0, 0};
+        out << fmt::format("\"x\":{:.1f},\"y\":{:.1f}", x, y);
+    };
+
+    out << "{";
+
+    // Items
+    {
+        out << "\"items\":{";
+        for (auto item_it = factory.items.cbegin(); item_it != factory.items.cend(); item_it++) {
+            const auto& [item_uid, item] = *item_it;
+            out << "\"" << item_uid.value << "\":{\"name\":\"" << item.name << "\",\"type\":\"";
+            bool write_xy = false;
+            switch (item.type) {
+                case Item::NodeType::Input:
+                    out << "input";
+                    write_xy = true;
+                    break;
+                case Item::NodeType::Output:
+                    out << "output";
+                    write_xy = true;
+                    break;
+                case Item::NodeType::Internal: out << "internal"; break;
+            }
+            out << "\",\"start_with\":" << item.starting_quantity;
+            if (write_xy) {
+                out << ",";
+                output_xy(item_uid);
+                out << "}";
+            } else {
+                out << "}";
+            }
+            if (std::next(item_it) != factory.items.cend()) {
+                out << ",";
+            }
+        }
+        out << "},";
+    }
+
+    // Machines
+    {
+        out << "\"machines\":{";
+        const auto& machines = factory.machines;
+        for (auto machine_it = machines.cbegin(); machine_it != machines.cend(); machine_it++) {
+            const auto& [machine_uid, machine] = *machine_it;
+
+            out << "\"" << machine_uid.value << "\":"
+                << "{";
+            {
+                out << "\"name\":\"" << machine.name << "\",";
+                out << "\"inputs\":{";
+                {
+                    const auto& inputs = machine.inputs;
+                    for (std::size_t i = 0; i < inputs.size(); i++) {
+                        out << "\"" << inputs[i].item.value << "\":" << inputs[i].quantity;
+                        if (i < inputs.size() - 1) {
+                            out << ",";
+                        }
+                    }
+                }
+                out << "},";
+                out << "\"outputs\":{";
+                {
+                    const auto& outputs = machine.outputs;
+                    for (std::size_t i = 0; i < outputs.size(); i++) {
+                        out << "\"" << outputs[i].item.value << "\":" << outputs[i].quantity;
+                        if (i < outputs.size() - 1) {
+                            out << ",";
+                        }
+                    }
+                }
+                out << "},";
+                if (std::any_of(machine.outputs.begin(), machine.outputs.end(),
+                                [](const auto& output) { return output.probability < 1.f; })) {
+                    out << "\"output_chances\":{";
+                    const auto& outputs = machine.outputs;
+                    for (std::size_t i = 0; i < outputs.size(); i++) {
+                        // Written in full, so that they read back as the same float
+                        out << "\"" << outputs[i].item.value
+                            << "\":" << fmt::format("{}", outputs[i].probability);
+                        if (i < outputs.size() - 1) {
+                            out << ",";
+                        }
+                    }
+                    out << "},";
+                }
+                const auto& distribution = machine.op_time_distribution;
+                if (distribution.type != OpTimeDistribution::Type::Fixed) {
+                    out << "\"time_distribution\":\""
+                        << (distribution.type == OpTimeDistribution::Type::Uniform ? "uniform"
+                                                                                   : "normal")
+                        << "\",";
+                    out << "\"time_spread\":" << distribution.spread.count() << ",";
+                }
+                out << "\"time\":" << machine.op_time.count() << ",";
+                output_xy(machine_uid);
+            }
+            out << "}";
+            if (std::next(machine_it) != factory.machines.cend()) {
+                out << ",";
+            }
+        }
+        out << "},";
+    }
+
+    // Simulate value
+    { out << "\"simulate\":" << ticks_to_simulate << ","; }
+
+    { out << "\"uid_pool\":{\"next_uid\":" << uid_pool.get_next_uid().value << "}"; }
+
+    out << "}";
+}
+
+} // namespace fmk::io
\ No newline at end of file
@@ -0,0 +1,43 @@
+#include "io/module_library.hpp"
+
+#include <plog/Log.h>
+
+#include "io/factory_file.hpp"
+
+namespace fmk::io {
+
+std::shared_ptr<const sim::ModuleSummary>
+ModuleLibrary::get(const std::filesystem::path& path, util::JobProgress* progress) {
+    std::error_code ec;
+    const auto canonical_path = std::filesystem::canonical(path, ec);
+    const auto last_write_time = std::filesystem::last_write_time(path, ec);
+    if (ec) {
+        PLOG_ERROR << "Could not open module '" << path.string() << "': " << ec.message();
+        return nullptr;
+    }
+
+    std::lock_guard lock(mutex);
+    const auto entry = entries.find(canonical_path.string());
+    if (entry != entries.end() && entry->second.last_write_time == last_write_time) {
+        return entry->second.summary;
+    }
+
+    const auto document = load_factory_file(path, progress);
+    if (!document) {
+        return nullptr;
+    }
+    if (progress) {
+        progress->set_stage("Summarizing");
+    }
+    auto summary = sim::summarize_module(path.stem().string(), document->factory,
+                                         document->ticks_to_simulate, progress);
+    if (!summary) {
+        return nullptr;
+    }
+
+    auto shared_summary = std::make_shared<const sim::ModuleSummary>(std::move(*summary));
+    entries[canonical_path.string()] = Entry{last_write_time, shared_summary};
+    return shared_summary;
+}
+
+} // namespace fmk::io
\ No newline at end of file
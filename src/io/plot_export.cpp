@@ -0,0 +1,342 @@
+#include "io/plot_export.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <fmt/core.h>
+#include <fmt/format.h>
+#include <string>
+#include <vector>
+
+#include "sim/throughput.hpp"
+#include "util/background_job.hpp"
+
+namespace fmk::io {
+
+namespace {
+
+constexpr std::array<char, 4> columnar_magic = {'F', 'M', 'K', 'S'};
+constexpr std::uint32_t columnar_version = 1;
+
+/// A single exported value of an item, taken from its plot or from one of its throughput series.
+struct Column {
+    std::string name;
+    std::size_t item_i;
+    enum class Source { Plot, Produced, Consumed, Net } source;
+    enum class Kind { Sample, Min, Max } kind;
+};
+
+std::vector<Column> make_columns(const Factory& factory,
+                                 std::span<const Uid> items,
+                                 const PlotExportOptions& options) {
+    std::vector<Column> columns;
+    const auto add_columns = [&](std::string name, std::size_t item_i, Column::Source source) {
+        if (options.downsampling == PlotExportOptions::Downsampling::MinMax) {
+            columns.emplace_back(Column{name + " (min)", item_i, source, Column::Kind::Min});
+            columns.emplace_back(Column{name + " (max)", item_i, source, Column::Kind::Max});
+        } else {
+            columns.emplace_back(Column{std::move(name), item_i, source, Column::Kind::Sample});
+        }
+    };
+
+    for (std::size_t item_i = 0; item_i < items.size(); item_i++) {
+        const auto& name = factory.items.at(items[item_i]).name;
+        add_columns(name, item_i, Column::Source::Plot);
+        if (options.throughput_window == 0) {
+            continue;
+        }
+
+        const auto window = fmt::format(" in {} ticks", options.throughput_window);
+        add_columns(name + " produced" + window, item_i, Column::Source::Produced);
+        add_columns(name + " consumed" + window, item_i, Column::Source::Consumed);
+        add_columns(name + " change" + window, item_i, Column::Source::Net);
+    }
+    return columns;
+}
+
+std::size_t bucket_size(const PlotExportOptions& options) {
+    return options.downsampling == PlotExportOptions::Downsampling::None
+               ? 1
+               : std::max<std::size_t>(options.bucket_size, 1);
+}
+
+/// Calculates the value of a column at a given row, from values that start at the first tick of
+/// row 0.
+Quantity sample(std::span<const Quantity> values,
+                Column::Kind kind,
+                std::size_t row,
+                std::size_t bucket) {
+    if (values.empty()) {
+        return 0;
+    }
+
+    const auto first = std::min(row * bucket, values.size() - 1);
+    const auto last = std::min(first + bucket, values.size());
+    switch (kind) {
+        case Column::Kind::Min:
+            return *std::min_element(values.begin() + first, values.begin() + last);
+        case Column::Kind::Max:
+            return *std::max_element(values.begin() + first, values.begin() + last);
+        default: return values[first];
+    }
+}
+
+/// Samples the columns of the exported items chunk by chunk. Only the ticks of the current chunk
+/// are copied out of the cache, one item at a time, so that no plot is ever built in full.
+class ChunkSampler {
+public:
+    /// @param progress Receives the progress of the throughput simulation, if any, which leaves
+    /// the sampler unusable if cancelled.
+    ChunkSampler(const Factory& factory,
+                 const Factory::Cache& cache,
+                 std::span<const Uid> items,
+                 const PlotExportOptions& options,
+                 util::JobProgress* progress) :
+        cache(cache),
+        items(items),
+        columns(make_columns(factory, items, options)),
+        bucket(bucket_size(options)),
+        tick_count(cache.ticks_simulated() + 1),
+        rows(items.empty() ? 0 : (tick_count + bucket - 1) / bucket) {
+        if (options.throughput_window > 0) {
+            if (progress) {
+                progress->set_stage("Simulating throughput");
+            }
+            throughputs = sim::simulate_throughput(factory, cache.ticks_simulated(), items,
+                                                   options.throughput_window, progress);
+        }
+    }
+
+    const std::vector<Column>& column_list() const { return columns; }
+    std::size_t bucket_ticks() const { return bucket; }
+    std::size_t row_count() const { return rows; }
+
+    /// Samples the rows in `[first_row, end_row)`, which can then be read with `value()`.
+    void sample_rows(std::size_t first_row, std::size_t end_row) {
+        chunk_rows = end_row - first_row;
+        chunk_values.resize(columns.size() * chunk_rows);
+
+        const auto first_tick = first_row * bucket;
+        item_ticks.resize(std::min(end_row * bucket, tick_count) - first_tick);
+        std::size_t copied_item_i = items.size();
+        for (std::size_t column_i = 0; column_i < columns.size(); column_i++) {
+            const auto& column = columns[column_i];
+            // The values of the column, and the row they start at
+            std::span<const Quantity> values;
+            std::size_t values_first_row = first_row;
+            if (column.source == Column::Source::Plot) {
+                if (copied_item_i != column.item_i) {
+                    cache.copy_quantities(items[column.item_i], first_tick, item_ticks);
+                    copied_item_i = column.item_i;
+                }
+                values = item_ticks;
+            } else {
+                const auto& throughput = throughputs[column.item_i];
+                values = column.source == Column::Source::Produced   ? throughput.produced
+                         : column.source == Column::Source::Consumed ? throughput.consumed
+                                                                     : throughput.net;
+                values_first_row = 0;
+            }
+
+            for (std::size_t row = first_row; row < end_row; row++) {
+                chunk_values[column_i * chunk_rows + row - first_row] =
+                    sample(values, column.kind, row - values_first_row, bucket);
+            }
+        }
+        chunk_first_row = first_row;
+    }
+
+    /// The value of a column at a row of the last rows sampled.
+    Quantity value(std::size_t column_i, std::size_t row) const {
+        return chunk_values[column_i * chunk_rows + row - chunk_first_row];
+    }
+
+private:
+    const Factory::Cache& cache;
+    std::span<const Uid> items;
+    std::vector<Column> columns;
+    /// Empty unless `PlotExportOptions::throughput_window` is set.
+    std::vector<sim::ThroughputSeries> throughputs;
+    std::size_t bucket;
+    /// Plots have a value for every tick simulated plus the one after the last.
+    std::size_t tick_count;
+    std::size_t rows;
+
+    /// The values of the rows sampled last, column by column.
+    std::vector<Quantity> chunk_values;
+    std::size_t chunk_first_row = 0;
+    std::size_t chunk_rows = 0;
+    /// The quantities of one item during the ticks of the rows being sampled.
+    std::vector<Quantity> item_ticks;
+};
+
+template<typename T> void write_le(std::string& out, T value) {
+    for (std::size_t byte_i = 0; byte_i < sizeof(T); byte_i++) {
+        out.push_back(
+            static_cast<char>((static_cast<std::uint64_t>(value) >> (byte_i * 8)) & 0xff));
+    }
+}
+
+void write_varint(std::string& out, std::uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+std::uint64_t zigzag(std::int64_t value) {
+    return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+}
+
+/// Reports the rows written so far.
+/// @returns false if the export was cancelled.
+bool report_rows(util::JobProgress* progress, std::size_t rows_written, std::size_t rows) {
+    if (!progress) {
+        return true;
+    }
+    progress->set_fraction(static_cast<float>(rows_written) / static_cast<float>(rows));
+    return !progress->is_cancelled();
+}
+
+} // namespace
+
+std::string csv_escape(const std::string& str) {
+    if (str.find_first_of(",\"\n") == std::string::npos) {
+        return str;
+    }
+
+    std::string result = "\"";
+    for (char c : str) {
+        if (c == '"') {
+            result += '"';
+        }
+        result += c;
+    }
+    return result + '"';
+}
+
+bool export_plots_csv(std::ostream& out,
+                      const Factory& factory,
+                      const Factory::Cache& cache,
+                      std::span<const Uid> items,
+                      const PlotExportOptions& options,
+                      util::JobProgress* progress) {
+    ChunkSampler sampler(factory, cache, items, options, progress);
+    if (progress && progress->is_cancelled()) {
+        return false;
+    }
+    if (progress) {
+        progress->set_stage("Writing");
+    }
+    const auto& columns = sampler.column_list();
+    const auto bucket = sampler.bucket_ticks();
+    const auto rows = sampler.row_count();
+
+    std::string buffer = "tick";
+    for (const auto& column : columns) {
+        buffer += ',';
+        buffer += csv_escape(column.name);
+    }
+    buffer += '\n';
+
+    const auto chunk_rows = std::max<std::size_t>(options.chunk_rows, 1);
+    for (std::size_t chunk_start = 0; chunk_start < rows; chunk_start += chunk_rows) {
+        const auto chunk_end = std::min(chunk_start + chunk_rows, rows);
+        sampler.sample_rows(chunk_start, chunk_end);
+        for (std::size_t row = chunk_start; row < chunk_end; row++) {
+            fmt::format_to(std::back_inserter(buffer), "{}", row * bucket);
+            for (std::size_t column_i = 0; column_i < columns.size(); column_i++) {
+                fmt::format_to(std::back_inserter(buffer), ",{}", sampler.value(column_i, row));
+            }
+            buffer += '\n';
+        }
+        out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        buffer.clear();
+        if (!report_rows(progress, chunk_end, rows)) {
+            return false;
+        }
+    }
+    out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    return true;
+}
+
+bool export_plots_columnar(std::ostream& out,
+                           const Factory& factory,
+                           const Factory::Cache& cache,
+                           std::span<const Uid> items,
+                           const PlotExportOptions& options,
+                           util::JobProgress* progress) {
+    ChunkSampler sampler(factory, cache, items, options, progress);
+    if (progress && progress->is_cancelled()) {
+        return false;
+    }
+    if (progress) {
+        progress->set_stage("Writing");
+    }
+    const auto& columns = sampler.column_list();
+    const auto bucket = sampler.bucket_ticks();
+    const auto rows = sampler.row_count();
+
+    std::string buffer(columnar_magic.begin(), columnar_magic.end());
+    write_le<std::uint32_t>(buffer, columnar_version);
+    write_le<std::uint32_t>(buffer, static_cast<std::uint32_t>(options.downsampling));
+    write_le<std::uint64_t>(buffer, bucket);
+    write_le<std::uint64_t>(buffer, rows);
+    write_le<std::uint32_t>(buffer, static_cast<std::uint32_t>(columns.size()));
+    for (const auto& column : columns) {
+        write_le<std::uint32_t>(buffer, static_cast<std::uint32_t>(column.name.size()));
+        buffer += column.name;
+    }
+    out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+
+    std::vector<std::int64_t> last_values(columns.size(), 0);
+    std::string encoded;
+    const auto chunk_rows = std::max<std::size_t>(options.chunk_rows, 1);
+    for (std::size_t chunk_start = 0; chunk_start < rows; chunk_start += chunk_rows) {
+        const auto chunk_end = std::min(chunk_start + chunk_rows, rows);
+        buffer.clear();
+        write_le<std::uint32_t>(buffer, static_cast<std::uint32_t>(chunk_end - chunk_start));
+        sampler.sample_rows(chunk_start, chunk_end);
+
+        for (std::size_t column_i = 0; column_i < columns.size(); column_i++) {
+            encoded.clear();
+            auto& last_value = last_values[column_i];
+            std::uint64_t pending_delta = 0;
+            std::uint64_t pending_repeats = 0;
+            for (std::size_t row = chunk_start; row < chunk_end; row++) {
+                const std::int64_t value = sampler.value(column_i, row);
+                // Deltas wrap around, so that they never overflow with 64-bit quantities
+                const auto delta = zigzag(static_cast<std::int64_t>(
+                    static_cast<std::uint64_t>(value) - static_cast<std::uint64_t>(last_value)));
+                last_value = value;
+
+                if (pending_repeats > 0 && delta == pending_delta) {
+                    pending_repeats++;
+                    continue;
+                }
+                if (pending_repeats > 0) {
+                    write_varint(encoded, pending_delta);
+                    write_varint(encoded, pending_repeats);
+                }
+                pending_delta = delta;
+                pending_repeats = 1;
+            }
+            if (pending_repeats > 0) {
+                write_varint(encoded, pending_delta);
+                write_varint(encoded, pending_repeats);
+            }
+
+            write_le<std::uint32_t>(buffer, static_cast<std::uint32_t>(encoded.size()));
+            buffer += encoded;
+        }
+
+        out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        if (!report_rows(progress, chunk_end, rows)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace fmk::io
\ No newline at end of file
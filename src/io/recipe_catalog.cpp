@@ -0,0 +1,444 @@
+#include "io/recipe_catalog.hpp"
+
+#include <algorithm>
+#include <boost/json.hpp>
+#include <charconv>
+#include <fmt/core.h>
+#include <plog/Log.h>
+#include <string>
+
+#include "util/background_job.hpp"
+#include "util/mapped_file.hpp"
+
+namespace json = boost::json;
+
+namespace fmk::io {
+
+namespace {
+
+/// Reads an integer that must fit in `T`, like stream quantities.
+template<typename T> std::optional<T> parse_integer(const json::value& value) {
+    const auto integer = value.if_int64();
+    return integer ? util::narrow<T>(*integer) : std::nullopt;
+}
+
+/// Parses an integer that must fit in `T` and take the whole string.
+template<typename T> std::optional<T> parse_integer(std::string_view str) {
+    T value;
+    const auto [end, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+    if (ec != std::errc() || end != str.data() + str.size()) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+std::string_view trim(std::string_view str) {
+    const auto first = str.find_first_not_of(" \t");
+    if (first == std::string_view::npos) {
+        return {};
+    }
+    return str.substr(first, str.find_last_not_of(" \t") - first + 1);
+}
+
+/// Splits CSV into records and fields, unquoting the fields that are quoted.
+class CsvReader {
+public:
+    explicit CsvReader(std::string_view csv) : csv(csv) {}
+
+    /// Reads the fields of the next record into `fields`, whose strings are reused.
+    /// @returns False at the end of the input.
+    bool next(std::vector<std::string>& fields) {
+        if (offset >= csv.size()) {
+            return false;
+        }
+        _line = next_line;
+
+        std::size_t field_count = 0;
+        while (true) {
+            if (field_count == fields.size()) {
+                fields.emplace_back();
+            }
+            auto& field = fields[field_count++];
+            field.clear();
+            if (offset < csv.size() && csv[offset] == '"') {
+                // Quotes are escaped by doubling them, and quoted fields can span several lines
+                for (offset++; offset < csv.size(); offset++) {
+                    if (csv[offset] == '"') {
+                        if (offset + 1 >= csv.size() || csv[offset + 1] != '"') {
+                            offset++;
+                            break;
+                        }
+                        offset++;
+                    } else if (csv[offset] == '\n') {
+                        next_line++;
+                    }
+                    field.push_back(csv[offset]);
+                }
+            }
+            const auto end = std::min(csv.find_first_of(",\n", offset), csv.size());
+            field.append(csv.substr(offset, end - offset));
+            offset = end + 1;
+            if (end == csv.size() || csv[end] == '\n') {
+                break;
+            }
+        }
+
+        next_line++;
+        if (!fields[field_count - 1].empty() && fields[field_count - 1].back() == '\r') {
+            fields[field_count - 1].pop_back();
+        }
+        fields.resize(field_count);
+        return true;
+    }
+
+    /// The line the last record read starts on, from 1.
+    std::size_t line() const { return _line; }
+
+private:
+    std::string_view csv;
+    std::size_t offset = 0;
+    std::size_t _line = 0;
+    std::size_t next_line = 1;
+};
+
+void warn_about_duplicates(std::size_t duplicate_count) {
+    if (duplicate_count > 0) {
+        PLOG_WARNING << duplicate_count
+                     << " recipes were skipped because another one had the same name";
+    }
+}
+
+} // namespace
+
+RecipeCatalog::Index RecipeCatalog::intern_item(std::string_view name) {
+    if (const auto item = item_indices.find(name); item != item_indices.end()) {
+        return item->second;
+    }
+    const auto stored_name = store_name(name);
+    const auto item = static_cast<Index>(item_names.size());
+    item_names.emplace_back(stored_name);
+    item_indices.emplace(stored_name, item);
+    return item;
+}
+
+std::optional<RecipeCatalog::Index> RecipeCatalog::add_recipe(std::string_view name,
+                                                              util::ticks op_time,
+                                                              std::span<const Stream> inputs,
+                                                              std::span<const Stream> outputs) {
+    if (recipe_indices.contains(name)) {
+        return std::nullopt;
+    }
+    const auto stored_name = store_name(name);
+    const auto recipe = static_cast<Index>(recipes.size());
+    recipes.emplace_back(Recipe{stored_name, op_time, static_cast<std::uint32_t>(streams.size()),
+                                static_cast<std::uint32_t>(inputs.size()),
+                                static_cast<std::uint32_t>(outputs.size())});
+    recipe_indices.emplace(stored_name, recipe);
+    streams.insert(streams.end(), inputs.begin(), inputs.end());
+    streams.insert(streams.end(), outputs.begin(), outputs.end());
+    return recipe;
+}
+
+std::optional<RecipeCatalog::Index> RecipeCatalog::find_item(std::string_view name) const {
+    const auto item = item_indices.find(name);
+    return item != item_indices.end() ? std::optional(item->second) : std::nullopt;
+}
+
+std::span<const RecipeCatalog::Stream> RecipeCatalog::inputs(Index recipe) const {
+    const auto& record = recipes[recipe];
+    return std::span(streams).subspan(record.first_stream, record.input_count);
+}
+
+std::span<const RecipeCatalog::Stream> RecipeCatalog::outputs(Index recipe) const {
+    const auto& record = recipes[recipe];
+    return std::span(streams).subspan(record.first_stream + record.input_count,
+                                      record.output_count);
+}
+
+std::optional<RecipeCatalog::Index> RecipeCatalog::find_recipe(std::string_view name) const {
+    const auto recipe = recipe_indices.find(name);
+    return recipe != recipe_indices.end() ? std::optional(recipe->second) : std::nullopt;
+}
+
+std::string_view RecipeCatalog::store_name(std::string_view name) {
+    if (name.empty()) {
+        return {};
+    }
+    auto* data = static_cast<char*>(names->allocate(name.size(), 1));
+    std::copy(name.begin(), name.end(), data);
+    return {data, name.size()};
+}
+
+std::optional<RecipeCatalog> parse_recipes_json(std::string_view json) {
+    // Everything parsed is thrown away at once, so there's no point in freeing it piece by piece
+    json::monotonic_resource resource;
+    json::error_code parse_error;
+    const auto value = json::parse(json, parse_error, &resource);
+    if (parse_error) {
+        PLOG_ERROR << "Recipe JSON parsing error: " << parse_error.message();
+        return std::nullopt;
+    }
+
+    const json::array* recipes = value.if_array();
+    if (const auto object = value.if_object()) {
+        if (const auto recipes_val = object->if_contains("recipes")) {
+            recipes = recipes_val->if_array();
+        }
+    }
+    if (!recipes) {
+        PLOG_ERROR << "Recipe JSON loading error: Expected an array of recipes";
+        return std::nullopt;
+    }
+
+    RecipeCatalog catalog;
+    bool had_errors = false;
+    std::size_t duplicate_count = 0;
+    std::vector<RecipeCatalog::Stream> inputs;
+    std::vector<RecipeCatalog::Stream> outputs;
+    const auto parse_streams = [&](const json::object& recipe, std::string_view key,
+                                   std::string_view recipe_name,
+                                   std::vector<RecipeCatalog::Stream>& streams) {
+        streams.clear();
+        const auto streams_val = recipe.if_contains(key);
+        if (!streams_val) {
+            return;
+        }
+        const auto stream_quantities = streams_val->if_object();
+        if (!stream_quantities) {
+            PLOG_ERROR << fmt::format("Recipe JSON loading error: The {} of '{}' must be an "
+                                      "object",
+                                      key, recipe_name);
+            had_errors = true;
+            return;
+        }
+        for (const auto& [item_name, quantity_val] : *stream_quantities) {
+            const auto quantity = parse_integer<Quantity>(quantity_val);
+            if (!quantity || *quantity <= 0) {
+                PLOG_ERROR << fmt::format("Recipe JSON loading error: The quantity of '{}' in "
+                                          "'{}' must be a positive integer",
+                                          std::string_view(item_name), recipe_name);
+                had_errors = true;
+                continue;
+            }
+            streams.emplace_back(RecipeCatalog::Stream{catalog.intern_item(item_name), *quantity});
+        }
+    };
+
+    for (std::size_t recipe_i = 0; recipe_i < recipes->size(); recipe_i++) {
+        const auto recipe = (*recipes)[recipe_i].if_object();
+        const auto name_val = recipe ? recipe->if_contains("name") : nullptr;
+        const auto name = name_val ? name_val->if_string() : nullptr;
+        if (!name) {
+            PLOG_ERROR << "Recipe JSON loading error: Recipe " << recipe_i
+                       << " must be an object with a \"name\" string";
+            had_errors = true;
+            continue;
+        }
+
+        const auto time_val = recipe->if_contains("time");
+        const auto time = time_val ? parse_integer<TickCount>(*time_val) : std::nullopt;
+        if (!time || *time <= 0) {
+            PLOG_ERROR << fmt::format("Recipe JSON loading error: The time of '{}' must be a "
+                                      "positive integer",
+                                      std::string_view(*name));
+            had_errors = true;
+            continue;
+        }
+
+        parse_streams(*recipe, "inputs", *name, inputs);
+        parse_streams(*recipe, "outputs", *name, outputs);
+        if (!catalog.add_recipe(*name, util::ticks(*time), inputs, outputs)) {
+            duplicate_count++;
+        }
+    }
+
+    if (had_errors) {
+        return std::nullopt;
+    }
+    warn_about_duplicates(duplicate_count);
+    return catalog;
+}
+
+std::optional<RecipeCatalog> parse_recipes_csv(std::string_view csv) {
+    CsvReader reader(csv);
+    std::vector<std::string> fields;
+    if (!reader.next(fields)) {
+        PLOG_ERROR << "Recipe CSV loading error: The header is missing";
+        return std::nullopt;
+    }
+
+    const auto column = [&fields](std::string_view name) -> std::optional<std::size_t> {
+        const auto field = std::find_if(fields.begin(), fields.end(), [name](const auto& field) {
+            return trim(field) == name;
+        });
+        return field != fields.end() ? std::optional(field - fields.begin()) : std::nullopt;
+    };
+    const auto name_column = column("name");
+    const auto time_column = column("time");
+    const auto inputs_column = column("inputs");
+    const auto outputs_column = column("outputs");
+    if (!name_column || !time_column) {
+        PLOG_ERROR << "Recipe CSV loading error: The header must name a `name` and a `time` "
+                      "column";
+        return std::nullopt;
+    }
+
+    RecipeCatalog catalog;
+    bool had_errors = false;
+    std::size_t duplicate_count = 0;
+    std::vector<RecipeCatalog::Stream> inputs;
+    std::vector<RecipeCatalog::Stream> outputs;
+    const auto parse_streams = [&](std::optional<std::size_t> column_i,
+                                   std::vector<RecipeCatalog::Stream>& streams) {
+        streams.clear();
+        if (!column_i || *column_i >= fields.size()) {
+            return;
+        }
+        const std::string_view cell = fields[*column_i];
+        for (std::size_t start = 0; start < cell.size();) {
+            const auto end = std::min(cell.find(';', start), cell.size());
+            const auto stream = trim(cell.substr(start, end - start));
+            start = end + 1;
+            if (stream.empty()) {
+                continue;
+            }
+
+            const auto quantity_end = std::min(stream.find(' '), stream.size());
+            const auto quantity = parse_integer<Quantity>(stream.substr(0, quantity_end));
+            const auto item_name = trim(stream.substr(quantity_end));
+            if (!quantity || *quantity <= 0 || item_name.empty()) {
+                PLOG_ERROR << fmt::format("Recipe CSV loading error on line {}: '{}' must be a "
+                                          "positive quantity followed by an item",
+                                          reader.line(), stream);
+                had_errors = true;
+                continue;
+            }
+            streams.emplace_back(RecipeCatalog::Stream{catalog.intern_item(item_name), *quantity});
+        }
+    };
+
+    while (reader.next(fields)) {
+        // Blank lines, e.g. at the end of the file
+        if (fields.size() == 1 && trim(fields.front()).empty()) {
+            continue;
+        }
+        if (*name_column >= fields.size() || *time_column >= fields.size()) {
+            PLOG_ERROR << "Recipe CSV loading error on line " << reader.line()
+                       << ": Some columns are missing";
+            had_errors = true;
+            continue;
+        }
+
+        const auto name = trim(fields[*name_column]);
+        const auto time = parse_integer<TickCount>(trim(fields[*time_column]));
+        if (name.empty() || !time || *time <= 0) {
+            PLOG_ERROR << "Recipe CSV loading error on line " << reader.line()
+                       << ": Recipes must have a name and a positive time";
+            had_errors = true;
+            continue;
+        }
+
+        parse_streams(inputs_column, inputs);
+        parse_streams(outputs_column, outputs);
+        if (!catalog.add_recipe(name, util::ticks(*time), inputs, outputs)) {
+            duplicate_count++;
+        }
+    }
+
+    if (had_errors) {
+        return std::nullopt;
+    }
+    warn_about_duplicates(duplicate_count);
+    return catalog;
+}
+
+std::optional<RecipeCatalog> load_recipe_file(const std::filesystem::path& path,
+                                              util::JobProgress* progress) {
+    if (progress) {
+        progress->set_stage("Reading");
+    }
+    const auto file = util::MappedFile::open(path);
+    if (!file) {
+        PLOG_ERROR << "Could not open '" << path.string() << "'";
+        return std::nullopt;
+    }
+
+    if (progress) {
+        progress->set_stage("Parsing");
+    }
+    const auto bytes = file->bytes();
+    const std::string_view contents(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    return path.extension() == ".csv" ? parse_recipes_csv(contents) : parse_recipes_json(contents);
+}
+
+std::vector<Uid> instantiate_recipes(Factory& factory,
+                                     UidPool& uid_pool,
+                                     const RecipeCatalog& catalog,
+                                     std::span<const RecipeCatalog::Index> recipes) {
+    struct ItemUse {
+        std::optional<Uid> uid;
+        bool is_consumed = false;
+        bool is_produced = false;
+    };
+    std::unordered_map<RecipeCatalog::Index, ItemUse> item_uses;
+    // Missing items are added in the order they first appear in
+    std::vector<RecipeCatalog::Index> used_items;
+    const auto use_item = [&](RecipeCatalog::Index item) -> ItemUse& {
+        const auto [use, inserted] = item_uses.try_emplace(item);
+        if (inserted) {
+            used_items.emplace_back(item);
+        }
+        return use->second;
+    };
+    for (const auto recipe : recipes) {
+        for (const auto& input : catalog.inputs(recipe)) {
+            use_item(input.item).is_consumed = true;
+        }
+        for (const auto& output : catalog.outputs(recipe)) {
+            use_item(output.item).is_produced = true;
+        }
+    }
+
+    // The items of the factory with the same name as the ones of the recipes are used
+    for (const auto& [item_uid, item] : factory.items) {
+        if (const auto catalog_item = catalog.find_item(item.name)) {
+            const auto use = item_uses.find(*catalog_item);
+            if (use != item_uses.end() && !use->second.uid) {
+                use->second.uid = item_uid;
+            }
+        }
+    }
+    for (const auto catalog_item : used_items) {
+        auto& use = item_uses.at(catalog_item);
+        if (use.uid) {
+            continue;
+        }
+        use.uid = uid_pool.generate();
+        const auto type = !use.is_produced  ? Item::NodeType::Input
+                          : !use.is_consumed ? Item::NodeType::Output
+                                             : Item::NodeType::Internal;
+        factory.items[*use.uid] =
+            Item{type, 0, std::string(catalog.item_name(catalog_item)),
+                 type != Item::NodeType::Internal ? uid_pool.generate() : Uid(Uid::INVALID_VALUE)};
+    }
+
+    std::vector<Uid> machine_uids;
+    machine_uids.reserve(recipes.size());
+    for (const auto recipe : recipes) {
+        Machine machine{std::string(catalog.recipe_name(recipe)), {}, {}, catalog.op_time(recipe)};
+        for (const auto& input : catalog.inputs(recipe)) {
+            machine.inputs.emplace_back(
+                ItemStream{*item_uses.at(input.item).uid, input.quantity, uid_pool.generate()});
+        }
+        for (const auto& output : catalog.outputs(recipe)) {
+            machine.outputs.emplace_back(
+                ItemStream{*item_uses.at(output.item).uid, output.quantity, uid_pool.generate()});
+        }
+        const auto machine_uid = uid_pool.generate();
+        factory.machines[machine_uid] = std::move(machine);
+        machine_uids.emplace_back(machine_uid);
+    }
+    return machine_uids;
+}
+
+} // namespace fmk::io
\ No newline at end of file
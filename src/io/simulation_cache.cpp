@@ -0,0 +1,268 @@
+#include "io/simulation_cache.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fmt/core.h>
+#include <fstream>
+#include <plog/Log.h>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "io/binary_format.hpp"
+
+namespace fmk::io {
+
+namespace {
+
+constexpr const char* entry_extension = ".fmkb";
+/// Changes whenever entries written before would be wrong (e.g. the simulation or what is hashed
+/// changed), so that their factories are simulated again instead.
+constexpr std::int64_t entry_version = 3;
+
+/// 64-bit FNV-1a.
+class Hasher {
+public:
+    void add(std::int64_t value) {
+        for (int byte_i = 0; byte_i < 8; byte_i++) {
+            hash ^= static_cast<std::uint64_t>(value >> (byte_i * 8)) & 0xff;
+            hash *= 0x100000001b3;
+        }
+    }
+
+    std::uint64_t hash = 0xcbf29ce484222325;
+};
+
+/// The position of every item of a factory. Items are identified by position instead of by UID,
+/// since UIDs change when saving (see `compact_uids()`) without changing the simulation.
+std::unordered_map<Uid, std::int64_t> item_indices(const Factory& factory) {
+    std::unordered_map<Uid, std::int64_t> indices;
+    for (const auto& [item_uid, _] : factory.items) {
+        indices.emplace(item_uid, static_cast<std::int64_t>(indices.size()));
+    }
+    return indices;
+}
+
+/// Checks whether two factories are simulated the same way, matching their items by position.
+bool is_same_simulation(const Factory& a, const Factory& b) {
+    if (a.items.size() != b.items.size() || a.machines.size() != b.machines.size()) {
+        return false;
+    }
+    for (std::size_t i = 0; i < a.items.size(); i++) {
+        const auto& a_item = a.items.begin()[i].second;
+        const auto& b_item = b.items.begin()[i].second;
+        if (a_item.type != b_item.type || a_item.starting_quantity != b_item.starting_quantity) {
+            return false;
+        }
+    }
+
+    const auto a_indices = item_indices(a);
+    const auto b_indices = item_indices(b);
+    const auto is_same_stream = [&](const ItemStream& a_stream, const ItemStream& b_stream) {
+        const auto a_index = a_indices.find(a_stream.item);
+        const auto b_index = b_indices.find(b_stream.item);
+        return a_index != a_indices.end() && b_index != b_indices.end() &&
+               a_index->second == b_index->second && a_stream.quantity == b_stream.quantity;
+    };
+    for (std::size_t i = 0; i < a.machines.size(); i++) {
+        const auto& a_machine = a.machines.begin()[i].second;
+        const auto& b_machine = b.machines.begin()[i].second;
+        if (a_machine.op_time != b_machine.op_time ||
+            !std::ranges::equal(a_machine.inputs, b_machine.inputs, is_same_stream) ||
+            !std::ranges::equal(a_machine.outputs, b_machine.outputs, is_same_stream)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+std::uint64_t hash_factory(const Factory& factory, std::size_t ticks_to_simulate) {
+    Hasher hasher;
+    hasher.add(entry_version);
+    // Builds with different quantity sizes can share the cache directory
+    hasher.add(static_cast<std::int64_t>(sizeof(Quantity)));
+    hasher.add(static_cast<std::int64_t>(ticks_to_simulate));
+
+    hasher.add(static_cast<std::int64_t>(factory.items.size()));
+    for (const auto& [_, item] : factory.items) {
+        hasher.add(static_cast<std::int64_t>(item.type));
+        hasher.add(item.starting_quantity);
+    }
+
+    // Machines are hashed in iteration order, since it decides which machine gets to consume
+    // contested items first
+    const auto indices = item_indices(factory);
+    hasher.add(static_cast<std::int64_t>(factory.machines.size()));
+    for (const auto& [_, machine] : factory.machines) {
+        hasher.add(machine.op_time.count());
+        for (const auto* io : {&machine.inputs, &machine.outputs}) {
+            hasher.add(static_cast<std::int64_t>(io->size()));
+            for (const auto& stream : *io) {
+                const auto index = indices.find(stream.item);
+                hasher.add(index != indices.end() ? index->second : -1);
+                hasher.add(stream.quantity);
+            }
+        }
+    }
+
+    return hasher.hash;
+}
+
+SimulationCache::SimulationCache(std::filesystem::path directory, std::uintmax_t max_bytes) :
+    directory(std::move(directory)), max_bytes(max_bytes) {}
+
+std::filesystem::path SimulationCache::default_directory() {
+#ifdef _WIN32
+    if (const char* local_app_data = std::getenv("LOCALAPPDATA")) {
+        return std::filesystem::path(local_app_data) / "facmaker" / "simulations";
+    }
+#else
+    if (const char* xdg_cache_home = std::getenv("XDG_CACHE_HOME");
+        xdg_cache_home && *xdg_cache_home) {
+        return std::filesystem::path(xdg_cache_home) / "facmaker" / "simulations";
+    }
+    if (const char* home = std::getenv("HOME")) {
+        return std::filesystem::path(home) / ".cache" / "facmaker" / "simulations";
+    }
+#endif
+    return std::filesystem::temp_directory_path() / "facmaker" / "simulations";
+}
+
+std::optional<Factory::Cache> SimulationCache::load(const Factory& factory,
+                                                    std::size_t ticks_to_simulate) const {
+    const auto path = entry_path(hash_factory(factory, ticks_to_simulate));
+    std::error_code ec;
+    if (!std::filesystem::exists(path, ec)) {
+        return std::nullopt;
+    }
+
+    auto document = read_factory_binary(path);
+    if (!document || !document->cache || document->ticks_to_simulate != ticks_to_simulate) {
+        PLOG_WARNING << "Discarding invalid simulation cache entry '" << path.string() << "'";
+        std::filesystem::remove(path, ec);
+        return std::nullopt;
+    }
+
+    // A different factory with the same hash, which keeps its entry
+    if (!is_same_simulation(document->factory, factory)) {
+        return std::nullopt;
+    }
+
+    // Mark the entry as recently used
+    std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+
+    // The entry may have been stored with other UIDs, so its items are matched by position. The
+    // plots reference the mapped entry, so copying them is cheap
+    const auto& stored_items = document->factory.items;
+    Factory::Cache::QuantityPlotsT plots;
+    for (std::size_t i = 0; i < factory.items.size(); i++) {
+        plots.emplace(factory.items.begin()[i].first,
+                      document->cache->make_plot(stored_items.begin()[i].first));
+    }
+    auto overflow = document->cache->overflow();
+    if (overflow) {
+        const auto stored_item = stored_items.find(overflow->item);
+        overflow->item = stored_item != stored_items.end()
+                             ? factory.items.begin()[stored_item - stored_items.begin()].first
+                             : overflow->item;
+    }
+    return factory.make_cache(std::move(plots), document->cache->ticks_simulated(), overflow);
+}
+
+void SimulationCache::store(const Factory& factory,
+                            std::size_t ticks_to_simulate,
+                            const Factory::Cache& cache) {
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    if (ec) {
+        PLOG_WARNING << "Could not create simulation cache directory '" << directory.string()
+                     << "': " << ec.message();
+        return;
+    }
+
+    const auto path = entry_path(hash_factory(factory, ticks_to_simulate));
+    // Write to a temporary file first so that other instances and threads never see a partial
+    // entry
+    auto temp_path = path;
+    temp_path += fmt::format(".{}.tmp", std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    {
+        std::ofstream file(temp_path, std::ios::binary);
+        write_factory_binary(file, factory, UidPool(Uid(Uid::INVALID_VALUE)), {},
+                             ticks_to_simulate, &cache);
+        if (!file) {
+            PLOG_WARNING << "Could not write simulation cache entry '" << temp_path.string()
+                         << "'";
+            std::filesystem::remove(temp_path, ec);
+            return;
+        }
+    }
+    std::filesystem::rename(temp_path, path, ec);
+    if (ec) {
+        std::filesystem::remove(temp_path, ec);
+        return;
+    }
+
+    evict();
+}
+
+Factory::Cache SimulationCache::get_or_generate(const Factory& factory,
+                                                std::size_t ticks_to_simulate,
+                                                std::shared_ptr<util::Arena> arena,
+                                                util::JobProgress* progress) {
+    if (auto cached = load(factory, ticks_to_simulate)) {
+        PLOGD << "Loaded simulation results from cache";
+        return std::move(*cached);
+    }
+
+    auto cache = factory.generate_cache(ticks_to_simulate, std::move(arena), {}, progress);
+    if (!cache.cancelled()) {
+        store(factory, ticks_to_simulate, cache);
+    }
+    return cache;
+}
+
+std::filesystem::path SimulationCache::entry_path(std::uint64_t hash) const {
+    return directory / fmt::format("{:016x}{}", hash, entry_extension);
+}
+
+void SimulationCache::evict() {
+    struct Entry {
+        std::filesystem::path path;
+        std::uintmax_t size;
+        std::filesystem::file_time_type last_use;
+    };
+
+    std::vector<Entry> entries;
+    std::uintmax_t total_size = 0;
+    std::error_code ec;
+    for (const auto& file : std::filesystem::directory_iterator(directory, ec)) {
+        if (!file.is_regular_file(ec) || file.path().extension() != entry_extension) {
+            continue;
+        }
+        const auto size = file.file_size(ec);
+        const auto last_use = file.last_write_time(ec);
+        if (!ec) {
+            entries.emplace_back(Entry{file.path(), size, last_use});
+            total_size += size;
+        }
+    }
+
+    if (total_size <= max_bytes) {
+        return;
+    }
+
+    std::sort(entries.begin(), entries.end(),
+              [](const Entry& a, const Entry& b) { return a.last_use < b.last_use; });
+    for (const auto& entry : entries) {
+        if (total_size <= max_bytes) {
+            break;
+        }
+        if (std::filesystem::remove(entry.path, ec)) {
+            total_size -= entry.size;
+        }
+    }
+}
+
+} // namespace fmk::io
\ No newline at end of file
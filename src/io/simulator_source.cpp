@@ -0,0 +1,258 @@
+#include "io/simulator_source.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <fmt/format.h>
+#include <limits>
+#include <numeric>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "io/plot_export.hpp"
+#include "sim/flat_factory.hpp"
+#include "sim/program.hpp"
+
+namespace fmk::io {
+
+namespace {
+
+/// The parts of the generated program that don't depend on the factory, around `step()`.
+constexpr std::string_view state_source = R"(
+struct State {
+    std::vector<Quantity> stock =
+        std::vector<Quantity>(starting_stock, starting_stock + item_count);
+    /// The tick at which the task of every machine finishes, or `idle`.
+    std::vector<std::size_t> finish_ticks = std::vector<std::size_t>(machine_count, idle);
+    std::size_t tick = 0;
+    std::size_t overflow_item = 0;
+};
+
+bool change(State& state, std::size_t item, Quantity modifier) {
+    auto& stock = state.stock[item];
+    if ((modifier > 0 && stock > std::numeric_limits<Quantity>::max() - modifier) ||
+        (modifier < 0 && stock < std::numeric_limits<Quantity>::min() - modifier)) {
+        state.overflow_item = item;
+        return false;
+    }
+    stock += modifier;
+    return true;
+}
+)";
+
+constexpr std::string_view main_source = R"(
+void append_number(std::string& buffer, long long number) {
+    char digits[24];
+    buffer.append(digits, std::to_chars(digits, digits + sizeof(digits), number).ptr);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2 || argc > 3) {
+        std::fprintf(stderr, "Usage: %s <output.csv> [<ticks>]\n", argv[0]);
+        return 1;
+    }
+    std::size_t ticks = default_ticks;
+    if (argc == 3) {
+        char* end = nullptr;
+        ticks = std::strtoull(argv[2], &end, 10);
+        if (*argv[2] == '\0' || *end != '\0') {
+            std::fprintf(stderr, "Invalid tick count '%s'\n", argv[2]);
+            return 1;
+        }
+    }
+    // Plots record ticks with as many bits as quantities
+    ticks = std::min(ticks, static_cast<std::size_t>(std::numeric_limits<Quantity>::max()));
+
+    std::FILE* out = std::fopen(argv[1], "wb");
+    if (!out) {
+        std::fprintf(stderr, "Could not open '%s'\n", argv[1]);
+        return 1;
+    }
+
+    // Like plots, rows go one past the last tick, and stay the same after an overflow
+    State state;
+    bool overflowed = false;
+    std::string buffer = csv_header;
+    for (std::size_t tick = 0; item_count > 0 && tick <= ticks; tick++) {
+        if (tick < ticks && !overflowed && !step(state)) {
+            overflowed = true;
+            std::fprintf(stderr,
+                         "Simulation stopped at tick %zu: the quantity of '%s' doesn't fit in "
+                         "%zu bits\n",
+                         tick, item_names[state.overflow_item], sizeof(Quantity) * 8);
+        }
+        append_number(buffer, static_cast<long long>(tick));
+        for (const auto quantity : state.stock) {
+            buffer += ',';
+            append_number(buffer, quantity);
+        }
+        buffer += '\n';
+        if (buffer.size() >= (std::size_t(1) << 16)) {
+            std::fwrite(buffer.data(), 1, buffer.size(), out);
+            buffer.clear();
+        }
+    }
+    std::fwrite(buffer.data(), 1, buffer.size(), out);
+    if (std::fclose(out) != 0) {
+        std::fprintf(stderr, "Could not write '%s'\n", argv[1]);
+        return 1;
+    }
+    return 0;
+}
+)";
+
+/// A C++ string literal with the given contents.
+std::string string_literal(std::string_view str) {
+    std::string literal = "\"";
+    for (const char c : str) {
+        const auto byte = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\') {
+            literal += '\\';
+            literal += c;
+        } else if (byte < 0x20 || byte == 0x7f) {
+            // Octal escapes have at most 3 digits, unlike hexadecimal ones which would take the
+            // characters that follow
+            literal += fmt::format("\\{:03o}", byte);
+        } else {
+            literal += c;
+        }
+    }
+    return literal + '"';
+}
+
+/// A name that can go in a line comment.
+std::string comment_text(std::string_view name) {
+    std::string text(name);
+    std::replace_if(
+        text.begin(), text.end(),
+        [](char c) { return static_cast<unsigned char>(c) < 0x20 || c == '\\'; }, ' ');
+    return text;
+}
+
+/// A quantity as a C++ expression of type `Quantity`, since the lowest one can't be written as a
+/// literal.
+std::string quantity_literal(Quantity quantity) {
+    if (quantity == std::numeric_limits<Quantity>::min()) {
+        return "std::numeric_limits<Quantity>::min()";
+    }
+    return fmt::format("Quantity({})", quantity);
+}
+
+} // namespace
+
+void write_simulator_source(std::ostream& out,
+                            const Factory& factory,
+                            std::size_t ticks_to_simulate) {
+    using Op = sim::Program::Op;
+    const sim::FlatFactory flat(factory.items, factory.machines);
+    const sim::Program program(flat);
+    std::string source;
+    auto it = std::back_inserter(source);
+
+    fmt::format_to(it,
+                   "// Simulates a factory of {} items and {} machines, generated by facmaker.\n"
+                   "// Usage: <program> <output.csv> [<ticks>]\n",
+                   flat.item_count, flat.machine_count);
+    source += "#include <algorithm>\n#include <charconv>\n#include <cstdint>\n#include <cstdio>\n"
+              "#include <cstdlib>\n#include <limits>\n#include <string>\n#include <vector>\n\n"
+              "namespace {\n\n";
+    fmt::format_to(it, "using Quantity = std::int{}_t;\n\n", sizeof(Quantity) * 8);
+    fmt::format_to(it,
+                   "constexpr std::size_t item_count = {};\n"
+                   "constexpr std::size_t machine_count = {};\n"
+                   "constexpr std::size_t default_ticks = {};\n"
+                   "constexpr std::size_t idle = std::numeric_limits<std::size_t>::max();\n\n",
+                   flat.item_count, flat.machine_count, ticks_to_simulate);
+
+    // The arrays have an extra entry, so that they are never empty
+    std::string header = "tick";
+    source += "const char* const item_names[item_count + 1] = {\n";
+    for (const auto& [_, item] : factory.items) {
+        header += ',';
+        header += csv_escape(item.name);
+        fmt::format_to(it, "    {},\n", string_literal(item.name));
+    }
+    source += "    \"\"};\n";
+    source += "const Quantity starting_stock[item_count + 1] = {\n";
+    for (const auto& [_, item] : factory.items) {
+        fmt::format_to(it, "    {},\n", quantity_literal(item.starting_quantity));
+    }
+    source += "    0};\n";
+    fmt::format_to(it, "const char* const csv_header = {};\n", string_literal(header + '\n'));
+    source += state_source;
+
+    source += "\n/// Simulates the next tick, like `Simulation::step()` does.\n"
+              "bool step(State& state) {\n"
+              "    const auto tick = state.tick;\n"
+              "    [[maybe_unused]] auto* const stock = state.stock.data();\n"
+              "    [[maybe_unused]] auto* const finish_ticks = state.finish_ticks.data();\n";
+
+    // Tasks finish in the order they were scheduled, so among the tasks finishing at the same
+    // tick, the ones of the machines with the longest operation times come first. Changes of 0
+    // can't overflow nor change anything, so they are left out.
+    std::vector<std::uint32_t> finish_order(flat.machine_count);
+    std::iota(finish_order.begin(), finish_order.end(), 0);
+    const auto op_time = [&](std::uint32_t machine_i) {
+        return std::max(flat.op_times[machine_i], TickCount(1));
+    };
+    std::stable_sort(finish_order.begin(), finish_order.end(),
+                     [&](std::uint32_t a, std::uint32_t b) { return op_time(a) > op_time(b); });
+    const auto machine_names = [&] {
+        std::vector<const std::string*> names;
+        names.reserve(factory.machines.size());
+        for (const auto& [_, machine] : factory.machines) { names.emplace_back(&machine.name); }
+        return names;
+    }();
+
+    source += "\n    // Finish the tasks due\n";
+    for (const auto machine_i : finish_order) {
+        fmt::format_to(it, "    if (finish_ticks[{}] == tick) {{ // {}\n", machine_i,
+                       comment_text(*machine_names[machine_i]));
+        for (auto pc = program.finish_entries[machine_i]; program.code[pc].op == Op::Give; pc++) {
+            const auto& give = program.code[pc];
+            if (give.quantity == 0) {
+                continue;
+            }
+            fmt::format_to(it, "        if (!change(state, {}, {})) return false;\n", give.item,
+                           quantity_literal(give.quantity));
+        }
+        fmt::format_to(it, "        finish_ticks[{}] = idle;\n    }}\n", machine_i);
+    }
+
+    source += "\n    // Start the machines that are idle and have their inputs\n";
+    for (std::uint32_t machine_i = 0; machine_i < flat.machine_count; machine_i++) {
+        auto pc = program.start_entries[machine_i];
+        fmt::format_to(it, "    if (finish_ticks[{}] == idle", machine_i);
+        for (; program.code[pc].op == Op::Require; pc++) {
+            fmt::format_to(it, " && stock[{}] >= {}", program.code[pc].item,
+                           quantity_literal(program.code[pc].quantity));
+        }
+        fmt::format_to(it, ") {{ // {}\n", comment_text(*machine_names[machine_i]));
+
+        bool overflows = false;
+        for (; program.code[pc].op != Op::Start && !overflows; pc++) {
+            const auto& instruction = program.code[pc];
+            if (instruction.op == Op::Overflow) {
+                fmt::format_to(it, "        state.overflow_item = {};\n        return false;\n",
+                               instruction.item);
+                overflows = true;
+            } else if (instruction.quantity != 0) {
+                fmt::format_to(it, "        if (!change(state, {}, {})) return false;\n",
+                               instruction.item, quantity_literal(instruction.quantity));
+            }
+        }
+        if (!overflows) {
+            fmt::format_to(it, "        finish_ticks[{}] = tick + {};\n", machine_i,
+                           op_time(machine_i));
+        }
+        source += "    }\n";
+    }
+
+    source += "\n    state.tick++;\n    return true;\n}\n";
+    source += main_source;
+    out.write(source.data(), static_cast<std::streamsize>(source.size()));
+}
+
+} // namespace fmk::io
\ No newline at end of file
@@ -12,16 +12,25 @@
 #include <plog/Init.h>
 #include <plog/Log.h>
 
+#include <string_view>
+#include <vector>
+
 #include "editor/factory_editor.hpp"
+#include "headless.hpp"
 
 bool init_graphics(GLFWwindow** out_window);
 
 static imnodes::Context* imnodes_context;
 
-int main() {
+int main(int argc, char** argv) {
     static plog::ColorConsoleAppender<plog::TxtFormatter> console_appender;
     plog::init(plog::verbose, &console_appender);
 
+    if (argc > 1) {
+        const std::vector<std::string_view> args(argv + 1, argv + argc);
+        return fmk::run_headless(args);
+    }
+
     GLFWwindow* window;
     if (!init_graphics(&window)) {
         PLOG_FATAL << "Couldn't initialize graphics.";
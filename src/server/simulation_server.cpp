@@ -0,0 +1,619 @@
+#include "server/simulation_server.hpp"
+
+#include <algorithm>
+#include <boost/json.hpp>
+#include <charconv>
+#include <plog/Log.h>
+#include <shared_mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "io/factory_file.hpp"
+#include "io/json_format.hpp"
+
+#ifndef _WIN32
+#    include <poll.h>
+#    include <sys/socket.h>
+#    include <sys/stat.h>
+#    include <sys/un.h>
+#    include <unistd.h>
+#endif
+
+namespace json = boost::json;
+
+namespace fmk::server {
+
+struct SimulationServer::Resident {
+    /// Patches take it exclusively, simulations and queries share it.
+    std::shared_mutex mutex;
+    io::FactoryDocument document;
+    /// Incremented on every patch, so that simulations of an older version of the factory are
+    /// not stored.
+    std::uint64_t revision = 0;
+};
+
+namespace {
+
+json::object error(std::string_view message) {
+    return {{"ok", false}, {"error", message}};
+}
+
+std::optional<Uid> parse_uid(std::string_view str) {
+    Uid uid(Uid::INVALID_VALUE);
+    const auto [end, ec] = std::from_chars(str.data(), str.data() + str.size(), uid.value);
+    if (ec != std::errc() || end != str.data() + str.size()) {
+        return std::nullopt;
+    }
+    return uid;
+}
+
+json::object summarize(const Factory& factory, const Factory::Cache& cache) {
+    json::object items;
+    for (const auto& [item_uid, item] : factory.items) {
+        // Built one at a time, so that summarizing doesn't keep every plot in memory
+        const auto plot = cache.make_plot(item_uid);
+        const auto values = plot.values();
+        json::object summary{{"name", item.name}};
+        if (!values.empty()) {
+            const auto [min, max] = std::minmax_element(values.begin(), values.end());
+            summary["start"] = values.front();
+            summary["final"] = values.back();
+            summary["min"] = *min;
+            summary["max"] = *max;
+        }
+        items[std::to_string(item_uid.value)] = std::move(summary);
+    }
+    json::object result{{"ok", true},
+                        {"ticks", static_cast<std::uint64_t>(cache.ticks_simulated())},
+                        {"items", std::move(items)}};
+    if (const auto& overflow = cache.overflow()) {
+        result["overflow"] = json::object{{"item", std::to_string(overflow->item.value)},
+                                          {"tick", static_cast<std::uint64_t>(overflow->tick)}};
+    }
+    return result;
+}
+
+/// Parses the `"inputs"` or `"outputs"` of a machine patch into `out_streams`.
+/// @returns An error message if the streams were not valid.
+std::optional<std::string> parse_streams(const json::value& value,
+                                         const Factory& factory,
+                                         UidPool& uid_pool,
+                                         std::vector<ItemStream>& out_streams) {
+    const auto streams = value.if_object();
+    if (!streams) {
+        return "Machine inputs and outputs must be objects";
+    }
+
+    for (const auto& stream : out_streams) { uid_pool.release(stream.uid); }
+    out_streams.clear();
+    for (const auto& [item_uid_str, quantity] : *streams) {
+        const auto item_uid = parse_uid(item_uid_str);
+        if (!item_uid || !factory.items.contains(*item_uid)) {
+            return "Machine streams must refer to existing items";
+        }
+        const auto parsed = quantity.is_int64() ? util::narrow<Quantity>(quantity.as_int64())
+                                                : std::nullopt;
+        if (!parsed) {
+            return "Stream quantities must be integers within the supported range";
+        }
+        out_streams.emplace_back(ItemStream{*item_uid, *parsed, uid_pool.generate()});
+    }
+    return std::nullopt;
+}
+
+/// Applies a patch request to a document.
+/// @returns An error message if the patch was not valid. The document might have been partially
+/// patched in that case.
+std::optional<std::string> apply_patch(const json::object& request, io::FactoryDocument& document) {
+    auto& factory = document.factory;
+
+    if (const auto items_val = request.if_contains("items")) {
+        const auto items = items_val->if_object();
+        if (!items) {
+            return "\"items\" must be an object";
+        }
+        for (const auto& [item_uid_str, patch_val] : *items) {
+            const auto item_uid = parse_uid(item_uid_str);
+            if (!item_uid) {
+                return "Could not parse item UID";
+            }
+            if (patch_val.is_null()) {
+                if (const auto item = factory.items.find(*item_uid); item != factory.items.end()) {
+                    document.uid_pool.release(item->first);
+                    document.uid_pool.release(item->second.attribute_uid);
+                    factory.items.erase(item);
+                }
+                continue;
+            }
+            const auto patch = patch_val.if_object();
+            if (!patch) {
+                return "Item patches must be objects or null";
+            }
+
+            const auto item_it = factory.items.find(*item_uid);
+            if (item_it == factory.items.end()) {
+                return "No item with that UID";
+            }
+            auto& item = item_it->second;
+            if (const auto name = patch->if_contains("name"); name && name->is_string()) {
+                item.name = name->as_string();
+            }
+            if (const auto quantity = patch->if_contains("start_with")) {
+                const auto parsed = quantity->is_int64()
+                                        ? util::narrow<Quantity>(quantity->as_int64())
+                                        : std::nullopt;
+                if (!parsed) {
+                    return "\"start_with\" must be an integer within the supported range";
+                }
+                item.starting_quantity = *parsed;
+            }
+            if (const auto type_val = patch->if_contains("type")) {
+                const auto type = type_val->if_string();
+                if (type && *type == "input") {
+                    item.type = Item::NodeType::Input;
+                } else if (type && *type == "output") {
+                    item.type = Item::NodeType::Output;
+                } else if (type && *type == "internal") {
+                    item.type = Item::NodeType::Internal;
+                } else {
+                    return "\"type\" must be \"input\", \"output\" or \"internal\"";
+                }
+            }
+        }
+    }
+
+    if (const auto machines_val = request.if_contains("machines")) {
+        const auto machines = machines_val->if_object();
+        if (!machines) {
+            return "\"machines\" must be an object";
+        }
+        for (const auto& [machine_uid_str, patch_val] : *machines) {
+            const auto machine_uid = parse_uid(machine_uid_str);
+            if (!machine_uid) {
+                return "Could not parse machine UID";
+            }
+            if (patch_val.is_null()) {
+                if (const auto machine = factory.machines.find(*machine_uid);
+                    machine != factory.machines.end()) {
+                    document.uid_pool.release(machine->first);
+                    for (const auto* io : {&machine->second.inputs, &machine->second.outputs}) {
+                        for (const auto& stream : *io) { document.uid_pool.release(stream.uid); }
+                    }
+                    factory.machines.erase(machine);
+                }
+                continue;
+            }
+            const auto patch = patch_val.if_object();
+            if (!patch) {
+                return "Machine patches must be objects or null";
+            }
+
+            const auto machine_it = factory.machines.find(*machine_uid);
+            if (machine_it == factory.machines.end()) {
+                return "No machine with that UID";
+            }
+            auto& machine = machine_it->second;
+            if (const auto name = patch->if_contains("name"); name && name->is_string()) {
+                machine.name = name->as_string();
+            }
+            if (const auto time = patch->if_contains("time")) {
+                const auto parsed =
+                    time->is_int64() ? util::narrow<TickCount>(time->as_int64()) : std::nullopt;
+                if (!parsed) {
+                    return "\"time\" must be an integer within the supported range";
+                }
+                machine.op_time = util::ticks(*parsed);
+            }
+            if (const auto inputs = patch->if_contains("inputs")) {
+                if (auto err = parse_streams(*inputs, factory, document.uid_pool, machine.inputs)) {
+                    return err;
+                }
+            }
+            if (const auto outputs = patch->if_contains("outputs")) {
+                if (auto err =
+                        parse_streams(*outputs, factory, document.uid_pool, machine.outputs)) {
+                    return err;
+                }
+            }
+        }
+    }
+
+    // Removed items might still be referenced by machines
+    for (const auto& [_, machine] : factory.machines) {
+        for (const auto* io : {&machine.inputs, &machine.outputs}) {
+            for (const auto& stream : *io) {
+                if (!factory.items.contains(stream.item)) {
+                    return "Machines must not refer to removed items";
+                }
+            }
+        }
+    }
+
+    return std::nullopt;
+}
+
+} // namespace
+
+SimulationServer::SimulationServer(std::filesystem::path socket_path, std::size_t worker_count) :
+    socket_path(std::move(socket_path)), workers(worker_count) {}
+
+SimulationServer::~SimulationServer() = default;
+
+std::shared_ptr<SimulationServer::Resident>
+SimulationServer::find_resident(const std::string& name) {
+    std::lock_guard lock(residents_mutex);
+    const auto resident = residents.find(name);
+    return resident != residents.end() ? resident->second : nullptr;
+}
+
+std::string SimulationServer::handle_batch(std::string_view batch) {
+    json::error_code ec;
+    const auto batch_val = json::parse(batch, ec);
+    if (ec) {
+        return json::serialize(json::object{{"results", json::array{error(ec.message())}}});
+    }
+
+    json::object response;
+    const json::array* requests = batch_val.if_array();
+    if (const auto batch_obj = batch_val.if_object()) {
+        if (const auto id = batch_obj->if_contains("id")) {
+            response["id"] = *id;
+        }
+        if (const auto requests_val = batch_obj->if_contains("requests")) {
+            requests = requests_val->if_array();
+        }
+    }
+    if (!requests) {
+        response["results"] = json::array{error("Batches must contain an array of requests")};
+        return json::serialize(response);
+    }
+
+    auto handle_request = [this](const json::value& request_val) -> json::object {
+        const auto request = request_val.if_object();
+        if (!request) {
+            return error("Requests must be objects");
+        }
+        const auto op_val = request->if_contains("op");
+        if (!op_val || !op_val->is_string()) {
+            return error("Requests must have an \"op\" string");
+        }
+        const std::string_view op = op_val->as_string();
+
+        if (op == "list") {
+            json::array names;
+            std::lock_guard lock(residents_mutex);
+            for (const auto& [name, _] : residents) { names.emplace_back(name); }
+            return {{"ok", true}, {"names", std::move(names)}};
+        }
+
+        const auto name_val = request->if_contains("name");
+        if (!name_val || !name_val->is_string()) {
+            return error("Requests must have a \"name\" string");
+        }
+        const std::string name(name_val->as_string());
+
+        if (op == "load") {
+            std::optional<io::FactoryDocument> document;
+            if (const auto path = request->if_contains("path"); path && path->is_string()) {
+                document = io::load_factory_file(std::string(path->as_string()));
+            } else if (const auto factory = request->if_contains("factory")) {
+                std::istringstream input(json::serialize(*factory));
+                document = io::parse_factory_json(input);
+            } else {
+                return error("\"load\" requires a \"path\" or a \"factory\"");
+            }
+            if (!document) {
+                return error("Could not load factory");
+            }
+
+            auto resident = std::make_shared<Resident>();
+            resident->document = std::move(*document);
+            const json::object result{
+                {"ok", true},
+                {"items", static_cast<std::uint64_t>(resident->document.factory.items.size())},
+                {"machines",
+                 static_cast<std::uint64_t>(resident->document.factory.machines.size())}};
+
+            std::lock_guard lock(residents_mutex);
+            residents[name] = std::move(resident);
+            return result;
+        }
+        if (op == "unload") {
+            std::lock_guard lock(residents_mutex);
+            return {{"ok", residents.erase(name) > 0}};
+        }
+
+        const auto resident = find_resident(name);
+        if (!resident) {
+            return error("No factory loaded with that name");
+        }
+
+        if (op == "patch") {
+            std::unique_lock lock(resident->mutex);
+            // Patches are applied on a copy so that invalid ones don't leave the factory half
+            // patched. Only what patches change is copied, the plots in particular can be large
+            io::FactoryDocument patched{.factory = resident->document.factory,
+                                        .uid_pool = resident->document.uid_pool};
+            if (auto err = apply_patch(*request, patched)) {
+                return error(*err);
+            }
+            resident->document.factory = std::move(patched.factory);
+            resident->document.uid_pool = patched.uid_pool;
+            resident->document.cache.reset();
+            resident->revision++;
+            return {{"ok", true}};
+        }
+
+        if (op == "simulate") {
+            std::shared_lock lock(resident->mutex);
+            auto ticks = resident->document.ticks_to_simulate;
+            if (const auto ticks_val = request->if_contains("ticks")) {
+                if (!ticks_val->is_int64() || ticks_val->as_int64() < 0) {
+                    return error("\"ticks\" must be a positive integer");
+                }
+                ticks = static_cast<std::size_t>(ticks_val->as_int64());
+            }
+
+            // Simulations of the same factory can run concurrently, only storing the results
+            // requires exclusive access
+            const auto revision = resident->revision;
+            auto cache = resident->document.factory.generate_cache(ticks);
+            auto result = summarize(resident->document.factory, cache);
+            lock.unlock();
+
+            std::unique_lock store_lock(resident->mutex);
+            if (resident->revision == revision) {
+                resident->document.cache = std::move(cache);
+            }
+            return result;
+        }
+
+        std::shared_lock lock(resident->mutex);
+        const auto& factory = resident->document.factory;
+        const auto& cache = resident->document.cache;
+        if (!cache) {
+            return error("The factory has not been simulated since it was loaded or patched");
+        }
+
+        if (op == "summary") {
+            return summarize(factory, *cache);
+        }
+
+        if (op == "series") {
+            std::size_t every = 1;
+            if (const auto every_val = request->if_contains("every")) {
+                if (!every_val->is_int64() || every_val->as_int64() <= 0) {
+                    return error("\"every\" must be a positive integer");
+                }
+                every = static_cast<std::size_t>(every_val->as_int64());
+            }
+
+            std::vector<Uid> items;
+            if (const auto items_val = request->if_contains("items")) {
+                const auto requested_items = items_val->if_array();
+                if (!requested_items) {
+                    return error("\"items\" must be an array");
+                }
+                for (const auto& requested : *requested_items) {
+                    if (requested.is_int64()) {
+                        items.emplace_back(requested.as_int64());
+                    } else if (const auto item_name = requested.if_string()) {
+                        const auto item = std::find_if(
+                            factory.items.begin(), factory.items.end(),
+                            [&](const auto& item) { return item.second.name == *item_name; });
+                        if (item == factory.items.end()) {
+                            return error("No item with that name");
+                        }
+                        items.emplace_back(item->first);
+                    } else {
+                        return error("Items must be given as UIDs or names");
+                    }
+                    if (!factory.items.contains(items.back())) {
+                        return error("No item with that UID");
+                    }
+                }
+            } else {
+                for (const auto& [item_uid, _] : factory.items) { items.emplace_back(item_uid); }
+            }
+
+            json::object series;
+            for (const auto& item_uid : items) {
+                const auto plot = cache->make_plot(item_uid);
+                const auto values = plot.values();
+                json::array sampled;
+                sampled.reserve(values.size() / every + 1);
+                for (std::size_t tick = 0; tick < values.size(); tick += every) {
+                    sampled.emplace_back(values[tick]);
+                }
+                series[std::to_string(item_uid.value)] = std::move(sampled);
+            }
+            return {{"ok", true}, {"every", static_cast<std::uint64_t>(every)},
+                    {"series", std::move(series)}};
+        }
+
+        return error("Unknown \"op\"");
+    };
+
+    json::array results;
+    results.reserve(requests->size());
+    for (const auto& request : *requests) {
+        try {
+            results.emplace_back(handle_request(request));
+        } catch (const std::exception& e) {
+            // Thrown by boost::json when values have unexpected types
+            results.emplace_back(error(e.what()));
+        }
+    }
+    response["results"] = std::move(results);
+    return json::serialize(response);
+}
+
+#ifdef _WIN32
+
+bool SimulationServer::run() {
+    PLOG_ERROR << "The simulation server is not supported on Windows";
+    return false;
+}
+
+#else
+
+namespace {
+
+/// A client connection. Responses to its batches may be written from any worker.
+struct Connection {
+    explicit Connection(int fd) : fd(fd) {}
+    ~Connection() { ::close(fd); }
+
+    void send_line(std::string line) {
+        line += '\n';
+        std::lock_guard lock(write_mutex);
+        std::size_t sent = 0;
+        while (sent < line.size()) {
+#    ifdef MSG_NOSIGNAL
+            const auto result = ::send(fd, line.data() + sent, line.size() - sent, MSG_NOSIGNAL);
+#    else
+            const auto result = ::send(fd, line.data() + sent, line.size() - sent, 0);
+#    endif
+            if (result <= 0) {
+                return;
+            }
+            sent += static_cast<std::size_t>(result);
+        }
+    }
+
+    const int fd;
+    std::mutex write_mutex;
+};
+
+/// Batches longer than this close the connection.
+constexpr std::size_t max_batch_size = 64 * 1024 * 1024;
+
+} // namespace
+
+bool SimulationServer::run() {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    const auto path = socket_path.string();
+    if (path.size() >= sizeof(address.sun_path)) {
+        PLOG_ERROR << "Socket path '" << path << "' is too long";
+        return false;
+    }
+    std::copy(path.begin(), path.end(), address.sun_path);
+
+    const int listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd == -1) {
+        PLOG_ERROR << "Could not create socket";
+        return false;
+    }
+
+    // Remove the socket left behind by a previous server, if any
+    ::unlink(path.c_str());
+    // Only the current user may connect
+    const auto previous_umask = ::umask(0077);
+    const bool bound =
+        ::bind(listen_fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+    ::umask(previous_umask);
+    if (!bound || ::listen(listen_fd, SOMAXCONN) != 0) {
+        PLOG_ERROR << "Could not listen on '" << path << "'";
+        ::close(listen_fd);
+        return false;
+    }
+    PLOGI << "Listening on '" << path << "' with " << workers.worker_count() << " workers";
+
+    // Each connection has a reader thread, joined once its connection closes. Readers are
+    // identified by a number of their own since fds are reused by later connections
+    std::unordered_map<std::size_t, std::thread> readers;
+    std::size_t next_reader_id = 0;
+    struct ReaderStates {
+        std::mutex mutex;
+        /// The fds of the connections still being read, to unblock their readers when stopping.
+        std::unordered_map<std::size_t, int> fds;
+        /// The readers that are done and can be joined.
+        std::vector<std::size_t> finished;
+    } reader_states;
+    const auto join_finished_readers = [&] {
+        std::vector<std::size_t> finished;
+        {
+            std::lock_guard lock(reader_states.mutex);
+            finished.swap(reader_states.finished);
+        }
+        for (const auto reader_id : finished) {
+            readers.at(reader_id).join();
+            readers.erase(reader_id);
+        }
+    };
+
+    while (!stopping) {
+        join_finished_readers();
+
+        pollfd listen_poll{listen_fd, POLLIN, 0};
+        if (::poll(&listen_poll, 1, 200) <= 0) {
+            continue;
+        }
+
+        const int client_fd = ::accept(listen_fd, nullptr, nullptr);
+        if (client_fd == -1) {
+            continue;
+        }
+        const auto reader_id = next_reader_id++;
+        {
+            std::lock_guard lock(reader_states.mutex);
+            reader_states.fds.emplace(reader_id, client_fd);
+        }
+
+        auto connection = std::make_shared<Connection>(client_fd);
+        readers.emplace(reader_id, std::thread([this, &reader_states, reader_id,
+                                                connection = std::move(connection)] {
+            std::string pending;
+            char chunk[1 << 16];
+            while (true) {
+                const auto received = ::recv(connection->fd, chunk, sizeof(chunk), 0);
+                if (received <= 0) {
+                    break;
+                }
+                pending.append(chunk, static_cast<std::size_t>(received));
+
+                std::size_t line_start = 0;
+                for (auto line_end = pending.find('\n'); line_end != std::string::npos;
+                     line_end = pending.find('\n', line_start)) {
+                    auto line = pending.substr(line_start, line_end - line_start);
+                    line_start = line_end + 1;
+                    if (line.empty()) {
+                        continue;
+                    }
+                    workers.submit([this, connection, line = std::move(line)] {
+                        connection->send_line(handle_batch(line));
+                    });
+                }
+                pending.erase(0, line_start);
+
+                if (pending.size() > max_batch_size) {
+                    PLOG_WARNING << "Closing connection that sent a batch over the size limit";
+                    break;
+                }
+            }
+
+            // Forgotten before the connection can be closed, which happens once the batches
+            // still pending have been answered
+            std::lock_guard lock(reader_states.mutex);
+            reader_states.fds.erase(reader_id);
+            reader_states.finished.emplace_back(reader_id);
+        }));
+    }
+
+    // Unblock the readers still waiting for data; pending batches still get answered
+    {
+        std::lock_guard lock(reader_states.mutex);
+        for (const auto& [_, fd] : reader_states.fds) { ::shutdown(fd, SHUT_RD); }
+    }
+    for (auto& [_, reader] : readers) { reader.join(); }
+
+    ::close(listen_fd);
+    ::unlink(path.c_str());
+    return true;
+}
+
+#endif
+
+} // namespace fmk::server
\ No newline at end of file
@@ -0,0 +1,181 @@
+#include "sim/flat_factory.hpp"
+
+#include <algorithm>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+    #define FACMAKER_AVX2_REQUIREMENTS
+    #include <immintrin.h>
+#endif
+
+namespace fmk::sim {
+
+FlatFactory::FlatFactory(const Factory::ItemsT& items,
+                         const Factory::MachinesT& machines,
+                         std::pmr::memory_resource* resource) :
+    item_count(items.size()),
+    machine_count(machines.size()),
+    padded_machine_count((machines.size() + machine_block - 1) / machine_block * machine_block),
+    op_times(resource),
+    op_time_distributions(resource),
+    input_offsets(resource),
+    input_streams(resource),
+    output_offsets(resource),
+    output_streams(resource),
+    output_probabilities(resource),
+    required_items(resource),
+    required_quantities(resource) {
+    item_indices.reserve(items.size());
+    for (const auto& [item_uid, _] : items) {
+        item_indices.emplace(item_uid, static_cast<std::uint32_t>(item_indices.size()));
+    }
+
+    op_times.reserve(machine_count);
+    op_time_distributions.reserve(machine_count);
+    input_offsets.reserve(machine_count + 1);
+    output_offsets.reserve(machine_count + 1);
+    input_offsets.emplace_back(0);
+    output_offsets.emplace_back(0);
+    for (const auto& [_, machine] : machines) {
+        op_times.emplace_back(machine.op_time.count());
+        op_time_distributions.emplace_back(machine.op_time_distribution);
+        is_stochastic = is_stochastic ||
+                        (machine.op_time_distribution.type != OpTimeDistribution::Type::Fixed &&
+                         machine.op_time_distribution.spread.count() > 0);
+        for (const auto& input : machine.inputs) {
+            input_streams.emplace_back(Stream{item_index(input.item), input.quantity});
+        }
+        for (const auto& output : machine.outputs) {
+            output_streams.emplace_back(Stream{item_index(output.item), output.quantity});
+            output_probabilities.emplace_back(output.probability);
+            is_stochastic = is_stochastic || output.probability < 1.f;
+        }
+        input_offsets.emplace_back(static_cast<std::uint32_t>(input_streams.size()));
+        output_offsets.emplace_back(static_cast<std::uint32_t>(output_streams.size()));
+        required_columns = std::max(required_columns, machine.inputs.size());
+    }
+
+    required_items.assign(required_columns * padded_machine_count, unlimited_item());
+    required_quantities.assign(required_columns * padded_machine_count, 0);
+    std::size_t machine_i = 0;
+    for (const auto& [_, machine] : machines) {
+        std::size_t column = 0;
+        for (const auto& input : machine.inputs) {
+            if (items.at(input.item).type != Item::NodeType::Input) {
+                const auto cell = column * padded_machine_count + machine_i;
+                required_items[cell] = item_index(input.item);
+                required_quantities[cell] = input.quantity;
+            }
+            column++;
+        }
+        machine_i++;
+    }
+}
+
+void find_blocked_machines_scalar(const FlatFactory& factory,
+                                  std::span<const Quantity> stock,
+                                  std::span<std::int32_t> blocked) {
+    std::fill(blocked.begin(), blocked.end(), 0);
+    for (std::size_t column = 0; column < factory.required_columns; column++) {
+        const auto* items = factory.required_items.data() + column * factory.padded_machine_count;
+        const auto* quantities =
+            factory.required_quantities.data() + column * factory.padded_machine_count;
+        for (std::size_t machine_i = 0; machine_i < factory.padded_machine_count; machine_i++) {
+            if (stock[items[machine_i]] < quantities[machine_i]) {
+                blocked[machine_i] = -1;
+            }
+        }
+    }
+}
+
+#ifdef FACMAKER_AVX2_REQUIREMENTS
+
+namespace {
+
+/// Checks 8 machines at a time: their requirements are gathered from the stock column by column,
+/// and the comparisons are OR-ed together.
+__attribute__((target("avx2"))) void find_blocked_machines_avx2(const FlatFactory& factory,
+                                                                 std::span<const Quantity> stock,
+                                                                 std::span<std::int32_t> blocked) {
+    const auto stride = factory.padded_machine_count;
+    for (std::size_t machine_i = 0; machine_i < stride; machine_i += FlatFactory::machine_block) {
+        const auto* items = factory.required_items.data() + machine_i;
+        const auto* needed = factory.required_quantities.data() + machine_i;
+        __m256i any_short;
+
+        if constexpr (sizeof(Quantity) == sizeof(std::int32_t)) {
+            any_short = _mm256_setzero_si256();
+            for (std::size_t column = 0; column < factory.required_columns; column++) {
+                const auto cell = column * stride;
+                const auto indices =
+                    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(items + cell));
+                const auto available = _mm256_i32gather_epi32(
+                    reinterpret_cast<const int*>(stock.data()), indices, sizeof(Quantity));
+                any_short = _mm256_or_si256(
+                    any_short,
+                    _mm256_cmpgt_epi32(
+                        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(needed + cell)),
+                        available));
+            }
+        } else {
+            // 64-bit quantities only fit 4 to a register, so each block is checked in two halves
+            // whose masks are narrowed to 32 bits at the end
+            __m256i any_short_halves[2] = {_mm256_setzero_si256(), _mm256_setzero_si256()};
+            const auto* stock_data = reinterpret_cast<const long long*>(stock.data());
+            for (std::size_t column = 0; column < factory.required_columns; column++) {
+                for (std::size_t half = 0; half < 2; half++) {
+                    const auto cell = column * stride + half * 4;
+                    const auto indices =
+                        _mm_loadu_si128(reinterpret_cast<const __m128i*>(items + cell));
+                    const auto available =
+                        _mm256_i32gather_epi64(stock_data, indices, sizeof(Quantity));
+                    any_short_halves[half] = _mm256_or_si256(
+                        any_short_halves[half],
+                        _mm256_cmpgt_epi64(
+                            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(needed + cell)),
+                            available));
+                }
+            }
+            const auto even_lanes = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+            any_short = _mm256_set_m128i(
+                _mm256_castsi256_si128(
+                    _mm256_permutevar8x32_epi32(any_short_halves[1], even_lanes)),
+                _mm256_castsi256_si128(
+                    _mm256_permutevar8x32_epi32(any_short_halves[0], even_lanes)));
+        }
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(blocked.data() + machine_i), any_short);
+    }
+}
+
+} // namespace
+
+bool has_vectorized_requirement_checks() {
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    return has_avx2;
+}
+
+void find_blocked_machines(const FlatFactory& factory,
+                           std::span<const Quantity> stock,
+                           std::span<std::int32_t> blocked) {
+    if (has_vectorized_requirement_checks()) {
+        find_blocked_machines_avx2(factory, stock, blocked);
+    } else {
+        find_blocked_machines_scalar(factory, stock, blocked);
+    }
+}
+
+#else
+
+bool has_vectorized_requirement_checks() {
+    return false;
+}
+
+void find_blocked_machines(const FlatFactory& factory,
+                           std::span<const Quantity> stock,
+                           std::span<std::int32_t> blocked) {
+    find_blocked_machines_scalar(factory, stock, blocked);
+}
+
+#endif
+
+} // namespace fmk::sim
\ No newline at end of file
@@ -0,0 +1,276 @@
+#include "sim/machine_counts.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <plog/Log.h>
+#include <unordered_map>
+
+#include "sim/simulation.hpp"
+#include "util/background_job.hpp"
+#include "util/linear_program.hpp"
+
+namespace fmk::sim {
+
+namespace {
+
+constexpr double ticks_per_minute =
+    60. * static_cast<double>(util::ticks::period::den) / util::ticks::period::num;
+/// How far from an integer a relaxed count can be and still be taken as one.
+constexpr double integrality_tolerance = 1e-6;
+/// The weight of the machine count when minimizing the surplus, small enough to only break ties.
+constexpr double tie_breaker = 1e-4;
+
+/// The bounds on the counts of a node of the branch and bound search.
+struct Bounds {
+    std::vector<double> lower;
+    std::vector<double> upper;
+};
+
+/// The net rate per minute at which one copy of every machine changes the stock of an item, if it
+/// runs all the time. Outputs count with their chance of being produced.
+std::vector<util::LinearProgram::Term>
+rate_terms(const Factory& factory, const ItemGraph& graph, Uid item) {
+    std::vector<util::LinearProgram::Term> terms;
+    const auto add_links = [&](std::span<const ItemGraph::Link> links, bool is_output) {
+        for (const auto& link : links) {
+            const auto machine = factory.machines.find(link.machine);
+            const auto& stream = is_output ? machine->second.outputs[link.io_index]
+                                           : machine->second.inputs[link.io_index];
+            const auto cycles_per_minute =
+                ticks_per_minute /
+                static_cast<double>(std::max(machine->second.op_time.count(), TickCount(1)));
+            const auto quantity = static_cast<double>(stream.quantity) *
+                                  (is_output ? static_cast<double>(stream.probability) : -1.);
+            terms.emplace_back(util::LinearProgram::Term{
+                static_cast<std::uint32_t>(machine - factory.machines.begin()),
+                quantity * cycles_per_minute});
+        }
+    };
+    add_links(graph.producers(item), true);
+    add_links(graph.consumers(item), false);
+    return terms;
+}
+
+} // namespace
+
+std::optional<MachineCounts> solve_machine_counts(const Factory& factory,
+                                                  std::span<const RateTarget> targets,
+                                                  const MachineCountOptions& options,
+                                                  util::JobProgress* progress) {
+    using Relation = util::LinearProgram::Constraint::Relation;
+    const ItemGraph graph(factory.machines);
+    const auto machine_count = factory.machines.size();
+
+    std::unordered_map<Uid, double> target_rates;
+    for (const auto& target : targets) {
+        const auto item = factory.items.find(target.item);
+        if (item == factory.items.end()) {
+            PLOG_ERROR << "The target item isn't in the factory";
+            return std::nullopt;
+        }
+        if (item->second.type == Item::NodeType::Input) {
+            PLOG_ERROR << "'" << item->second.name << "' is an input, so it can't be produced";
+            return std::nullopt;
+        }
+        if (graph.producers(target.item).empty() && target.per_minute > 0) {
+            PLOG_ERROR << "No machine produces '" << item->second.name << "'";
+            return std::nullopt;
+        }
+        target_rates[target.item] = target.per_minute;
+    }
+
+    // Every target item is produced at least at its rate, and every internal item at least as
+    // fast as it is consumed
+    MachineCounts result;
+    util::LinearProgram program;
+    for (const auto& [item_uid, item] : factory.items) {
+        const auto target = target_rates.find(item_uid);
+        if (target == target_rates.end() && item.type != Item::NodeType::Internal) {
+            continue;
+        }
+        const auto target_rate = target != target_rates.end() ? target->second : 0.;
+        result.rates.emplace_back(
+            MachineCounts::ItemRate{item_uid, target_rate, 0., std::nullopt});
+        program.constraints.emplace_back(util::LinearProgram::Constraint{
+            Relation::GreaterEqual, rate_terms(factory, graph, item_uid), target_rate});
+    }
+
+    program.objective.assign(machine_count, 1.);
+    if (options.objective == MachineCountOptions::Objective::Surplus) {
+        // The surplus is the sum of the net rates of the constrained items beyond their target,
+        // which is linear in the counts
+        std::fill(program.objective.begin(), program.objective.end(), tie_breaker);
+        for (const auto& constraint : program.constraints) {
+            for (const auto& term : constraint.terms) {
+                program.objective[term.variable] += term.coefficient;
+            }
+        }
+    }
+
+    // Depth-first branch and bound, going into the rounded up branch first, which is the likeliest
+    // to be feasible, so that integer counts are found early and prune the rest
+    std::optional<std::vector<double>> best;
+    double best_objective = std::numeric_limits<double>::infinity();
+    const auto is_pruned = [&](double objective) {
+        if (options.objective == MachineCountOptions::Objective::MachineCount) {
+            return std::ceil(objective - integrality_tolerance) >= best_objective - 0.5;
+        }
+        return objective >= best_objective - 1e-9 * (1. + std::abs(best_objective));
+    };
+    std::vector<Bounds> nodes{Bounds{std::vector<double>(machine_count, 0.),
+                                     std::vector<double>(machine_count, -1.)}};
+    std::size_t relaxations = 0;
+    if (progress) {
+        progress->set_stage("Searching");
+    }
+    while (!nodes.empty() && relaxations < options.max_relaxations) {
+        if (progress) {
+            progress->set_fraction(static_cast<float>(relaxations) /
+                                   static_cast<float>(options.max_relaxations));
+            if (progress->is_cancelled()) {
+                return std::nullopt;
+            }
+        }
+        const auto bounds = std::move(nodes.back());
+        nodes.pop_back();
+
+        auto node = program;
+        for (std::uint32_t machine_i = 0; machine_i < machine_count; machine_i++) {
+            if (bounds.lower[machine_i] > 0) {
+                node.constraints.emplace_back(util::LinearProgram::Constraint{
+                    Relation::GreaterEqual, {{machine_i, 1.}}, bounds.lower[machine_i]});
+            }
+            if (bounds.upper[machine_i] >= 0) {
+                node.constraints.emplace_back(util::LinearProgram::Constraint{
+                    Relation::LessEqual, {{machine_i, 1.}}, bounds.upper[machine_i]});
+            }
+        }
+        const auto relaxed = util::solve_linear_program(node);
+        relaxations++;
+        if (relaxed.status != util::LinearSolution::Status::Optimal) {
+            if (relaxations == 1 &&
+                relaxed.status == util::LinearSolution::Status::Infeasible) {
+                PLOG_ERROR << "The target rates can't be met: some items are consumed faster "
+                              "than they can be produced";
+                return std::nullopt;
+            }
+            if (relaxations == 1) {
+                PLOG_ERROR << "Could not solve the relaxation, the counts needed are likely too "
+                              "large to compute accurately";
+                return std::nullopt;
+            }
+            continue;
+        }
+        if (is_pruned(relaxed.objective)) {
+            continue;
+        }
+
+        // Branch on the count furthest from an integer
+        std::optional<std::uint32_t> branch;
+        double branch_fraction = integrality_tolerance;
+        for (std::uint32_t machine_i = 0; machine_i < machine_count; machine_i++) {
+            const auto value = relaxed.values[machine_i];
+            const auto fraction = std::min(value - std::floor(value), std::ceil(value) - value);
+            if (fraction > branch_fraction) {
+                branch = machine_i;
+                branch_fraction = fraction;
+            }
+        }
+        if (!branch) {
+            best = relaxed.values;
+            best_objective = relaxed.objective;
+            continue;
+        }
+
+        const auto value = relaxed.values[*branch];
+        Bounds round_down = bounds;
+        round_down.upper[*branch] = std::floor(value);
+        Bounds round_up = bounds;
+        round_up.lower[*branch] = std::ceil(value);
+        nodes.emplace_back(std::move(round_down));
+        nodes.emplace_back(std::move(round_up));
+    }
+
+    if (!best) {
+        PLOG_ERROR << "No machine counts found within " << options.max_relaxations
+                   << " relaxations";
+        return std::nullopt;
+    }
+    result.is_optimal = nodes.empty();
+    for (const auto value : *best) {
+        result.counts.emplace_back(static_cast<std::size_t>(std::llround(value)));
+    }
+    for (std::size_t rate_i = 0; rate_i < result.rates.size(); rate_i++) {
+        for (const auto& term : program.constraints[rate_i].terms) {
+            result.rates[rate_i].planned_per_minute +=
+                term.coefficient * static_cast<double>(result.counts[term.variable]);
+        }
+    }
+
+    if (options.validation_ticks == 0) {
+        return result;
+    }
+
+    // Simulate the copies of the machines, and measure the rates once they had half of the time
+    // to fill up their internal items
+    Uid::ValueT last_uid = Uid::INVALID_VALUE;
+    for (const auto& [machine_uid, _] : factory.machines) {
+        last_uid = std::max(last_uid, machine_uid.value);
+    }
+    UidPool uid_pool(Uid(last_uid + 1));
+    const auto machines = repeat_machines(factory.machines, result.counts, uid_pool);
+    Simulation simulation(factory.items, machines);
+    if (simulation.flat_factory().is_stochastic) {
+        simulation.randomize(0);
+    }
+    if (progress) {
+        progress->set_stage("Validating");
+    }
+    const auto ticks = options.validation_ticks;
+    const auto half = ticks / 2;
+    std::vector<Quantity> half_stock;
+    while (simulation.tick() < ticks) {
+        if (!simulation.report_progress(progress, ticks)) {
+            return std::nullopt;
+        }
+        if (!simulation.step()) {
+            result.overflow = simulation.overflow();
+            PLOG_WARNING << "The validation simulation overflowed at tick "
+                         << result.overflow->tick;
+            return result;
+        }
+        if (simulation.tick() == half) {
+            half_stock.assign(simulation.stock().begin(), simulation.stock().end());
+        }
+    }
+    const auto& flat = simulation.flat_factory();
+    const auto measured_minutes = static_cast<double>(ticks - half) / ticks_per_minute;
+    for (auto& rate : result.rates) {
+        const auto item_i = flat.item_index(rate.item);
+        const auto start = half_stock.empty() ? factory.items.at(rate.item).starting_quantity
+                                              : half_stock[item_i];
+        rate.simulated_per_minute =
+            static_cast<double>(simulation.stock()[item_i] - start) / measured_minutes;
+    }
+    return result;
+}
+
+Factory::MachinesT repeat_machines(const Factory::MachinesT& machines,
+                                   std::span<const std::size_t> counts,
+                                   UidPool& uid_pool) {
+    Factory::MachinesT repeated;
+    std::size_t machine_i = 0;
+    for (const auto& [_, machine] : machines) {
+        for (std::size_t copy_i = 0; copy_i < counts[machine_i]; copy_i++) {
+            auto copy = machine;
+            for (auto& input : copy.inputs) { input.uid = uid_pool.generate(); }
+            for (auto& output : copy.outputs) { output.uid = uid_pool.generate(); }
+            repeated[uid_pool.generate()] = std::move(copy);
+        }
+        machine_i++;
+    }
+    return repeated;
+}
+
+} // namespace fmk::sim
\ No newline at end of file
@@ -0,0 +1,163 @@
+#include "sim/module_summary.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <plog/Log.h>
+#include <utility>
+
+#include "sim/stop_condition.hpp"
+
+namespace fmk::sim {
+
+namespace {
+
+/// The windows to look for a steady state with. Factories usually repeat themselves with a period
+/// that is a multiple of the operation time of every machine, but blocked machines can make it a
+/// few times longer.
+std::vector<StopCondition> steady_state_conditions(const Factory& factory,
+                                                   std::size_t max_ticks) {
+    // Two windows are needed to compare them, so longer ones can't be met
+    std::size_t base_window = 1;
+    for (const auto& [_, machine] : factory.machines) {
+        const auto op_time =
+            static_cast<std::size_t>(std::max<TickCount>(machine.op_time.count(), 1));
+        base_window = std::lcm(base_window, op_time);
+        if (base_window * 2 > max_ticks) {
+            return {};
+        }
+    }
+
+    constexpr std::size_t max_multiple = 8;
+    std::vector<StopCondition> conditions;
+    for (std::size_t multiple = 1;
+         multiple <= max_multiple && base_window * multiple * 2 <= max_ticks; multiple++) {
+        conditions.emplace_back(StopCondition::steady_state(base_window * multiple));
+    }
+    return conditions;
+}
+
+} // namespace
+
+std::optional<ModuleSummary> summarize_module(std::string name,
+                                              const Factory& module,
+                                              std::size_t max_ticks,
+                                              util::JobProgress* progress) {
+    const auto conditions = steady_state_conditions(module, max_ticks);
+    if (conditions.empty()) {
+        PLOG_ERROR << "Module '" << name << "' can't repeat itself within " << max_ticks
+                   << " ticks";
+        return std::nullopt;
+    }
+    const auto cache = module.generate_cache(max_ticks, nullptr, conditions, progress);
+    if (cache.overflow() || cache.cancelled()) {
+        return std::nullopt;
+    }
+    const auto& stop = cache.stop();
+    if (!stop) {
+        PLOG_ERROR << "Module '" << name << "' didn't get to a steady state within " << max_ticks
+                   << " ticks";
+        return std::nullopt;
+    }
+
+    // The last two windows changed every stock the same, so the module was steady since the
+    // start of the first one
+    const auto window = conditions[stop->condition].window;
+    const auto end = stop->tick;
+    ModuleSummary summary{std::move(name), window, end + 1 - 2 * window, {}};
+
+    struct Boundary {
+        const Item& item;
+        util::QuantityPlot plot;
+    };
+    std::vector<Boundary> boundaries;
+    for (const auto& [item_uid, item] : module.items) {
+        if (item.type != Item::NodeType::Internal) {
+            boundaries.push_back(Boundary{item, cache.make_plot(item_uid)});
+        } else if (cache.quantity_at(item_uid, end) !=
+                   cache.quantity_at(item_uid, end - window)) {
+            PLOG_WARNING << "The stock of '" << item.name << "' keeps changing inside module '"
+                         << summary.name << "', which the module summary leaves out";
+        }
+    }
+    const auto change = [&](const Boundary& boundary, std::size_t from, std::size_t to) {
+        const auto values = boundary.plot.values();
+        return static_cast<std::int64_t>(values[to]) - values[from];
+    };
+
+    // The window is a multiple of the period, which is kept as short as possible so that the
+    // machine standing for the module isn't burstier than the module itself
+    const auto repeats_every = [&](std::size_t period) {
+        return std::all_of(boundaries.begin(), boundaries.end(), [&](const Boundary& boundary) {
+            const auto first = change(boundary, end - period, end);
+            for (auto span_end = end - period; span_end > end - window; span_end -= period) {
+                if (change(boundary, span_end - period, span_end) != first) {
+                    return false;
+                }
+            }
+            return true;
+        });
+    };
+    for (std::size_t period = 1; period < window; period++) {
+        if (window % period == 0 && repeats_every(period)) {
+            summary.period = period;
+            break;
+        }
+    }
+
+    for (const auto& boundary : boundaries) {
+        const auto per_period =
+            util::narrow<Quantity>(change(boundary, end - summary.period, end));
+        if (!per_period) {
+            PLOG_ERROR << "The stock of '" << boundary.item.name << "' changes too much in every "
+                       << "period of module '" << summary.name << "'";
+            return std::nullopt;
+        }
+        if (*per_period == 0) {
+            continue;
+        }
+
+        ModuleSummary::Flow flow{boundary.item.name, *per_period, {}};
+        flow.warmup.reserve(summary.warmup_ticks);
+        const auto values = boundary.plot.values();
+        for (std::size_t tick = 0; tick < summary.warmup_ticks; tick++) {
+            const auto warmup_change =
+                util::checked_sub(values[tick], boundary.item.starting_quantity);
+            if (!warmup_change) {
+                PLOG_ERROR << "The stock of '" << boundary.item.name << "' changes too much "
+                           << "during the warm-up of module '" << summary.name << "'";
+                return std::nullopt;
+            }
+            flow.warmup.emplace_back(*warmup_change);
+        }
+        summary.flows.emplace_back(std::move(flow));
+    }
+
+    return summary;
+}
+
+Uid embed_module(Factory& factory, UidPool& uid_pool, const ModuleSummary& summary) {
+    Machine machine{summary.name, {}, {}, util::ticks(static_cast<TickCount>(summary.period))};
+    for (const auto& flow : summary.flows) {
+        const bool is_consumed = flow.per_period < 0;
+        const auto item =
+            std::find_if(factory.items.begin(), factory.items.end(),
+                         [&](const auto& entry) { return entry.second.name == flow.item; });
+        Uid item_uid = item != factory.items.end() ? item->first : uid_pool.generate();
+        if (item == factory.items.end()) {
+            factory.items[item_uid] =
+                Item{is_consumed ? Item::NodeType::Input : Item::NodeType::Output, 0, flow.item,
+                     uid_pool.generate()};
+        }
+
+        auto& streams = is_consumed ? machine.inputs : machine.outputs;
+        streams.emplace_back(
+            ItemStream{item_uid, is_consumed ? -flow.per_period : flow.per_period,
+                       uid_pool.generate()});
+    }
+
+    const auto machine_uid = uid_pool.generate();
+    factory.machines[machine_uid] = std::move(machine);
+    return machine_uid;
+}
+
+} // namespace fmk::sim
\ No newline at end of file
@@ -0,0 +1,143 @@
+#include "sim/monte_carlo.hpp"
+
+#include <algorithm>
+#include <deque>
+#include <span>
+#include <vector>
+
+#include "sim/simulation.hpp"
+#include "util/background_job.hpp"
+#include "util/thread_pool.hpp"
+
+namespace fmk::sim {
+
+namespace {
+
+/// Bounds the quantities of all replicas kept between reductions to percentiles.
+constexpr std::size_t max_block_bytes = 64 * 1024 * 1024;
+constexpr std::size_t max_block_ticks = 256;
+
+/// Derives independent seeds for consecutive replicas from a single one (SplitMix64).
+std::uint64_t replica_seed(std::uint64_t seed, std::size_t replica) {
+    auto mixed = seed + (replica + 1) * 0x9e3779b97f4a7c15;
+    mixed = (mixed ^ (mixed >> 30)) * 0xbf58476d1ce4e5b9;
+    mixed = (mixed ^ (mixed >> 27)) * 0x94d049bb133111eb;
+    return mixed ^ (mixed >> 31);
+}
+
+/// The value at a percentile of `values`, which are reordered.
+Quantity percentile(std::span<Quantity> values, std::size_t percent) {
+    const auto rank = static_cast<std::ptrdiff_t>((values.size() - 1) * percent / 100);
+    std::nth_element(values.begin(), values.begin() + rank, values.end());
+    return values[static_cast<std::size_t>(rank)];
+}
+
+} // namespace
+
+MonteCarloResult run_monte_carlo(const Factory& factory,
+                                 std::size_t ticks_to_simulate,
+                                 std::size_t replicas,
+                                 std::uint64_t seed,
+                                 std::size_t worker_count,
+                                 util::JobProgress* progress) {
+    MonteCarloResult result;
+    result.replicas = replicas;
+    if (replicas == 0) {
+        return result;
+    }
+
+    std::deque<Simulation> simulations;
+    simulations.emplace_back(factory.items, factory.machines);
+    // Replicas of a factory without randomness are all the same
+    const auto simulated_replicas =
+        simulations.front().flat_factory().is_stochastic ? replicas : std::size_t(1);
+    while (simulations.size() < simulated_replicas) {
+        simulations.emplace_back(factory.items, factory.machines);
+    }
+    for (std::size_t replica = 0; replica < simulated_replicas; replica++) {
+        simulations[replica].randomize(replica_seed(seed, replica));
+    }
+
+    const auto item_count = simulations.front().flat_factory().item_count;
+    const auto tick_bytes =
+        std::max(simulated_replicas * item_count * sizeof(Quantity), std::size_t(1));
+    const auto block_ticks =
+        std::clamp(max_block_bytes / tick_bytes, std::size_t(1), max_block_ticks);
+    // The quantity of item `i` in replica `r` at the end of the `t`-th tick of the block is at
+    // `(r * block_ticks + t) * item_count + i`, so that every replica writes a contiguous range
+    std::vector<Quantity> block(simulated_replicas * block_ticks * item_count);
+    std::vector<char> overflowed(simulated_replicas, false);
+
+    struct Percentiles {
+        util::QuantityPlot::ContainerT low;
+        util::QuantityPlot::ContainerT median;
+        util::QuantityPlot::ContainerT high;
+    };
+    std::vector<Percentiles> percentiles(item_count);
+
+    util::ThreadPool pool(worker_count);
+    const auto is_cancelled = [progress] { return progress && progress->is_cancelled(); };
+    for (std::size_t start = 0; start < ticks_to_simulate; start += block_ticks) {
+        const auto length = std::min(block_ticks, ticks_to_simulate - start);
+
+        pool.parallel_for(simulated_replicas, [&](std::size_t first, std::size_t last) {
+            for (auto replica = first; replica < last; replica++) {
+                auto& simulation = simulations[replica];
+                auto* stocks = block.data() + replica * block_ticks * item_count;
+                for (std::size_t tick = 0; tick < length && !is_cancelled(); tick++) {
+                    if (!overflowed[replica] && !simulation.step()) {
+                        overflowed[replica] = true;
+                    }
+                    const auto stock = simulation.stock();
+                    std::copy(stock.begin(), stock.end(), stocks + tick * item_count);
+                }
+            }
+        });
+        // Ticks that only some replicas got to are left out
+        if (is_cancelled()) {
+            result.cancelled = true;
+            break;
+        }
+
+        pool.parallel_for(item_count, [&](std::size_t first, std::size_t last) {
+            std::vector<Quantity> values(simulated_replicas);
+            for (auto item_i = first; item_i < last; item_i++) {
+                auto& item_percentiles = percentiles[item_i];
+                for (std::size_t tick = 0; tick < length; tick++) {
+                    for (std::size_t replica = 0; replica < simulated_replicas; replica++) {
+                        values[replica] =
+                            block[(replica * block_ticks + tick) * item_count + item_i];
+                    }
+                    item_percentiles.low.emplace_back(
+                        percentile(values, MonteCarloResult::low_percentile));
+                    item_percentiles.median.emplace_back(percentile(values, 50));
+                    item_percentiles.high.emplace_back(
+                        percentile(values, MonteCarloResult::high_percentile));
+                }
+            }
+        });
+
+        result.ticks_simulated = start + length;
+        if (progress) {
+            progress->set_fraction(static_cast<float>(result.ticks_simulated) /
+                                   static_cast<float>(ticks_to_simulate));
+        }
+    }
+
+    const auto overflow_count =
+        static_cast<std::size_t>(std::count(overflowed.begin(), overflowed.end(), true));
+    result.overflowed_replicas = overflow_count * (replicas / simulated_replicas);
+    result.bands.reserve(item_count);
+    for (std::size_t item_i = 0; item_i < item_count; item_i++) {
+        auto& item_percentiles = percentiles[item_i];
+        result.bands.emplace(
+            simulations.front().item_uid(static_cast<std::uint32_t>(item_i)),
+            MonteCarloResult::Bands{
+                util::QuantityPlot::from_values(std::move(item_percentiles.low)),
+                util::QuantityPlot::from_values(std::move(item_percentiles.median)),
+                util::QuantityPlot::from_values(std::move(item_percentiles.high))});
+    }
+    return result;
+}
+
+} // namespace fmk::sim
\ No newline at end of file
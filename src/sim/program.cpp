@@ -0,0 +1,42 @@
+#include "sim/program.hpp"
+
+namespace fmk::sim {
+
+Program::Program(const FlatFactory& factory, std::pmr::memory_resource* resource) :
+    code(resource), start_entries(resource), finish_entries(resource) {
+    code.reserve(factory.required_columns * factory.machine_count +
+                 factory.input_streams.size() + factory.output_streams.size() +
+                 factory.machine_count * 2);
+    start_entries.reserve(factory.machine_count);
+    finish_entries.reserve(factory.machine_count);
+
+    for (std::size_t machine_i = 0; machine_i < factory.machine_count; machine_i++) {
+        const auto machine = static_cast<std::uint32_t>(machine_i);
+        start_entries.emplace_back(static_cast<std::uint32_t>(code.size()));
+
+        // The requirements are the same as the ones checked by `find_blocked_machines()`, so
+        // that machines not blocked at the start of the tick can only fail the ones on items
+        // taken by the machines before them
+        for (std::size_t column = 0; column < factory.required_columns; column++) {
+            const auto cell = column * factory.padded_machine_count + machine_i;
+            if (factory.required_items[cell] != factory.unlimited_item()) {
+                code.emplace_back(Instruction{Op::Require, factory.required_items[cell],
+                                              factory.required_quantities[cell]});
+            }
+        }
+        for (const auto& input : factory.inputs(machine_i)) {
+            const auto removed = util::checked_sub(Quantity(0), input.quantity);
+            code.emplace_back(removed ? Instruction{Op::Take, input.item, *removed}
+                                      : Instruction{Op::Overflow, input.item, 0});
+        }
+        code.emplace_back(Instruction{Op::Start, machine, factory.op_times[machine_i]});
+
+        finish_entries.emplace_back(static_cast<std::uint32_t>(code.size()));
+        for (const auto& output : factory.outputs(machine_i)) {
+            code.emplace_back(Instruction{Op::Give, output.item, output.quantity});
+        }
+        code.emplace_back(Instruction{Op::Finish, machine, 0});
+    }
+}
+
+} // namespace fmk::sim
\ No newline at end of file
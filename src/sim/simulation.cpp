@@ -0,0 +1,341 @@
+#include "sim/simulation.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fmt/core.h>
+#include <limits>
+
+#include "util/arena.hpp"
+
+namespace fmk::sim {
+
+Simulation::Simulation(const Factory::ItemsT& items,
+                       const Factory::MachinesT& machines,
+                       std::pmr::memory_resource* resource,
+                       Engine engine) :
+    items(items),
+    flat(items, machines, resource),
+    engine(engine),
+    program(flat, resource),
+    _stock(flat.item_count + 1, 0, resource),
+    tasks(resource),
+    busy_machines(flat.machine_count, false, resource),
+    blocked_machines(flat.padded_machine_count, 0, resource),
+    _changes(resource) {
+    std::size_t item_i = 0;
+    for (const auto& [_, item] : items) { _stock[item_i++] = item.starting_quantity; }
+}
+
+bool Simulation::change_stock(std::uint32_t item_i, Quantity modifier) {
+    const auto new_stock = util::checked_add(_stock[item_i], modifier);
+    if (!new_stock) {
+        _overflow = Factory::Cache::Overflow{item_uid(item_i), _tick};
+        return false;
+    }
+    _stock[item_i] = *new_stock;
+    _changes.emplace_back(StockChange{item_i, modifier});
+    return true;
+}
+
+TickCount Simulation::sample_op_time(std::uint32_t machine_i) {
+    constexpr auto max_op_time = static_cast<double>(std::numeric_limits<TickCount>::max());
+    const std::int64_t op_time = flat.op_times[machine_i];
+    const std::int64_t spread = flat.op_time_distributions[machine_i].spread.count();
+    if (spread <= 0) {
+        return flat.op_times[machine_i];
+    }
+    double sampled = static_cast<double>(op_time);
+    switch (flat.op_time_distributions[machine_i].type) {
+        case OpTimeDistribution::Type::Fixed: break;
+        case OpTimeDistribution::Type::Uniform: {
+            sampled = static_cast<double>(std::uniform_int_distribution<std::int64_t>(
+                op_time - spread, op_time + spread)(*rng));
+        } break;
+        case OpTimeDistribution::Type::Normal: {
+            sampled = std::round(std::normal_distribution<double>(
+                static_cast<double>(op_time), static_cast<double>(spread))(*rng));
+        } break;
+    }
+    return static_cast<TickCount>(std::clamp(sampled, 1., max_op_time));
+}
+
+bool Simulation::sample_output(std::size_t stream_i) {
+    const auto probability = flat.output_probabilities[stream_i];
+    return probability >= 1.f || std::uniform_real_distribution<float>()(*rng) < probability;
+}
+
+bool Simulation::step() {
+    if (_overflow) {
+        return false;
+    }
+    _changes.clear();
+    if (!(engine == Engine::Compiled ? run_compiled_tick() : run_reference_tick())) {
+        return false;
+    }
+    _tick++;
+    return true;
+}
+
+bool Simulation::run_compiled_tick() {
+    using Op = Program::Op;
+    const auto* code = program.code.data();
+
+    tasks.advance_to(_tick, [&](std::uint32_t machine_i) {
+        auto stream_i = static_cast<std::size_t>(flat.output_offsets[machine_i]);
+        for (auto pc = program.finish_entries[machine_i];; pc++) {
+            const auto& instruction = code[pc];
+            if (instruction.op == Op::Finish) {
+                busy_machines[machine_i] = false;
+                return;
+            }
+            if (rng && !sample_output(stream_i++)) {
+                continue;
+            }
+            if (_overflow || !change_stock(instruction.item, instruction.quantity)) {
+                return;
+            }
+        }
+    });
+    if (_overflow) {
+        return false;
+    }
+
+    find_blocked_machines(flat, _stock, blocked_machines);
+
+    // Same as in `run_reference_tick()`, but each machine that isn't skipped runs its requirement
+    // checks, removals and scheduling straight from its instructions
+    bool stock_increased = false;
+    for (std::uint32_t machine_i = 0; machine_i < flat.machine_count; machine_i++) {
+        if (busy_machines[machine_i] || (blocked_machines[machine_i] && !stock_increased)) {
+            continue;
+        }
+
+        auto pc = program.start_entries[machine_i];
+        while (code[pc].op == Op::Require && _stock[code[pc].item] >= code[pc].quantity) {
+            pc++;
+        }
+        if (code[pc].op == Op::Require) {
+            continue;
+        }
+
+        for (; code[pc].op != Op::Start; pc++) {
+            const auto& instruction = code[pc];
+            if (instruction.op == Op::Overflow) {
+                _overflow = Factory::Cache::Overflow{item_uid(instruction.item), _tick};
+                return false;
+            }
+            if (!change_stock(instruction.item, instruction.quantity)) {
+                return false;
+            }
+            stock_increased = stock_increased || instruction.quantity > 0;
+        }
+
+        const auto op_time =
+            std::max(rng ? sample_op_time(machine_i) : code[pc].quantity, TickCount(1));
+        tasks.schedule(_tick + static_cast<std::size_t>(op_time), machine_i);
+        busy_machines[machine_i] = true;
+    }
+    return true;
+}
+
+bool Simulation::run_reference_tick() {
+    // Add the outputs of the tasks finished at this tick, freeing their machines
+    tasks.advance_to(_tick, [&](std::uint32_t machine_i) {
+        auto stream_i = static_cast<std::size_t>(flat.output_offsets[machine_i]);
+        for (const auto& output : flat.outputs(machine_i)) {
+            if (rng && !sample_output(stream_i++)) {
+                continue;
+            }
+            if (_overflow || !change_stock(output.item, output.quantity)) {
+                return;
+            }
+        }
+        busy_machines[machine_i] = false;
+    });
+    if (_overflow) {
+        return false;
+    }
+
+    // Check which machines can do a processing cycle with the stock they start the tick with
+    find_blocked_machines(flat, _stock, blocked_machines);
+
+    // Machines only take items during the tick, so blocked machines stay blocked unless one
+    // takes a negative quantity
+    bool stock_increased = false;
+    for (std::uint32_t machine_i = 0; machine_i < flat.machine_count; machine_i++) {
+        // Check if this machine is not currently busy with a previous cycle, and if it still
+        // has its inputs after the machines before it took theirs
+        if (busy_machines[machine_i] || (blocked_machines[machine_i] && !stock_increased) ||
+            !flat.can_start(machine_i, _stock)) {
+            continue;
+        }
+
+        // Remove items required
+        for (const auto& input : flat.inputs(machine_i)) {
+            const auto removed = util::checked_sub(Quantity(0), input.quantity);
+            if (!removed) {
+                _overflow = Factory::Cache::Overflow{item_uid(input.item), _tick};
+            }
+            if (!removed || !change_stock(input.item, *removed)) {
+                return false;
+            }
+            stock_increased = stock_increased || input.quantity < 0;
+        }
+
+        // Add processing task, which is finished at the earliest on the next tick
+        const auto op_time =
+            std::max(rng ? sample_op_time(machine_i) : flat.op_times[machine_i], TickCount(1));
+        tasks.schedule(_tick + static_cast<std::size_t>(op_time), machine_i);
+        busy_machines[machine_i] = true;
+    }
+    return true;
+}
+
+StopConditionChecker::StopConditionChecker(std::span<const StopCondition> conditions,
+                                           const Simulation& simulation,
+                                           std::pmr::memory_resource* resource) :
+    conditions(conditions),
+    item_offsets(simulation.flat_factory().item_count + 1, 0, resource),
+    item_conditions(resource),
+    steady_states(resource) {
+    const auto& flat = simulation.flat_factory();
+
+    // The conditions of every item are stored like the rows of `ItemGraph`: counted first, then
+    // filled in back to front
+    const auto for_each_watched_item = [&](const StopCondition& condition, const auto& visit) {
+        switch (condition.type) {
+            case StopCondition::Type::Reaches:
+            case StopCondition::Type::DropsTo: {
+                visit(flat.item_index(condition.item));
+            } break;
+
+            case StopCondition::Type::AnyBufferDropsTo: {
+                for (std::uint32_t item_i = 0; item_i < flat.item_count; item_i++) {
+                    if (simulation.item(item_i).type == Item::NodeType::Internal) {
+                        visit(item_i);
+                    }
+                }
+            } break;
+
+            case StopCondition::Type::SteadyState: break;
+        }
+    };
+    for (const auto& condition : conditions) {
+        for_each_watched_item(condition, [&](std::uint32_t item_i) { item_offsets[item_i]++; });
+    }
+    std::uint32_t total = 0;
+    for (auto& offset : item_offsets) {
+        total += offset;
+        offset = total;
+    }
+    item_conditions.resize(total);
+    for (std::size_t condition_i = conditions.size(); condition_i-- > 0;) {
+        for_each_watched_item(conditions[condition_i], [&](std::uint32_t item_i) {
+            item_conditions[--item_offsets[item_i]] = static_cast<std::uint32_t>(condition_i);
+        });
+    }
+
+    for (std::size_t condition_i = 0; condition_i < conditions.size(); condition_i++) {
+        const auto& condition = conditions[condition_i];
+        if (condition.type == StopCondition::Type::SteadyState) {
+            const auto stock = simulation.stock();
+            steady_states.emplace_back(Steadiness{
+                condition_i, std::max(condition.window, std::size_t(1)),
+                std::pmr::vector<Quantity>(stock.begin(), stock.end(), resource),
+                std::pmr::vector<std::uint64_t>(stock.size(), 0, resource)});
+        }
+    }
+}
+
+bool StopConditionChecker::is_met(const StopCondition& condition, Quantity stock) const {
+    return condition.type == StopCondition::Type::Reaches ? stock >= condition.threshold
+                                                          : stock <= condition.threshold;
+}
+
+std::optional<StopResult> StopConditionChecker::check(const Simulation& simulation) {
+    const auto tick = simulation.tick() - 1;
+    const auto stock = simulation.stock();
+    std::optional<StopResult> result;
+    const auto meet = [&](std::size_t condition_i, Uid item) {
+        if (!result || condition_i < result->condition) {
+            result = StopResult{condition_i, tick, item};
+        }
+    };
+
+    // Only the items that changed can have met a condition. The stock is checked as it is at the
+    // end of the tick, even if the item changed several times during it.
+    for (const auto& change : simulation.changes()) {
+        for (auto offset = item_offsets[change.item]; offset < item_offsets[change.item + 1];
+             offset++) {
+            const auto condition_i = item_conditions[offset];
+            if (is_met(conditions[condition_i], stock[change.item])) {
+                meet(condition_i, simulation.item_uid(change.item));
+            }
+        }
+    }
+
+    for (auto& steadiness : steady_states) {
+        if (simulation.tick() % steadiness.window != 0) {
+            continue;
+        }
+
+        // Compare the change of every item during the window that just ended with the previous one
+        bool is_steady = steadiness.has_previous_change;
+        for (std::size_t item_i = 0; item_i < stock.size(); item_i++) {
+            // Differences are computed with wrapping arithmetic, so that they never overflow
+            const auto change = static_cast<std::uint64_t>(stock[item_i]) -
+                                static_cast<std::uint64_t>(steadiness.window_start[item_i]);
+            is_steady = is_steady && change == steadiness.previous_change[item_i];
+            steadiness.previous_change[item_i] = change;
+            steadiness.window_start[item_i] = stock[item_i];
+        }
+        steadiness.has_previous_change = true;
+        if (is_steady) {
+            meet(steadiness.condition, Uid(Uid::INVALID_VALUE));
+        }
+    }
+
+    return result;
+}
+
+std::optional<StopResult> find_stop(const Factory& factory,
+                                    std::span<const StopCondition> conditions,
+                                    std::size_t max_ticks,
+                                    util::JobProgress* progress) {
+    util::Arena arena;
+    Simulation simulation(factory.items, factory.machines, &arena);
+    StopConditionChecker checker(conditions, simulation, &arena);
+    while (simulation.tick() < max_ticks && simulation.report_progress(progress, max_ticks) &&
+           simulation.step()) {
+        if (const auto result = checker.check(simulation)) {
+            return result;
+        }
+    }
+    return std::nullopt;
+}
+
+std::string describe_stop(const Factory& factory,
+                          const StopCondition& condition,
+                          const StopResult& result) {
+    // The condition is met at the end of the tick, so that tick is counted in the time taken
+    const std::chrono::duration<double> time =
+        std::chrono::duration<double, util::ticks::period>(static_cast<double>(result.tick + 1));
+    const auto when = fmt::format("at tick {} ({:.2f} s)", result.tick, time.count());
+    const auto item = factory.items.find(result.item);
+    const auto item_name = item != factory.items.end() ? item->second.name : "?";
+
+    switch (condition.type) {
+        case StopCondition::Type::Reaches:
+            return fmt::format("'{}' reached {} {}", item_name, condition.threshold, when);
+        case StopCondition::Type::DropsTo:
+        case StopCondition::Type::AnyBufferDropsTo:
+            return fmt::format("'{}' dropped to {} {}", item_name, condition.threshold, when);
+        case StopCondition::Type::SteadyState:
+            return fmt::format("Steady state with a period of {} ticks reached {}",
+                               condition.window, when);
+    }
+    return when;
+}
+
+} // namespace fmk::sim
\ No newline at end of file
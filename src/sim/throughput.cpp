@@ -0,0 +1,87 @@
+#include "sim/throughput.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#include "sim/simulation.hpp"
+
+namespace fmk::sim {
+
+namespace {
+
+using TotalT = std::make_unsigned_t<Quantity>;
+
+/// `a - b`, wrapping around like the running totals do.
+Quantity wrapping_sub(Quantity a, Quantity b) {
+    return static_cast<Quantity>(static_cast<TotalT>(a) - static_cast<TotalT>(b));
+}
+
+} // namespace
+
+std::vector<ThroughputSeries> simulate_throughput(const Factory& factory,
+                                                  std::size_t ticks,
+                                                  std::span<const Uid> items,
+                                                  std::size_t window,
+                                                  util::JobProgress* progress) {
+    window = std::max<std::size_t>(window, 1);
+    constexpr auto no_series = std::numeric_limits<std::uint32_t>::max();
+    std::vector<std::uint32_t> series_of(factory.items.size(), no_series);
+    std::vector<ThroughputSeries> series;
+    series.reserve(items.size());
+    for (const auto& item_uid : items) {
+        const auto item_i = factory.items.find(item_uid) - factory.items.begin();
+        series_of[static_cast<std::size_t>(item_i)] = static_cast<std::uint32_t>(series.size());
+        series.emplace_back(ThroughputSeries{item_uid, window, std::vector<Quantity>(ticks + 1),
+                                             std::vector<Quantity>(ticks + 1), {}});
+    }
+
+    // The totals wrap around instead of overflowing, which keeps the differences between them
+    // right. They are stored in the series, and turned into the quantities of the windows after.
+    Simulation simulation(factory.items, factory.machines);
+    std::vector<TotalT> produced(series.size(), 0);
+    std::vector<TotalT> consumed(series.size(), 0);
+    bool overflowed = false;
+    for (std::size_t tick = 0; tick <= ticks; tick++) {
+        // Like in plots, the changes made before an overflow are kept and the totals hold after
+        if (tick < ticks && !overflowed) {
+            if (!simulation.report_progress(progress, ticks)) {
+                return {};
+            }
+            overflowed = !simulation.step();
+            for (const auto& change : simulation.changes()) {
+                const auto series_i = series_of[change.item];
+                if (series_i == no_series) {
+                    continue;
+                }
+                if (change.modifier > 0) {
+                    produced[series_i] += static_cast<TotalT>(change.modifier);
+                } else {
+                    consumed[series_i] -= static_cast<TotalT>(change.modifier);
+                }
+            }
+        }
+        for (std::size_t series_i = 0; series_i < series.size(); series_i++) {
+            series[series_i].produced[tick] = static_cast<Quantity>(produced[series_i]);
+            series[series_i].consumed[tick] = static_cast<Quantity>(consumed[series_i]);
+        }
+    }
+
+    // Going backwards, the totals at the start of every window are still there when needed
+    for (auto& item_series : series) {
+        item_series.net.resize(ticks + 1);
+        for (std::size_t tick = ticks + 1; tick-- > 0;) {
+            if (tick >= window) {
+                item_series.produced[tick] = wrapping_sub(item_series.produced[tick],
+                                                          item_series.produced[tick - window]);
+                item_series.consumed[tick] = wrapping_sub(item_series.consumed[tick],
+                                                          item_series.consumed[tick - window]);
+            }
+            item_series.net[tick] =
+                wrapping_sub(item_series.produced[tick], item_series.consumed[tick]);
+        }
+    }
+    return series;
+}
+
+} // namespace fmk::sim
\ No newline at end of file
@@ -5,15 +5,26 @@
 namespace fmk {
 
 Uid UidPool::generate() {
+    if (!released.empty()) {
+        const Uid to_return = released.back();
+        released.pop_back();
+        return to_return;
+    }
+
     Uid to_return = next_uid;
     next_uid.value++;
     return to_return;
 }
 
+void UidPool::release(Uid uid) {
+    if (uid.value != Uid::INVALID_VALUE) {
+        released.emplace_back(uid);
+    }
+}
+
 std::size_t UidPool::available() const {
-    return static_cast<std::size_t>(std::numeric_limits<int>::max()) * 2 -
-           (static_cast<std::int64_t>(next_uid.value) +
-            static_cast<std::int64_t>(std::numeric_limits<int>::max()));
+    return static_cast<std::size_t>(std::numeric_limits<Uid::ValueT>::max() - next_uid.value) +
+           released.size();
 }
 
 } // namespace fmk
\ No newline at end of file
@@ -0,0 +1,70 @@
+#include "util/arena.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+namespace fmk::util {
+
+Arena::Arena(std::size_t initial_chunk_size) : _next_chunk_size(initial_chunk_size) {}
+
+void Arena::reset() {
+    if (_chunks.size() > 1) {
+        const auto total_size = bytes_reserved();
+        _chunks.clear();
+        add_chunk(total_size);
+    }
+    _current_chunk = 0;
+    _offset = 0;
+}
+
+std::size_t Arena::bytes_reserved() const {
+    std::size_t total_size = 0;
+    for (const auto& chunk : _chunks) { total_size += chunk.size; }
+    return total_size;
+}
+
+void* Arena::do_allocate(std::size_t bytes, std::size_t alignment) {
+    while (true) {
+        if (_current_chunk < _chunks.size()) {
+            auto& chunk = _chunks[_current_chunk];
+            const auto address = reinterpret_cast<std::uintptr_t>(chunk.data.get()) + _offset;
+            const auto padding = (alignment - address % alignment) % alignment;
+            if (_offset + padding + bytes <= chunk.size) {
+                _offset += padding + bytes;
+                return chunk.data.get() + (_offset - bytes);
+            }
+            // Leave the rest of this chunk unused; the next one might be big enough
+            if (_current_chunk + 1 < _chunks.size()) {
+                _current_chunk++;
+                _offset = 0;
+                continue;
+            }
+        }
+
+        add_chunk(bytes + alignment);
+        _current_chunk = _chunks.size() - 1;
+        _offset = 0;
+    }
+}
+
+void Arena::add_chunk(std::size_t min_size) {
+    const auto size = std::max(_next_chunk_size, min_size);
+    _chunks.emplace_back(Chunk{std::unique_ptr<std::byte[]>(new std::byte[size]), size});
+    _next_chunk_size = size * 2;
+    _heap_allocations++;
+}
+
+std::shared_ptr<Arena> ArenaPool::acquire() {
+    for (const auto& arena : _arenas) {
+        if (arena.use_count() == 1) {
+            // Synchronizes with the thread that released the arena last
+            std::atomic_thread_fence(std::memory_order_acquire);
+            arena->reset();
+            return arena;
+        }
+    }
+    return _arenas.emplace_back(std::make_shared<Arena>());
+}
+
+} // namespace fmk::util
\ No newline at end of file
@@ -0,0 +1,29 @@
+#include "util/heap_stats.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+std::atomic<std::size_t> allocation_count = 0;
+
+} // namespace
+
+namespace fmk::util {
+
+std::size_t heap_allocation_count() { return allocation_count.load(std::memory_order_relaxed); }
+
+} // namespace fmk::util
+
+// The array and nothrow versions call these ones
+void* operator new(std::size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
\ No newline at end of file
@@ -0,0 +1,222 @@
+#include "util/linear_program.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+
+namespace fmk::util {
+
+namespace {
+
+constexpr double epsilon = 1e-9;
+
+/// The constraints in the form `A x = b` with `b >= 0`, where `x` has a slack variable for every
+/// inequality and an artificial one for every constraint without a slack to start the basis with.
+/// The last row holds the reduced costs of the objective being minimized.
+class Tableau {
+public:
+    Tableau(std::size_t row_count, std::size_t column_count) :
+        row_count(row_count),
+        column_count(column_count),
+        cells((row_count + 1) * (column_count + 1), 0.),
+        basis(row_count) {}
+
+    double& at(std::size_t row, std::size_t column) {
+        return cells[row * (column_count + 1) + column];
+    }
+    double& rhs(std::size_t row) { return at(row, column_count); }
+    double& cost(std::size_t column) { return at(row_count, column); }
+
+    /// Sets the objective row to the reduced costs of `costs` for the current basis.
+    void set_costs(const std::vector<double>& costs) {
+        for (std::size_t column = 0; column <= column_count; column++) {
+            cost(column) = column < costs.size() ? costs[column] : 0.;
+        }
+        for (std::size_t row = 0; row < row_count; row++) {
+            const auto basic_cost = basis[row] < costs.size() ? costs[basis[row]] : 0.;
+            if (basic_cost != 0.) {
+                for (std::size_t column = 0; column <= column_count; column++) {
+                    cost(column) -= basic_cost * at(row, column);
+                }
+            }
+        }
+    }
+
+    /// Makes `column` basic in `row`.
+    void pivot(std::size_t row, std::size_t column) {
+        const auto pivot_value = at(row, column);
+        for (std::size_t other = 0; other <= column_count; other++) {
+            at(row, other) /= pivot_value;
+        }
+        for (std::size_t other_row = 0; other_row <= row_count; other_row++) {
+            const auto factor = at(other_row, column);
+            if (other_row == row || factor == 0.) {
+                continue;
+            }
+            for (std::size_t other = 0; other <= column_count; other++) {
+                at(other_row, other) -= factor * at(row, other);
+            }
+            at(other_row, column) = 0.;
+        }
+        basis[row] = column;
+    }
+
+    /// Pivots until no column below `entering_limit` can lower the objective.
+    LinearSolution::Status minimize(std::size_t entering_limit) {
+        const auto max_iterations = 50 * (row_count + column_count) + 1000;
+        bool was_degenerate = false;
+        for (std::size_t iteration = 0; iteration < max_iterations; iteration++) {
+            // The most negative reduced cost, or the first negative one after a degenerate pivot
+            std::size_t entering = column_count;
+            for (std::size_t column = 0; column < entering_limit; column++) {
+                if (cost(column) < -epsilon &&
+                    (entering == column_count ||
+                     (!was_degenerate && cost(column) < cost(entering)))) {
+                    entering = column;
+                    if (was_degenerate) {
+                        break;
+                    }
+                }
+            }
+            if (entering == column_count) {
+                return LinearSolution::Status::Optimal;
+            }
+
+            // The row that limits the entering variable the most, breaking ties by lowest basic
+            // variable as Bland's rule does
+            std::size_t leaving = row_count;
+            double leaving_ratio = std::numeric_limits<double>::infinity();
+            for (std::size_t row = 0; row < row_count; row++) {
+                if (at(row, entering) <= epsilon) {
+                    continue;
+                }
+                const auto ratio = rhs(row) / at(row, entering);
+                if (ratio < leaving_ratio - epsilon ||
+                    (ratio <= leaving_ratio + epsilon && basis[row] < basis[leaving])) {
+                    leaving = row;
+                    leaving_ratio = ratio;
+                }
+            }
+            if (leaving == row_count) {
+                return LinearSolution::Status::Unbounded;
+            }
+            was_degenerate = leaving_ratio <= epsilon;
+            pivot(leaving, entering);
+        }
+        return LinearSolution::Status::IterationLimit;
+    }
+
+    std::size_t row_count;
+    std::size_t column_count;
+    std::vector<double> cells;
+    /// The variable that is basic in every row.
+    std::vector<std::size_t> basis;
+};
+
+} // namespace
+
+LinearSolution solve_linear_program(const LinearProgram& program) {
+    using Relation = LinearProgram::Constraint::Relation;
+    const auto variable_count = program.objective.size();
+    const auto row_count = program.constraints.size();
+
+    // Rows with a negative bound are negated, which turns their inequality around
+    std::vector<Relation> relations;
+    std::size_t slack_count = 0;
+    std::size_t artificial_count = 0;
+    for (const auto& constraint : program.constraints) {
+        auto relation = constraint.relation;
+        if (constraint.bound < 0 && relation != Relation::Equal) {
+            relation = relation == Relation::LessEqual ? Relation::GreaterEqual
+                                                       : Relation::LessEqual;
+        }
+        relations.emplace_back(relation);
+        slack_count += relation != Relation::Equal;
+        artificial_count += relation != Relation::LessEqual;
+    }
+
+    const auto slack_start = variable_count;
+    const auto artificial_start = slack_start + slack_count;
+    Tableau tableau(row_count, artificial_start + artificial_count);
+    std::size_t slack = slack_start;
+    std::size_t artificial = artificial_start;
+    for (std::size_t row = 0; row < row_count; row++) {
+        const auto& constraint = program.constraints[row];
+        const double sign = constraint.bound < 0 ? -1. : 1.;
+        for (const auto& term : constraint.terms) {
+            tableau.at(row, term.variable) += sign * term.coefficient;
+        }
+        tableau.rhs(row) = sign * constraint.bound;
+
+        switch (relations[row]) {
+            case Relation::LessEqual: {
+                tableau.at(row, slack) = 1.;
+                tableau.basis[row] = slack++;
+            } break;
+            case Relation::GreaterEqual: {
+                tableau.at(row, slack++) = -1.;
+                tableau.at(row, artificial) = 1.;
+                tableau.basis[row] = artificial++;
+            } break;
+            case Relation::Equal: {
+                tableau.at(row, artificial) = 1.;
+                tableau.basis[row] = artificial++;
+            } break;
+        }
+    }
+
+    LinearSolution solution;
+    // Phase 1 finds a feasible basis by minimizing the sum of the artificial variables
+    if (artificial_count > 0) {
+        std::vector<double> artificial_costs(tableau.column_count, 0.);
+        std::fill(artificial_costs.begin() + static_cast<std::ptrdiff_t>(artificial_start),
+                  artificial_costs.end(), 1.);
+        tableau.set_costs(artificial_costs);
+        solution.status = tableau.minimize(tableau.column_count);
+        if (solution.status != LinearSolution::Status::Optimal) {
+            return solution;
+        }
+        double bound_scale = 1.;
+        for (const auto& constraint : program.constraints) {
+            bound_scale = std::max(bound_scale, std::abs(constraint.bound));
+        }
+        if (-tableau.cost(tableau.column_count) > 1e-7 * bound_scale) {
+            solution.status = LinearSolution::Status::Infeasible;
+            return solution;
+        }
+
+        // Artificial variables left in the basis are 0, and are swapped for any other variable
+        // of their row. Rows with none are redundant, and never pivoted on again.
+        for (std::size_t row = 0; row < row_count; row++) {
+            if (tableau.basis[row] < artificial_start) {
+                continue;
+            }
+            for (std::size_t column = 0; column < artificial_start; column++) {
+                if (std::abs(tableau.at(row, column)) > epsilon) {
+                    tableau.pivot(row, column);
+                    break;
+                }
+            }
+        }
+    }
+
+    // Phase 2 minimizes the objective without letting artificial variables back in
+    tableau.set_costs(program.objective);
+    solution.status = tableau.minimize(artificial_start);
+    if (solution.status != LinearSolution::Status::Optimal) {
+        return solution;
+    }
+    solution.values.assign(variable_count, 0.);
+    for (std::size_t row = 0; row < row_count; row++) {
+        if (tableau.basis[row] < variable_count) {
+            solution.values[tableau.basis[row]] = tableau.rhs(row);
+        }
+    }
+    for (std::size_t variable = 0; variable < variable_count; variable++) {
+        solution.objective += program.objective[variable] * solution.values[variable];
+    }
+    return solution;
+}
+
+} // namespace fmk::util
\ No newline at end of file
@@ -0,0 +1,87 @@
+#include "util/mapped_file.hpp"
+
+#ifdef _WIN32
+#    define WIN32_LEAN_AND_MEAN
+#    include <windows.h>
+#else
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+namespace fmk::util {
+
+#ifdef _WIN32
+
+std::shared_ptr<const MappedFile> MappedFile::open(const std::filesystem::path& path) {
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return nullptr;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return nullptr;
+    }
+
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!mapping)
+        return nullptr;
+
+    const void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!data) {
+        CloseHandle(mapping);
+        return nullptr;
+    }
+
+    std::shared_ptr<MappedFile> result(new MappedFile());
+    result->_data = static_cast<const std::byte*>(data);
+    result->_size = static_cast<std::size_t>(size.QuadPart);
+    result->_mapping_handle = mapping;
+    return result;
+}
+
+MappedFile::~MappedFile() {
+    if (_data)
+        UnmapViewOfFile(_data);
+    if (_mapping_handle)
+        CloseHandle(_mapping_handle);
+}
+
+#else
+
+std::shared_ptr<const MappedFile> MappedFile::open(const std::filesystem::path& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+        return nullptr;
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) == -1 || file_stat.st_size == 0) {
+        ::close(fd);
+        return nullptr;
+    }
+
+    const auto size = static_cast<std::size_t>(file_stat.st_size);
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping stays valid after closing its file descriptor
+    ::close(fd);
+    if (data == MAP_FAILED)
+        return nullptr;
+
+    std::shared_ptr<MappedFile> result(new MappedFile());
+    result->_data = static_cast<const std::byte*>(data);
+    result->_size = size;
+    return result;
+}
+
+MappedFile::~MappedFile() {
+    if (_data)
+        munmap(const_cast<std::byte*>(_data), _size);
+}
+
+#endif
+
+} // namespace fmk::util
\ No newline at end of file
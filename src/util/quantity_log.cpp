@@ -0,0 +1,109 @@
+#include "util/quantity_log.hpp"
+
+#include <algorithm>
+
+namespace fmk::util {
+
+QuantityLog::QuantityLog(Quantity starting_value, std::pmr::memory_resource* resource) :
+    starting_value(starting_value), ticks(resource), values(resource) {}
+
+void QuantityLog::record(std::size_t tick, Quantity value) {
+    if (dense) {
+        const auto last = values.empty() ? starting_value : values.back();
+        if (values.size() > tick) {
+            values.back() = value;
+        } else {
+            values.resize(tick, last);
+            values.emplace_back(value);
+        }
+        return;
+    }
+
+    if (!ticks.empty() && ticks.back() == tick) {
+        values.back() = value;
+        return;
+    }
+    ticks.emplace_back(static_cast<TickT>(tick));
+    values.emplace_back(value);
+
+    if (ticks.size() * (sizeof(TickT) + sizeof(Quantity)) > (tick + 1) * sizeof(Quantity)) {
+        densify();
+    }
+}
+
+void QuantityLog::densify() {
+    std::pmr::vector<Quantity> every_tick(values.get_allocator());
+    every_tick.reserve(static_cast<std::size_t>(ticks.back()) + 1);
+    auto last = starting_value;
+    for (std::size_t change_i = 0; change_i < ticks.size(); change_i++) {
+        every_tick.resize(ticks[change_i], last);
+        last = values[change_i];
+        every_tick.emplace_back(last);
+    }
+
+    values = std::move(every_tick);
+    ticks.clear();
+    ticks.shrink_to_fit();
+    dense = true;
+}
+
+Quantity QuantityLog::value_at(std::size_t tick) const {
+    if (dense) {
+        return values.empty() ? starting_value : values[std::min(tick, values.size() - 1)];
+    }
+
+    const auto next_change = std::upper_bound(ticks.begin(), ticks.end(), tick);
+    return next_change == ticks.begin() ? starting_value
+                                        : values[next_change - ticks.begin() - 1];
+}
+
+Quantity QuantityLog::max_value() const {
+    // The starting value only shows up if the value didn't change at the first tick
+    const bool has_starting_value = dense ? values.empty() : ticks.empty() || ticks.front() > 0;
+    const auto max = std::max_element(values.begin(), values.end());
+    if (max == values.end()) {
+        return starting_value;
+    }
+    return has_starting_value ? std::max(*max, starting_value) : *max;
+}
+
+void QuantityLog::copy_values(std::size_t first_tick, std::span<Quantity> out) const {
+    if (dense) {
+        for (std::size_t value_i = 0; value_i < out.size(); value_i++) {
+            out[value_i] = value_at(first_tick + value_i);
+        }
+        return;
+    }
+
+    auto next_change = std::upper_bound(ticks.begin(), ticks.end(), first_tick);
+    auto value = next_change == ticks.begin() ? starting_value
+                                              : values[next_change - ticks.begin() - 1];
+    for (std::size_t value_i = 0; value_i < out.size(); value_i++) {
+        for (; next_change != ticks.end() && *next_change <= first_tick + value_i; next_change++) {
+            value = values[next_change - ticks.begin()];
+        }
+        out[value_i] = value;
+    }
+}
+
+QuantityPlot QuantityLog::to_plot(std::size_t length, std::pmr::memory_resource* resource) const {
+    QuantityPlot::ContainerT plot_values(resource);
+    plot_values.reserve(length);
+    if (dense) {
+        plot_values.assign(values.begin(),
+                           values.begin() + static_cast<std::ptrdiff_t>(
+                                                std::min(length, values.size())));
+    } else {
+        auto last = starting_value;
+        for (std::size_t change_i = 0; change_i < ticks.size() && ticks[change_i] < length;
+             change_i++) {
+            plot_values.resize(ticks[change_i], last);
+            last = values[change_i];
+            plot_values.emplace_back(last);
+        }
+    }
+    plot_values.resize(length, plot_values.empty() ? starting_value : plot_values.back());
+    return QuantityPlot::from_values(std::move(plot_values));
+}
+
+} // namespace fmk::util
\ No newline at end of file
@@ -1,14 +1,63 @@
 #include "util/quantity_plot.hpp"
 
+#include <algorithm>
+
 namespace fmk::util {
 
-QuantityPlot::QuantityPlot(std::size_t capacity) { _container.reserve(capacity); }
-QuantityPlot::QuantityPlot(std::size_t capacity, int starting_val) {
+template<typename T>
+BasicQuantityPlot<T>::BasicQuantityPlot(std::size_t capacity,
+                                        std::pmr::memory_resource* resource) :
+    _container(resource) {
+    _container.reserve(capacity);
+}
+template<typename T>
+BasicQuantityPlot<T>::BasicQuantityPlot(std::size_t capacity,
+                                        T starting_val,
+                                        std::pmr::memory_resource* resource) :
+    _container(resource) {
     _container.reserve(capacity);
     _container.emplace_back(starting_val);
 }
 
-void QuantityPlot::change_value(std::size_t tick, int mod) {
+template<typename T>
+BasicQuantityPlot<T> BasicQuantityPlot<T>::view(std::span<const T> values,
+                                                T max_value,
+                                                std::shared_ptr<const void> backing) {
+    BasicQuantityPlot plot;
+    plot._view = values;
+    plot._backing = std::move(backing);
+    const auto max_it = std::find(values.begin(), values.end(), max_value);
+    if (max_it != values.end()) {
+        plot._max_value_i = static_cast<std::size_t>(max_it - values.begin());
+    }
+    return plot;
+}
+
+template<typename T> BasicQuantityPlot<T> BasicQuantityPlot<T>::copy_of(std::span<const T> values) {
+    BasicQuantityPlot plot(values.size());
+    plot._container.assign(values.begin(), values.end());
+    const auto max_it = std::max_element(values.begin(), values.end());
+    if (max_it != values.end()) {
+        plot._max_value_i = static_cast<std::size_t>(max_it - values.begin());
+    }
+    return plot;
+}
+
+template<typename T>
+BasicQuantityPlot<T>::BasicQuantityPlot(ContainerT values) : _container(std::move(values)) {}
+
+template<typename T> BasicQuantityPlot<T> BasicQuantityPlot<T>::from_values(ContainerT values) {
+    // Moving the values in keeps the resource they were allocated from
+    BasicQuantityPlot plot(std::move(values));
+    const auto max_it = std::max_element(plot._container.begin(), plot._container.end());
+    if (max_it != plot._container.end()) {
+        plot._max_value_i = static_cast<std::size_t>(max_it - plot._container.begin());
+    }
+    return plot;
+}
+
+template<typename T> void BasicQuantityPlot<T>::change_value(std::size_t tick, T mod) {
+    detach();
     if (_container.size() <= tick) {
         extrapolate_until(tick);
     }
@@ -20,12 +69,29 @@ void QuantityPlot::change_value(std::size_t tick, int mod) {
     }
 }
 
-int QuantityPlot::extrapolate_until(std::size_t tick) {
-    auto last_element = _container.empty() ? 0 : _container.back();
+template<typename T> T BasicQuantityPlot<T>::extrapolate_until(std::size_t tick) {
+    detach();
+    auto last_element = _container.empty() ? T(0) : _container.back();
     for (std::size_t i = _container.size(); i <= tick; i++) {
         _container.emplace_back(last_element);
     }
     return last_element;
 }
 
+template<typename T> T BasicQuantityPlot<T>::max_value() const {
+    return _max_value_i == static_cast<std::size_t>(-1) ? T(0) : values()[_max_value_i];
+}
+
+template<typename T> void BasicQuantityPlot<T>::detach() {
+    if (!_backing)
+        return;
+
+    _container.assign(_view.begin(), _view.end());
+    _view = {};
+    _backing.reset();
+}
+
+template class BasicQuantityPlot<std::int32_t>;
+template class BasicQuantityPlot<std::int64_t>;
+
 } // namespace fmk::util
\ No newline at end of file
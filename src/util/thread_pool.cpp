@@ -0,0 +1,63 @@
+#include "util/thread_pool.hpp"
+
+#include <algorithm>
+#include <latch>
+
+namespace fmk::util {
+
+ThreadPool::ThreadPool(std::size_t worker_count) {
+    if (worker_count == 0) {
+        worker_count = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    workers.reserve(worker_count);
+    for (std::size_t i = 0; i < worker_count; i++) { workers.emplace_back([this] { work(); }); }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    task_available.notify_all();
+    for (auto& worker : workers) { worker.join(); }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    {
+        std::lock_guard lock(mutex);
+        tasks.emplace_back(std::move(task));
+    }
+    task_available.notify_one();
+}
+
+void ThreadPool::parallel_for(std::size_t count,
+                              const std::function<void(std::size_t, std::size_t)>& task) {
+    const auto ranges = std::min(count, workers.size());
+    std::latch done(static_cast<std::ptrdiff_t>(ranges));
+    for (std::size_t range = 0; range < ranges; range++) {
+        submit([&, range] {
+            task(count * range / ranges, count * (range + 1) / ranges);
+            done.count_down();
+        });
+    }
+    done.wait();
+}
+
+void ThreadPool::work() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock lock(mutex);
+            task_available.wait(lock, [this] { return stopping || !tasks.empty(); });
+            if (tasks.empty()) {
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+}
+
+} // namespace fmk::util
\ No newline at end of file
@@ -0,0 +1,50 @@
+#include <fmt/core.h>
+#include <optional>
+
+#include "check.hpp"
+#include "random_factory.hpp"
+#include "util/arena.hpp"
+#include "util/heap_stats.hpp"
+
+using namespace fmk;
+
+namespace {
+
+constexpr std::size_t ticks_to_simulate = 3000;
+constexpr int runs = 5;
+
+/// The heap allocations of a call, on average over a few runs.
+template<typename F> std::size_t allocations_per_run(const F& generate) {
+    const auto allocations_before = util::heap_allocation_count();
+    for (int run_i = 0; run_i < runs; run_i++) {
+        generate();
+    }
+    return (util::heap_allocation_count() - allocations_before) / runs;
+}
+
+} // namespace
+
+int main() {
+    for (std::uint32_t seed = 0; seed < 5; seed++) {
+        const auto factory = test::random_factory(seed);
+        const auto with_new_arenas =
+            allocations_per_run([&] { factory.generate_cache(ticks_to_simulate); });
+
+        // Like the editor, the previous results are kept alive while the next ones are generated,
+        // and the arenas are warmed up first
+        util::ArenaPool arenas;
+        std::optional<Factory::Cache> previous;
+        const auto generate_reusing = [&] {
+            previous = factory.generate_cache(ticks_to_simulate, arenas.acquire());
+        };
+        generate_reusing();
+        generate_reusing();
+        const auto with_reused_arenas = allocations_per_run(generate_reusing);
+
+        test::check(with_reused_arenas < with_new_arenas,
+                    fmt::format("factory {}: reusing arenas takes {} allocations instead of {}",
+                                seed, with_reused_arenas, with_new_arenas));
+    }
+
+    return test::exit_code();
+}
\ No newline at end of file
@@ -0,0 +1,130 @@
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <fmt/core.h>
+#include <fstream>
+#include <optional>
+
+#include "check.hpp"
+#include "io/binary_format.hpp"
+#include "io/factory_file.hpp"
+#include "random_factory.hpp"
+
+using namespace fmk;
+
+namespace {
+
+/// Checks that the items of `loaded`, which were saved with compacted UIDs, have the same plots as
+/// the items of `factory` in the same positions.
+void check_same_plots(const Factory& factory,
+                      const Factory::Cache& cache,
+                      const io::FactoryDocument& loaded) {
+    if (!test::check(loaded.cache.has_value(), "the file has plots") ||
+        !test::check(loaded.factory.items.size() == factory.items.size(), "same item count")) {
+        return;
+    }
+    test::check(loaded.cache->ticks_simulated() == cache.ticks_simulated(), "same ticks");
+    test::check(loaded.cache->overflow().has_value() == cache.overflow().has_value(),
+                "same overflow");
+    for (std::size_t i = 0; i < factory.items.size(); i++) {
+        const auto expected = cache.make_plot(factory.items.begin()[i].first);
+        const auto actual = loaded.cache->make_plot(loaded.factory.items.begin()[i].first);
+        test::check(std::ranges::equal(expected.values(), actual.values()),
+                    fmt::format("plot of item {}", i));
+    }
+}
+
+bool is_used(const Factory& factory, Uid item_uid) {
+    const auto uses_item = [&](const ItemStream& stream) { return stream.item == item_uid; };
+    return std::any_of(factory.machines.begin(), factory.machines.end(), [&](const auto& machine) {
+        return std::ranges::any_of(machine.second.inputs, uses_item) ||
+               std::ranges::any_of(machine.second.outputs, uses_item);
+    });
+}
+
+template<typename T> T read_file(const std::filesystem::path& path, std::size_t offset) {
+    std::ifstream file(path, std::ios::binary);
+    file.seekg(static_cast<std::streamoff>(offset));
+    T value{};
+    file.read(reinterpret_cast<char*>(&value), sizeof(T));
+    return value;
+}
+
+/// Overwrites part of a file in place.
+template<typename T>
+void patch_file(const std::filesystem::path& path, std::size_t offset, T value) {
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(static_cast<std::streamoff>(offset));
+    file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const auto directory = std::filesystem::path(argc > 1 ? argv[1] : ".");
+    const auto path = directory / "binary_format_test.fmkb";
+
+    for (std::uint32_t seed = 0; seed < 20; seed++) {
+        const auto factory = test::random_factory(seed, seed % 5 == 0);
+        const auto cache = factory.generate_cache(2000);
+        const auto uid_pool = UidPool(Uid(1 << 20));
+
+        if (!test::check(io::save_factory_file(path, factory, uid_pool, {}, 2000, &cache),
+                         "saving")) {
+            continue;
+        }
+        const auto loaded = io::load_factory_file(path);
+        if (!test::check(loaded.has_value(), "loading")) {
+            continue;
+        }
+        check_same_plots(factory, cache, *loaded);
+
+        // The plots of the loaded document are views into the file being replaced, which must
+        // keep working after it has been saved over
+        test::check(io::save_factory_file(path, loaded->factory, loaded->uid_pool,
+                                          loaded->node_positions, loaded->ticks_to_simulate,
+                                          &*loaded->cache),
+                    "saving in place");
+        check_same_plots(factory, cache, *loaded);
+        const auto reloaded = io::load_factory_file(path);
+        if (test::check(reloaded.has_value(), "reloading")) {
+            check_same_plots(factory, cache, *reloaded);
+        }
+    }
+
+    // Files of any other version are rejected, after the magic and byte order mark
+    io::save_factory_file(path, test::random_factory(1), UidPool(Uid(1 << 20)), {}, 2000);
+    for (const std::uint32_t version : {0u, io::binary_format_version + 1}) {
+        patch_file(path, 8, version);
+        test::check(!io::load_factory_file(path), fmt::format("version {} is rejected", version));
+    }
+
+    // Records that repeat the UID of an earlier one make the file corrupt, rather than replacing
+    // it. Records are found through the counts and offsets of the header. The item made a
+    // duplicate isn't used by any machine, so that only its UID can make loading fail
+    auto factory = test::random_factory(2);
+    factory.items[Uid(1 << 19)] = Item{Item::NodeType::Internal, 0, "Unused"};
+    const auto unused_item =
+        std::find_if(factory.items.begin() + 1, factory.items.end(),
+                     [&](const auto& item) { return !is_used(factory, item.first); });
+    if (test::check(unused_item != factory.items.end() && factory.machines.size() > 1,
+                    "duplicates can be made")) {
+        const auto item_i = static_cast<std::size_t>(unused_item - factory.items.begin());
+        for (const auto [count_offset, records_offset, next_offset, record_i] :
+             {std::array<std::size_t, 4>{32, 40, 56, item_i},
+              std::array<std::size_t, 4>{48, 56, 72, 1}}) {
+            io::save_factory_file(path, factory, UidPool(Uid(1 << 20)), {}, 2000);
+            const auto count = read_file<std::uint64_t>(path, count_offset);
+            const auto records = read_file<std::uint64_t>(path, records_offset);
+            const auto record_size =
+                (read_file<std::uint64_t>(path, next_offset) - records) / count;
+            patch_file(path, records + record_i * record_size,
+                       read_file<std::int64_t>(path, records));
+            test::check(!io::load_factory_file(path),
+                        fmt::format("a duplicate UID in the records at {} is rejected", records));
+        }
+    }
+    std::filesystem::remove(path);
+
+    return test::exit_code();
+}
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdlib>
+#include <iostream>
+#include <source_location>
+#include <string_view>
+
+namespace fmk::test {
+
+/// How many checks have failed so far.
+inline int failures = 0;
+
+/// Reports a failed check with where it is, and keeps going so that one run shows every failure.
+/// @returns `condition`, so that checks that later ones depend on can stop the test early.
+inline bool check(bool condition,
+                  std::string_view what,
+                  std::source_location location = std::source_location::current()) {
+    if (!condition) {
+        failures++;
+        std::cerr << location.file_name() << ":" << location.line() << ": check failed: " << what
+                  << "\n";
+    }
+    return condition;
+}
+
+/// The exit code of a test, to be returned from `main`.
+inline int exit_code() {
+    if (failures > 0) {
+        std::cerr << failures << " checks failed\n";
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+} // namespace fmk::test
\ No newline at end of file
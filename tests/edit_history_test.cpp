@@ -0,0 +1,123 @@
+#include <algorithm>
+#include <fmt/core.h>
+#include <functional>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "check.hpp"
+#include "editor/edit_history.hpp"
+#include "random_factory.hpp"
+
+using namespace fmk;
+
+namespace {
+
+/// Whether two factories have the same items and machines, in the same order.
+bool is_same_factory(const Factory& a, const Factory& b) {
+    const auto same_entries = [](const auto& x, const auto& y) {
+        return std::ranges::equal(x, y, [](const auto& entry_x, const auto& entry_y) {
+            return entry_x.first == entry_y.first && entry_x.second == entry_y.second;
+        });
+    };
+    return same_entries(a.items, b.items) && same_entries(a.machines, b.machines);
+}
+
+/// Makes a random edit, like the ones the editor makes.
+void edit(Factory& factory, UidPool& uid_pool, std::mt19937& rng) {
+    auto& machines = factory.machines;
+    auto machine = machines.begin() + static_cast<std::ptrdiff_t>(rng() % machines.size());
+    switch (rng() % 4) {
+        case 0: machine->second.op_time += util::ticks(1); break;
+        case 1: machine->second.name += "'"; break;
+        case 2: {
+            if (machines.size() > 1) {
+                uid_pool.release(machine->first);
+                machines.erase(machine);
+            }
+        } break;
+        default: {
+            const auto item_uid = uid_pool.generate();
+            factory.items[item_uid] = Item{Item::NodeType::Internal, 0, "New item"};
+            machines[uid_pool.generate()] =
+                Machine{"New machine", {}, {{item_uid, 1, uid_pool.generate()}}, util::ticks(5)};
+        } break;
+    }
+}
+
+/// Undoes and redoes random edits, checking every step restores the factory and UIDs it had.
+void check_undo_redo(std::uint32_t seed) {
+    std::mt19937 rng(seed);
+    auto factory = test::random_factory(seed);
+    UidPool uid_pool(Uid(1 << 20));
+    EditHistory history;
+    history.reset(factory, uid_pool, nullptr);
+    std::vector<std::pair<Factory, Uid>> states{{factory, uid_pool.get_next_uid()}};
+    for (int edit_i = 0; edit_i < 100; edit_i++) {
+        edit(factory, uid_pool, rng);
+        history.record(factory, uid_pool, nullptr);
+        states.emplace_back(factory, uid_pool.get_next_uid());
+    }
+
+    const auto check_step = [&](const EditHistory::Step& step, std::size_t state_i) {
+        return is_same_factory(step.factory.restore(), states[state_i].first) &&
+               step.uid_pool.get_next_uid() == states[state_i].second;
+    };
+    std::size_t mismatches = 0;
+    std::size_t state_i = states.size() - 1;
+    while (history.can_undo()) {
+        mismatches += !check_step(history.undo(), --state_i);
+    }
+    test::check(state_i == 0 && mismatches == 0,
+                fmt::format("seed {}: {} steps undone wrong", seed, mismatches));
+    while (history.can_redo()) {
+        mismatches += !check_step(history.redo(), ++state_i);
+    }
+    test::check(state_i == states.size() - 1 && mismatches == 0,
+                fmt::format("seed {}: {} steps redone wrong", seed, mismatches));
+
+    // Recording an edit after undoing drops the steps that could be redone
+    for (int undo_i = 0; undo_i < 10; undo_i++) {
+        history.undo();
+    }
+    auto branch = history.undo().factory.restore();
+    edit(branch, uid_pool, rng);
+    history.record(branch, uid_pool, nullptr);
+    test::check(!history.can_redo() && is_same_factory(history.undo().factory.restore(),
+                                                       states[states.size() - 12].first),
+                fmt::format("seed {}: recording after undoing", seed));
+}
+
+} // namespace
+
+int main() {
+    for (std::uint32_t seed = 0; seed < 20; seed++) {
+        check_undo_redo(seed);
+    }
+
+    // Only the latest steps are kept, and only the ones close to the current one keep their
+    // results
+    const auto factory = test::random_factory(1);
+    const UidPool uid_pool(Uid(1 << 20));
+    EditHistory history(10, 3);
+    std::vector<std::shared_ptr<const Factory::Cache>> caches;
+    for (int step_i = 0; step_i < 20; step_i++) {
+        caches.push_back(std::make_shared<const Factory::Cache>());
+        history.record(factory, uid_pool, caches.back());
+    }
+    std::vector<bool> has_cache;
+    while (history.can_undo()) {
+        has_cache.push_back(history.undo().cache != nullptr);
+    }
+    test::check(has_cache.size() == 9,
+                fmt::format("{} steps can be undone instead of 9", has_cache.size()));
+    test::check(has_cache.size() > 2 && has_cache[0] && has_cache[1] &&
+                    std::none_of(has_cache.begin() + 2, has_cache.end(), std::identity()),
+                "steps far from the current one drop their results");
+
+    history.set_current_cache(caches.front());
+    test::check(history.redo().cache == nullptr && history.undo().cache == caches.front(),
+                "results given back to a step are kept");
+
+    return test::exit_code();
+}
\ No newline at end of file
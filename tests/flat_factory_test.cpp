@@ -0,0 +1,51 @@
+#include <fmt/core.h>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "check.hpp"
+#include "random_factory.hpp"
+#include "sim/flat_factory.hpp"
+
+using namespace fmk;
+
+int main() {
+    if (!sim::has_vectorized_requirement_checks()) {
+        std::cout << "Requirement checks aren't vectorized on this CPU, only checking the "
+                     "scalar ones\n";
+    }
+
+    for (std::uint32_t seed = 0; seed < 200; seed++) {
+        const auto factory = test::random_factory(seed, seed % 5 == 0);
+        const sim::FlatFactory flat(factory.items, factory.machines);
+
+        std::mt19937 rng(seed);
+        std::vector<Quantity> stock(flat.item_count + 1);
+        std::vector<std::int32_t> blocked(flat.padded_machine_count);
+        std::vector<std::int32_t> expected(flat.padded_machine_count);
+        for (int round = 0; round < 50; round++) {
+            // Mostly small stocks around the quantities required, with some extremes
+            for (std::size_t item_i = 0; item_i < flat.item_count; item_i++) {
+                switch (rng() % 8) {
+                case 0: stock[item_i] = std::numeric_limits<Quantity>::min(); break;
+                case 1: stock[item_i] = std::numeric_limits<Quantity>::max(); break;
+                default: stock[item_i] = static_cast<Quantity>(rng() % 8) - 2; break;
+                }
+            }
+            stock[flat.unlimited_item()] = 0;
+
+            sim::find_blocked_machines(flat, stock, blocked);
+            sim::find_blocked_machines_scalar(flat, stock, expected);
+            test::check(blocked == expected,
+                        fmt::format("seed {}, round {}: same as the scalar check", seed, round));
+            for (std::size_t machine_i = 0; machine_i < flat.machine_count; machine_i++) {
+                test::check(expected[machine_i] == (flat.can_start(machine_i, stock) ? 0 : -1),
+                            fmt::format("seed {}, round {}: machine {} matches can_start", seed,
+                                        round, machine_i));
+            }
+        }
+    }
+
+    return test::exit_code();
+}
\ No newline at end of file
@@ -0,0 +1,92 @@
+#include <algorithm>
+#include <cmath>
+#include <fmt/core.h>
+#include <set>
+#include <utility>
+
+#include "check.hpp"
+#include "editor/graph_layout.hpp"
+#include "random_factory.hpp"
+
+using namespace fmk;
+
+namespace {
+
+/// Every machine and every input and output item has a position of its own, and nothing else.
+void check_random_factory(std::uint32_t seed) {
+    const auto factory = test::random_factory(seed);
+    GraphLayoutOptions options;
+    options.worker_count = 1 + seed % 4;
+    std::size_t updates = 0;
+    options.on_update = [&](const io::NodePositionsT&) { updates++; };
+    const auto positions = layout_factory(factory, options);
+
+    std::size_t nodes = factory.machines.size();
+    for (const auto& [item_uid, item] : factory.items) {
+        nodes += item.type != Item::NodeType::Internal;
+    }
+    const auto is_node = [&](Uid uid) {
+        const auto item = factory.items.find(uid);
+        return item != factory.items.end() ? item->second.type != Item::NodeType::Internal
+                                           : factory.machines.contains(uid);
+    };
+    std::set<std::pair<float, float>> distinct;
+    bool are_finite = true;
+    for (const auto& [uid, position] : positions) {
+        distinct.emplace(position.x, position.y);
+        are_finite = are_finite && std::isfinite(position.x) && std::isfinite(position.y);
+    }
+    test::check(positions.size() == nodes &&
+                    std::all_of(positions.begin(), positions.end(),
+                                [&](const auto& entry) { return is_node(entry.first); }),
+                fmt::format("factory {}: every node is laid out", seed));
+    test::check(are_finite && distinct.size() == positions.size(),
+                fmt::format("factory {}: nodes have finite positions of their own", seed));
+    test::check(updates > 0, fmt::format("factory {}: updates are given", seed));
+
+    options.worker_count = 1;
+    options.on_update = nullptr;
+    const auto single_threaded = layout_factory(factory, options);
+    test::check(std::all_of(positions.begin(), positions.end(),
+                            [&](const auto& entry) {
+                                const auto other = single_threaded.find(entry.first);
+                                return other != single_threaded.end() &&
+                                       other->second.x == entry.second.x &&
+                                       other->second.y == entry.second.y;
+                            }),
+                fmt::format("factory {}: the layout doesn't depend on the threads", seed));
+}
+
+} // namespace
+
+int main() {
+    for (std::uint32_t seed = 0; seed < 30; seed++) {
+        check_random_factory(seed);
+    }
+
+    // A chain with a recycling loop goes from left to right along the flow of items
+    Factory factory;
+    const Uid ore(1), plate(2), gear(3), scrap(4);
+    factory.items[ore] = Item{Item::NodeType::Input, 0, "Ore", Uid(100)};
+    factory.items[plate] = Item{Item::NodeType::Internal, 0, "Plate"};
+    factory.items[scrap] = Item{Item::NodeType::Internal, 0, "Scrap"};
+    factory.items[gear] = Item{Item::NodeType::Output, 0, "Gear", Uid(101)};
+    const Uid smelter(10), press(20);
+    factory.machines[smelter] = Machine{"Smelter",
+                                        {{ore, 1, Uid(11)}, {scrap, 1, Uid(12)}},
+                                        {{plate, 2, Uid(13)}},
+                                        util::ticks(4)};
+    factory.machines[press] = Machine{"Press",
+                                      {{plate, 2, Uid(21)}},
+                                      {{gear, 1, Uid(22)}, {scrap, 1, Uid(23)}},
+                                      util::ticks(8)};
+    const auto positions = layout_factory(factory);
+    if (test::check(positions.size() == 4, "the chain is laid out")) {
+        test::check(positions.at(ore).x < positions.at(smelter).x &&
+                        positions.at(smelter).x < positions.at(press).x &&
+                        positions.at(press).x < positions.at(gear).x,
+                    "nodes follow the flow of items despite the loop");
+    }
+
+    return test::exit_code();
+}
\ No newline at end of file
@@ -0,0 +1,56 @@
+#include <fmt/core.h>
+#include <unordered_set>
+#include <vector>
+
+#include "check.hpp"
+#include "editor/imnodes_ids.hpp"
+
+using namespace fmk;
+
+int main() {
+    ImnodesIds ids;
+    // UIDs of any width, including two that only differ above 32 bits
+    const std::vector<Uid> uids{Uid(1), Uid(2), Uid(1 + (Uid::ValueT(1) << 32)),
+                                Uid(Uid::INVALID_VALUE + 1), Uid(42)};
+
+    std::unordered_set<int> assigned;
+    for (const auto uid : uids) {
+        const auto id = ids.id(uid);
+        assigned.emplace(id);
+        test::check(ids.id(uid) == id && ids.find(uid) == id && ids.uid(id) == uid,
+                    fmt::format("UID {} round-trips through its ID", uid.value));
+    }
+    test::check(assigned.size() == uids.size(), "every UID gets its own ID");
+    test::check(!ids.find(Uid(3)), "UIDs that weren't drawn have no ID");
+
+    const auto link = ids.link_id(uids[0], uids[1]);
+    const auto other_link = ids.link_id(uids[2], uids[4]);
+    test::check(ids.link_id(uids[0], uids[1]) == link && !assigned.contains(link) &&
+                    link != other_link,
+                "links keep their own ID");
+
+    // A forgotten node leaves no ID behind, for itself or its links, and isn't confused with a
+    // node drawn later
+    const auto forgotten = uids[1];
+    const auto forgotten_id = *ids.find(forgotten);
+    ids.forget(forgotten);
+    test::check(!ids.find(forgotten) && !ids.uid(forgotten_id),
+                "a forgotten UID has no ID anymore");
+    test::check(ids.link_id(uids[2], uids[4]) == other_link,
+                "forgetting a UID keeps the links of others");
+    const auto new_link = ids.link_id(uids[0], uids[1]);
+    test::check(new_link != link, "the links of a forgotten UID get a new ID");
+    const auto new_id = ids.id(Uid(43));
+    test::check(new_id != forgotten_id && !assigned.contains(new_id) && new_id != new_link,
+                "IDs aren't reused");
+    test::check(ids.id(forgotten) != forgotten_id, "a forgotten UID drawn again gets a new ID");
+    for (const auto uid : {uids[0], uids[2], uids[3], uids[4]}) {
+        test::check(ids.uid(*ids.find(uid)) == uid,
+                    fmt::format("UID {} keeps its ID", uid.value));
+    }
+
+    ids.clear();
+    test::check(!ids.find(uids[0]) && !ids.uid(forgotten_id), "clearing forgets every UID");
+
+    return test::exit_code();
+}
\ No newline at end of file
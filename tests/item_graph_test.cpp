@@ -0,0 +1,63 @@
+#include <algorithm>
+#include <fmt/core.h>
+#include <span>
+#include <vector>
+
+#include "check.hpp"
+#include "random_factory.hpp"
+
+using namespace fmk;
+
+namespace {
+
+/// The links of an item found by scanning every stream of every machine, in factory order.
+std::vector<ItemGraph::Link> scan_links(const Factory& factory, Uid item, bool is_input) {
+    std::vector<ItemGraph::Link> links;
+    for (const auto& [machine_uid, machine] : factory.machines) {
+        const auto& streams = is_input ? machine.inputs : machine.outputs;
+        for (std::size_t io_index = 0; io_index < streams.size(); io_index++) {
+            if (streams[io_index].item == item) {
+                links.push_back(ItemGraph::Link{machine_uid, io_index});
+            }
+        }
+    }
+    return links;
+}
+
+bool is_same_row(std::span<const ItemGraph::Link> row,
+                 const std::vector<ItemGraph::Link>& expected) {
+    return std::ranges::equal(row, expected, [](const auto& a, const auto& b) {
+        return a.machine == b.machine && a.io_index == b.io_index;
+    });
+}
+
+} // namespace
+
+int main() {
+    for (std::uint32_t seed = 0; seed < 100; seed++) {
+        auto factory = test::random_factory(seed);
+        // An item no machine uses has no links
+        factory.items[Uid(1 << 20)] = Item{Item::NodeType::Internal, 0, "Unused"};
+        const ItemGraph graph(factory.machines);
+
+        std::size_t mismatches = 0;
+        for (const auto& [item_uid, item] : factory.items) {
+            mismatches +=
+                !is_same_row(graph.consumers(item_uid), scan_links(factory, item_uid, true));
+            mismatches +=
+                !is_same_row(graph.producers(item_uid), scan_links(factory, item_uid, false));
+        }
+        test::check(mismatches == 0,
+                    fmt::format("factory {}: {} rows differ from a scan of the machines", seed,
+                                mismatches));
+        test::check(graph.consumers(Uid(1 << 20)).empty() &&
+                        graph.producers(Uid(1 << 20)).empty(),
+                    fmt::format("factory {}: unused items have no links", seed));
+    }
+
+    const ItemGraph empty;
+    test::check(empty.consumers(Uid(1)).empty() && empty.producers(Uid(1)).empty(),
+                "an empty graph has no links");
+
+    return test::exit_code();
+}
\ No newline at end of file
@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <fmt/core.h>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "check.hpp"
+#include "editor/item_search.hpp"
+
+using namespace fmk;
+
+namespace {
+
+constexpr const char* name_parts[] = {"Iron",    "Copper", "Plate",  "Gear",   "Circuit",
+                                      "Steel",   "Wire",   "ADVANCED", "basic", "Engine",
+                                      "Unit",    "Oil",    "Plastic", "Sulfur", "Acid",
+                                      "Battery", "Module", "Speed",  "Rocket", "Café"};
+
+/// Short and long words, several words, repeated words, any case, non-ASCII and no matches.
+constexpr const char* queries[] = {"", "i", "ir", "IRON", "iron pl", "gear 12", "circuit advanced",
+                                   "zzz", "ENGINE unit 9", "  e  ", "acid 999", "é", "afé",
+                                   "l 1", "ate", "plate plate", "7"};
+
+std::string random_name(std::mt19937& rng) {
+    std::string name;
+    for (auto words = 1 + rng() % 3; words > 0; words--) {
+        name += name_parts[rng() % std::size(name_parts)];
+        name += ' ';
+    }
+    return name + std::to_string(rng() % 1000);
+}
+
+/// Only ASCII letters are matched in any case.
+std::string to_lower(std::string str) {
+    for (auto& c : str) {
+        c = c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+    }
+    return str;
+}
+
+/// The items whose name contains every word of the query, going through all of them.
+std::vector<Uid> scan(const util::UidMap<Item>& items, std::string_view query) {
+    std::vector<std::string> words;
+    const auto lower_query = to_lower(std::string(query));
+    for (std::size_t start = 0; start < lower_query.size();) {
+        const auto end = std::min(lower_query.find(' ', start), lower_query.size());
+        if (end > start) {
+            words.emplace_back(lower_query.substr(start, end - start));
+        }
+        start = end + 1;
+    }
+
+    std::vector<Uid> matches;
+    for (const auto& [item_uid, item] : items) {
+        const auto name = to_lower(item.name);
+        if (std::all_of(words.begin(), words.end(), [&](const std::string& word) {
+                return name.find(word) != std::string::npos;
+            })) {
+            matches.emplace_back(item_uid);
+        }
+    }
+    return matches;
+}
+
+std::vector<Uid::ValueT> sorted_values(const std::vector<Uid>& uids) {
+    std::vector<Uid::ValueT> values;
+    for (const auto uid : uids) {
+        values.emplace_back(uid.value);
+    }
+    std::sort(values.begin(), values.end());
+    return values;
+}
+
+void check_searches(const ItemSearchIndex& index,
+                    const util::UidMap<Item>& items,
+                    std::string_view when) {
+    for (const auto* query : queries) {
+        std::vector<Uid> found;
+        index.search(query, found);
+        const auto values = sorted_values(found);
+        test::check(std::adjacent_find(values.begin(), values.end()) == values.end(),
+                    fmt::format("{}: '{}' finds items once", when, query));
+        test::check(values == sorted_values(scan(items, query)),
+                    fmt::format("{}: '{}' finds {} items like a scan", when, query,
+                                values.size()));
+    }
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 rng(3);
+    util::UidMap<Item> items;
+    Uid::ValueT next_uid = 1;
+    const auto add_item = [&](std::string name) {
+        const Uid item_uid(next_uid++);
+        items[item_uid] = Item{Item::NodeType::Internal, 0, std::move(name), Uid(next_uid++)};
+    };
+    const auto add_items = [&](int count) {
+        for (int i = 0; i < count; i++) {
+            add_item(random_name(rng));
+        }
+    };
+    const auto random_uids = [&](int count) {
+        std::vector<Uid> uids;
+        for (const auto& [item_uid, item] : items) {
+            uids.emplace_back(item_uid);
+        }
+        std::shuffle(uids.begin(), uids.end(), rng);
+        uids.erase(uids.begin() + std::min(uids.size(), static_cast<std::size_t>(count)),
+                   uids.end());
+        return uids;
+    };
+
+    ItemSearchIndex index;
+    add_items(5000);
+    index.sync(items);
+    check_searches(index, items, "indexed");
+
+    // Few removals are unindexed one by one, and many compact the index
+    for (const int removed : {10, 300, 3000}) {
+        for (const auto uid : random_uids(200)) {
+            items.at(uid).name = random_name(rng);
+        }
+        for (const auto uid : random_uids(removed)) {
+            items.erase(items.find(uid));
+        }
+        add_items(500);
+        const auto generation = index.generation();
+        index.sync(items);
+        test::check(index.generation() != generation,
+                    fmt::format("{} removed: syncing changes the generation", removed));
+        check_searches(index, items, fmt::format("{} removed", removed));
+    }
+
+    // Filters search again only once the index changes
+    ItemFilter filter;
+    filter.query = "gear";
+    const auto gears = filter.refresh(index).size();
+    const auto generation = index.generation();
+    index.sync(items);
+    test::check(index.generation() == generation, "syncing without changes keeps the generation");
+    add_item("Gear");
+    index.sync(items);
+    test::check(filter.refresh(index).size() == gears + 1, "a filter finds a new item");
+
+    return test::exit_code();
+}
\ No newline at end of file
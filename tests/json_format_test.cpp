@@ -0,0 +1,118 @@
+#include <algorithm>
+#include <cmath>
+#include <fmt/core.h>
+#include <random>
+#include <sstream>
+#include <unordered_set>
+
+#include "check.hpp"
+#include "io/json_format.hpp"
+#include "random_factory.hpp"
+
+using namespace fmk;
+
+namespace {
+
+/// Factory files key the streams of a machine by item, so each item is only kept once per side.
+void remove_repeated_items(std::vector<ItemStream>& streams) {
+    std::unordered_set<Uid> seen;
+    std::erase_if(streams, [&](const ItemStream& stream) {
+        return !seen.insert(stream.item).second;
+    });
+}
+
+bool is_same_stream(const ItemStream& a, const ItemStream& b) {
+    return a.item == b.item && a.quantity == b.quantity && a.probability == b.probability;
+}
+
+} // namespace
+
+int main() {
+    for (std::uint32_t seed = 0; seed < 50; seed++) {
+        auto factory = test::random_factory(seed);
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> chance(0.f, 1.f);
+        io::NodePositionsT positions;
+        for (auto& [machine_uid, machine] : factory.machines) {
+            remove_repeated_items(machine.inputs);
+            remove_repeated_items(machine.outputs);
+            // Chances that only survive the round trip if they are written in full
+            for (auto& output : machine.outputs) {
+                output.probability = rng() % 2 ? chance(rng) : 1.f / 3.f;
+            }
+            positions[machine_uid] = io::NodePosition{chance(rng) * 1000.f, -chance(rng) * 10.f};
+        }
+
+        std::stringstream json;
+        io::write_factory_json(json, factory, UidPool(Uid(1 << 20)), positions, 1234 + seed);
+        const auto document = io::parse_factory_json(json);
+        if (!test::check(document.has_value(), fmt::format("seed {}: parsing", seed))) {
+            continue;
+        }
+
+        test::check(document->ticks_to_simulate == 1234 + seed,
+                    fmt::format("seed {}: ticks to simulate", seed));
+        // Attributes and streams get new UIDs when loaded, which must not be generated again
+        const auto next_uid = document->uid_pool.get_next_uid().value;
+        bool is_past_uids = next_uid >= (1 << 20);
+        for (const auto& [item_uid, item] : document->factory.items) {
+            is_past_uids &= item_uid.value < next_uid && item.attribute_uid.value < next_uid;
+        }
+        for (const auto& [machine_uid, machine] : document->factory.machines) {
+            is_past_uids &= machine_uid.value < next_uid;
+            for (const auto& stream : machine.inputs) {
+                is_past_uids &= stream.uid.value < next_uid;
+            }
+            for (const auto& stream : machine.outputs) {
+                is_past_uids &= stream.uid.value < next_uid;
+            }
+        }
+        test::check(is_past_uids, fmt::format("seed {}: UID pool is past every UID", seed));
+        test::check(document->factory.items.size() == factory.items.size(),
+                    fmt::format("seed {}: item count", seed));
+        for (const auto& [item_uid, item] : factory.items) {
+            const auto parsed = document->factory.items.find(item_uid);
+            test::check(parsed != document->factory.items.end() &&
+                            parsed->second.type == item.type &&
+                            parsed->second.starting_quantity == item.starting_quantity &&
+                            parsed->second.name == item.name,
+                        fmt::format("seed {}: item {}", seed, item_uid.value));
+        }
+
+        test::check(document->factory.machines.size() == factory.machines.size(),
+                    fmt::format("seed {}: machine count", seed));
+        for (const auto& [machine_uid, machine] : factory.machines) {
+            const auto parsed = document->factory.machines.find(machine_uid);
+            if (!test::check(parsed != document->factory.machines.end(),
+                             fmt::format("seed {}: machine {}", seed, machine_uid.value))) {
+                continue;
+            }
+            const auto& parsed_machine = parsed->second;
+            test::check(parsed_machine.op_time == machine.op_time &&
+                            parsed_machine.op_time_distribution == machine.op_time_distribution,
+                        fmt::format("seed {}: times of machine {}", seed, machine_uid.value));
+            test::check(
+                std::ranges::equal(parsed_machine.inputs, machine.inputs, is_same_stream) &&
+                    std::ranges::equal(parsed_machine.outputs, machine.outputs, is_same_stream),
+                fmt::format("seed {}: streams of machine {}", seed, machine_uid.value));
+
+            const auto position = positions.at(machine_uid);
+            const auto parsed_position = document->node_positions.find(machine_uid);
+            // Positions are written with a single decimal
+            test::check(parsed_position != document->node_positions.end() &&
+                            std::abs(parsed_position->second.x - position.x) <= .051f &&
+                            std::abs(parsed_position->second.y - position.y) <= .051f,
+                        fmt::format("seed {}: position of machine {}", seed, machine_uid.value));
+        }
+    }
+
+    for (const auto* ticks : {"-1", "1e3", "\"6000\"", "99999999999999999999"}) {
+        std::stringstream json(fmt::format(
+            R"({{"uid_pool": {{"next_uid": 1}}, "items": {{}}, "machines": [], "simulate": {}}})",
+            ticks));
+        test::check(!io::parse_factory_json(json),
+                    fmt::format("simulating {} ticks is a loading error", ticks));
+    }
+
+    return test::exit_code();
+}
\ No newline at end of file
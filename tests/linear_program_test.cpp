@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <cmath>
+#include <fmt/core.h>
+#include <limits>
+#include <random>
+#include <string_view>
+#include <vector>
+
+#include "check.hpp"
+#include "util/linear_program.hpp"
+
+using namespace fmk;
+using util::LinearProgram;
+using util::LinearSolution;
+using Relation = LinearProgram::Constraint::Relation;
+
+namespace {
+
+constexpr double tolerance = 1e-6;
+
+bool is_feasible(const LinearProgram& program, const std::vector<double>& values) {
+    const auto is_negative = [](double value) { return value < -tolerance; };
+    if (values.size() != program.objective.size() ||
+        std::any_of(values.begin(), values.end(), is_negative)) {
+        return false;
+    }
+    return std::all_of(
+        program.constraints.begin(), program.constraints.end(), [&](const auto& constraint) {
+            double sum = 0;
+            for (const auto& term : constraint.terms) {
+                sum += term.coefficient * values[term.variable];
+            }
+            switch (constraint.relation) {
+            case Relation::LessEqual:
+                return sum <= constraint.bound + tolerance;
+            case Relation::GreaterEqual:
+                return sum >= constraint.bound - tolerance;
+            case Relation::Equal:
+                return std::abs(sum - constraint.bound) <= tolerance;
+            }
+            return false;
+        });
+}
+
+void check_optimum(const LinearProgram& program,
+                   double objective,
+                   const std::vector<double>& values,
+                   std::string_view what) {
+    const auto solution = util::solve_linear_program(program);
+    if (!test::check(solution.status == LinearSolution::Status::Optimal,
+                     fmt::format("{}: an optimum is found", what))) {
+        return;
+    }
+    test::check(std::abs(solution.objective - objective) <= tolerance,
+                fmt::format("{}: the minimum is {}, not {}", what, objective, solution.objective));
+    test::check(solution.values.size() == values.size() &&
+                    std::equal(values.begin(), values.end(), solution.values.begin(),
+                               [](double a, double b) { return std::abs(a - b) <= tolerance; }),
+                fmt::format("{}: the minimum is reached at the known values", what));
+}
+
+/// Random programs of one or two variables up to 10, against the best point of a grid over them.
+/// The grid may miss the optimum, but no feasible point can beat it.
+void check_random_programs() {
+    std::mt19937 rng(1);
+    const auto random = [&rng](int low, int high) {
+        return low + static_cast<int>(rng() % static_cast<unsigned>(high - low + 1));
+    };
+    for (int program_i = 0; program_i < 500; program_i++) {
+        LinearProgram program;
+        const auto variable_count = static_cast<std::uint32_t>(random(1, 2));
+        for (std::uint32_t variable = 0; variable < variable_count; variable++) {
+            program.objective.emplace_back(random(-3, 7));
+            program.constraints.emplace_back(
+                LinearProgram::Constraint{Relation::LessEqual, {{variable, 1}}, 10});
+        }
+        for (auto constraints = random(1, 4); constraints > 0; constraints--) {
+            LinearProgram::Constraint constraint{static_cast<Relation>(random(0, 2)), {},
+                                                 static_cast<double>(random(-5, 15))};
+            for (std::uint32_t variable = 0; variable < variable_count; variable++) {
+                if (random(0, 2) > 0) {
+                    constraint.terms.emplace_back(
+                        LinearProgram::Term{variable, static_cast<double>(random(-4, 4))});
+                }
+            }
+            program.constraints.emplace_back(std::move(constraint));
+        }
+
+        auto grid_best = std::numeric_limits<double>::infinity();
+        std::vector<double> point(variable_count);
+        const int grid_points = variable_count == 1 ? 41 : 41 * 41;
+        for (int point_i = 0; point_i < grid_points; point_i++) {
+            point[0] = (point_i % 41) * .25;
+            if (variable_count == 2) {
+                point[1] = (point_i / 41) * .25;
+            }
+            if (is_feasible(program, point)) {
+                double objective = 0;
+                for (std::uint32_t variable = 0; variable < variable_count; variable++) {
+                    objective += program.objective[variable] * point[variable];
+                }
+                grid_best = std::min(grid_best, objective);
+            }
+        }
+
+        const auto solution = util::solve_linear_program(program);
+        if (solution.status == LinearSolution::Status::Optimal) {
+            test::check(is_feasible(program, solution.values),
+                        fmt::format("random program {}: the optimum is feasible", program_i));
+            test::check(solution.objective <= grid_best + tolerance,
+                        fmt::format("random program {}: the minimum {} is at most {}", program_i,
+                                    solution.objective, grid_best));
+        } else {
+            test::check(solution.status == LinearSolution::Status::Infeasible &&
+                            grid_best == std::numeric_limits<double>::infinity(),
+                        fmt::format("random program {}: only infeasible programs have no optimum",
+                                    program_i));
+        }
+    }
+}
+
+} // namespace
+
+int main() {
+    check_optimum({{-1, -1},
+                   {{Relation::LessEqual, {{0, 1}, {1, 2}}, 4},
+                    {Relation::LessEqual, {{0, 3}, {1, 1}}, 6}}},
+                  -2.8, {1.6, 1.2}, "two upper bounds");
+    check_optimum({{1, 1},
+                   {{Relation::GreaterEqual, {{0, 1}, {1, 1}}, 2},
+                    {Relation::Equal, {{0, 1}, {1, -1}}, 1}}},
+                  2, {1.5, .5}, "an equality");
+    check_optimum({{2, 3}, {{Relation::GreaterEqual, {{0, 1}, {0, 1}, {1, 1}}, 4}}}, 4, {2, 0},
+                  "terms of the same variable");
+    check_optimum({{1}, {{Relation::LessEqual, {{0, -1}}, -3}}}, 3, {3}, "a negative bound");
+    // Degenerate: three constraints meet at the optimum
+    check_optimum({{-1, -1},
+                   {{Relation::LessEqual, {{0, 1}}, 1},
+                    {Relation::LessEqual, {{1, 1}}, 1},
+                    {Relation::LessEqual, {{0, 1}, {1, 1}}, 2}}},
+                  -2, {1, 1}, "a degenerate vertex");
+
+    test::check(util::solve_linear_program({{1},
+                                            {{Relation::LessEqual, {{0, 1}}, 1},
+                                             {Relation::GreaterEqual, {{0, 1}}, 2}}})
+                        .status == LinearSolution::Status::Infeasible,
+                "contradicting bounds are infeasible");
+    test::check(util::solve_linear_program({{-1}, {{Relation::GreaterEqual, {{0, 1}}, 2}}})
+                        .status == LinearSolution::Status::Unbounded,
+                "a variable without an upper bound is unbounded");
+
+    check_random_programs();
+    return test::exit_code();
+}
\ No newline at end of file
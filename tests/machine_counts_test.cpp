@@ -0,0 +1,205 @@
+#include <algorithm>
+#include <fmt/core.h>
+#include <fmt/ranges.h>
+#include <numeric>
+#include <random>
+#include <unordered_set>
+#include <vector>
+
+#include "check.hpp"
+#include "sim/machine_counts.hpp"
+
+using namespace fmk;
+using Objective = sim::MachineCountOptions::Objective;
+
+namespace {
+
+constexpr double ticks_per_minute =
+    60. * static_cast<double>(util::ticks::period::den) / util::ticks::period::num;
+
+/// Ore smelted into plates, which make gears, and both make circuits.
+struct CircuitFactory {
+    Factory factory;
+    Uid ore{1};
+    Uid plate{2};
+    Uid gear{3};
+    Uid circuit{4};
+
+    CircuitFactory() {
+        factory.items[ore] = Item{Item::NodeType::Input, 0, "Ore", Uid(100)};
+        factory.items[plate] = Item{Item::NodeType::Internal, 0, "Plate"};
+        factory.items[gear] = Item{Item::NodeType::Internal, 0, "Gear"};
+        factory.items[circuit] = Item{Item::NodeType::Output, 0, "Circuit", Uid(101)};
+        factory.machines[Uid(20)] =
+            Machine{"Smelter", {{ore, 1, Uid(10)}}, {{plate, 1, Uid(11)}}, util::ticks(64)};
+        factory.machines[Uid(21)] =
+            Machine{"Gear press", {{plate, 2, Uid(12)}}, {{gear, 1, Uid(13)}}, util::ticks(10)};
+        factory.machines[Uid(22)] = Machine{"Assembler",
+                                            {{plate, 3, Uid(14)}, {gear, 2, Uid(15)}},
+                                            {{circuit, 1, Uid(16)}},
+                                            util::ticks(30)};
+    }
+};
+
+void check_circuits(Objective objective, const std::vector<std::size_t>& expected_counts) {
+    const CircuitFactory circuits;
+    const std::vector<sim::RateTarget> targets{{circuits.circuit, 60}};
+    sim::MachineCountOptions options;
+    options.objective = objective;
+    const auto counts = sim::solve_machine_counts(circuits.factory, targets, options);
+    const auto what = objective == Objective::MachineCount ? "fewest machines" : "least surplus";
+    if (!test::check(counts.has_value(), fmt::format("{}: counts are found", what))) {
+        return;
+    }
+    test::check(counts->is_optimal, fmt::format("{}: the counts are optimal", what));
+    test::check(counts->counts == expected_counts,
+                fmt::format("{}: the counts are {}", what, fmt::join(counts->counts, ", ")));
+    test::check(!counts->overflow, fmt::format("{}: the validation doesn't overflow", what));
+
+    const auto circuit_rate =
+        std::find_if(counts->rates.begin(), counts->rates.end(),
+                     [&](const auto& rate) { return rate.item == circuits.circuit; });
+    if (test::check(circuit_rate != counts->rates.end(),
+                    fmt::format("{}: the rate of circuits is given", what))) {
+        test::check(circuit_rate->target_per_minute == 60 &&
+                        circuit_rate->planned_per_minute >= 60 &&
+                        circuit_rate->simulated_per_minute.value_or(0) >= 60,
+                    fmt::format("{}: circuits are planned and simulated at their target", what));
+    }
+}
+
+/// Small random factories from one input to one output, against every count up to a bound.
+void check_random_factories() {
+    constexpr std::size_t max_count = 30;
+    for (std::uint32_t seed = 0; seed < 100; seed++) {
+        std::mt19937 rng(seed);
+        const auto random = [&rng](unsigned n) { return static_cast<int>(rng() % n); };
+
+        Factory factory;
+        Uid::ValueT next_uid = 1000;
+        const auto item_count = 3 + random(3);
+        std::vector<Uid> items;
+        for (int item_i = 0; item_i < item_count; item_i++) {
+            items.emplace_back(item_i + 1);
+            const auto type = item_i == 0                ? Item::NodeType::Input
+                              : item_i == item_count - 1 ? Item::NodeType::Output
+                                                         : Item::NodeType::Internal;
+            factory.items[items.back()] = Item{type, 0, fmt::format("Item {}", item_i)};
+        }
+        const auto machine_count = 1 + random(3);
+        for (int machine_i = 0; machine_i < machine_count; machine_i++) {
+            Machine machine;
+            for (auto inputs = 1 + random(2); inputs > 0; inputs--) {
+                machine.inputs.push_back(ItemStream{items[random(item_count - 1)],
+                                                    static_cast<Quantity>(1 + random(3)),
+                                                    Uid(next_uid++)});
+            }
+            for (auto outputs = 1 + random(2); outputs > 0; outputs--) {
+                machine.outputs.push_back(ItemStream{items[1 + random(item_count - 1)],
+                                                     static_cast<Quantity>(1 + random(3)),
+                                                     Uid(next_uid++)});
+            }
+            machine.op_time = util::ticks(5 + random(40));
+            factory.machines[Uid(next_uid++)] = std::move(machine);
+        }
+        const double target = 1 + random(30);
+
+        // The net rate of every item, per copy of every machine
+        std::vector<std::vector<double>> rates(item_count, std::vector<double>(machine_count));
+        std::size_t column = 0;
+        for (const auto& [machine_uid, machine] : factory.machines) {
+            const auto cycles_per_minute =
+                ticks_per_minute / static_cast<double>(machine.op_time.count());
+            for (const auto& input : machine.inputs) {
+                rates[input.item.value - 1][column] -=
+                    static_cast<double>(input.quantity) * cycles_per_minute;
+            }
+            for (const auto& output : machine.outputs) {
+                rates[output.item.value - 1][column] +=
+                    static_cast<double>(output.quantity) * cycles_per_minute;
+            }
+            column++;
+        }
+        const auto meets_targets = [&](const std::vector<std::size_t>& counts) {
+            for (int item_i = 1; item_i < item_count; item_i++) {
+                double net = 0;
+                for (std::size_t machine_i = 0; machine_i < counts.size(); machine_i++) {
+                    net += rates[item_i][machine_i] * static_cast<double>(counts[machine_i]);
+                }
+                if (net < (item_i == item_count - 1 ? target : 0) - 1e-7) {
+                    return false;
+                }
+            }
+            return true;
+        };
+
+        std::optional<std::size_t> fewest;
+        std::vector<std::size_t> counts(machine_count);
+        std::size_t combinations = 1;
+        for (int machine_i = 0; machine_i < machine_count; machine_i++) {
+            combinations *= max_count + 1;
+        }
+        for (std::size_t combination = 0; combination < combinations; combination++) {
+            auto rest = combination;
+            for (auto& count : counts) {
+                count = rest % (max_count + 1);
+                rest /= max_count + 1;
+            }
+            const auto total = std::accumulate(counts.begin(), counts.end(), std::size_t(0));
+            if ((!fewest || total < *fewest) && meets_targets(counts)) {
+                fewest = total;
+            }
+        }
+
+        const std::vector<sim::RateTarget> targets{{items.back(), target}};
+        sim::MachineCountOptions options;
+        options.validation_ticks = 0;
+        const auto solved = sim::solve_machine_counts(factory, targets, options);
+        if (!solved) {
+            test::check(!fewest, fmt::format("factory {}: counts are found", seed));
+            continue;
+        }
+        const auto total =
+            std::accumulate(solved->counts.begin(), solved->counts.end(), std::size_t(0));
+        test::check(meets_targets(solved->counts),
+                    fmt::format("factory {}: the counts meet the target", seed));
+        // Counts over the bound may add up to fewer machines, but never to more
+        test::check(!fewest || total <= *fewest,
+                    fmt::format("factory {}: {} machines instead of {}", seed, total,
+                                fewest.value_or(0)));
+    }
+}
+
+} // namespace
+
+int main() {
+    check_circuits(Objective::MachineCount, {39, 2, 2});
+    check_circuits(Objective::Surplus, {45, 2, 3});
+
+    // Targets without any machine producing them can't be met
+    const CircuitFactory circuits;
+    const std::vector<sim::RateTarget> ore_target{{circuits.ore, 10}};
+    test::check(!sim::solve_machine_counts(circuits.factory, ore_target),
+                "inputs can't be targeted");
+
+    // Copies of machines get their own UIDs
+    UidPool uid_pool(Uid(1000));
+    const std::vector<std::size_t> counts{3, 0, 2};
+    const auto machines = sim::repeat_machines(circuits.factory.machines, counts, uid_pool);
+    std::unordered_set<Uid> uids;
+    for (const auto& [machine_uid, machine] : machines) {
+        uids.emplace(machine_uid);
+        for (const auto& stream : machine.inputs) {
+            uids.emplace(stream.uid);
+        }
+        for (const auto& stream : machine.outputs) {
+            uids.emplace(stream.uid);
+        }
+    }
+    // Smelters have 2 streams and assemblers 3
+    test::check(machines.size() == 5 && uids.size() == 3 * (1 + 2) + 2 * (1 + 3),
+                "machines are repeated with new UIDs");
+
+    check_random_factories();
+    return test::exit_code();
+}
\ No newline at end of file
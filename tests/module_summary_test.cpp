@@ -0,0 +1,110 @@
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fmt/core.h>
+#include <string_view>
+
+#include "check.hpp"
+#include "io/factory_file.hpp"
+#include "io/module_library.hpp"
+#include "sim/module_summary.hpp"
+
+using namespace fmk;
+
+namespace {
+
+/// Ore smelted into plates every 4 ticks, pressed two at a time into gears every `press_time`.
+Factory make_gear_module(TickCount press_time) {
+    Factory module;
+    module.items[Uid(1)] = Item{Item::NodeType::Input, 0, "Ore", Uid(100)};
+    module.items[Uid(2)] = Item{Item::NodeType::Internal, 0, "Plate"};
+    module.items[Uid(3)] = Item{Item::NodeType::Output, 0, "Gear", Uid(101)};
+    module.machines[Uid(10)] =
+        Machine{"Smelter", {{Uid(1), 1, Uid(11)}}, {{Uid(2), 1, Uid(12)}}, util::ticks(4)};
+    module.machines[Uid(20)] =
+        Machine{"Press", {{Uid(2), 2, Uid(21)}}, {{Uid(3), 1, Uid(22)}}, util::ticks(press_time)};
+    return module;
+}
+
+const sim::ModuleSummary::Flow* find_flow(const sim::ModuleSummary& summary,
+                                          std::string_view item) {
+    const auto flow = std::find_if(summary.flows.begin(), summary.flows.end(),
+                                   [&](const auto& flow) { return flow.item == item; });
+    return flow != summary.flows.end() ? &*flow : nullptr;
+}
+
+void check_embedding(const sim::ModuleSummary& summary) {
+    Factory factory;
+    UidPool uid_pool(Uid(1000));
+    factory.items[Uid(1)] = Item{Item::NodeType::Input, 0, "Ore", Uid(2)};
+    const auto first = sim::embed_module(factory, uid_pool, summary);
+    const auto second = sim::embed_module(factory, uid_pool, summary);
+    const auto gear = std::find_if(factory.items.begin(), factory.items.end(),
+                                   [](const auto& item) { return item.second.name == "Gear"; });
+    if (!test::check(factory.items.size() == 2 && gear != factory.items.end() &&
+                         gear->second.type == Item::NodeType::Output,
+                     "embedding adds the missing items once")) {
+        return;
+    }
+    const auto& machine = factory.machines.at(first);
+    test::check(first != second &&
+                    machine.op_time == util::ticks(static_cast<TickCount>(summary.period)) &&
+                    machine.inputs.size() == 1 && machine.inputs[0].item == Uid(1) &&
+                    machine.outputs.size() == 1 && machine.outputs[0].item == gear->first,
+                "every module is a machine taking a period");
+
+    // Both modules make their gears every period
+    constexpr std::size_t ticks = 1000;
+    const auto cache = factory.generate_cache(ticks);
+    const auto periods = ticks / summary.period - 2;
+    const auto gears_made = cache.quantity_at(gear->first, ticks - 1) -
+                            cache.quantity_at(gear->first, ticks - 1 - periods * summary.period);
+    const auto gears_per_period = find_flow(summary, "Gear")->per_period;
+    test::check(gears_made == static_cast<Quantity>(2 * periods) * gears_per_period,
+                fmt::format("the modules make {} gears in {} periods", gears_made, periods));
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const auto summary = sim::summarize_module("Gears", make_gear_module(8), 1000);
+    if (test::check(summary.has_value(), "the module gets to a steady state")) {
+        const auto ore = find_flow(*summary, "Ore");
+        const auto gear = find_flow(*summary, "Gear");
+        // A gear every 8 ticks, from an ore every 4
+        test::check(ore && gear && !find_flow(*summary, "Plate") && summary->flows.size() == 2,
+                    "only inputs and outputs flow");
+        if (ore && gear) {
+            test::check(summary->period % 8 == 0 &&
+                            gear->per_period * 8 == static_cast<Quantity>(summary->period) &&
+                            ore->per_period * 4 == -static_cast<Quantity>(summary->period),
+                        fmt::format("{} gears and {} ore every {} ticks", gear->per_period,
+                                    ore->per_period, summary->period));
+            test::check(gear->warmup.size() == summary->warmup_ticks &&
+                            ore->warmup.size() == summary->warmup_ticks,
+                        "the warm-up has the change at every tick");
+        }
+        check_embedding(*summary);
+    }
+
+    // Two windows of the operation times of every machine have to fit in the ticks simulated
+    test::check(!sim::summarize_module("Too long", make_gear_module(8), 12),
+                "modules that can't repeat themselves within the ticks aren't summarized");
+
+    // Files are only summarized again once they change
+    const auto path = std::filesystem::path(argc > 1 ? argv[1] : ".") / "Gears.fmkb";
+    io::ModuleLibrary library;
+    io::save_factory_file(path, make_gear_module(8), UidPool(Uid(1000)), {}, 1000);
+    const auto from_file = library.get(path);
+    test::check(from_file && from_file->name == "Gears" && library.get(path) == from_file,
+                "summaries of files are reused");
+    io::save_factory_file(path, make_gear_module(16), UidPool(Uid(1000)), {}, 1000);
+    std::filesystem::last_write_time(path, std::filesystem::last_write_time(path) +
+                                               std::chrono::seconds(1));
+    const auto changed = library.get(path);
+    test::check(changed && changed != from_file && changed->period % 16 == 0,
+                "changed files are summarized again");
+    std::filesystem::remove(path);
+
+    return test::exit_code();
+}
\ No newline at end of file
@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <fmt/core.h>
+#include <vector>
+
+#include "check.hpp"
+#include "random_factory.hpp"
+#include "sim/monte_carlo.hpp"
+#include "sim/simulation.hpp"
+#include "util/background_job.hpp"
+
+using namespace fmk;
+
+namespace {
+
+/// Crosses the blocks of ticks that replicas are reduced by.
+constexpr std::size_t ticks_to_simulate = 700;
+
+/// The seed of every replica, derived the same way as by `run_monte_carlo`.
+std::uint64_t replica_seed(std::uint64_t seed, std::size_t replica) {
+    auto mixed = seed + (replica + 1) * 0x9e3779b97f4a7c15;
+    mixed = (mixed ^ (mixed >> 30)) * 0xbf58476d1ce4e5b9;
+    mixed = (mixed ^ (mixed >> 27)) * 0x94d049bb133111eb;
+    return mixed ^ (mixed >> 31);
+}
+
+/// Replicas simulated one at a time.
+struct Replicas {
+    /// The quantity of every item at the end of every tick: `[replica][tick][item_i]`.
+    std::vector<std::vector<std::vector<Quantity>>> stocks;
+    std::size_t overflowed = 0;
+};
+
+Replicas simulate_replicas(const Factory& factory, std::size_t replicas, std::uint64_t seed) {
+    Replicas result;
+    result.stocks.resize(replicas);
+    for (std::size_t replica = 0; replica < replicas; replica++) {
+        sim::Simulation simulation(factory.items, factory.machines);
+        simulation.randomize(replica_seed(seed, replica));
+        bool overflowed = false;
+        for (std::size_t tick = 0; tick < ticks_to_simulate; tick++) {
+            // Overflowed replicas keep their quantities until the end
+            overflowed = overflowed || !simulation.step();
+            const auto stock = simulation.stock();
+            result.stocks[replica].emplace_back(stock.begin(), stock.end());
+        }
+        result.overflowed += overflowed;
+    }
+    return result;
+}
+
+/// The value at a percentile of `values`, by sorting them all.
+Quantity percentile(std::vector<Quantity> values, std::size_t percent) {
+    std::sort(values.begin(), values.end());
+    return values[(values.size() - 1) * percent / 100];
+}
+
+void check_stochastic(std::uint32_t factory_seed) {
+    const auto factory = test::random_factory(factory_seed, factory_seed % 5 == 0);
+    constexpr std::size_t replicas = 21;
+    constexpr std::uint64_t seed = 7;
+    const auto result = sim::run_monte_carlo(factory, ticks_to_simulate, replicas, seed, 4);
+    if (!test::check(result.ticks_simulated == ticks_to_simulate && !result.cancelled,
+                     fmt::format("factory {}: every tick is simulated", factory_seed))) {
+        return;
+    }
+
+    // The bands are the percentiles of the replicas simulated on their own
+    const auto simulated = simulate_replicas(factory, replicas, seed);
+    test::check(result.overflowed_replicas == simulated.overflowed,
+                fmt::format("factory {}: {} replicas overflowed, not {}", factory_seed,
+                            simulated.overflowed, result.overflowed_replicas));
+
+    const sim::Simulation reference(factory.items, factory.machines);
+    std::size_t mismatches = 0;
+    std::vector<Quantity> values(replicas);
+    for (std::uint32_t item_i = 0; item_i < reference.flat_factory().item_count; item_i++) {
+        const auto& bands = result.bands.at(reference.item_uid(item_i));
+        for (std::size_t tick = 0; tick < ticks_to_simulate; tick++) {
+            for (std::size_t replica = 0; replica < replicas; replica++) {
+                values[replica] = simulated.stocks[replica][tick][item_i];
+            }
+            const auto low = bands.low.values()[tick];
+            const auto median = bands.median.values()[tick];
+            const auto high = bands.high.values()[tick];
+            mismatches += low != percentile(values, sim::MonteCarloResult::low_percentile) ||
+                          median != percentile(values, 50) ||
+                          high != percentile(values, sim::MonteCarloResult::high_percentile) ||
+                          low > median || median > high;
+        }
+    }
+    test::check(mismatches == 0, fmt::format("factory {}: {} ticks have different percentiles",
+                                             factory_seed, mismatches));
+
+    // Results don't depend on how many threads simulate
+    const auto single_worker = sim::run_monte_carlo(factory, ticks_to_simulate, replicas, seed, 1);
+    bool is_same = true;
+    for (const auto& [item_uid, bands] : result.bands) {
+        const auto& other = single_worker.bands.at(item_uid);
+        is_same = is_same && std::ranges::equal(bands.low.values(), other.low.values()) &&
+                  std::ranges::equal(bands.median.values(), other.median.values()) &&
+                  std::ranges::equal(bands.high.values(), other.high.values());
+    }
+    test::check(is_same, fmt::format("factory {}: one worker gives the same bands", factory_seed));
+}
+
+/// Without randomness, every band is the plot of the deterministic simulation.
+void check_deterministic(std::uint32_t factory_seed) {
+    auto factory = test::random_factory(factory_seed);
+    for (auto& [machine_uid, machine] : factory.machines) {
+        machine.op_time_distribution = {};
+        for (auto& output : machine.outputs) {
+            output.probability = 1.f;
+        }
+    }
+    const auto result = sim::run_monte_carlo(factory, ticks_to_simulate, 9, 3);
+    const auto cache = factory.generate_cache(ticks_to_simulate);
+    for (const auto& [item_uid, item] : factory.items) {
+        const auto plot = cache.make_plot(item_uid);
+        const auto& bands = result.bands.at(item_uid);
+        // Monte Carlo replicas go on after an overflow, keeping their quantities
+        const auto ticks = std::min(result.ticks_simulated, cache.ticks_simulated());
+        std::size_t mismatches = 0;
+        for (std::size_t tick = 0; tick < ticks; tick++) {
+            const auto quantity = plot.values()[tick];
+            mismatches += bands.low.values()[tick] != quantity ||
+                          bands.median.values()[tick] != quantity ||
+                          bands.high.values()[tick] != quantity;
+        }
+        test::check(mismatches == 0,
+                    fmt::format("factory {}: {} ticks differ from the simulation of item {}",
+                                factory_seed, mismatches, item_uid.value));
+    }
+}
+
+} // namespace
+
+int main() {
+    for (std::uint32_t seed = 0; seed < 20; seed++) {
+        check_stochastic(seed);
+        check_deterministic(seed);
+    }
+
+    // Cancelling keeps no partial ticks
+    const auto factory = test::random_factory(1);
+    util::JobProgress progress;
+    progress.cancel();
+    const auto cancelled = sim::run_monte_carlo(factory, ticks_to_simulate, 5, 1, 2, &progress);
+    test::check(cancelled.cancelled && cancelled.ticks_simulated == 0,
+                "a cancelled simulation has no ticks");
+
+    return test::exit_code();
+}
\ No newline at end of file
@@ -0,0 +1,178 @@
+#include <algorithm>
+#include <cstdint>
+#include <fmt/core.h>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "check.hpp"
+#include "io/plot_export.hpp"
+#include "random_factory.hpp"
+
+using namespace fmk;
+using Downsampling = io::PlotExportOptions::Downsampling;
+
+namespace {
+
+/// Rows of exported values, column by column.
+using Table = std::vector<std::vector<std::int64_t>>;
+
+/// What the export of the given plots should contain, sampled like the documentation of
+/// `PlotExportOptions` says.
+Table expected_table(const std::vector<std::vector<Quantity>>& plots,
+                     const io::PlotExportOptions& options) {
+    const auto bucket = options.downsampling == Downsampling::None ? 1 : options.bucket_size;
+    Table table;
+    for (const auto& values : plots) {
+        std::vector<std::int64_t> samples, maxima;
+        for (std::size_t first = 0; first < values.size(); first += bucket) {
+            const auto last = std::min(first + bucket, values.size());
+            if (options.downsampling == Downsampling::MinMax) {
+                const auto [min, max] =
+                    std::minmax_element(values.begin() + first, values.begin() + last);
+                samples.push_back(*min);
+                maxima.push_back(*max);
+            } else {
+                samples.push_back(values[first]);
+            }
+        }
+        table.push_back(std::move(samples));
+        if (options.downsampling == Downsampling::MinMax) {
+            table.push_back(std::move(maxima));
+        }
+    }
+    return table;
+}
+
+/// Parses the values of a CSV export, checking its ticks and skipping its header.
+Table parse_csv(std::istream& in, std::size_t column_count, std::size_t bucket) {
+    Table table(column_count);
+    std::string line;
+    std::getline(in, line);
+    for (std::size_t row = 0; std::getline(in, line); row++) {
+        std::istringstream fields(line);
+        std::string field;
+        std::getline(fields, field, ',');
+        if (std::stoull(field) != row * bucket) {
+            return {};
+        }
+        for (auto& column : table) {
+            std::getline(fields, field, ',');
+            column.push_back(std::stoll(field));
+        }
+    }
+    return table;
+}
+
+template<typename T> T read_le(std::istream& in) {
+    std::uint64_t value = 0;
+    for (std::size_t byte_i = 0; byte_i < sizeof(T); byte_i++) {
+        value |= static_cast<std::uint64_t>(static_cast<std::uint8_t>(in.get())) << (byte_i * 8);
+    }
+    return static_cast<T>(value);
+}
+
+std::uint64_t read_varint(std::istream& in) {
+    std::uint64_t value = 0;
+    for (int shift = 0;; shift += 7) {
+        const auto byte = static_cast<std::uint8_t>(in.get());
+        value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+        if (byte < 0x80 || !in) {
+            return value;
+        }
+    }
+}
+
+/// Decodes a columnar export, following the layout documented in `export_plots_columnar()`.
+Table parse_columnar(std::istream& in, std::size_t bucket) {
+    std::string magic(4, '\0');
+    in.read(magic.data(), 4);
+    read_le<std::uint32_t>(in);
+    read_le<std::uint32_t>(in);
+    if (magic != "FMKS" || read_le<std::uint64_t>(in) != bucket) {
+        return {};
+    }
+    const auto row_count = read_le<std::uint64_t>(in);
+    Table table(read_le<std::uint32_t>(in));
+    for (std::size_t column_i = 0; column_i < table.size(); column_i++) {
+        in.ignore(read_le<std::uint32_t>(in));
+    }
+
+    std::vector<std::uint64_t> last_values(table.size());
+    for (std::size_t rows = 0; rows < row_count && in;) {
+        const auto chunk_rows = read_le<std::uint32_t>(in);
+        for (std::size_t column_i = 0; column_i < table.size(); column_i++) {
+            const auto byte_count = read_le<std::uint32_t>(in);
+            const auto end = in.tellg() + static_cast<std::streamoff>(byte_count);
+            while (in && in.tellg() < end) {
+                const auto delta = read_varint(in);
+                const auto repeats = read_varint(in);
+                for (std::uint64_t repeat = 0; repeat < repeats; repeat++) {
+                    last_values[column_i] += (delta >> 1) ^ (~(delta & 1) + 1);
+                    table[column_i].push_back(static_cast<std::int64_t>(last_values[column_i]));
+                }
+            }
+        }
+        rows += chunk_rows;
+    }
+    return table;
+}
+
+void check_factory(std::uint32_t seed) {
+    const auto factory = test::random_factory(seed, seed % 5 == 0);
+    const auto cache = factory.generate_cache(1000);
+    std::mt19937 rng(seed);
+    std::vector<Uid> items;
+    std::vector<std::vector<Quantity>> plots;
+    for (const auto& [item_uid, item] : factory.items) {
+        if (rng() % 3 == 0) {
+            items.push_back(item_uid);
+            const auto plot = cache.make_plot(item_uid);
+            plots.emplace_back(plot.values().begin(), plot.values().end());
+        }
+    }
+
+    for (const auto downsampling :
+         {Downsampling::None, Downsampling::EveryNth, Downsampling::MinMax}) {
+        io::PlotExportOptions options;
+        options.downsampling = downsampling;
+        options.bucket_size = 1 + rng() % 50;
+        // Small chunks, so that values and runs of deltas span several of them
+        options.chunk_rows = 1 + rng() % 40;
+        const auto expected = expected_table(plots, options);
+        const auto bucket = downsampling == Downsampling::None ? 1 : options.bucket_size;
+        const auto what = fmt::format("factory {}, downsampling {}, buckets of {}", seed,
+                                      static_cast<int>(downsampling), options.bucket_size);
+
+        std::stringstream csv;
+        io::export_plots_csv(csv, factory, cache, items, options);
+        test::check(parse_csv(csv, expected.size(), bucket) == expected,
+                    fmt::format("{}: CSV values", what));
+
+        std::stringstream columnar;
+        io::export_plots_columnar(columnar, factory, cache, items, options);
+        test::check(parse_columnar(columnar, bucket) == expected,
+                    fmt::format("{}: columnar values", what));
+    }
+}
+
+} // namespace
+
+int main() {
+    for (std::uint32_t seed = 0; seed < 30; seed++) {
+        check_factory(seed);
+    }
+
+    auto factory = test::random_factory(1);
+    factory.items.begin()->second.name = "Iron \"plate\", rolled";
+    const std::vector<Uid> items{factory.items.begin()->first};
+    std::stringstream csv;
+    io::export_plots_csv(csv, factory, factory.generate_cache(10), items);
+    std::string header;
+    std::getline(csv, header);
+    test::check(header == "tick,\"Iron \"\"plate\"\", rolled\"",
+                "names are quoted in CSV headers");
+
+    return test::exit_code();
+}
\ No newline at end of file
@@ -0,0 +1,80 @@
+#include <algorithm>
+#include <fmt/core.h>
+#include <random>
+#include <span>
+#include <vector>
+
+#include "check.hpp"
+#include "util/quantity_log.hpp"
+
+using namespace fmk;
+
+namespace {
+
+/// Records random changes, rarely at first and then at most ticks so that the log switches to
+/// storing every tick partway through, and checks it against the value of every tick.
+void check_random_log(std::uint32_t seed) {
+    std::mt19937 rng(seed);
+    const auto starting_value = static_cast<Quantity>(rng() % 100);
+    util::QuantityLog log(starting_value);
+    // The value at the end of every tick until the last one recorded
+    std::vector<Quantity> expected;
+
+    const auto sparse_ticks = rng() % 2000;
+    const auto dense_ticks = rng() % 3 == 0 ? 0 : rng() % 2000;
+    std::size_t tick = rng() % 3;
+    while (tick < sparse_ticks + dense_ticks) {
+        const auto value = static_cast<Quantity>(rng() % 200) - 50;
+        expected.resize(tick, expected.empty() ? starting_value : expected.back());
+        expected.push_back(value);
+        log.record(tick, value);
+        // The same tick recorded again replaces its value
+        if (rng() % 5 == 0) {
+            expected.back() = value + 1;
+            log.record(tick, value + 1);
+        }
+        tick += 1 + (tick < sparse_ticks ? rng() % 300 : rng() % 4 / 3);
+    }
+
+    const auto what = fmt::format("seed {} with {} ticks", seed, expected.size());
+    const auto length = expected.size() + 50;
+    auto every_tick = expected;
+    every_tick.resize(length, expected.empty() ? starting_value : expected.back());
+
+    std::size_t mismatches = 0;
+    for (std::size_t value_tick = 0; value_tick < length; value_tick++) {
+        mismatches += log.value_at(value_tick) != every_tick[value_tick];
+    }
+    test::check(mismatches == 0,
+                fmt::format("{}: {} values differ, including after the last tick", what,
+                            mismatches));
+
+    const auto plot = log.to_plot(length);
+    test::check(std::ranges::equal(plot.values(), every_tick), fmt::format("{}: plot", what));
+    const auto shorter_plot = log.to_plot(expected.size() / 2);
+    test::check(std::ranges::equal(shorter_plot.values(),
+                                   std::span(every_tick).first(expected.size() / 2)),
+                fmt::format("{}: plot of the first half", what));
+
+    for (int window_i = 0; window_i < 20; window_i++) {
+        const auto first_tick = rng() % length;
+        std::vector<Quantity> window(rng() % (length - first_tick + 1));
+        log.copy_values(first_tick, window);
+        test::check(std::ranges::equal(window, std::span(every_tick).subspan(first_tick,
+                                                                              window.size())),
+                    fmt::format("{}: copy of {} ticks from {}", what, window.size(), first_tick));
+    }
+
+    const auto expected_max =
+        expected.empty() ? starting_value : *std::max_element(expected.begin(), expected.end());
+    test::check(log.max_value() == expected_max, fmt::format("{}: maximum", what));
+}
+
+} // namespace
+
+int main() {
+    for (std::uint32_t seed = 0; seed < 200; seed++) {
+        check_random_log(seed);
+    }
+    return test::exit_code();
+}
\ No newline at end of file
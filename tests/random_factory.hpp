@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "factory.hpp"
+
+namespace fmk::test {
+
+/// Builds a random factory, the same for a given seed: machines with any number of streams over
+/// a few items, including empty machines, zero and negative quantities, chances and random
+/// operation times. With `has_extreme_quantities`, some streams move huge quantities so that
+/// simulations overflow.
+inline Factory random_factory(std::uint32_t seed, bool has_extreme_quantities = false) {
+    std::mt19937 rng(seed);
+    const auto random = [&rng](int n) {
+        return static_cast<int>(rng() % static_cast<unsigned>(n));
+    };
+
+    Factory factory;
+    Uid::ValueT next_uid = 1;
+    const auto new_uid = [&next_uid] { return Uid(next_uid++); };
+
+    std::vector<Uid> items;
+    const auto item_count = 5 + random(40);
+    for (int i = 0; i < item_count; i++) {
+        const auto item_uid = new_uid();
+        const auto type = static_cast<Item::NodeType>(random(3));
+        factory.items[item_uid] =
+            Item{type, static_cast<Quantity>(random(5)), "item", new_uid()};
+        items.emplace_back(item_uid);
+    }
+
+    const auto machine_count = 1 + random(120);
+    for (int m = 0; m < machine_count; m++) {
+        Machine machine;
+        for (auto inputs = random(5); inputs > 0; inputs--) {
+            auto quantity = static_cast<Quantity>(random(4) - (random(10) == 0));
+            if (has_extreme_quantities && random(5) == 0) {
+                quantity = random(2) ? std::numeric_limits<Quantity>::min()
+                                     : std::numeric_limits<Quantity>::max() / 3;
+            }
+            machine.inputs.push_back(ItemStream{items[random(item_count)], quantity, new_uid()});
+        }
+        for (auto outputs = random(4); outputs > 0; outputs--) {
+            auto quantity = static_cast<Quantity>(random(4));
+            if (has_extreme_quantities && random(5) == 0) {
+                quantity = std::numeric_limits<Quantity>::max() / 2;
+            }
+            machine.outputs.push_back(ItemStream{items[random(item_count)], quantity, new_uid(),
+                                                 random(3) ? 1.f : .5f});
+        }
+        machine.op_time = util::ticks(random(30) - 2);
+        if (random(3) == 0) {
+            machine.op_time_distribution = OpTimeDistribution{
+                random(2) ? OpTimeDistribution::Type::Uniform : OpTimeDistribution::Type::Normal,
+                util::ticks(random(5))};
+        }
+        factory.machines[new_uid()] = std::move(machine);
+    }
+    return factory;
+}
+
+} // namespace fmk::test
\ No newline at end of file
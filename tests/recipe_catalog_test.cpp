@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <fmt/core.h>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "check.hpp"
+#include "io/recipe_catalog.hpp"
+
+using namespace fmk;
+
+namespace {
+
+constexpr std::string_view recipes_json = R"({"recipes": [
+    {"name": "Plate", "time": 4, "inputs": {"Ore": 1}, "outputs": {"Iron Plate": 1}},
+    {"name": "Gear", "time": 8, "inputs": {"Iron Plate": 2}, "outputs": {"Gear": 1}},
+    {"name": "Gear", "time": 99, "outputs": {"Scrap": 1}},
+    {"name": "Engine", "time": 30, "inputs": {"Gear": 3, "Iron Plate": 1},
+     "outputs": {"Engine": 1}}
+]})";
+
+/// The same recipes as `recipes_json`, with columns in another order and quoted fields.
+constexpr std::string_view recipes_csv = "outputs,notes,name,time,inputs\n"
+                                         "1 Iron Plate,,Plate,4,1 Ore\n"
+                                         "1 Gear,\"smelted, then pressed\",Gear,8,2 Iron Plate\n"
+                                         "1 Scrap,,Gear,99,\n"
+                                         "1 Engine,,\"Engine\",30,\"3 Gear; 1 Iron Plate\"\n"
+                                         "\n";
+
+/// The streams of a recipe, with the names of their items.
+std::vector<std::pair<std::string_view, Quantity>> named_streams(
+    const io::RecipeCatalog& catalog, std::span<const io::RecipeCatalog::Stream> streams) {
+    std::vector<std::pair<std::string_view, Quantity>> named;
+    for (const auto& stream : streams) {
+        named.emplace_back(catalog.item_name(stream.item), stream.quantity);
+    }
+    return named;
+}
+
+/// Both formats give the recipes in order, skipping the second "Gear", with every item once.
+void check_catalog(const std::optional<io::RecipeCatalog>& catalog, std::string_view format) {
+    if (!test::check(catalog.has_value(), fmt::format("{}: the recipes are parsed", format))) {
+        return;
+    }
+    test::check(catalog->recipe_count() == 3 && catalog->recipe_name(0) == "Plate" &&
+                    catalog->recipe_name(1) == "Gear" && catalog->recipe_name(2) == "Engine",
+                fmt::format("{}: recipes are in order, without the duplicate", format));
+    test::check(std::ranges::all_of(std::vector<std::string_view>{"Ore", "Iron Plate", "Gear",
+                                                                  "Engine"},
+                                    [&](std::string_view name) {
+                                        const auto item = catalog->find_item(name);
+                                        return item && catalog->item_name(*item) == name;
+                                    }),
+                fmt::format("{}: items are found by name", format));
+    const auto gear = catalog->find_recipe("Gear");
+    const auto engine = catalog->find_recipe("Engine");
+    if (!test::check(gear && engine, fmt::format("{}: recipes are found by name", format))) {
+        return;
+    }
+    using Streams = std::vector<std::pair<std::string_view, Quantity>>;
+    test::check(catalog->op_time(*gear) == util::ticks(8) &&
+                    named_streams(*catalog, catalog->inputs(*gear)) ==
+                        Streams{{"Iron Plate", 2}} &&
+                    named_streams(*catalog, catalog->outputs(*gear)) == Streams{{"Gear", 1}},
+                fmt::format("{}: the first recipe of a name is kept", format));
+    const auto engine_inputs = named_streams(*catalog, catalog->inputs(*engine));
+    test::check(std::ranges::is_permutation(engine_inputs,
+                                            Streams{{"Gear", 3}, {"Iron Plate", 1}}) &&
+                    catalog->inputs(*engine)[0].item != catalog->inputs(*engine)[1].item,
+                fmt::format("{}: streams refer to the items they name", format));
+}
+
+} // namespace
+
+int main() {
+    check_catalog(io::parse_recipes_json(recipes_json), "JSON");
+    check_catalog(io::parse_recipes_csv(recipes_csv), "CSV");
+
+    test::check(!io::parse_recipes_json(R"([{"name": "Gear", "time": 0}])") &&
+                    !io::parse_recipes_json(R"([{"name": "Gear", "time": 8, "inputs": 2}])") &&
+                    !io::parse_recipes_json(R"({"gears": []})") &&
+                    !io::parse_recipes_csv("name,time\nGear,eight\n") &&
+                    !io::parse_recipes_csv("name,inputs\nGear,1 Plate\n") &&
+                    !io::parse_recipes_csv("name,time,inputs\nGear,8,Plate\n"),
+                "invalid recipes are errors");
+
+    // Names are kept even once the catalog is moved
+    auto catalog = *io::parse_recipes_json(recipes_json);
+    const auto item_name = catalog.item_name(0);
+    const auto moved = std::move(catalog);
+    test::check(moved.item_name(0).data() == item_name.data() && moved.find_recipe("Plate"),
+                "names survive moving the catalog");
+
+    // Items of the factory with the same names are used, and the missing ones are added
+    Factory factory;
+    UidPool uid_pool(Uid(1000));
+    const Uid ore(1);
+    factory.items[ore] = Item{Item::NodeType::Input, 50, "Ore", Uid(2)};
+    const std::vector<io::RecipeCatalog::Index> recipes{*moved.find_recipe("Plate"),
+                                                        *moved.find_recipe("Gear"),
+                                                        *moved.find_recipe("Gear")};
+    const auto machine_uids = io::instantiate_recipes(factory, uid_pool, moved, recipes);
+    const auto find_item = [&](std::string_view name) {
+        return std::find_if(factory.items.begin(), factory.items.end(),
+                            [&](const auto& item) { return item.second.name == name; });
+    };
+    const auto plate = find_item("Iron Plate");
+    const auto gear = find_item("Gear");
+    if (test::check(machine_uids.size() == 3 && factory.machines.size() == 3 &&
+                        factory.items.size() == 3 && plate != factory.items.end() &&
+                        gear != factory.items.end(),
+                    "a machine per recipe, and the missing items once")) {
+        test::check(plate->second.type == Item::NodeType::Internal &&
+                        gear->second.type == Item::NodeType::Output &&
+                        factory.items.at(ore).starting_quantity == 50,
+                    "added items are typed by how the recipes use them");
+        const auto& smelter = factory.machines.at(machine_uids[0]);
+        const auto& press = factory.machines.at(machine_uids[2]);
+        test::check(smelter.name == "Plate" && smelter.op_time == util::ticks(4) &&
+                        smelter.inputs.size() == 1 && smelter.inputs[0].item == ore &&
+                        press.name == "Gear" && press.inputs.size() == 1 &&
+                        press.inputs[0].item == plate->first && press.inputs[0].quantity == 2 &&
+                        press.outputs.size() == 1 && press.outputs[0].item == gear->first,
+                    "machines take their streams from the recipes");
+        const auto cache = factory.generate_cache(100);
+        test::check(cache.quantity_at(gear->first, 99) > 0, "the machines make gears");
+    }
+
+    return test::exit_code();
+}
\ No newline at end of file
@@ -0,0 +1,83 @@
+#include <algorithm>
+#include <filesystem>
+#include <fmt/core.h>
+#include <vector>
+
+#include "check.hpp"
+#include "io/simulation_cache.hpp"
+#include "random_factory.hpp"
+#include "sim/stop_condition.hpp"
+
+using namespace fmk;
+
+int main(int argc, char** argv) {
+    // Not named after the test, which is the name of its executable in the same directory
+    const auto directory =
+        std::filesystem::path(argc > 1 ? argv[1] : ".") / "simulation_cache_entries";
+    std::filesystem::remove_all(directory);
+    io::SimulationCache simulation_cache(directory, 64 * 1024 * 1024);
+
+    for (std::uint32_t seed = 0; seed < 20; seed++) {
+        const auto factory = test::random_factory(seed, seed % 5 == 0);
+        auto compacted = factory;
+        auto uid_pool = UidPool(Uid(1 << 20));
+        // Renumbered from the lowest UID, so none of them stays the same
+        compact_uids(compacted, uid_pool);
+        for (auto& [_, item] : compacted.items) { item.name = "renamed"; }
+
+        test::check(io::hash_factory(factory, 1000) == io::hash_factory(compacted, 1000),
+                    fmt::format("seed {}: UIDs and names don't change the hash", seed));
+        test::check(io::hash_factory(factory, 1000) != io::hash_factory(factory, 1001),
+                    fmt::format("seed {}: ticks change the hash", seed));
+
+        auto changed = factory;
+        changed.machines.begin()->second.op_time += util::ticks(1);
+        test::check(io::hash_factory(factory, 1000) != io::hash_factory(changed, 1000),
+                    fmt::format("seed {}: machines change the hash", seed));
+
+        const auto cache = factory.generate_cache(1000);
+        simulation_cache.store(factory, 1000, cache);
+        const auto loaded = simulation_cache.load(compacted, 1000);
+        if (!test::check(loaded.has_value(), fmt::format("seed {}: loading", seed))) {
+            continue;
+        }
+        for (std::size_t i = 0; i < factory.items.size(); i++) {
+            const auto expected = cache.make_plot(factory.items.begin()[i].first);
+            const auto actual = loaded->make_plot(compacted.items.begin()[i].first);
+            test::check(std::ranges::equal(expected.values(), actual.values()),
+                        fmt::format("seed {}: plot of item {}", seed, i));
+        }
+        test::check(loaded->overflow().has_value() == cache.overflow().has_value() &&
+                        (!cache.overflow() ||
+                         compacted.items.contains(loaded->overflow()->item)),
+                    fmt::format("seed {}: overflow", seed));
+        test::check(!simulation_cache.load(changed, 1000),
+                    fmt::format("seed {}: other factories aren't loaded", seed));
+
+        // Results that stopped early replace the ones above, and are found again by the ticks that
+        // were asked for. They stop once an item gets to its quantity halfway through.
+        const auto changing = std::ranges::find_if(factory.items, [&](const auto& entry) {
+            const auto plot = cache.make_plot(entry.first);
+            return plot.values()[500] != entry.second.starting_quantity;
+        });
+        if (cache.overflow() || changing == factory.items.end()) {
+            continue;
+        }
+        const auto halfway = cache.make_plot(changing->first).values()[500];
+        const std::vector<sim::StopCondition> stop_conditions{
+            halfway > changing->second.starting_quantity
+                ? sim::StopCondition::reaches(changing->first, halfway)
+                : sim::StopCondition::drops_to(changing->first, halfway)};
+        const auto stopped = factory.generate_cache(1000, nullptr, stop_conditions);
+        simulation_cache.store(factory, 1000, stopped);
+        const auto loaded_stopped = simulation_cache.load(factory, 1000);
+        test::check(stopped.ticks_simulated() <= 501 && loaded_stopped &&
+                        loaded_stopped->ticks_simulated() == stopped.ticks_simulated(),
+                    fmt::format("seed {}: results that stopped early", seed));
+        test::check(!simulation_cache.load(factory, stopped.ticks_simulated()),
+                    fmt::format("seed {}: results are not found by the ticks simulated", seed));
+    }
+    std::filesystem::remove_all(directory);
+
+    return test::exit_code();
+}
\ No newline at end of file
@@ -0,0 +1,189 @@
+#include <algorithm>
+#include <boost/json.hpp>
+#include <chrono>
+#include <filesystem>
+#include <fmt/core.h>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "check.hpp"
+#include "io/json_format.hpp"
+#include "random_factory.hpp"
+#include "server/simulation_server.hpp"
+
+#ifndef _WIN32
+#    include <sys/socket.h>
+#    include <sys/un.h>
+#    include <unistd.h>
+#endif
+
+namespace json = boost::json;
+using namespace fmk;
+
+namespace {
+
+constexpr std::size_t ticks_to_simulate = 500;
+
+/// Runs a batch and returns the results of its requests.
+json::array run_batch(server::SimulationServer& server, const json::value& requests) {
+    const auto response = json::parse(server.handle_batch(json::serialize(requests)));
+    return response.as_object().at("results").as_array();
+}
+
+bool is_ok(const json::value& result) {
+    return result.as_object().at("ok").as_bool();
+}
+
+/// Requests run against the resident factory give the results of simulating it directly, and
+/// invalid patches leave it untouched.
+void check_requests() {
+    auto factory = test::random_factory(4);
+    factory.items.begin()->second.name = "First";
+    std::stringstream factory_json;
+    io::write_factory_json(factory_json, factory, UidPool(Uid(1 << 20)), {}, ticks_to_simulate);
+    const auto document = io::parse_factory_json(factory_json);
+    if (!test::check(document.has_value(), "the factory is written as JSON")) {
+        return;
+    }
+    const auto cache = document->factory.generate_cache(ticks_to_simulate);
+    const auto first_uid = document->factory.items.begin()->first;
+    const auto first_key = std::to_string(first_uid.value);
+    const auto first_plot = cache.make_plot(first_uid);
+    const auto first_values = first_plot.values();
+
+    server::SimulationServer server(std::filesystem::path(), 2);
+    const auto loaded = run_batch(
+        server,
+        json::array{
+            json::object{{"op", "load"},
+                         {"name", "f"},
+                         {"factory", json::parse(factory_json.str())}},
+            json::object{{"op", "summary"}, {"name", "f"}},
+            json::object{{"op", "simulate"}, {"name", "f"}},
+            json::object{{"op", "series"}, {"name", "f"}, {"items", json::array{"First"}},
+                         {"every", 7}}});
+    if (!test::check(loaded.size() == 4 && is_ok(loaded[0]) && !is_ok(loaded[1]) &&
+                         is_ok(loaded[2]) && is_ok(loaded[3]),
+                     "loaded factories can only be queried once simulated")) {
+        return;
+    }
+
+    const auto& summary = loaded[2].as_object().at("items").as_object().at(first_key).as_object();
+    test::check(loaded[2].as_object().at("ticks").as_int64() == std::int64_t(ticks_to_simulate) &&
+                    summary.at("start").as_int64() == first_values.front() &&
+                    summary.at("final").as_int64() == first_values.back(),
+                "the summary matches a simulation of the factory");
+    const auto& series = loaded[3].as_object().at("series").as_object().at(first_key).as_array();
+    bool is_same_series = series.size() == (first_values.size() + 6) / 7;
+    for (std::size_t value_i = 0; is_same_series && value_i < series.size(); value_i++) {
+        is_same_series = series[value_i].as_int64() == first_values[value_i * 7];
+    }
+    test::check(is_same_series, "the series of an item, by name, keeps one tick out of 7");
+
+    // The first part of the patch is valid, but not the second, so nothing changes
+    const auto rejected = run_batch(
+        server,
+        json::array{
+            json::object{{"op", "patch"},
+                         {"name", "f"},
+                         {"items", json::object{{first_key, json::object{{"start_with", 99}}},
+                                                {"1234567", json::object{{"start_with", 1}}}}}},
+            json::object{{"op", "summary"}, {"name", "f"}}});
+    test::check(rejected.size() == 2 && !is_ok(rejected[0]) && is_ok(rejected[1]) &&
+                    rejected[1].as_object().at("items").as_object().at(first_key).as_object()
+                            .at("start")
+                            .as_int64() == first_values.front(),
+                "invalid patches are discarded entirely");
+
+    const auto patched = run_batch(
+        server,
+        json::array{
+            json::object{{"op", "patch"},
+                         {"name", "f"},
+                         {"items", json::object{{first_key, json::object{{"start_with", 99}}}}}},
+            json::object{{"op", "summary"}, {"name", "f"}},
+            json::object{{"op", "simulate"}, {"name", "f"}, {"ticks", 10}},
+            json::object{{"op", "unload"}, {"name", "f"}},
+            json::object{{"op", "summary"}, {"name", "f"}}});
+    test::check(patched.size() == 5 && is_ok(patched[0]) && !is_ok(patched[1]) &&
+                    is_ok(patched[2]) && is_ok(patched[3]) && !is_ok(patched[4]),
+                "patching drops the results, and unloading the factory");
+    if (patched.size() == 5 && is_ok(patched[2])) {
+        auto patched_factory = document->factory;
+        patched_factory.items.at(first_uid).starting_quantity = 99;
+        const auto patched_plot = patched_factory.generate_cache(10).make_plot(first_uid);
+        test::check(patched[2].as_object().at("items").as_object().at(first_key).as_object()
+                            .at("final")
+                            .as_int64() == patched_plot.values().back(),
+                    "patches are simulated");
+    }
+}
+
+#ifndef _WIN32
+
+/// Batches sent on the socket are answered on the same connection, each with its ID.
+void check_socket(const std::filesystem::path& directory) {
+    const auto socket_path = directory / "simulation_server_test.sock";
+    server::SimulationServer server(socket_path, 2);
+    bool is_listening = false;
+    std::thread server_thread([&] { is_listening = server.run(); });
+
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    const auto path = socket_path.string();
+    std::copy(path.begin(), path.end(), address.sun_path);
+    bool is_connected = false;
+    for (int attempt = 0; attempt < 100 && !is_connected; attempt++) {
+        is_connected =
+            ::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+        if (!is_connected) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+    }
+
+    std::string responses;
+    if (test::check(is_connected, "connecting to the server")) {
+        const std::string batches = R"({"id": 1, "requests": [{"op": "list"}]})"
+                                    "\n"
+                                    R"({"id": "two", "requests": [{"op": "unload", "name": "x"}]})"
+                                    "\n";
+        ::send(fd, batches.data(), batches.size(), 0);
+        char chunk[4096];
+        while (std::count(responses.begin(), responses.end(), '\n') < 2) {
+            const auto received = ::recv(fd, chunk, sizeof(chunk), 0);
+            if (received <= 0) {
+                break;
+            }
+            responses.append(chunk, static_cast<std::size_t>(received));
+        }
+    }
+    ::close(fd);
+    server.stop();
+    server_thread.join();
+
+    test::check(is_listening, "the server listens on the socket");
+    bool has_ids[2] = {false, false};
+    std::istringstream lines(responses);
+    for (std::string line; std::getline(lines, line);) {
+        const auto response = json::parse(line);
+        const auto& id = response.as_object().at("id");
+        has_ids[0] = has_ids[0] || (id.is_int64() && id.as_int64() == 1);
+        has_ids[1] = has_ids[1] || (id.is_string() && id.as_string() == "two");
+    }
+    test::check(has_ids[0] && has_ids[1], "every batch is answered with its ID");
+    test::check(!std::filesystem::exists(socket_path), "the socket is removed once stopped");
+}
+
+#endif
+
+} // namespace
+
+int main(int argc, char** argv) {
+    check_requests();
+#ifndef _WIN32
+    check_socket(argc > 1 ? argv[1] : ".");
+#endif
+    return test::exit_code();
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+#include <algorithm>
+#include <fmt/core.h>
+#include <optional>
+#include <string_view>
+
+#include "check.hpp"
+#include "io/factory_file.hpp"
+#include "random_factory.hpp"
+#include "sim/simulation.hpp"
+
+using namespace fmk;
+
+namespace {
+
+/// Simulates a factory with both engines, and checks that every tick gives the same stock,
+/// changes and overflow.
+void check_engines(const Factory& factory,
+                   std::size_t ticks_to_simulate,
+                   std::optional<std::uint64_t> seed,
+                   std::string_view what) {
+    using Engine = sim::Simulation::Engine;
+    sim::Simulation compiled(factory.items, factory.machines, std::pmr::get_default_resource(),
+                             Engine::Compiled);
+    sim::Simulation reference(factory.items, factory.machines, std::pmr::get_default_resource(),
+                              Engine::Reference);
+    if (seed) {
+        compiled.randomize(*seed);
+        reference.randomize(*seed);
+    }
+
+    while (compiled.tick() < ticks_to_simulate) {
+        const auto tick = compiled.tick();
+        const bool is_compiled_running = compiled.step();
+        const bool is_reference_running = reference.step();
+        if (!test::check(is_compiled_running == is_reference_running,
+                         fmt::format("{}: both engines overflow at tick {}", what, tick)) ||
+            !test::check(std::ranges::equal(compiled.stock(), reference.stock()),
+                         fmt::format("{}: both engines have the same stock at tick {}", what,
+                                     tick)) ||
+            !test::check(std::ranges::equal(compiled.changes(), reference.changes(),
+                                            [](const auto& a, const auto& b) {
+                                                return a.item == b.item &&
+                                                       a.modifier == b.modifier;
+                                            }),
+                         fmt::format("{}: both engines make the same changes at tick {}", what,
+                                     tick))) {
+            return;
+        }
+        if (!is_compiled_running) {
+            test::check(compiled.overflow()->item == reference.overflow()->item &&
+                            compiled.overflow()->tick == reference.overflow()->tick,
+                        fmt::format("{}: both engines overflow the same item", what));
+            return;
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    // The factory that new files start with
+    if (!test::check(argc > 1, "the starting program is given")) {
+        return test::exit_code();
+    }
+    const auto starting = io::load_factory_file(argv[1]);
+    if (test::check(starting.has_value() && !starting->factory.machines.empty(),
+                    fmt::format("{} loads", argv[1]))) {
+        check_engines(starting->factory, 20'000, std::nullopt, "starting factory");
+        check_engines(starting->factory, 20'000, 1, "randomized starting factory");
+    }
+
+    for (std::uint32_t seed = 0; seed < 100; seed++) {
+        const auto factory = test::random_factory(seed, seed % 7 == 0);
+        check_engines(factory, 2000, std::nullopt, fmt::format("factory {}", seed));
+        check_engines(factory, 2000, seed, fmt::format("randomized factory {}", seed));
+    }
+
+    return test::exit_code();
+}
\ No newline at end of file
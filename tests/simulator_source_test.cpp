@@ -0,0 +1,95 @@
+#include <cstdlib>
+#include <filesystem>
+#include <fmt/core.h>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "check.hpp"
+#include "io/plot_export.hpp"
+#include "io/simulator_source.hpp"
+#include "random_factory.hpp"
+
+using namespace fmk;
+
+namespace {
+
+/// Names that need quoting or escaping, in CSV headers and in the generated source.
+constexpr const char* item_names[] = {"Iron", "a,b", "q\"uote", "back\\slash", "new\nline",
+                                      "tab\there", "ü"};
+
+std::string read_file(const std::filesystem::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+}
+
+int run(const std::string& command) {
+    std::cout << command << std::endl;
+    return std::system(command.c_str());
+}
+
+/// Compiles the simulator of a factory and checks that it writes the same CSV file as exporting
+/// the plots of its simulation.
+void check_simulator(const std::string& compiler,
+                     const std::filesystem::path& directory,
+                     std::uint32_t seed) {
+    auto factory = test::random_factory(seed, seed % 2 == 0);
+    std::size_t name_i = 0;
+    for (auto& [item_uid, item] : factory.items) {
+        item.name = fmt::format("{} {}", item_names[name_i % std::size(item_names)], name_i);
+        name_i++;
+    }
+    const std::size_t ticks_to_simulate = 1000 + seed * 100;
+
+    const auto stem = directory / fmt::format("simulator_{}", seed);
+    auto source = stem;
+    source += ".cpp";
+    {
+        std::ofstream out(source, std::ios::binary);
+        io::write_simulator_source(out, factory, ticks_to_simulate);
+    }
+    if (!test::check(run(fmt::format("\"{}\" -std=c++17 -O1 -o \"{}\" \"{}\"", compiler,
+                                     stem.string(), source.string())) == 0,
+                     fmt::format("factory {}: the simulator compiles", seed))) {
+        return;
+    }
+
+    std::vector<Uid> items;
+    for (const auto& [item_uid, item] : factory.items) {
+        items.emplace_back(item_uid);
+    }
+    // Simulators take the ticks to simulate of the factory unless given another count
+    for (const auto ticks : {ticks_to_simulate, ticks_to_simulate / 3 + 1}) {
+        auto csv = stem;
+        csv += fmt::format("_{}.csv", ticks);
+        const auto tick_argument = ticks == ticks_to_simulate ? "" : fmt::format(" {}", ticks);
+        if (!test::check(run(fmt::format("\"{}\" \"{}\"{}", stem.string(), csv.string(),
+                                         tick_argument)) == 0,
+                         fmt::format("factory {}: the simulator runs {} ticks", seed, ticks))) {
+            continue;
+        }
+
+        const auto cache = factory.generate_cache(ticks);
+        std::ostringstream expected;
+        io::export_plots_csv(expected, factory, cache, items);
+        test::check(read_file(csv) == expected.str(),
+                    fmt::format("factory {}: the simulator writes the plots of {} ticks", seed,
+                                ticks));
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    // The compiler to build simulators with, and where to write them and their results
+    if (!test::check(argc > 2, "the compiler and directory are given")) {
+        return test::exit_code();
+    }
+    for (std::uint32_t seed = 0; seed < 6; seed++) {
+        check_simulator(argv[1], argv[2], seed);
+    }
+    return test::exit_code();
+}
\ No newline at end of file
@@ -0,0 +1,121 @@
+#include <algorithm>
+#include <fmt/core.h>
+#include <optional>
+#include <random>
+#include <vector>
+
+#include "check.hpp"
+#include "random_factory.hpp"
+#include "sim/simulation.hpp"
+
+using namespace fmk;
+
+namespace {
+
+constexpr std::size_t ticks_to_simulate = 2000;
+
+/// A threshold that an item doesn't meet at the start but meets at a random tick of its plot, so
+/// that the first tick its plot meets it is the tick the condition is met.
+std::optional<sim::StopCondition> random_condition(Uid item_uid,
+                                                   Quantity starting_quantity,
+                                                   std::span<const Quantity> values,
+                                                   std::mt19937& rng) {
+    const auto threshold = values[rng() % (values.size() - 1)];
+    if (threshold == starting_quantity) {
+        return std::nullopt;
+    }
+    return threshold > starting_quantity ? sim::StopCondition::reaches(item_uid, threshold)
+                                         : sim::StopCondition::drops_to(item_uid, threshold);
+}
+
+/// Item conditions on random factories, against the first tick their plots meet them.
+void check_factory(std::uint32_t seed) {
+    const auto factory = test::random_factory(seed);
+    const auto cache = factory.generate_cache(ticks_to_simulate);
+    if (cache.overflow()) {
+        return;
+    }
+
+    std::mt19937 rng(seed);
+    std::vector<sim::StopCondition> conditions;
+    std::optional<sim::StopResult> expected;
+    for (int attempt = 0; attempt < 10 && conditions.size() < 3; attempt++) {
+        const auto& [item_uid, item] = factory.items.begin()[rng() % factory.items.size()];
+        const auto plot = cache.make_plot(item_uid);
+        const auto values = plot.values();
+        const auto condition = random_condition(item_uid, item.starting_quantity, values, rng);
+        if (!condition) {
+            continue;
+        }
+
+        const auto is_met = [&](Quantity stock) {
+            return condition->type == sim::StopCondition::Type::Reaches
+                       ? stock >= condition->threshold
+                       : stock <= condition->threshold;
+        };
+        const auto tick = static_cast<std::size_t>(
+            std::find_if(values.begin(), values.end(), is_met) - values.begin());
+        // Conditions met at the same tick as an earlier one lose to it
+        if (!expected || tick < expected->tick) {
+            expected = sim::StopResult{conditions.size(), tick, item_uid};
+        }
+        conditions.push_back(*condition);
+    }
+    if (!expected) {
+        return;
+    }
+
+    const auto found = sim::find_stop(factory, conditions, ticks_to_simulate);
+    test::check(found && found->condition == expected->condition &&
+                    found->tick == expected->tick && found->item == expected->item,
+                fmt::format("factory {}: the query stops at tick {}, not {}", seed,
+                            expected->tick, found ? found->tick : 0));
+
+    const auto stopped = factory.generate_cache(ticks_to_simulate, nullptr, conditions);
+    const auto& stop = stopped.stop();
+    if (!test::check(stop && stop->tick == expected->tick &&
+                         stopped.ticks_simulated() == expected->tick + 1,
+                     fmt::format("factory {}: the simulation stops at tick {}", seed,
+                                 expected->tick))) {
+        return;
+    }
+    std::size_t mismatches = 0;
+    for (const auto& [item_uid, item] : factory.items) {
+        const auto full = cache.make_plot(item_uid);
+        const auto partial = stopped.make_plot(item_uid);
+        // The last value of a plot is its quantity after the last tick simulated
+        const auto ticks = stopped.ticks_simulated();
+        mismatches += !std::ranges::equal(partial.values().first(ticks),
+                                          full.values().first(ticks));
+    }
+    test::check(mismatches == 0,
+                fmt::format("factory {}: {} plots differ from the full simulation", seed,
+                            mismatches));
+}
+
+} // namespace
+
+int main() {
+    for (std::uint32_t seed = 0; seed < 100; seed++) {
+        check_factory(seed);
+    }
+
+    // A machine that makes an item every 10 ticks repeats itself every 10 ticks
+    Factory factory;
+    factory.items[Uid(1)] = Item{Item::NodeType::Output, 0, "Gear", Uid(2)};
+    factory.machines[Uid(3)] = Machine{"Press", {}, {{Uid(1), 1, Uid(4)}}, util::ticks(10)};
+    const std::vector<sim::StopCondition> steady{sim::StopCondition::steady_state(20)};
+    const auto found = sim::find_stop(factory, steady, ticks_to_simulate);
+    test::check(found && found->condition == 0 && found->item == Uid(Uid::INVALID_VALUE) &&
+                    found->tick + 1 >= 2 * 20 && found->tick < 100,
+                "steady states are found after two windows");
+    // Items that never change don't meet conditions they started out meeting
+    factory.items[Uid(5)] = Item{Item::NodeType::Input, 10, "Spare plate", Uid(6)};
+    factory.items[Uid(7)] = Item{Item::NodeType::Internal, 0, "Empty buffer"};
+    const std::vector<sim::StopCondition> never{sim::StopCondition::drops_to(Uid(5), 20),
+                                                sim::StopCondition::any_buffer_drops_to(0)};
+    test::check(!sim::find_stop(factory, never, ticks_to_simulate),
+                "conditions are only met when stock changes");
+
+    return test::exit_code();
+}
\ No newline at end of file
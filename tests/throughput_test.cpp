@@ -0,0 +1,131 @@
+#include <fmt/core.h>
+#include <random>
+#include <sstream>
+#include <type_traits>
+#include <vector>
+
+#include "check.hpp"
+#include "io/plot_export.hpp"
+#include "random_factory.hpp"
+#include "sim/simulation.hpp"
+#include "sim/throughput.hpp"
+#include "util/background_job.hpp"
+
+using namespace fmk;
+
+namespace {
+
+/// Sums wrap around like the quantities of the series.
+using TotalT = std::make_unsigned_t<Quantity>;
+
+constexpr std::size_t ticks_to_simulate = 2000;
+
+/// Checks the series of random items of a factory against the changes of every tick of its
+/// simulation, added up again for every window, and against the plots of its cache.
+void check_factory(std::uint32_t seed) {
+    const auto factory = test::random_factory(seed, seed % 7 == 0);
+    const auto cache = factory.generate_cache(ticks_to_simulate);
+
+    // What every item produced and consumed during every tick
+    const auto item_count = factory.items.size();
+    std::vector<std::vector<TotalT>> produced(item_count,
+                                              std::vector<TotalT>(ticks_to_simulate + 1));
+    std::vector<std::vector<TotalT>> consumed = produced;
+    sim::Simulation simulation(factory.items, factory.machines);
+    while (simulation.tick() < cache.ticks_simulated()) {
+        const auto tick = simulation.tick();
+        const bool is_running = simulation.step();
+        for (const auto& change : simulation.changes()) {
+            if (change.modifier > 0) {
+                produced[change.item][tick] += static_cast<TotalT>(change.modifier);
+            } else {
+                consumed[change.item][tick] -= static_cast<TotalT>(change.modifier);
+            }
+        }
+        if (!is_running) {
+            break;
+        }
+    }
+
+    std::mt19937 rng(seed);
+    const std::size_t window = 1 + rng() % 400;
+    std::vector<Uid> items;
+    for (const auto& [item_uid, item] : factory.items) {
+        if (rng() % 3 > 0) {
+            items.emplace_back(item_uid);
+        }
+    }
+    const auto series = sim::simulate_throughput(factory, cache.ticks_simulated(), items, window);
+    if (!test::check(series.size() == items.size(),
+                     fmt::format("factory {}: every item has a series", seed))) {
+        return;
+    }
+
+    const auto ticks = cache.ticks_simulated();
+    for (std::size_t series_i = 0; series_i < series.size(); series_i++) {
+        const auto& item_series = series[series_i];
+        const auto item_uid = items[series_i];
+        const auto item_i = static_cast<std::size_t>(factory.items.find(item_uid) -
+                                                     factory.items.begin());
+        const auto plot = cache.make_plot(item_uid);
+        const auto stock = plot.values();
+        if (!test::check(item_series.item == item_uid && item_series.window == window &&
+                             stock.size() == ticks + 1 &&
+                             item_series.produced.size() == ticks + 1 &&
+                             item_series.consumed.size() == ticks + 1 &&
+                             item_series.net.size() == ticks + 1,
+                         fmt::format("factory {}: item {} has a value for every tick", seed,
+                                     item_uid.value))) {
+            continue;
+        }
+
+        std::size_t mismatches = 0;
+        const auto starting_quantity = factory.items.at(item_uid).starting_quantity;
+        for (std::size_t tick = 0; tick <= ticks; tick++) {
+            TotalT window_produced = 0;
+            TotalT window_consumed = 0;
+            for (auto window_tick = tick + 1 - item_series.window_ticks(tick);
+                 window_tick <= tick; window_tick++) {
+                window_produced += produced[item_i][window_tick];
+                window_consumed += consumed[item_i][window_tick];
+            }
+            const auto stock_before =
+                tick >= window ? stock[tick - window] : starting_quantity;
+            const auto stock_change = static_cast<Quantity>(static_cast<TotalT>(stock[tick]) -
+                                                            static_cast<TotalT>(stock_before));
+            mismatches += item_series.produced[tick] != static_cast<Quantity>(window_produced) ||
+                          item_series.consumed[tick] != static_cast<Quantity>(window_consumed) ||
+                          item_series.net[tick] != stock_change;
+        }
+        test::check(mismatches == 0,
+                    fmt::format("factory {}: {} windows of item {} differ from a scan of them",
+                                seed, mismatches, item_uid.value));
+    }
+}
+
+} // namespace
+
+int main() {
+    for (std::uint32_t seed = 0; seed < 60; seed++) {
+        check_factory(seed);
+    }
+
+    // Cancelling gives no series rather than partial ones
+    const auto factory = test::random_factory(1);
+    std::vector<Uid> items;
+    for (const auto& [item_uid, item] : factory.items) {
+        items.emplace_back(item_uid);
+    }
+    util::JobProgress progress;
+    progress.cancel();
+    test::check(sim::simulate_throughput(factory, ticks_to_simulate, items, 20, &progress).empty(),
+                "a cancelled simulation has no series");
+    std::ostringstream out;
+    io::PlotExportOptions options;
+    options.throughput_window = 20;
+    test::check(!io::export_plots_csv(out, factory, factory.generate_cache(ticks_to_simulate),
+                                      items, options, &progress),
+                "cancelling the throughput simulation of an export stops it");
+
+    return test::exit_code();
+}
\ No newline at end of file
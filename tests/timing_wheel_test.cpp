@@ -0,0 +1,69 @@
+#include <algorithm>
+#include <fmt/core.h>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "check.hpp"
+#include "util/timing_wheel.hpp"
+
+using namespace fmk;
+
+namespace {
+
+/// Schedules values at random distances, some of them in the higher levels of the wheel, while
+/// moving the clock forward by random steps, and checks every value comes back at its tick in the
+/// order it was scheduled.
+void check_random_schedules(std::uint32_t seed) {
+    std::mt19937 rng(seed);
+    util::TimingWheel<int> wheel;
+    // The tick and value of everything scheduled, and of everything handed back
+    std::vector<std::pair<std::size_t, int>> scheduled;
+    std::vector<std::pair<std::size_t, int>> due;
+    const auto on_due = [&](int value) { due.emplace_back(wheel.now(), value); };
+
+    int next_value = 0;
+    for (int step = 0; step < 2000; step++) {
+        for (auto count = rng() % 4; count > 0; count--) {
+            const std::size_t max_distance = rng() % 10 == 0 ? 1 << 21
+                                             : rng() % 3 == 0 ? 1 << 16
+                                                               : 300;
+            const auto tick = wheel.now() + 1 + rng() % max_distance;
+            wheel.schedule(tick, next_value);
+            scheduled.emplace_back(tick, next_value++);
+        }
+        wheel.advance_to(wheel.now() + rng() % 600, on_due);
+    }
+    std::size_t last_tick = 0;
+    for (const auto& [tick, value] : scheduled) {
+        last_tick = std::max(last_tick, tick);
+    }
+    wheel.advance_to(last_tick, on_due);
+
+    // Values are scheduled in increasing order, so sorting by tick keeps them in that order
+    std::ranges::stable_sort(scheduled, {}, [](const auto& entry) { return entry.first; });
+    test::check(due == scheduled,
+                fmt::format("seed {}: values are handed back at their tick, in order", seed));
+}
+
+} // namespace
+
+int main() {
+    for (std::uint32_t seed = 0; seed < 10; seed++) {
+        check_random_schedules(seed);
+    }
+
+    // Values scheduled right before a level boundary, and right after it
+    util::TimingWheel<int> wheel;
+    std::vector<int> due;
+    for (const std::size_t tick : {255, 256, 257, 65535, 65536, 65537}) {
+        wheel.schedule(tick, static_cast<int>(tick));
+    }
+    wheel.advance_to(65536, [&](int value) { due.push_back(value); });
+    test::check(due == std::vector<int>{255, 256, 257, 65535, 65536},
+                "values around level boundaries are due in order");
+    wheel.advance_to(65537, [&](int value) { due.push_back(value); });
+    test::check(due.back() == 65537 && due.size() == 6, "the clock stops at the tick given");
+
+    return test::exit_code();
+}
\ No newline at end of file
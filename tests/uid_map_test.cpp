@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <fmt/core.h>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "check.hpp"
+#include "util/uid_map.hpp"
+
+using namespace fmk;
+
+namespace {
+
+using Entries = std::vector<std::pair<Uid, int>>;
+
+/// Checks the map against the entries it should have, in order, and every UID that was ever in it.
+void check_map(const util::UidMap<int>& map,
+               const Entries& expected,
+               const std::vector<Uid>& uids,
+               std::string_view what) {
+    test::check(std::ranges::equal(map, expected,
+                                   [](const auto& a, const auto& b) {
+                                       return a.first == b.first && a.second == b.second;
+                                   }),
+                fmt::format("{}: the entries are kept in insertion order", what));
+
+    std::size_t misses = 0;
+    for (const auto uid : uids) {
+        const auto entry = std::find_if(expected.begin(), expected.end(),
+                                        [&](const auto& entry) { return entry.first == uid; });
+        const auto found = map.find(uid);
+        if (entry == expected.end()) {
+            misses += found != map.end() || map.contains(uid);
+        } else {
+            misses += found == map.end() || found - map.begin() != entry - expected.begin() ||
+                      found->second != entry->second;
+        }
+    }
+    test::check(misses == 0, fmt::format("{}: {} lookups are wrong", what, misses));
+}
+
+/// Inserts and erases random UIDs, reinserting erased ones. With a `stride`, UIDs share their low
+/// bits so that they collide in the index and erasing has to move the others back.
+void check_random_operations(std::uint32_t seed, Uid::ValueT stride) {
+    std::mt19937 rng(seed);
+    util::UidMap<int> map;
+    Entries expected;
+    std::vector<Uid> uids;
+    for (Uid::ValueT uid_i = 0; uid_i < 300; uid_i++) {
+        uids.emplace_back(uid_i * stride + 1);
+    }
+
+    for (int operation = 0; operation < 3000; operation++) {
+        const auto uid = uids[rng() % uids.size()];
+        const auto entry = std::find_if(expected.begin(), expected.end(),
+                                        [&](const auto& entry) { return entry.first == uid; });
+        if (rng() % 3 > 0) {
+            const auto [it, inserted] = map.try_emplace(uid, operation);
+            test::check(inserted == (entry == expected.end()) && it->first == uid,
+                        fmt::format("seed {}: inserting {}", seed, uid.value));
+            if (inserted) {
+                expected.emplace_back(uid, operation);
+            }
+        } else if (rng() % 2 == 0) {
+            test::check(map.erase(uid) == (entry != expected.end() ? 1 : 0),
+                        fmt::format("seed {}: erasing {}", seed, uid.value));
+            if (entry != expected.end()) {
+                expected.erase(entry);
+            }
+        } else if (entry != expected.end()) {
+            const auto position = entry - expected.begin();
+            const auto next = map.erase(map.find(uid));
+            test::check(next - map.begin() == position,
+                        fmt::format("seed {}: erasing {} gives the entry after it", seed,
+                                    uid.value));
+            expected.erase(entry);
+        }
+
+        if (operation % 100 == 0) {
+            check_map(map, expected, uids, fmt::format("seed {} after {}", seed, operation));
+        }
+    }
+    check_map(map, expected, uids, fmt::format("seed {}", seed));
+
+    // Erasing everything leaves an empty map that takes the same UIDs again
+    while (!map.empty()) {
+        map.erase(map.begin() + static_cast<std::ptrdiff_t>(rng() % map.size()));
+    }
+    check_map(map, {}, uids, fmt::format("seed {}: emptied", seed));
+    Entries reinserted;
+    for (const auto uid : uids) {
+        map[uid] = static_cast<int>(uid.value);
+        reinserted.emplace_back(uid, static_cast<int>(uid.value));
+    }
+    check_map(map, reinserted, uids, fmt::format("seed {}: reinserted", seed));
+}
+
+} // namespace
+
+int main() {
+    for (std::uint32_t seed = 0; seed < 10; seed++) {
+        check_random_operations(seed, 1);
+        check_random_operations(seed, 1024);
+        check_random_operations(seed, 1 + seed * 37);
+    }
+    return test::exit_code();
+}
\ No newline at end of file
@@ -0,0 +1,123 @@
+#include <algorithm>
+#include <filesystem>
+#include <fmt/core.h>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <vector>
+
+#include "check.hpp"
+#include "io/binary_format.hpp"
+#include "io/json_format.hpp"
+#include "random_factory.hpp"
+
+using namespace fmk;
+
+namespace {
+
+void check_recycling() {
+    UidPool uid_pool(Uid(100));
+    std::vector<Uid> uids;
+    for (int uid_i = 0; uid_i < 10; uid_i++) {
+        uids.push_back(uid_pool.generate());
+    }
+    const auto available = uid_pool.available();
+
+    const std::vector<Uid> released{uids[2], uids[7], uids[4]};
+    for (const auto uid : released) {
+        uid_pool.release(uid);
+    }
+    uid_pool.release(Uid(Uid::INVALID_VALUE));
+    test::check(uid_pool.available() == available + released.size(),
+                "released UIDs are available again, but not the invalid one");
+
+    std::vector<Uid> recycled;
+    for (std::size_t uid_i = 0; uid_i < released.size(); uid_i++) {
+        recycled.push_back(uid_pool.generate());
+    }
+    test::check(std::ranges::is_permutation(recycled, released),
+                "released UIDs are generated before new ones");
+    test::check(uid_pool.generate() == Uid(110) && uid_pool.get_next_uid() == Uid(111),
+                "new UIDs continue after the ones generated before");
+    test::check(uid_pool.available() == available - 1, "recycled UIDs are counted out again");
+}
+
+/// Checks that a factory read back has the item and machine UIDs of the one written, and with
+/// `has_stream_uids`, its stream and attribute UIDs as well.
+void check_same_uids(const Factory& expected,
+                     const Factory& actual,
+                     bool has_stream_uids,
+                     std::string_view what) {
+    const auto has_uid = [](const auto& map) {
+        return [&map](const auto& entry) { return map.contains(entry.first); };
+    };
+    test::check(actual.items.size() == expected.items.size() &&
+                    std::ranges::all_of(expected.items, has_uid(actual.items)),
+                fmt::format("{}: same item UIDs", what));
+    test::check(actual.machines.size() == expected.machines.size() &&
+                    std::ranges::all_of(expected.machines, has_uid(actual.machines)),
+                fmt::format("{}: same machine UIDs", what));
+    if (!has_stream_uids || actual.items.size() != expected.items.size() ||
+        actual.machines.size() != expected.machines.size()) {
+        return;
+    }
+
+    std::size_t mismatches = 0;
+    for (const auto& [item_uid, item] : expected.items) {
+        mismatches += actual.items.at(item_uid).attribute_uid != item.attribute_uid;
+    }
+    for (const auto& [machine_uid, machine] : expected.machines) {
+        const auto& actual_machine = actual.machines.at(machine_uid);
+        const auto same_stream = [](const ItemStream& a, const ItemStream& b) {
+            return a.uid == b.uid && a.item == b.item;
+        };
+        mismatches += !std::ranges::equal(machine.inputs, actual_machine.inputs, same_stream) ||
+                      !std::ranges::equal(machine.outputs, actual_machine.outputs, same_stream);
+    }
+    test::check(mismatches == 0, fmt::format("{}: {} stream and attribute UIDs differ", what,
+                                             mismatches));
+}
+
+/// UIDs that don't fit in 32 bits, including two that only differ above them, survive both file
+/// formats.
+void check_wide_uids(const std::filesystem::path& directory) {
+    // Compacted UIDs start from the lowest 64-bit one
+    auto factory = test::random_factory(3);
+    UidPool uid_pool(Uid(1));
+    compact_uids(factory, uid_pool);
+    const auto first_item = factory.items.begin()->first;
+    test::check(first_item.value < std::numeric_limits<std::int32_t>::min(),
+                "compacted UIDs are outside 32 bits");
+    const Uid alias(first_item.value + (Uid::ValueT(1) << 32));
+    factory.items[alias] = Item{Item::NodeType::Internal, 0, "Alias", Uid(Uid::INVALID_VALUE)};
+    test::check(factory.items.contains(first_item) && factory.items.at(alias).name == "Alias",
+                "UIDs that only differ above 32 bits are different keys");
+
+    std::stringstream json;
+    io::write_factory_json(json, factory, uid_pool, {}, 1000);
+    const auto from_json = io::parse_factory_json(json);
+    if (test::check(from_json.has_value(), "JSON with wide UIDs is parsed")) {
+        check_same_uids(factory, from_json->factory, false, "JSON");
+    }
+
+    const auto path = directory / "uid_test.fmkb";
+    {
+        std::ofstream file(path, std::ios::binary);
+        io::write_factory_binary(file, factory, uid_pool, {}, 1000);
+    }
+    const auto from_binary = io::read_factory_binary(path);
+    if (test::check(from_binary.has_value(), "a binary file with wide UIDs is read")) {
+        check_same_uids(factory, from_binary->factory, true, "binary");
+        test::check(from_binary->uid_pool.get_next_uid() == uid_pool.get_next_uid(),
+                    "binary: same next UID");
+    }
+    std::filesystem::remove(path);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    check_recycling();
+    check_wide_uids(argc > 1 ? argv[1] : ".");
+    return test::exit_code();
+}
\ No newline at end of file